@@ -129,6 +129,7 @@ std::uint64_t write_vector_uint(Writer* writer, const std::vector<T>& v) {
 template <typename T>
 std::uint64_t read_vector_uint(Reader* reader, const std::size_t size, std::vector<T>* v) {
   std::uint64_t rbits = 0;
+  reader->checkEntryCount(size, sizeof(T));
   v->resize(size);
   for (std::size_t i = 0; i < size; ++i) {
     rbits += read_uint<T>(reader, &((*v)[i]));
@@ -22,6 +22,12 @@ class Reader {
 
   std::istream& getIStream() const;
 
+  // istream の残りのバイト数
+  std::uint64_t getRemainingSize();
+  // count 個の要素がそれぞれ min_entry_size バイト以上として, 残りのデータに収まるかを確認する
+  // 不正なファイルの entry_count で巨大な領域を確保しないように, 要素を確保する前に呼び出す
+  void checkEntryCount(const std::uint64_t count, const std::uint64_t min_entry_size);
+
  private:
   std::istream& m_is;
   std::uint8_t m_octet = 0x00;
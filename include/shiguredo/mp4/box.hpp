@@ -1,10 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <compare>  // NOLINT
+#include <cstddef>
 #include <cstdint>
 #include <istream>
+#include <iterator>
 #include <string>
+#include <vector>
 
 #include "shiguredo/mp4/box_type.hpp"
 
@@ -31,6 +35,9 @@ class Box {
   virtual void removeFlag(std::uint32_t);
   BoxType getType() const;
   virtual std::string toStringOnlyData() const = 0;
+  // 配列の要素を max_entries 個までにして残りを "... N more" と省略した toStringOnlyData(). 0 の場合は省略しない
+  // 要素の数がサンプル数やデータの大きさに比例する Box が override し, 既定では toStringOnlyData() を返す
+  virtual std::string toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const;
   std::string toString() const;
   std::uint64_t write(std::ostream&);
   virtual std::uint64_t writeData(std::ostream&) const = 0;
@@ -38,6 +45,7 @@ class Box {
   std::uint64_t getHeaderSize();
   virtual std::uint64_t getDataSize() const;
   std::uint64_t getSize() const;
+  std::uint64_t getOffset() const;
 
   void setHeader(BoxHeader*);
   void seekToData(std::istream& is);
@@ -83,4 +91,23 @@ class AnyTypeBox : public Box {
   auto operator<=>(const AnyTypeBox&) const = default;
 };
 
+// entries の先頭から max_entries 個を format で文字列にして ", " で連結し, 残りは "... N more" にまとめる
+// max_entries が 0 の場合は全ての要素を連結する
+template <class T, class F>
+std::string join_entries(const std::vector<T>& entries, const std::size_t max_entries, F format) {
+  const auto size = std::size(entries);
+  const auto n = max_entries == 0 ? size : std::min(size, max_entries);
+  std::string s;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (i > 0) {
+      s += ", ";
+    }
+    s += format(entries[i]);
+  }
+  if (n < size) {
+    s += (n == 0 ? "... " : ", ... ") + std::to_string(size - n) + " more";
+  }
+  return s;
+}
+
 }  // namespace shiguredo::mp4
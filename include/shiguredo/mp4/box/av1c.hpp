@@ -27,7 +27,9 @@ struct AV1CodecConfigurationParameters {
   const std::vector<std::uint8_t> config_OBUs = {};
 };
 
-BoxType box_type_av1c();
+constexpr BoxType box_type_av1c() {
+  return BoxType("av1C");
+}
 
 class AV1CodecConfiguration : public Box {
  public:
@@ -52,12 +52,15 @@ class AVCParameterSet {
   std::uint64_t writeData(bitio::Writer*) const;
   std::uint64_t getSize() const;
   std::uint64_t readData(bitio::Reader*);
+  const std::vector<std::uint8_t>& getNalUnit() const;
 
  private:
   std::vector<std::uint8_t> m_nal_unit;
 };
 
-BoxType box_type_avcc();
+constexpr BoxType box_type_avcc() {
+  return BoxType("avcC");
+}
 
 struct AVCDecoderConfigurationParameters {
   const std::uint8_t configuration_version;
@@ -15,7 +15,9 @@ struct BtrtParameters {
   const std::uint32_t avg_bitrate;
 };
 
-BoxType box_type_btrt();
+constexpr BoxType box_type_btrt() {
+  return BoxType("btrt");
+}
 
 class Btrt : public Box {
  public:
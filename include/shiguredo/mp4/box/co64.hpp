@@ -1,6 +1,7 @@
 #pragma once
 
 #include <compare>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -17,7 +18,9 @@ struct Co64Parameters {
   const std::vector<std::uint64_t> chunk_offsets;
 };
 
-BoxType box_type_co64();
+constexpr BoxType box_type_co64() {
+  return BoxType("co64");
+}
 
 class Co64 : public FullBox {
  public:
@@ -25,6 +28,7 @@ class Co64 : public FullBox {
   explicit Co64(const Co64Parameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream& os) const override;
   std::uint64_t readData(std::istream& is) override;
@@ -32,6 +36,9 @@ class Co64 : public FullBox {
 
   auto operator<=>(const Co64&) const = default;
 
+  const std::vector<std::uint64_t>& getChunkOffsets() const;
+  void addChunkOffset(const std::uint64_t);
+
  private:
   std::vector<std::uint64_t> m_chunk_offsets;
 };
@@ -28,7 +28,9 @@ struct ColrParameters {
   const std::vector<std::uint8_t> unknown = {};
 };
 
-BoxType box_type_colr();
+constexpr BoxType box_type_colr() {
+  return BoxType("colr");
+}
 
 class Colr : public Box {
  public:
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -17,7 +18,9 @@ class Writer;
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_ctts();
+constexpr BoxType box_type_ctts() {
+  return BoxType("ctts");
+}
 
 class CttsEntry {
  public:
@@ -28,6 +31,9 @@ class CttsEntry {
   std::uint64_t writeData(bitio::Writer*) const;
   std::uint64_t readData(bitio::Reader*);
 
+  std::uint32_t getSampleCount() const;
+  std::int64_t getSampleOffset() const;
+
  private:
   std::uint32_t m_sample_count;
   std::int64_t m_sample_offset;  // size = 32
@@ -45,11 +51,14 @@ class Ctts : public FullBox {
   explicit Ctts(const CttsParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream& os) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream& is) override;
 
+  const std::vector<CttsEntry>& getEntries() const;
+
  private:
   std::vector<CttsEntry> m_entries;
 };
@@ -41,7 +41,9 @@ class DOpsChannelMappingTable {
   std::vector<std::uint8_t> m_channel_mapping = {};
 };
 
-BoxType box_type_dOps();
+constexpr BoxType box_type_dOps() {
+  return BoxType("dOps");
+}
 
 struct DOpsParameters {
   const std::uint8_t version = 0;
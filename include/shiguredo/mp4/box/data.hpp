@@ -52,7 +52,9 @@ struct DataParameters {
   const std::vector<std::uint8_t> data;
 };
 
-BoxType box_type_data();
+constexpr BoxType box_type_data() {
+  return BoxType("data");
+}
 
 class Data : public Box {
  public:
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_dinf();
+constexpr BoxType box_type_dinf() {
+  return BoxType("dinf");
+}
 
 class Dinf : public Box {
  public:
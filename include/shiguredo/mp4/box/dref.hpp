@@ -15,7 +15,9 @@ struct DrefParameters {
   const std::uint32_t entry_count;
 };
 
-BoxType box_type_dref();
+constexpr BoxType box_type_dref() {
+  return BoxType("dref");
+}
 
 class Dref : public FullBox {
  public:
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_edts();
+constexpr BoxType box_type_edts() {
+  return BoxType("edts");
+}
 
 class Edts : public Box {
  public:
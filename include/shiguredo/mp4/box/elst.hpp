@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -40,7 +41,9 @@ class ElstEntry {
   std::int32_t m_media_rate;
 };
 
-BoxType box_type_elst();
+constexpr BoxType box_type_elst() {
+  return BoxType("elst");
+}
 
 struct ElstParameters {
   const std::uint8_t version = 0;
@@ -54,11 +57,16 @@ class Elst : public FullBox {
   explicit Elst(const ElstParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream& os) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream& is) override;
 
+  // トラック全体の長さを track_duration にする. 最後の空でない edit の長さのみを変更し, 空の edit (media_time == -1) は変更しない
+  void setTrackDuration(const std::uint64_t);
+  const std::vector<ElstEntry>& getEntries() const;
+
  private:
   std::vector<ElstEntry> m_entries;
 };
@@ -22,7 +22,9 @@ struct EmsgParameters {
   const std::vector<std::uint8_t> message_data;
 };
 
-BoxType box_type_emsg();
+constexpr BoxType box_type_emsg() {
+  return BoxType("emsg");
+}
 
 class Emsg : public FullBox {
  public:
@@ -152,7 +152,9 @@ class SLConfigDescr : public Descriptor {
   std::vector<std::uint8_t> m_data;
 };
 
-BoxType box_type_esds();
+constexpr BoxType box_type_esds() {
+  return BoxType("esds");
+}
 
 struct EsdsParameters {
   const std::vector<std::shared_ptr<Descriptor>> descriptors;
@@ -14,7 +14,9 @@ struct FielParameters {
   const std::uint8_t field_ordering = 0;
 };
 
-BoxType box_type_fiel();
+constexpr BoxType box_type_fiel() {
+  return BoxType("fiel");
+}
 
 class Fiel : public Box {
  public:
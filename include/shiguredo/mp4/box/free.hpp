@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -14,7 +15,9 @@ struct FreeParameters {
   const std::vector<std::uint8_t> data;
 };
 
-BoxType box_type_free();
+constexpr BoxType box_type_free() {
+  return BoxType("free");
+}
 
 class Free : public Box {
  public:
@@ -22,11 +25,15 @@ class Free : public Box {
   explicit Free(const FreeParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream& os) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream& is) override;
 
+  // data の大きさを size にする. 増えた部分は 0 で埋め, 確保済みの領域は解放しない
+  void setDataSize(const std::size_t);
+
  private:
   std::vector<std::uint8_t> m_data;
 };
@@ -11,7 +11,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_ftyp();
+constexpr BoxType box_type_ftyp() {
+  return BoxType("ftyp");
+}
 
 struct FtypParameters {
   const Brand major_brand;
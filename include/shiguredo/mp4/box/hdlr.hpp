@@ -20,7 +20,9 @@ struct HdlrParameters {
   const std::vector<std::uint8_t> padding = {};
 };
 
-BoxType box_type_hdlr();
+constexpr BoxType box_type_hdlr() {
+  return BoxType("hdlr");
+}
 
 class Hdlr : public FullBox {
  public:
@@ -33,6 +35,8 @@ class Hdlr : public FullBox {
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream& is) override;
 
+  std::string getHandlerType() const;
+
  private:
   std::uint32_t m_pre_defined = 0;
   std::array<std::uint8_t, 4> m_handler_type;
@@ -23,7 +23,9 @@ class IlstMeta : public AnyTypeBox {
   std::uint64_t readData(std::istream&) override;
 };
 
-BoxType box_type_ilst();
+constexpr BoxType box_type_ilst() {
+  return BoxType("ilst");
+}
 
 class Ilst : public Box {
  public:
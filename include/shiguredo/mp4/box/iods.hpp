@@ -22,7 +22,9 @@ struct IodsParameters {
   const std::uint8_t graphics_profile_level;
 };
 
-BoxType box_type_iods();
+constexpr BoxType box_type_iods() {
+  return BoxType("iods");
+}
 
 class Iods : public FullBox {
  public:
@@ -14,7 +14,9 @@ struct MdatParameters {
   const std::vector<std::uint8_t> data;
 };
 
-BoxType box_type_mdat();
+constexpr BoxType box_type_mdat() {
+  return BoxType("mdat");
+}
 
 class Mdat : public Box {
  public:
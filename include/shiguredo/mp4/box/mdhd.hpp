@@ -22,7 +22,9 @@ struct MdhdParameters {
   const std::uint16_t pre_defined = 0;
 };
 
-BoxType box_type_mdhd();
+constexpr BoxType box_type_mdhd() {
+  return BoxType("mdhd");
+}
 
 class Mdhd : public FullBox {
  public:
@@ -35,6 +37,10 @@ class Mdhd : public FullBox {
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint32_t getTimescale() const;
+  std::uint64_t getDuration() const;
+  void setDuration(const std::uint64_t);
+
  private:
   std::uint64_t m_creation_time;
   std::uint64_t m_modification_time;
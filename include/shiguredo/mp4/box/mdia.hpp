@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mdia();
+constexpr BoxType box_type_mdia() {
+  return BoxType("mdia");
+}
 
 class Mdia : public Box {
  public:
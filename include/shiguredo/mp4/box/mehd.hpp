@@ -15,7 +15,9 @@ struct MehdParameters {
   const std::uint64_t fragment_duration;
 };
 
-BoxType box_type_mehd();
+constexpr BoxType box_type_mehd() {
+  return BoxType("mehd");
+}
 
 class Mehd : public FullBox {
  public:
@@ -28,6 +30,8 @@ class Mehd : public FullBox {
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint64_t getFragmentDuration() const;
+
  private:
   std::uint64_t m_fragment_duration;
 };
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_meta();
+constexpr BoxType box_type_meta() {
+  return BoxType("meta");
+}
 
 class Meta : public FullBox {
  public:
@@ -15,7 +15,9 @@ struct MfhdParameters {
   const std::uint32_t sequence_number;
 };
 
-BoxType box_type_mfhd();
+constexpr BoxType box_type_mfhd() {
+  return BoxType("mfhd");
+}
 
 class Mfhd : public FullBox {
  public:
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mfra();
+constexpr BoxType box_type_mfra() {
+  return BoxType("mfra");
+}
 
 class Mfra : public Box {
  public:
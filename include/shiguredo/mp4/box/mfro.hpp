@@ -15,7 +15,9 @@ struct MfroParameters {
   const std::uint32_t size;
 };
 
-BoxType box_type_mfro();
+constexpr BoxType box_type_mfro() {
+  return BoxType("mfro");
+}
 
 class Mfro : public FullBox {
  public:
@@ -28,6 +30,9 @@ class Mfro : public FullBox {
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  // mfro を含む mfra 全体のサイズ
+  std::uint32_t getMfraSize() const;
+
  private:
   std::uint32_t m_size;
 };
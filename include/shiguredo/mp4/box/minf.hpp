@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_minf();
+constexpr BoxType box_type_minf() {
+  return BoxType("minf");
+}
 
 class Minf : public Box {
  public:
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_moof();
+constexpr BoxType box_type_moof() {
+  return BoxType("moof");
+}
 
 class Moof : public Box {
  public:
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_moov();
+constexpr BoxType box_type_moov() {
+  return BoxType("moov");
+}
 
 class Moov : public Box {
  public:
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mvex();
+constexpr BoxType box_type_mvex() {
+  return BoxType("mvex");
+}
 
 class Mvex : public Box {
  public:
@@ -24,7 +24,9 @@ struct MvhdParameters {
   const std::uint32_t next_track_id;
 };
 
-BoxType box_type_mvhd();
+constexpr BoxType box_type_mvhd() {
+  return BoxType("mvhd");
+}
 
 class Mvhd : public FullBox {
  public:
@@ -38,6 +40,9 @@ class Mvhd : public FullBox {
   std::uint64_t readData(std::istream&) override;
 
   double getRate() const;
+  std::uint32_t getTimescale() const;
+  std::uint64_t getDuration() const;
+  void setDuration(const std::uint64_t);
 
   void setNextTrackID(const std::uint32_t);
 
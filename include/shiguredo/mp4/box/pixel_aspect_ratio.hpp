@@ -14,7 +14,9 @@ struct PixelAspectRatioParameters {
   const std::uint32_t v_spacing = 1;
 };
 
-BoxType box_type_pasp();
+constexpr BoxType box_type_pasp() {
+  return BoxType("pasp");
+}
 
 class PixelAspectRatio : public AnyTypeBox {
  public:
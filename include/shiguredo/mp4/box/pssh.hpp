@@ -42,7 +42,9 @@ struct PsshParameters {
   const std::vector<std::uint8_t> data;
 };
 
-BoxType box_type_pssh();
+constexpr BoxType box_type_pssh() {
+  return BoxType("pssh");
+}
 
 class Pssh : public FullBox {
  public:
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -46,7 +47,9 @@ struct SbgpParameters {
   const std::vector<SbgpEntry> entries;
 };
 
-BoxType box_type_sbgp();
+constexpr BoxType box_type_sbgp() {
+  return BoxType("sbgp");
+}
 
 class Sbgp : public FullBox {
  public:
@@ -54,6 +57,7 @@ class Sbgp : public FullBox {
   explicit Sbgp(const SbgpParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
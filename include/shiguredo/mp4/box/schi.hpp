@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_schi();
+constexpr BoxType box_type_schi() {
+  return BoxType("schi");
+}
 
 class Schi : public Box {
  public:
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -45,7 +46,9 @@ struct SdtpParameters {
   const std::vector<SdtpSample> samples;
 };
 
-BoxType box_type_sdtp();
+constexpr BoxType box_type_sdtp() {
+  return BoxType("sdtp");
+}
 
 class Sdtp : public FullBox {
  public:
@@ -53,6 +56,7 @@ class Sdtp : public FullBox {
   explicit Sdtp(const SdtpParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
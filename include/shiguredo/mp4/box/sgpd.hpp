@@ -147,7 +147,9 @@ struct SgpdParameters {
   const std::vector<TemporalLevelEntry> temporal_level_entries = {};
 };
 
-BoxType box_type_sgpd();
+constexpr BoxType box_type_sgpd() {
+  return BoxType("sgpd");
+}
 
 class Sgpd : public FullBox {
  public:
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -36,6 +37,10 @@ class SidxReference {
   std::uint64_t writeData(bitio::Writer*) const;
   std::uint64_t readData(bitio::Reader*);
 
+  std::uint32_t getReferenceSize() const;
+  std::uint32_t getSubsegmentDuration() const;
+  bool getStartsWithSAP() const;
+
  private:
   bool m_reference_type;
   std::uint32_t m_reference_size;
@@ -55,7 +60,9 @@ struct SidxParameters {
   const std::vector<SidxReference> references;
 };
 
-BoxType box_type_sidx();
+constexpr BoxType box_type_sidx() {
+  return BoxType("sidx");
+}
 
 class Sidx : public FullBox {
  public:
@@ -63,11 +70,17 @@ class Sidx : public FullBox {
   explicit Sidx(const SidxParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint32_t getReferenceID() const;
+  std::uint64_t getEarliestPresentationTime() const;
+  std::uint64_t getFirstOffset() const;
+  const std::vector<SidxReference>& getReferences() const;
+
  private:
   std::uint32_t m_reference_id;
   std::uint32_t m_timescale;
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_sinf();
+constexpr BoxType box_type_sinf() {
+  return BoxType("sinf");
+}
 
 class Sinf : public Box {
  public:
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -14,7 +15,9 @@ struct SkipParameters {
   const std::vector<std::uint8_t> data;
 };
 
-BoxType box_type_skip();
+constexpr BoxType box_type_skip() {
+  return BoxType("skip");
+}
 
 class Skip : public Box {
  public:
@@ -22,6 +25,7 @@ class Skip : public Box {
   explicit Skip(const SkipParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream& os) const override;
   std::uint64_t getDataSize() const override;
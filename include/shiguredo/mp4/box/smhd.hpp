@@ -15,7 +15,9 @@ struct SmhdParameters {
   const std::int16_t balance = 0;
 };
 
-BoxType box_type_smhd();
+constexpr BoxType box_type_smhd() {
+  return BoxType("smhd");
+}
 
 class Smhd : public FullBox {
  public:
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_stbl();
+constexpr BoxType box_type_stbl() {
+  return BoxType("stbl");
+}
 
 class Stbl : public Box {
  public:
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <compare>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -17,7 +18,9 @@ struct StcoParameters {
   const std::vector<std::uint32_t> chunk_offsets;
 };
 
-BoxType box_type_stco();
+constexpr BoxType box_type_stco() {
+  return BoxType("stco");
+}
 
 class Stco : public FullBox {
  public:
@@ -25,6 +28,7 @@ class Stco : public FullBox {
   explicit Stco(const StcoParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t readData(std::istream&) override;
@@ -32,6 +36,9 @@ class Stco : public FullBox {
 
   auto operator<=>(const Stco&) const = default;
 
+  const std::vector<std::uint32_t>& getChunkOffsets() const;
+  void addChunkOffset(const std::uint32_t);
+
  private:
   std::vector<std::uint32_t> m_chunk_offsets;
 };
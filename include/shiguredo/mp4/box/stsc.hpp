@@ -1,6 +1,7 @@
 #pragma once
 
 #include <compare>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -35,6 +36,10 @@ class StscEntry {
   std::uint64_t readData(bitio::Reader*);
   auto operator<=>(const StscEntry&) const = default;
 
+  std::uint32_t getFirstChunk() const;
+  std::uint32_t getSamplesPerChunk() const;
+  std::uint32_t getSampleDescriptionIndex() const;
+
  private:
   std::uint32_t m_first_chunk;
   std::uint32_t m_sample_per_chunk;
@@ -49,7 +54,9 @@ struct StscParameters {
   const std::vector<StscEntry> entries;
 };
 
-BoxType box_type_stsc();
+constexpr BoxType box_type_stsc() {
+  return BoxType("stsc");
+}
 
 class Stsc : public FullBox {
  public:
@@ -57,11 +64,16 @@ class Stsc : public FullBox {
   explicit Stsc(const StscParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  const std::vector<StscEntry>& getEntries() const;
+  // chunk 番号 chunk を末尾に追加する. 最後の要素と samples_per_chunk が同じ場合は要素を増やさない
+  void addChunk(const std::uint32_t chunk, const std::uint32_t samples_per_chunk);
+
  private:
   std::vector<StscEntry> m_entries;
 };
@@ -15,7 +15,9 @@ struct StsdParameters {
   const std::uint32_t entry_count;
 };
 
-BoxType box_type_stsd();
+constexpr BoxType box_type_stsd() {
+  return BoxType("stsd");
+}
 
 class Stsd : public FullBox {
  public:
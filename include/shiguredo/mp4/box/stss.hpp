@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -16,7 +18,9 @@ struct StssParmeters {
   const std::vector<std::uint32_t>& sample_numbers;
 };
 
-BoxType box_type_stss();
+constexpr BoxType box_type_stss() {
+  return BoxType("stss");
+}
 
 class Stss : public FullBox {
  public:
@@ -24,11 +28,15 @@ class Stss : public FullBox {
   explicit Stss(const StssParmeters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  const std::vector<std::uint32_t>& getSampleNumbers() const;
+  void addSampleNumbers(const std::span<const std::uint32_t>);
+
  private:
   std::vector<std::uint32_t> m_sample_numbers;
 };
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -17,7 +19,9 @@ struct StszParameters {
   const std::vector<std::uint32_t> entry_sizes;
 };
 
-BoxType box_type_stsz();
+constexpr BoxType box_type_stsz() {
+  return BoxType("stsz");
+}
 
 class Stsz : public FullBox {
  public:
@@ -25,11 +29,18 @@ class Stsz : public FullBox {
   explicit Stsz(const StszParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint32_t getSampleCount() const;
+  // sample_size が一定の場合もサンプル毎のサイズを返す
+  const std::vector<std::uint32_t>& getEntrySizes() const;
+  // sample_size が 0 の場合のみ使える
+  void addEntrySizes(const std::span<const std::uint32_t>);
+
  private:
   std::uint32_t m_sample_size;
   std::vector<std::uint32_t> m_entry_sizes;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <compare>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -34,6 +35,9 @@ class SttsEntry {
   std::uint64_t readData(bitio::Reader*);
   auto operator<=>(const SttsEntry&) const = default;
 
+  std::uint32_t getSampleCount() const;
+  std::uint32_t getSampleDuration() const;
+
  private:
   std::uint32_t m_sample_count;
   std::uint32_t m_sample_duration;
@@ -47,7 +51,9 @@ struct SttsParameters {
   const std::vector<SttsEntry> entries;
 };
 
-BoxType box_type_stts();
+constexpr BoxType box_type_stts() {
+  return BoxType("stts");
+}
 
 class Stts : public FullBox {
  public:
@@ -55,11 +61,18 @@ class Stts : public FullBox {
   explicit Stts(const SttsParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  const std::vector<SttsEntry>& getEntries() const;
+  // サンプルを末尾に追加する. 最後の要素と同じ duration の場合は sample_count を増やす
+  void addSample(const std::uint32_t sample_duration);
+  // 末尾のサンプルを取り除く
+  void removeLastSample();
+
  private:
   std::vector<SttsEntry> m_entries;
 };
@@ -17,7 +17,9 @@ struct StypParameters {
   const std::vector<Brand> compatible_brands;
 };
 
-BoxType box_type_styp();
+constexpr BoxType box_type_styp() {
+  return BoxType("styp");
+}
 
 class Styp : public Box {
  public:
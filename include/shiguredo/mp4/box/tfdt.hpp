@@ -15,7 +15,9 @@ struct TfdtParameters {
   const std::uint64_t base_media_decode_time;
 };
 
-BoxType box_type_tfdt();
+constexpr BoxType box_type_tfdt() {
+  return BoxType("tfdt");
+}
 
 class Tfdt : public FullBox {
  public:
@@ -28,6 +30,8 @@ class Tfdt : public FullBox {
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint64_t getBaseMediaDecodeTime() const;
+
  private:
   std::uint64_t m_base_media_decode_time;
 };
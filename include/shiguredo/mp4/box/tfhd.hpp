@@ -30,7 +30,9 @@ struct TfhdParameters {
   const std::uint32_t default_sample_flags = 0;
 };
 
-BoxType box_type_tfhd();
+constexpr BoxType box_type_tfhd() {
+  return BoxType("tfhd");
+}
 
 class Tfhd : public FullBox {
  public:
@@ -43,6 +45,13 @@ class Tfhd : public FullBox {
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint32_t getTrackID() const;
+  std::uint64_t getBaseDataOffset() const;
+  std::uint32_t getSampleDescriptionIndex() const;
+  std::uint32_t getDefaultSampleDuration() const;
+  std::uint32_t getDefaultSampleSize() const;
+  std::uint32_t getDefaultSampleFlags() const;
+
  private:
   std::uint32_t m_track_id;
   std::uint64_t m_base_data_offset;
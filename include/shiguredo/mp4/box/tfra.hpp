@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -44,6 +45,12 @@ class TfraEntry {
                          const std::uint8_t,
                          const std::uint8_t);
 
+  std::uint64_t getTime() const;
+  std::uint64_t getMoofOffset() const;
+  std::uint32_t getTrafNumber() const;
+  std::uint32_t getTrunNumber() const;
+  std::uint32_t getSampleNumber() const;
+
  private:
   std::uint64_t m_time;
   std::uint64_t m_moof_offset;
@@ -62,7 +69,9 @@ struct TfraParameters {
   const std::vector<TfraEntry> entries;
 };
 
-BoxType box_type_tfra();
+constexpr BoxType box_type_tfra() {
+  return BoxType("tfra");
+}
 
 class Tfra : public FullBox {
  public:
@@ -70,11 +79,15 @@ class Tfra : public FullBox {
   explicit Tfra(const TfraParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint32_t getTrackID() const;
+  const std::vector<TfraEntry>& getEntries() const;
+
  private:
   std::uint32_t m_track_id;
   std::uint32_t m_reserved = 0;
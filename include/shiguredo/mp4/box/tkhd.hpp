@@ -25,7 +25,9 @@ struct TkhdParameters {
   const std::uint32_t height = 0;
 };
 
-BoxType box_type_tkhd();
+constexpr BoxType box_type_tkhd() {
+  return BoxType("tkhd");
+}
 
 class Tkhd : public FullBox {
  public:
@@ -40,6 +42,9 @@ class Tkhd : public FullBox {
 
   double getWidth() const;
   double getHeight() const;
+  std::uint32_t getTrackID() const;
+  std::uint64_t getDuration() const;
+  void setDuration(const std::uint64_t);
 
  private:
   std::uint64_t m_creation_time;
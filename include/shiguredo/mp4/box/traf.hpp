@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_traf();
+constexpr BoxType box_type_traf() {
+  return BoxType("traf");
+}
 
 class Traf : public Box {
  public:
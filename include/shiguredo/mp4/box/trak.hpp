@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_trak();
+constexpr BoxType box_type_trak() {
+  return BoxType("trak");
+}
 
 class Trak : public Box {
  public:
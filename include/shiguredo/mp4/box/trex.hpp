@@ -19,7 +19,9 @@ struct TrexParameters {
   const std::uint32_t default_sample_flags;
 };
 
-BoxType box_type_trex();
+constexpr BoxType box_type_trex() {
+  return BoxType("trex");
+}
 
 class Trex : public FullBox {
  public:
@@ -32,6 +34,12 @@ class Trex : public FullBox {
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint32_t getTrackID() const;
+  std::uint32_t getDefaultSampleDescriptionIndex() const;
+  std::uint32_t getDefaultSampleDuration() const;
+  std::uint32_t getDefaultSampleSize() const;
+  std::uint32_t getDefaultSampleFlags() const;
+
  private:
   std::uint32_t m_track_id;
   std::uint32_t m_default_sample_description_index;
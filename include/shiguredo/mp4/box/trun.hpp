@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -17,6 +18,15 @@ class Writer;
 
 namespace shiguredo::mp4::box {
 
+enum TrunFlags : std::uint32_t {
+  TrunDataOffsetPresent = 0x000001,
+  TrunFirstSampleFlagsPresent = 0x000004,
+  TrunSampleDurationPresent = 0x000100,
+  TrunSampleSizePresent = 0x000200,
+  TrunSampleFlagsPresent = 0x000400,
+  TrunSampleCompositionTimeOffsetPresent = 0x000800,
+};
+
 struct TrunEntryParameters {
   const std::uint32_t sample_duration = 0;
   const std::uint32_t sample_size = 0;
@@ -34,6 +44,11 @@ class TrunEntry {
   std::uint64_t getSize(const std::uint32_t) const;
   std::uint64_t readData(bitio::Reader*, const std::uint32_t);
 
+  std::uint32_t getSampleDuration() const;
+  std::uint32_t getSampleSize() const;
+  std::uint32_t getSampleFlags() const;
+  std::int64_t getSampleCompositionTimeOffset() const;
+
  private:
   std::uint32_t m_sample_duration;
   std::uint32_t m_sample_size;
@@ -49,7 +64,13 @@ struct TrunParameters {
   const std::vector<TrunEntry> entries = {};
 };
 
-BoxType box_type_trun();
+// sample_duration などのフィールドを持たない trun で読み込むサンプル数の上限
+// フィールドがない場合は entry_count を残りのデータのサイズで検証できないため
+const std::uint32_t MaxSampleCountWithoutEntryFields = 1 << 20;
+
+constexpr BoxType box_type_trun() {
+  return BoxType("trun");
+}
 
 class Trun : public FullBox {
  public:
@@ -57,11 +78,19 @@ class Trun : public FullBox {
   explicit Trun(const TrunParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
   std::uint64_t readData(std::istream&) override;
 
+  std::uint32_t getSampleCount() const;
+  std::int32_t getDataOffset() const;
+  std::uint32_t getFirstSampleFlags() const;
+  const std::vector<TrunEntry>& getEntries() const;
+  // サイズは変わらないので, moof のサイズを計算した後に設定できる
+  void setDataOffset(const std::int32_t);
+
  private:
   std::int32_t m_data_offset;
   std::uint32_t m_first_sample_flags;
@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_udta();
+constexpr BoxType box_type_udta() {
+  return BoxType("udta");
+}
 
 class Udta : public Box {
  public:
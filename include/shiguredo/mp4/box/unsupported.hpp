@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <string>
@@ -14,7 +15,9 @@ struct UnsupportedParameters {
   const std::vector<std::uint8_t> data;
 };
 
-BoxType box_type_unsupported();
+constexpr BoxType box_type_unsupported() {
+  return BoxType("unsu");
+}
 
 class Unsupported : public Box {
  public:
@@ -22,6 +25,7 @@ class Unsupported : public Box {
   explicit Unsupported(const UnsupportedParameters&);
 
   std::string toStringOnlyData() const override;
+  std::string toStringOnlyDataWithMaxEntries(const std::size_t) const override;
 
   std::uint64_t writeData(std::ostream&) const override;
   std::uint64_t getDataSize() const override;
@@ -17,7 +17,9 @@ struct UrlParameters {
   const std::string location = "";
 };
 
-BoxType box_type_url();
+constexpr BoxType box_type_url() {
+  return BoxType("url ");
+}
 
 class Url : public FullBox {
  public:
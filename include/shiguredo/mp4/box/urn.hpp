@@ -18,7 +18,9 @@ struct UrnParameters {
   const std::string location = "";
 };
 
-BoxType box_type_urn();
+constexpr BoxType box_type_urn() {
+  return BoxType("urn ");
+}
 
 class Urn : public FullBox {
  public:
@@ -17,7 +17,9 @@ struct VmhdParameters {
   const std::array<std::uint16_t, 3> opcolor = {0, 0, 0};
 };
 
-BoxType box_type_vmhd();
+constexpr BoxType box_type_vmhd() {
+  return BoxType("vmhd");
+}
 
 class Vmhd : public FullBox {
  public:
@@ -24,7 +24,9 @@ struct VPCodecConfigurationParameters {
   const std::vector<std::uint8_t> codec_initialization_data = {};
 };
 
-BoxType box_type_vpcc();
+constexpr BoxType box_type_vpcc() {
+  return BoxType("vpcC");
+}
 
 class VPCodecConfiguration : public FullBox {
  public:
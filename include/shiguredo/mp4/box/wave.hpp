@@ -9,7 +9,9 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_wave();
+constexpr BoxType box_type_wave() {
+  return BoxType("wave");
+}
 
 class Wave : public Box {
  public:
@@ -17,6 +17,8 @@ using BoxPath = std::vector<BoxType>;
 struct BoxInfoParameters {
   BoxInfo* parent = nullptr;
   Box* box;
+  // false の場合は parent の path のみを引き継ぎ, parent->addLeaf() は呼び出し側で行う
+  bool add_leaf = true;
 };
 
 class BoxInfo {
@@ -28,14 +30,45 @@ class BoxInfo {
   std::uint64_t getSize() const;
   BoxType getType() const;
   void addLeaf(BoxInfo*);
+  // 子の BoxInfo を取り除いて解放する
+  void removeLeaf(BoxInfo*);
+  const std::vector<BoxInfo*>& getLeafs() const;
   std::string toString() const;
+  // 子孫のサイズを 1 度ずつ計算してから offset を設定する. 計算したサイズは invalidateSize() まで再利用する
   std::uint64_t adjustOffsetAndSize(const std::uint64_t);
+  // Box のサイズが変わる変更をした場合に呼び出す. 祖先の BoxInfo のサイズも再計算させる
+  void invalidateSize();
   void write(std::ostream&) const;
+  // adjustOffsetAndSize() の後に呼び出す. 子孫を含めて buffer の連続した領域に書き込む
+  void serialize(std::vector<char>* buffer) const;
+  // serialize() した領域を Box の offset に 1 度の ostream::write() で書き込む
+  void writeAtOnce(std::ostream&) const;
 
  private:
   BoxPath m_path;
   Box* m_box;
+  BoxInfo* m_parent;
   std::vector<BoxInfo*> m_leafs;
+  bool m_size_cached = false;
+  std::uint64_t m_data_size = 0;
+  std::uint64_t m_leafs_size = 0;
+
+  std::uint64_t computeSize();
+  void assignOffset(const std::uint64_t);
 };
 
+// 親の Box の種類で読み方が変わる Box を設定する. wave の中の AudioSampleEntry は QuickTime のデータのみを持つ
+// BoxInfo と reader::BoxIterator で子の Box の位置を同じにするために共有する
+void set_parent_type(Box*, const BoxType& parent_type);
+
+// info の子のうち最初の type の BoxInfo を返す. info が nullptr の場合や見つからない場合は nullptr を返す
+BoxInfo* find_leaf(const BoxInfo*, const BoxType&);
+
+// find_leaf() で見つけた Box を T として返す
+template <class T>
+T* find_box(const BoxInfo* info, const BoxType& type) {
+  const auto leaf = find_leaf(info, type);
+  return leaf == nullptr ? nullptr : dynamic_cast<T*>(leaf->getBox());
+}
+
 }  // namespace shiguredo::mp4
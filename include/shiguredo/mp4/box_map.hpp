@@ -1,48 +1,78 @@
 #pragma once
 
 #include <cstdint>
-#include <map>
-#include <memory>
+#include <initializer_list>
+#include <span>
+#include <type_traits>
 #include <vector>
 
-#include <boost/function.hpp>
-
+#include "shiguredo/mp4/box.hpp"
 #include "shiguredo/mp4/box_type.hpp"
 
 namespace shiguredo::mp4 {
 
-class Box;
 class BoxHeader;
 
-typedef boost::function<Box*()> BoxFactory;
+using BoxFactory = Box* (*)();
 
-struct BoxDefParameters {
-  const BoxFactory factory;
-  const std::vector<std::uint8_t> versions;
-};
+template <class T>
+Box* make_box() {
+  return new T();
+}
 
-class BoxDef {
- public:
-  explicit BoxDef(const BoxDefParameters&);
-  BoxFactory factory;
-  std::vector<std::uint8_t> versions;
+struct BoxDef {
+  BoxType type;
+  BoxFactory factory = nullptr;
+  // 対応する version のビットマスク. 0 の場合は全ての version に対応する
+  std::uint32_t versions = 0;
+  // AnyTypeBox の場合は生成後に BoxType を設定する
+  bool is_any_type = false;
 };
 
+constexpr std::uint32_t make_box_version_mask(const std::initializer_list<std::uint8_t> versions) {
+  std::uint32_t mask = 0;
+  for (const auto v : versions) {
+    mask |= 1U << v;
+  }
+  return mask;
+}
+
+template <class T>
+constexpr BoxDef make_box_def(const BoxType& type, const std::initializer_list<std::uint8_t> versions = {}) {
+  return {.type = type,
+          .factory = &make_box<T>,
+          .versions = make_box_version_mask(versions),
+          .is_any_type = std::is_base_of_v<AnyTypeBox, T>};
+}
+
+// BoxType で整列した BoxDef の配列から二分探索で Box を生成する
+// 既定の定義は register_box_map() ではなく get_box_map() で共有できる
 class BoxMap {
  public:
   BoxMap() = default;
+  // defs は type で整列済みで, BoxMap より長く生存する必要がある
+  explicit BoxMap(const std::span<const BoxDef>);
+  // addBoxDef() の後は m_defs が自身の m_owned_defs を指すので, コピーやムーブの後に指し直す
+  BoxMap(const BoxMap&);
+  BoxMap(BoxMap&&) noexcept;
+  BoxMap& operator=(const BoxMap&);
+  BoxMap& operator=(BoxMap&&) noexcept;
 
-  void addBoxDef(const BoxFactory&, const BoxType&, const std::vector<std::uint8_t>&);
+  void addBoxDef(const BoxDef&);
 
-  Box* getBoxInstance(const BoxType&);
-  Box* getBoxInstance(BoxHeader*);
+  Box* getBoxInstance(const BoxType&) const;
+  Box* getBoxInstance(BoxHeader*) const;
   bool isSupported(const BoxType& box_type) const;
   std::vector<std::uint8_t> getSupportedVersions(const BoxType&) const;
 
   bool isSupportedVersion(const BoxType&, const std::uint8_t) const;
 
  private:
-  std::map<BoxType, std::unique_ptr<BoxDef>> m_map;
+  std::span<const BoxDef> m_defs = {};
+  std::vector<BoxDef> m_owned_defs = {};
+
+  const BoxDef* find(const BoxType&) const;
+  bool ownsDefs() const;
 };
 
 }  // namespace shiguredo::mp4
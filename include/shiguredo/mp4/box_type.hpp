@@ -2,28 +2,79 @@
 
 #include <array>
 #include <compare>  // NOLINT
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <stdexcept>
 #include <string>
 
 namespace shiguredo::mp4 {
 
+// 4 文字の FourCC を big endian の std::uint32_t として保持する
+// 比較は整数の比較になり, 文字列リテラルからはコンパイル時に構築できる
 class BoxType {
  public:
   explicit BoxType(const std::string&);
-  explicit BoxType(const std::array<std::uint8_t, 4>&);
-  BoxType() = default;
+  constexpr explicit BoxType(const char (&str)[5])
+      : m_value(make_value(static_cast<std::uint8_t>(str[0]),
+                           static_cast<std::uint8_t>(str[1]),
+                           static_cast<std::uint8_t>(str[2]),
+                           static_cast<std::uint8_t>(str[3]))) {}
+  constexpr explicit BoxType(const std::array<std::uint8_t, 4>& data)
+      : m_value(make_value(data[0], data[1], data[2], data[3])) {}
+  constexpr explicit BoxType(const std::uint32_t value) : m_value(value) {}
+  constexpr BoxType() = default;
 
-  void setData(const std::uint8_t, const std::uint8_t, const std::uint8_t, const std::uint8_t);
+  constexpr void setData(const std::uint8_t d0, const std::uint8_t d1, const std::uint8_t d2, const std::uint8_t d3) {
+    m_value = make_value(d0, d1, d2, d3);
+  }
 
-  std::array<std::uint8_t, 4> getData() const;
-  auto operator<=>(const BoxType&) const = default;
+  constexpr std::array<std::uint8_t, 4> getData() const {
+    return {static_cast<std::uint8_t>(m_value >> 24), static_cast<std::uint8_t>(m_value >> 16),
+            static_cast<std::uint8_t>(m_value >> 8), static_cast<std::uint8_t>(m_value)};
+  }
+  constexpr std::uint32_t getValue() const { return m_value; }
+  constexpr auto operator<=>(const BoxType&) const = default;
 
   std::string toString() const;
-  bool matchWith(const BoxType& other) const;
+  constexpr bool matchWith(const BoxType& other) const {
+    return m_value == 0 || other.m_value == 0 || m_value == other.m_value;
+  }
 
  private:
-  std::array<std::uint8_t, 4> m_data;
+  std::uint32_t m_value = 0;
+
+  static constexpr std::uint32_t make_value(const std::uint8_t d0,
+                                            const std::uint8_t d1,
+                                            const std::uint8_t d2,
+                                            const std::uint8_t d3) {
+    return (static_cast<std::uint32_t>(d0) << 24) | (static_cast<std::uint32_t>(d1) << 16) |
+           (static_cast<std::uint32_t>(d2) << 8) | static_cast<std::uint32_t>(d3);
+  }
 };
 
-BoxType box_type_any();
+constexpr BoxType box_type_any() {
+  return BoxType(0U);
+}
+
+namespace literals {
+
+// "moov"_box
+consteval BoxType operator""_box(const char* str, const std::size_t length) {
+  if (length != 4) {
+    throw std::invalid_argument("invalid box type id length");
+  }
+  return BoxType(std::array<std::uint8_t, 4>{static_cast<std::uint8_t>(str[0]), static_cast<std::uint8_t>(str[1]),
+                                             static_cast<std::uint8_t>(str[2]), static_cast<std::uint8_t>(str[3])});
+}
+
+}  // namespace literals
+
 }  // namespace shiguredo::mp4
+
+template <>
+struct std::hash<shiguredo::mp4::BoxType> {
+  std::size_t operator()(const shiguredo::mp4::BoxType& type) const noexcept {
+    return std::hash<std::uint32_t>{}(type.getValue());
+  }
+};
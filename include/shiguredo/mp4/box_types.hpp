@@ -4,6 +4,8 @@ namespace shiguredo::mp4 {
 
 class BoxMap;
 
+// 既定の Box の定義を持つ共有の BoxMap を返す
+const BoxMap& get_box_map();
 void register_box_map(BoxMap*);
 
 }  // namespace shiguredo::mp4
@@ -12,5 +12,9 @@ const Brand BrandIso2{'i', 's', 'o', '2'};
 const Brand BrandMp41{'m', 'p', '4', '1'};
 const Brand BrandMp42{'m', 'p', '4', '2'};
 const Brand BrandAvc1{'a', 'v', 'c', '1'};
+const Brand BrandIso6{'i', 's', 'o', '6'};
+const Brand BrandCmfc{'c', 'm', 'f', 'c'};
+const Brand BrandCmfs{'c', 'm', 'f', 's'};
+const Brand BrandMsdh{'m', 's', 'd', 'h'};
 
 }  // namespace shiguredo::mp4
@@ -8,6 +8,8 @@ class Constants {
  public:
   static const std::uint64_t SMALL_HEADER_SIZE = 8;
   static const std::uint64_t LARGE_HEADER_SIZE = 16;
+  // 再帰的に Box を解析する際の入れ子の深さの上限
+  static const std::uint64_t MAX_BOX_DEPTH = 64;
 };
 
 }  // namespace shiguredo::mp4
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+
+namespace shiguredo::mp4::reader {
+
+struct BoxFilterParameters {
+  // 解析する Box のパス. 空の場合は全ての Box を解析する
+  // 許可したパスの祖先と子孫も解析する. box_type_any() は任意の Box に一致する
+  const std::vector<BoxPath> allow_paths = {};
+  // どの深さにあっても解析しない Box
+  const std::vector<BoxType> deny_types = {};
+  // 最上位の Box の深さを 1 とした最大の深さ. 0 の場合は制限しない
+  const std::size_t max_depth = 0;
+};
+
+class BoxFilter {
+ public:
+  BoxFilter() = default;
+  explicit BoxFilter(const BoxFilterParameters&);
+
+  bool match(const BoxPath&) const;
+
+ private:
+  std::vector<BoxPath> m_allow_paths = {};
+  std::vector<BoxType> m_deny_types = {};
+  std::size_t m_max_depth = 0;
+};
+
+// "moov/trak/*/mdhd" のような文字列を BoxPath に変換する
+BoxPath parse_box_path(const std::string&);
+
+}  // namespace shiguredo::mp4::reader
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+#include "shiguredo/mp4/box.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_map.hpp"
+
+namespace shiguredo::mp4::reader {
+
+enum class BoxEventType {
+  Enter,
+  Leave,
+};
+
+struct BoxEvent {
+  BoxEventType type = BoxEventType::Enter;
+  // 次に BoxIterator::next() を呼ぶまで有効
+  const BoxHeader* header = nullptr;
+  // 最上位の Box の深さを 1 とする
+  std::size_t depth = 0;
+};
+
+// Box を木として構築せずに, 先頭から順に Enter / Leave のイベントを返す
+// コンテナ Box の子孫は Enter と Leave の間に返す
+class BoxIterator {
+ public:
+  explicit BoxIterator(std::istream&);
+  ~BoxIterator();
+  BoxIterator(const BoxIterator&) = delete;
+  BoxIterator& operator=(const BoxIterator&) = delete;
+
+  // 次のイベントを取得する. 終端に達した場合は false を返す
+  bool next(BoxEvent*);
+  // 直前の Enter の Box の子孫を読まずに, 次のイベントを Leave にする
+  void skip();
+  // 直前の Enter の Box の payload を読んで Box を構築する. 子孫は含まない. 解放は呼び出し側で行う
+  Box* parse();
+  const BoxPath& getPath() const;
+
+ private:
+  struct Frame {
+    BoxHeader* header;
+    std::uint64_t next_offset;
+  };
+
+  std::istream& m_is;
+  const BoxMap& m_box_map;
+  std::uint64_t m_total_size;
+  std::uint64_t m_next_offset = 0;
+  std::vector<Frame> m_stack = {};
+  BoxPath m_path = {};
+  BoxHeader* m_left_header = nullptr;
+  bool m_entered = false;
+  bool m_skip = false;
+
+  BoxHeader* readHeader(const std::uint64_t offset, const std::uint64_t end_offset);
+  std::uint64_t getChildrenOffset(const BoxHeader*);
+};
+
+enum class VisitResult {
+  Continue,
+  Skip,
+  Stop,
+};
+
+class BoxVisitor {
+ public:
+  virtual ~BoxVisitor() = default;
+  // Skip を返すと子孫を読まず, Stop を返すと走査を終了する. iterator->parse() で Box を構築できる
+  virtual VisitResult onEnter(BoxIterator* iterator, const BoxEvent& event) = 0;
+  virtual void onLeave(const BoxEvent&) {}
+};
+
+// 全ての Box を visitor に渡す. 走査を最後まで行った場合は true を返す
+bool visit_boxes(std::istream&, BoxVisitor*);
+
+}  // namespace shiguredo::mp4::reader
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace shiguredo::mp4::reader {
+
+enum class DumpFormat {
+  Text,
+  JSON,
+};
+
+struct DumpParameters {
+  const DumpFormat format = DumpFormat::Text;
+  // 配列の要素を出力する最大の数. 0 の場合は全て出力する
+  const std::size_t max_entries = 0;
+};
+
+// Box を先頭から順に解析しながら os に出力する. Box の木や出力全体の文字列は保持しない
+// mdat の payload は出力しない
+void dump(std::istream& is, std::ostream& os, const DumpParameters& params = {});
+
+// JSON の文字列の中身として書き出せるようにエスケープする
+// UTF-8 として不正なバイトは, そのバイトの値を符号位置とする \u00XX として書き出す
+std::string escape_json(std::string_view);
+
+}  // namespace shiguredo::mp4::reader
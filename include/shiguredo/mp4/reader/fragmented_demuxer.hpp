@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "shiguredo/mp4/box_type.hpp"
+
+namespace shiguredo::mp4::reader {
+
+struct DemuxedTrack {
+  std::uint32_t track_id = 0;
+  std::string handler_type = "";
+  // 最初のサンプルエントリーの Box の種類
+  std::string codec = "";
+  std::uint32_t timescale = 0;
+};
+
+struct DemuxedSample {
+  std::uint32_t track_id = 0;
+  // トラックの timescale での decode time. tfdt がない場合は直前の fragment から続ける
+  std::uint64_t decode_time = 0;
+  std::int64_t composition_time_offset = 0;
+  std::uint32_t duration = 0;
+  std::uint32_t sample_description_index = 0;
+  bool is_key = false;
+  // ファイル全体でのサンプルの位置
+  std::uint64_t offset = 0;
+  std::uint32_t size = 0;
+  // FragmentedDemuxerHandler::onSample() の中でのみ有効
+  std::span<const std::uint8_t> data = {};
+};
+
+// trex で指定するトラック毎の既定値
+struct TrackFragmentDefaults {
+  std::uint32_t sample_description_index = 1;
+  std::uint32_t sample_duration = 0;
+  std::uint32_t sample_size = 0;
+  std::uint32_t sample_flags = 0;
+};
+
+// moof 全体のバイト列からサンプルの一覧を求める. data は設定しない
+// moof_offset はファイル全体での moof の位置で, tfhd に base_data_offset がない場合の基準になる
+// tfdt がない traf は next_decode_times のトラックの値から decode time を続け, 解析後に次の値に更新する
+std::vector<DemuxedSample> parse_moof_samples(const std::span<const std::uint8_t> moof,
+                                              const std::uint64_t moof_offset,
+                                              const std::map<std::uint32_t, TrackFragmentDefaults>& trex_defaults,
+                                              std::map<std::uint32_t, std::uint64_t>* next_decode_times);
+
+class FragmentedDemuxerHandler {
+ public:
+  virtual ~FragmentedDemuxerHandler() = default;
+  virtual void onInitSegment(const std::vector<DemuxedTrack>&) {}
+  virtual void onSample(const DemuxedSample&) = 0;
+};
+
+struct FragmentedDemuxerParameters {
+  // 保持する Box (moov, moof, mdat) の最大のサイズ. 超えた場合は std::runtime_error を送出する
+  const std::uint64_t max_box_size = 256 * 1024 * 1024;
+};
+
+// シークできないバイト列から fragmented MP4 を逐次解析する
+// 任意の大きさに分割されたバイト列を push() で受け取り, moov から初期化情報を, moof と続く mdat からサンプルを取得する
+// サンプルの情報は trun, tfhd, trex の順に既定値を適用して求める
+// 保持するのは解析中の Box と直前の moof のサンプルの情報のみ. moov, moof, mdat 以外の Box は読み飛ばす
+class FragmentedDemuxer {
+ public:
+  explicit FragmentedDemuxer(FragmentedDemuxerHandler*, const FragmentedDemuxerParameters& params = {});
+
+  void push(const std::uint8_t*, const std::size_t);
+  // push() したバイト数
+  std::uint64_t getReceivedSize() const;
+  // 途中まで受け取った Box がない場合は true
+  bool isAtBoxBoundary() const;
+  const std::vector<DemuxedTrack>& getTracks() const;
+
+ private:
+  FragmentedDemuxerHandler* m_handler;
+  const std::uint64_t m_max_box_size;
+  std::uint64_t m_received_size = 0;
+
+  // 解析中の最上位の Box
+  std::vector<std::uint8_t> m_header_data = {};
+  BoxType m_box_type;
+  std::uint64_t m_box_offset = 0;
+  std::uint64_t m_box_size = 0;
+  std::uint64_t m_box_header_size = 0;
+  bool m_has_header = false;
+  bool m_keeps_box = false;
+  std::uint64_t m_box_received_size = 0;
+  std::vector<std::uint8_t> m_box_data = {};
+
+  bool m_has_moov = false;
+  std::vector<DemuxedTrack> m_tracks = {};
+  std::map<std::uint32_t, TrackFragmentDefaults> m_trex_defaults = {};
+  std::map<std::uint32_t, std::uint64_t> m_next_decode_times = {};
+  std::vector<DemuxedSample> m_fragment_samples = {};
+
+  std::size_t readHeader(const std::uint8_t*, const std::size_t);
+  void processBox();
+  void processMoov();
+  void processMoof();
+  void processMdat();
+};
+
+}  // namespace shiguredo::mp4::reader
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace shiguredo::mp4::reader {
+
+struct TrackProbe {
+  std::uint32_t track_id = 0;
+  std::string handler_type = "";
+  // 最初のサンプルエントリーの Box の種類
+  std::string codec = "";
+  std::uint32_t timescale = 0;
+  std::uint64_t duration = 0;
+  // stsz と trun のサンプル数の合計
+  std::uint64_t sample_count = 0;
+};
+
+struct ProbeResult {
+  std::uint64_t file_size = 0;
+  std::uint32_t timescale = 0;
+  std::uint64_t duration = 0;
+  std::vector<TrackProbe> tracks = {};
+  bool is_fragmented = false;
+  std::uint64_t fragment_count = 0;
+  // 解析に失敗した場合のエラー. 失敗するまでに取得できた情報は残す
+  std::string error = "";
+
+  double getDurationSeconds() const;
+  // ファイル全体のサイズから計算したビットレート (bps). duration が不明な場合は 0
+  std::uint64_t getBitrate() const;
+};
+
+// mdat などの payload を読まずに, メタデータの Box のみを解析して概要を取得する
+// 例外は送出せず, ProbeResult::error に設定する
+ProbeResult probe(std::istream&);
+
+}  // namespace shiguredo::mp4::reader
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace shiguredo::mp4::reader {
+
+struct RandomAccessPoint {
+  // トラックの timescale での時刻
+  std::uint64_t time = 0;
+  std::uint64_t moof_offset = 0;
+  std::uint32_t traf_number = 0;
+  std::uint32_t trun_number = 0;
+  std::uint32_t sample_number = 0;
+};
+
+// ファイル末尾の mfro から mfra を読み込み, 時刻から同期サンプルを含む moof の位置を求める
+// mfra 以外の部分は読まない
+class RandomAccessIndex {
+ public:
+  // mfro または mfra が見つからない場合は std::runtime_error を送出する
+  explicit RandomAccessIndex(std::istream&);
+
+  std::vector<std::uint32_t> getTrackIDs() const;
+  const std::vector<RandomAccessPoint>& getPoints(const std::uint32_t track_id) const;
+  // time 以前で最も近いランダムアクセスポイントを二分探索で求める
+  // トラックがない場合や time が最初のランダムアクセスポイントより前の場合は std::nullopt を返す
+  std::optional<RandomAccessPoint> seek(const std::uint32_t track_id, const std::uint64_t time) const;
+
+ private:
+  std::map<std::uint32_t, std::vector<RandomAccessPoint>> m_points = {};
+};
+
+}  // namespace shiguredo::mp4::reader
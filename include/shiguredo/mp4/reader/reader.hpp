@@ -1,32 +1,47 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
+#include <string>
 #include <vector>
 
+#include "shiguredo/mp4/box_info.hpp"
 #include "shiguredo/mp4/box_map.hpp"
-
-namespace shiguredo::mp4 {
-
-class BoxInfo;
-
-}
+#include "shiguredo/mp4/reader/box_filter.hpp"
 
 namespace shiguredo::mp4::reader {
 
+struct SimpleReaderParameters {
+  // filter に一致しない Box は payload を読み飛ばし, BoxInfo も作らない
+  const BoxFilter filter = {};
+  // moov の子の trak を並列に解析するスレッド数. 1 以下の場合は逐次解析する
+  const std::size_t thread_count = 0;
+};
+
 class SimpleReader {
  public:
-  explicit SimpleReader(std::istream&);
+  explicit SimpleReader(std::istream&, const SimpleReaderParameters& params = {});
   ~SimpleReader();
   void read();
+  void parse();
+  const std::vector<BoxInfo*>& getBoxInfos() const;
 
  private:
   std::istream& m_is;
-  BoxMap m_box_map;
+  const BoxMap& m_box_map;
+  const BoxFilter m_filter;
+  const std::size_t m_thread_count;
   std::vector<BoxInfo*> m_boxes;
   std::uint64_t m_total_size;
+  BoxPath m_path;
 
   std::uint64_t readBox(BoxInfo*);
+  BoxInfo* parseBox(std::istream&, BoxPath*, BoxInfo* parent, const bool add_leaf, std::uint64_t* size) const;
+  void parseChildrenInParallel(BoxInfo*,
+                               const std::string& data,
+                               const std::uint64_t data_offset,
+                               const std::uint64_t children_offset) const;
 };
 
 }  // namespace shiguredo::mp4::reader
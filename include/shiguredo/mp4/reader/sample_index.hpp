@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace shiguredo::mp4 {
+
+class BoxInfo;
+
+}
+
+namespace shiguredo::mp4::reader {
+
+struct IndexedSample {
+  // ファイル全体でのサンプルの位置
+  std::uint64_t offset = 0;
+  std::uint32_t size = 0;
+  std::uint64_t decode_time = 0;
+  std::int64_t composition_time_offset = 0;
+  std::uint32_t duration = 0;
+  std::uint32_t sample_description_index = 1;
+  bool is_key = false;
+};
+
+struct IndexedTrack {
+  std::uint32_t track_id = 0;
+  std::string handler_type = "";
+  std::uint32_t timescale = 0;
+  std::vector<IndexedSample> samples = {};
+  // ctts に 0 以外の値がある
+  bool has_composition_time_offset = false;
+};
+
+// progressive な MP4 の trak の stbl から, サンプル毎の位置, サイズ, 時刻の一覧を作る
+// stss がない場合は全てのサンプルを同期サンプルとする. テーブルの間で矛盾がある場合は std::runtime_error を送出する
+IndexedTrack build_sample_index(const BoxInfo* trak);
+
+// moov の全ての trak の一覧を作る
+std::vector<IndexedTrack> build_sample_indexes(const BoxInfo* moov);
+
+}  // namespace shiguredo::mp4::reader
@@ -1,9 +1,64 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <istream>
+#include <streambuf>
 
 namespace shiguredo::mp4::stream {
 
 std::streamoff get_istream_offset_to_end(std::istream&);
 
+// メモリ上の領域を読み込み専用の streambuf として扱う. 領域はコピーしない
+// base_offset を指定すると, tellg() や seekg() の位置はファイル全体での位置として扱う
+class MemoryStreamBuf : public std::streambuf {
+ public:
+  MemoryStreamBuf(const char* data, const std::size_t size, const std::uint64_t base_offset = 0);
+
+ protected:
+  pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override;
+  pos_type seekpos(pos_type, std::ios_base::openmode) override;
+
+ private:
+  std::uint64_t m_base_offset;
+};
+
+// 別の streambuf の [offset, offset + size) の範囲を読み込み専用の streambuf として扱う
+// 範囲全体はコピーせず, 読み込む分のみを source から内部のバッファーに読み込む
+// tellg() や seekg() の位置は範囲の先頭を 0 とし, 範囲の末尾で EOF になる
+class BoundedStreamBuf : public std::streambuf {
+ public:
+  BoundedStreamBuf(std::streambuf* source, const std::uint64_t offset, const std::uint64_t size);
+
+ protected:
+  int_type underflow() override;
+  pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override;
+  pos_type seekpos(pos_type, std::ios_base::openmode) override;
+
+ private:
+  std::streambuf* m_source;
+  std::uint64_t m_offset;
+  std::uint64_t m_size;
+  // バッファーの末尾に対応する範囲内の位置
+  std::uint64_t m_position = 0;
+  std::array<char, 4096> m_buffer;
+};
+
+// 事前に確保したメモリ上の領域に書き込む streambuf. 領域を超える書き込みは失敗する
+// base_offset を指定すると, tellp() や seekp() の位置はファイル全体での位置として扱う
+class MemoryOutputStreamBuf : public std::streambuf {
+ public:
+  MemoryOutputStreamBuf(char* data, const std::size_t size, const std::uint64_t base_offset = 0);
+
+ protected:
+  pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override;
+  pos_type seekpos(pos_type, std::ios_base::openmode) override;
+
+ private:
+  char* m_begin;
+  char* m_end;
+  std::uint64_t m_base_offset;
+};
+
 }  // namespace shiguredo::mp4::stream
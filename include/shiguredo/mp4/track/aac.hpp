@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
 #include <vector>
 
 #include "shiguredo/mp4/track/soun.hpp"
@@ -24,24 +29,61 @@ struct AACTrackParameters {
   const float duration;
   const std::int64_t media_time = 0;
   const std::uint32_t track_id = 0;
-  const std::uint32_t buffer_size_db = 768;
-  const std::uint32_t max_bitrate;
-  const std::uint32_t avg_bitrate;
+  // 指定しない場合は書き込んだサンプルから計算した値を利用する
+  const std::optional<std::uint32_t> buffer_size_db = {};
+  const std::uint32_t max_bitrate = 0;
+  const std::uint32_t avg_bitrate = 0;
+  const std::vector<std::uint8_t> audio_specific_config = {};
   shiguredo::mp4::writer::Writer* writer;
 };
 
+struct AudioSpecificConfig {
+  std::uint8_t audio_object_type = 0;
+  std::uint32_t sampling_frequency = 0;
+  std::uint8_t channel_configuration = 0;
+};
+
+struct ADTSHeader {
+  std::uint8_t audio_object_type = 0;
+  std::uint8_t sampling_frequency_index = 0;
+  std::uint8_t channel_configuration = 0;
+  std::size_t header_size = 0;
+  std::size_t frame_length = 0;
+  std::uint8_t number_of_raw_data_blocks_in_frame = 0;
+};
+
+bool operator==(AudioSpecificConfig const& left, AudioSpecificConfig const& right);
+std::ostream& operator<<(std::ostream& os, const AudioSpecificConfig& asc);
+bool operator==(ADTSHeader const& left, ADTSHeader const& right);
+std::ostream& operator<<(std::ostream& os, const ADTSHeader& header);
+
+bool parse_adts_header(ADTSHeader*, const std::uint8_t*, const std::size_t);
+bool parse_audio_specific_config(AudioSpecificConfig*, const std::vector<std::uint8_t>&);
+void make_audio_specific_config(std::vector<std::uint8_t>*, const ADTSHeader&);
+std::uint16_t get_aac_channel_count(const std::uint8_t);
+
 class AACTrack : public SounTrack {
  public:
   explicit AACTrack(const AACTrackParameters&);
   void appendTrakBoxInfo(BoxInfo*) override;
   void addData(const std::uint64_t, const std::vector<std::uint8_t>&, bool) override;
   void addData(const std::uint64_t, const std::uint8_t*, const std::size_t, bool) override;
+  void addSamples(const std::span<const Sample>) override;
+  std::unique_ptr<Track> clone() const override;
+  // ADTS ヘッダーから作った AudioSpecificConfig
+  std::vector<std::uint8_t> getCodecConfig() const override;
+  void restoreCodecConfig(const std::vector<std::uint8_t>&) override;
 
  private:
-  const std::uint32_t m_buffer_size_db;
+  const std::optional<std::uint32_t> m_buffer_size_db;
   const std::uint32_t m_max_bitrate;
   const std::uint32_t m_avg_bitrate;
   const std::int16_t m_roll_distance = -1;
+  std::vector<std::uint8_t> m_audio_specific_config;
+  bool m_adts_input = false;
+  // addSamples() で ADTS ヘッダーを除いたサンプルを入れる. 呼び出し毎に確保し直さないよう使い回す
+  std::vector<Sample> m_raw_samples = {};
+  void removeADTSHeader(std::vector<Sample>*, const Sample&);
   void makeStsdBoxInfo(BoxInfo*);
   void makeSgpdBoxInfo(BoxInfo*);
   void makeSbgpBoxInfo(BoxInfo*);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
 
 #include "shiguredo/mp4/track/vide.hpp"
@@ -43,7 +45,9 @@ class AV1Track : public VideTrack {
   void appendTrakBoxInfo(BoxInfo*) override;
   void addData(const std::uint64_t, const std::vector<std::uint8_t>&, bool) override;
   void addData(const std::uint64_t, const std::uint8_t*, const std::size_t, bool) override;
+  void addSamples(const std::span<const Sample>) override;
   void setConfigOBUs(const std::vector<std::uint8_t>&);
+  std::unique_ptr<Track> clone() const override;
 
  private:
   std::uint8_t m_seq_profile;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "shiguredo/mp4/box/avc.hpp"
@@ -40,6 +41,10 @@ class H264Track : public VideTrack {
   void appendTrakBoxInfo(BoxInfo*) override;
   void addData(const std::uint64_t, const std::vector<std::uint8_t>&, bool) override;
   void addData(const std::uint64_t, const std::uint8_t*, const std::size_t, bool) override;
+  std::unique_ptr<Track> clone() const override;
+  // profile, profile_compatibility, level と SPS, PPS
+  std::vector<std::uint8_t> getCodecConfig() const override;
+  void restoreCodecConfig(const std::vector<std::uint8_t>&) override;
 
  private:
   void makeStsdBoxInfo(BoxInfo*);
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 
 #include "shiguredo/mp4/track/soun.hpp"
@@ -24,9 +27,10 @@ struct MP3TrackParameters {
   const float duration;
   const std::int64_t media_time = 0;
   const std::uint32_t track_id = 0;
-  const std::uint32_t buffer_size_db = 768;
-  const std::uint32_t max_bitrate;
-  const std::uint32_t avg_bitrate;
+  // 指定しない場合は書き込んだサンプルから計算した値を利用する
+  const std::optional<std::uint32_t> buffer_size_db = {};
+  const std::uint32_t max_bitrate = 0;
+  const std::uint32_t avg_bitrate = 0;
   shiguredo::mp4::writer::Writer* writer;
 };
 
@@ -36,9 +40,11 @@ class MP3Track : public SounTrack {
   void appendTrakBoxInfo(BoxInfo*) override;
   void addData(const std::uint64_t, const std::vector<std::uint8_t>&, bool) override;
   void addData(const std::uint64_t, const std::uint8_t*, const std::size_t, bool) override;
+  void addSamples(const std::span<const Sample>) override;
+  std::unique_ptr<Track> clone() const override;
 
  private:
-  const std::uint32_t m_buffer_size_db;
+  const std::optional<std::uint32_t> m_buffer_size_db;
   const std::uint32_t m_max_bitrate;
   const std::uint32_t m_avg_bitrate;
   void makeStsdBoxInfo(BoxInfo*);
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
 #include <vector>
 
 #include "shiguredo/mp4/track/soun.hpp"
@@ -18,12 +24,35 @@ class Writer;
 
 namespace shiguredo::mp4::track {
 
+// https://datatracker.ietf.org/doc/html/rfc7845#section-5.1
+struct OpusHead {
+  std::uint8_t version = 1;
+  std::uint8_t channel_count = 2;
+  std::uint16_t pre_skip = 0;
+  std::uint32_t input_sample_rate = 48000;
+  std::int16_t output_gain = 0;
+  std::uint8_t channel_mapping_family = 0;
+  std::uint8_t stream_count = 1;
+  std::uint8_t coupled_count = 1;
+  std::vector<std::uint8_t> channel_mapping = {};
+};
+
+bool operator==(OpusHead const& left, OpusHead const& right);
+std::ostream& operator<<(std::ostream& os, const OpusHead& head);
+
+bool parse_opus_head(OpusHead*, const std::uint8_t*, const std::size_t);
+// Opus パケットの TOC から 48kHz でのサンプル数を求める. 不正なパケットの場合は 0 を返す
+std::uint32_t get_opus_packet_duration(const std::uint8_t*, const std::size_t);
+
 struct OpusTrackParameters {
-  const std::uint64_t pre_skip;
+  // opus_head を指定した場合は opus_head の pre_skip を利用する
+  const std::uint64_t pre_skip = 0;
   const float duration;
   const std::int64_t media_time = 0;
-  const std::int16_t roll_distance = -4;
+  // 指定しない場合は最初のパケットの長さから 80ms 分の pre-roll になるように計算する
+  const std::optional<std::int16_t> roll_distance = {};
   const std::uint32_t track_id = 0;
+  const std::optional<OpusHead> opus_head = {};
   shiguredo::mp4::writer::Writer* writer;
 };
 
@@ -33,14 +62,53 @@ class OpusTrack : public SounTrack {
   void appendTrakBoxInfo(BoxInfo*) override;
   void addData(const std::uint64_t, const std::vector<std::uint8_t>&, bool) override;
   void addData(const std::uint64_t, const std::uint8_t*, const std::size_t, bool) override;
+  void addSamples(const std::span<const Sample>) override;
+  std::unique_ptr<Track> clone() const override;
+  // 最初のパケットの長さ. roll_distance を指定しない場合は sgpd の roll_distance をこの値から計算する
+  std::vector<std::uint8_t> getCodecConfig() const override;
+  void restoreCodecConfig(const std::vector<std::uint8_t>&) override;
 
  private:
-  const std::uint64_t m_pre_skip;
-  const std::int16_t m_roll_distance;
+  const OpusHead m_opus_head;
+  const std::optional<std::int16_t> m_roll_distance;
+  std::uint32_t m_first_packet_duration = 0;
 
   void makeStsdBoxInfo(BoxInfo*);
+  std::int16_t getRollDistance() const;
   void makeSgpdBoxInfo(BoxInfo*);
   void makeSbgpBoxInfo(BoxInfo*);
 };
 
+struct OpusPacket {
+  std::uint64_t timestamp = 0;
+  const std::uint8_t* data = nullptr;
+  std::size_t size = 0;
+};
+
+// Ogg Opus のページから Opus パケットを取り出す
+// https://datatracker.ietf.org/doc/html/rfc7845
+// readPacket() で得られる data は次の readPacket() を呼ぶまで有効
+class OggOpusReader {
+ public:
+  explicit OggOpusReader(std::istream&);
+  const OpusHead& getOpusHead() const;
+  bool readPacket(OpusPacket*);
+
+ private:
+  std::istream& m_is;
+  OpusHead m_opus_head;
+  std::uint32_t m_serial_number = 0;
+  bool m_has_serial_number = false;
+  std::vector<std::uint8_t> m_page = {};
+  std::vector<std::uint8_t> m_lacing_values = {};
+  std::size_t m_segment_index = 0;
+  std::size_t m_page_offset = 0;
+  std::vector<std::uint8_t> m_packet = {};
+  bool m_packet_reassembled = false;
+  std::uint64_t m_timestamp = 0;
+
+  bool readPage();
+  bool readRawPacket(const std::uint8_t**, std::size_t*);
+};
+
 }  // namespace shiguredo::mp4::track
@@ -3,6 +3,9 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -34,6 +37,39 @@ struct ChunkInfo {
   bool initialized = false;
 };
 
+struct Sample {
+  std::uint64_t timestamp = 0;
+  const std::uint8_t* data = nullptr;
+  std::size_t size = 0;
+  bool is_key = false;
+};
+
+// 書き込んだサンプルから求めたビットレートの統計値
+struct BitrateStatistics {
+  std::uint32_t max_bitrate = 0;  // 1 秒間のウィンドウでの最大ビットレート (bps)
+  std::uint32_t avg_bitrate = 0;  // トラック全体の平均ビットレート (bps)
+  // max_bitrate で一定に届くサンプルを復号時刻に取り出すデコーダーに必要なバッファの大きさ (bytes)
+  // 復号時刻毎にサンプルのサイズだけ増え, max_bitrate で減る leaky bucket の最大の水位として求める
+  std::uint32_t buffer_size = 0;
+};
+
+// moov のスナップショットで更新する BoxInfo と, テーブルに反映済みの要素の数
+struct TrackSnapshot {
+  BoxInfo* tkhd = nullptr;
+  BoxInfo* elst = nullptr;
+  BoxInfo* mdhd = nullptr;
+  BoxInfo* stbl = nullptr;
+  BoxInfo* stts = nullptr;
+  BoxInfo* stss = nullptr;
+  BoxInfo* stsc = nullptr;
+  BoxInfo* stsz = nullptr;
+  BoxInfo* offset = nullptr;
+  std::size_t sample_count = 0;
+  std::size_t sample_duration_count = 0;
+  std::size_t key_sample_count = 0;
+  std::size_t chunk_count = 0;
+};
+
 enum HandlerType {
   vide,
   soun,
@@ -45,14 +81,44 @@ class Track {
   virtual void appendTrakBoxInfo(BoxInfo*) = 0;
   virtual void addData(const std::uint64_t, const std::vector<std::uint8_t>&, bool) = 0;
   virtual void addData(const std::uint64_t, const std::uint8_t*, const std::size_t, bool) = 0;
+  // 複数のサンプルをまとめて追加する. サンプルを加工しないトラックではテーブルの確保と mdat への書き込みをまとめて行う
+  virtual void addSamples(const std::span<const Sample>);
+  // サンプルのデータを解析や加工をせずにテーブルにのみ追加する. ジャーナルからの復旧に使う
+  void restoreSamples(const std::span<const Sample>);
+  // サンプルのデータから得た設定 (H264Track の SPS/PPS など) を SampleJournal に記録するためのバイト列. ない場合は空
+  virtual std::vector<std::uint8_t> getCodecConfig() const;
+  // getCodecConfig() のバイト列から設定を戻す. ジャーナルからの復旧に使う
+  virtual void restoreCodecConfig(const std::vector<std::uint8_t>&);
   void setMediaTime(const std::int64_t);
+  void setDuration(const float);
   std::uint64_t getTimescale() const;
+  std::uint32_t getTrackID() const;
+  HandlerType getHandlerType() const;
   void resetChunkOffsets(std::uint64_t);
   void terminateCurrentChunk();
+  BitrateStatistics getBitrateStatistics() const;
+  std::size_t getSampleCount() const;
+  // これまでに追加したサンプルで moov のスナップショットの trak を作る
+  // finalize() はせず, 最後のサンプルの duration は直前のサンプルと同じとする
+  // 初回は appendTrakBoxInfo() で trak を作り, 2 回目以降は前回から増えたサンプルのみをテーブルに追加する
+  // スナップショットの duration を mvhd の timescale で返す
+  std::uint64_t updateSnapshotTrakBoxInfo(BoxInfo* moov);
+  // 同じ設定とサンプルのテーブルを持つトラックを作る. RollingWriter が別のスレッドで moov を作るために使う
+  // 対応していないトラックでは std::logic_error を送出する
+  virtual std::unique_ptr<Track> clone() const;
+  // 設定を引き継いだままサンプルのテーブルを空にする. 次に追加するサンプルの時刻をテーブルの先頭の時刻とする
+  // start_timestamp を指定した場合はその時刻をトラックの先頭とし, 最初のサンプルの時刻との差を elst で表す
+  void resetSamples(const std::optional<std::uint64_t> start_timestamp = std::nullopt);
+  // 最後のサンプルの終了時刻を設定する. 設定した場合は duration の代わりに使う
+  void setEndTimestamp(const std::uint64_t);
+  // 最後のサンプルの duration を直前のサンプルと同じとした終了時刻
+  std::uint64_t getEndTimestamp() const;
+  std::uint64_t getDurationInMvhdTimescale() const;
 
  protected:
   void addMdatData(const std::uint64_t, const std::vector<std::uint8_t>&, bool);
   void addMdatData(const std::uint64_t, const std::uint8_t*, const std::size_t, bool);
+  void addMdatSamples(const std::span<const Sample>);
   std::uint32_t m_timescale;
   float m_duration;
   std::uint32_t m_mvhd_timescale;
@@ -70,8 +136,30 @@ class Track {
   std::uint64_t m_prev_timestamp = 0;
   std::vector<std::uint32_t> m_sample_durations = {};
   std::vector<std::uint32_t> m_key_sample_numbers = {};
+  TrackSnapshot m_snapshot = {};
+  // サンプルのテーブルの先頭の時刻. resetSamples() の後に追加した最初のサンプルの時刻になる
+  std::uint64_t m_start_timestamp = 0;
+  bool m_restart_timestamp = false;
+  // resetSamples() で指定したトラックの先頭の時刻
+  std::optional<std::uint64_t> m_presentation_start_timestamp = std::nullopt;
+  std::optional<std::uint64_t> m_end_timestamp = std::nullopt;
+
+  std::uint64_t m_first_timestamp = 0;
+  std::uint64_t m_total_bits = 0;
+  std::uint64_t m_window_bits = 0;
+  std::uint64_t m_max_window_bits = 0;
+  std::uint64_t m_window_start_timestamp = 0;
+  std::size_t m_window_start_index = 0;
+  std::uint32_t m_max_sample_size = 0;
+  void updateBitrateStatistics(const std::uint64_t, const std::uint32_t);
+  // bitrate (bps) で減る leaky bucket の最大の水位 (bytes)
+  std::uint64_t getLeakyBucketSize(const std::uint64_t bitrate) const;
+  // サンプルを mdat に書き込み, テーブルに追加する
+  void addSamplesToTables(const std::span<const Sample>);
 
   void finalize();
+  // トラックの先頭の時刻. resetSamples() で指定していない場合は最初のサンプルの時刻
+  std::uint64_t getPresentationStartTimestamp() const;
   BoxInfo* makeTrakBoxInfo(BoxInfo*);
   virtual void makeTkhdBoxInfo(BoxInfo*) = 0;
   BoxInfo* makeEdtsBoxInfo(BoxInfo*);
@@ -89,7 +177,6 @@ class Track {
   void makeOffsetBoxInfo(BoxInfo*);
   std::array<std::uint8_t, 4> getHandlerTypeArray();
 
-  std::uint64_t getDurationInMvhdTimescale() const;
   std::uint64_t getDurationInTimescale() const;
 };
 
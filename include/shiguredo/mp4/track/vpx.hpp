@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
 #include <vector>
 
 #include "shiguredo/mp4/track/vide.hpp"
@@ -32,22 +36,54 @@ struct VPXTrackParameters {
   const std::uint32_t track_id = 0;
   const std::uint32_t width;
   const std::uint32_t height;
+  // 0 の場合は書き込んだサンプルから計算した値を利用する
   const std::uint32_t max_bitrate = 0;
   const std::uint32_t avg_bitrate = 0;
   shiguredo::mp4::writer::Writer* writer;
 };
 
+struct VPXFrameHeader {
+  bool is_key = false;
+  std::uint8_t profile = 0;
+  std::uint8_t bit_depth = 8;
+  std::uint8_t chroma_sub_sampling = 1;
+  std::uint8_t video_full_range_flag = 0;
+  std::uint8_t colour_primaries = 2;
+  std::uint8_t transfer_characteristics = 2;
+  std::uint8_t matrix_coefficients = 2;
+  std::uint32_t width = 0;
+  std::uint32_t height = 0;
+};
+
+bool operator==(VPXFrameHeader const& left, VPXFrameHeader const& right);
+
+std::ostream& operator<<(std::ostream& os, const VPXFrameHeader& header);
+
+bool parse_vp8_frame_header(VPXFrameHeader*, const std::uint8_t*, const std::size_t);
+bool parse_vp9_frame_header(VPXFrameHeader*, const std::uint8_t*, const std::size_t);
+
 class VPXTrack : public VideTrack {
  public:
   explicit VPXTrack(const VPXTrackParameters&);
   void appendTrakBoxInfo(BoxInfo*) override;
   void addData(const std::uint64_t, const std::vector<std::uint8_t>&, bool) override;
   void addData(const std::uint64_t, const std::uint8_t*, const std::size_t, bool) override;
+  void addSamples(const std::span<const Sample>) override;
+  std::unique_ptr<Track> clone() const override;
+  // キーフレームのヘッダーから得た vpcC の設定と最大の解像度
+  std::vector<std::uint8_t> getCodecConfig() const override;
+  void restoreCodecConfig(const std::vector<std::uint8_t>&) override;
 
  private:
   const VPXCodec m_codec;
+  VPXFrameHeader m_configuration;
+  bool m_has_configuration = false;
+  // addSamples() で is_key を書き換える場合に使い回すバッファ
+  std::vector<Sample> m_key_detected_samples = {};
 
   void makeStsdBoxInfo(BoxInfo*);
+  void updateConfiguration(const VPXFrameHeader&);
+  bool detectKeyFrame(const Sample&);
 };
 
 }  // namespace shiguredo::mp4::track
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <filesystem>
 #include <ostream>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,7 @@ class FaststartWriter : public Writer {
   void writeMoovBox() override;
 
   void addMdatData(const std::uint8_t*, const std::size_t) override;
+  void addMdatSamples(const std::span<const track::Sample>) override;
   std::uint64_t tellCurrentMdatOffset() override;
 
   void appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>&) override;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "shiguredo/mp4/box/ftyp.hpp"
+#include "shiguredo/mp4/brand.hpp"
+#include "shiguredo/mp4/reader/sample_index.hpp"
+#include "shiguredo/mp4/writer/fragment_run.hpp"
+
+namespace shiguredo::mp4 {
+
+class BoxInfo;
+
+namespace reader {
+
+class SimpleReader;
+
+}
+
+}  // namespace shiguredo::mp4
+
+namespace shiguredo::mp4::writer {
+
+struct FragmentRemuxerParameters {
+  // fragment の長さの目安. 参照トラックの間隔を過ぎた最初のキーフレームで区切る
+  const std::uint32_t fragment_duration_ms = 2000;
+  // サンプルのバイト列をコピーする際のバッファのサイズ
+  const std::size_t copy_buffer_size = 1024 * 1024;
+  const box::FtypParameters ftyp_params{.major_brand = BrandIso6,
+                                        .minor_version = 0,
+                                        .compatible_brands = {BrandIso6, BrandIsom}};
+};
+
+// SimpleWriter などで書き込んだ progressive な MP4 を fragmented MP4 に変換する
+// 元の moov からサンプルの一覧を作り, 参照トラック (最初の映像のトラック, ない場合は最初のトラック) の
+// キーフレームで区切った fragment 毎に全てのトラックの traf を持つ moof と mdat を書き込む
+// サンプルは復号せず, 元のファイルの連続した範囲をまとめて読み込んで mdat にコピーする
+class FragmentRemuxer {
+ public:
+  // is の moov のみを解析する. moov がない場合などは std::runtime_error を送出する
+  FragmentRemuxer(std::istream&, const FragmentRemuxerParameters& params = {});
+  ~FragmentRemuxer();
+  FragmentRemuxer(const FragmentRemuxer&) = delete;
+  FragmentRemuxer& operator=(const FragmentRemuxer&) = delete;
+
+  // ftyp と, サンプルのテーブルを空にして mvex を追加した moov を書き込む
+  void writeInitSegment(std::ostream&);
+  std::size_t getFragmentCount() const;
+  // index 番目の fragment の moof と mdat を書き込む. 他の fragment とは独立に書き込める
+  void writeFragment(std::ostream&, const std::size_t index);
+  // 初期化セグメントと全ての fragment を順に書き込む
+  void write(std::ostream&);
+
+  const std::vector<reader::IndexedTrack>& getTracks() const;
+
+ private:
+  struct SampleRange {
+    std::size_t begin;
+    std::size_t end;
+  };
+
+  std::istream& m_is;
+  const box::FtypParameters m_ftyp_params;
+  std::unique_ptr<reader::SimpleReader> m_reader;
+  BoxInfo* m_moov = nullptr;
+  std::vector<reader::IndexedTrack> m_tracks = {};
+  // fragment 毎, トラック毎のサンプルの範囲
+  std::vector<std::vector<SampleRange>> m_fragments = {};
+  // トラック毎の trex の default_sample_*
+  std::vector<FragmentSampleDefaults> m_trex_defaults = {};
+  std::vector<char> m_copy_buffer;
+
+  void makeFragments(const std::uint32_t fragment_duration_ms);
+  void makeInitMoov();
+};
+
+}  // namespace shiguredo::mp4::writer
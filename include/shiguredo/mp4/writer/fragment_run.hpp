@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "shiguredo/mp4/box/trun.hpp"
+
+namespace shiguredo::mp4::writer {
+
+// trun の sample_flags. キーフレームは他のサンプルに依存せず, それ以外は依存する non-sync サンプルとする
+const std::uint32_t KeySampleFlags = 0x02000000;
+const std::uint32_t NonKeySampleFlags = 0x01010000;
+
+struct FragmentSample {
+  std::uint32_t duration = 0;
+  std::uint32_t size = 0;
+  std::uint32_t flags = 0;
+  std::int64_t composition_time_offset = 0;
+};
+
+// tfhd や trex の default_sample_*
+struct FragmentSampleDefaults {
+  std::uint32_t duration = 0;
+  std::uint32_t size = 0;
+  std::uint32_t flags = 0;
+};
+
+// 1 つの traf の tfhd と trun に書き込む値
+struct FragmentRun {
+  // TfhdDefaultSample*Present の組み合わせ. tfhd_defaults のうち flags に含まれるもののみを書き込む
+  std::uint32_t tfhd_flags = 0;
+  FragmentSampleDefaults tfhd_defaults = {};
+  std::uint8_t trun_version = 0;
+  // 常に TrunDataOffsetPresent を含む
+  std::uint32_t trun_flags = 0;
+  std::uint32_t first_sample_flags = 0;
+  std::vector<box::TrunEntry> entries = {};
+};
+
+// サンプルの duration, size, flags のうち run の中で一定の値は trex と同じなら省略し, 異なれば tfhd に置く
+// 先頭のサンプルの flags のみが異なる場合は first_sample_flags を使い, 残りを一定の値として扱う
+// 一定でない値と composition_time_offset のみを trun の各要素に書き込む
+// samples が空の場合は std::invalid_argument を送出する
+FragmentRun make_fragment_run(const std::span<const FragmentSample>, const FragmentSampleDefaults& trex_defaults);
+
+// トラック全体で最も多く使われる duration, size, flags を trex に置く値として返す
+FragmentSampleDefaults make_trex_defaults(const std::span<const FragmentSample>);
+
+}  // namespace shiguredo::mp4::writer
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "shiguredo/mp4/box/ftyp.hpp"
+#include "shiguredo/mp4/box/styp.hpp"
+#include "shiguredo/mp4/brand.hpp"
+#include "shiguredo/mp4/writer/writer.hpp"
+
+namespace shiguredo::mp4::track {
+
+class Track;
+
+}
+
+namespace shiguredo::mp4::writer {
+
+enum class SidxMode {
+  // sidx を書き込まない
+  None,
+  // セグメント毎に styp の直後に sidx を書き込む. セグメントの moof と mdat はセグメントの終わりまで保持する
+  Segment,
+  // flush() で moov の直後にファイル全体の sidx を 1 つ書き込む. オンデマンド配信用で, moof と mdat は flush() まで
+  // 中間ファイルに書き込んでおき, sidx の後に書き戻す
+  Single,
+};
+
+struct FragmentedWriterParameters {
+  const std::uint32_t mvhd_timescale = 1000;
+  // トラック毎に moof と mdat の組を出力する間隔
+  const std::uint32_t chunk_duration_ms = 200;
+  // styp を出力してセグメントを区切る間隔. 映像のトラックがある場合は間隔を過ぎた最初のキーフレームで区切る
+  const std::uint32_t segment_duration_ms = 2000;
+  // sidx の参照は Segment では参照トラックの moof 毎, Single ではセグメント毎に作る
+  // 参照トラックは最初の映像のトラック, 映像のトラックがない場合は最初のトラックとする
+  const SidxMode sidx_mode = SidxMode::None;
+  // SidxMode::Single で moof と mdat を保持する中間ファイルのパスのテンプレート. mkstemp() に渡す
+  const std::string segment_path_template = "segmentXXXXXX";
+  // flush() の最後に, moof 毎の最初の同期サンプルを tfra に持つ mfra を書き込む
+  const bool write_mfra = false;
+  const box::FtypParameters ftyp_params{.major_brand = BrandIso6,
+                                        .minor_version = 0,
+                                        .compatible_brands = {BrandIso6, BrandCmfc}};
+  const box::StypParameters styp_params{.major_brand = BrandCmfs,
+                                        .minor_version = 0,
+                                        .compatible_brands = {BrandCmfs, BrandMsdh}};
+};
+
+// 先頭から順に書き込むだけで seekp() を行わないため, HTTP の chunked transfer などのシークできない ostream に出力できる
+// ftyp, moov を書き込んだ後, サンプルを chunk_duration_ms 毎に自己完結した moof と mdat の組として書き込む
+// moov を書き込む前に完成した moof と mdat は, moov の書き込み後に書き込む
+class FragmentedWriter : public Writer {
+ public:
+  FragmentedWriter(std::ostream&, const FragmentedWriterParameters&);
+  // 中間ファイルを閉じて削除する
+  ~FragmentedWriter() override;
+
+  void writeFtypBox() override;
+  void writeMoovBox() override;
+
+  // moof に含めるトラックが不明なため利用できない. Track から addTrackSamples() を呼び出す
+  void addMdatData(const std::uint8_t*, const std::size_t) override;
+  void addTrackSamples(const track::Track&, const std::span<const track::Sample>) override;
+  std::uint64_t tellCurrentMdatOffset() override;
+  // サンプルの情報は moof に書き込むため, trak の中のサンプルのテーブルは空にする
+  bool usesSampleTables() const override;
+
+  // 初期化セグメントの moov を作る. mvex に trex を追加する
+  void appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>&) override;
+
+  // 保持しているサンプルを全て書き込む. 最後のサンプルの duration は直前のサンプルと同じにする
+  // sidx を書き込む場合は保持しているセグメントも書き込む
+  void flush();
+
+  std::uint32_t getSequenceNumber() const;
+  std::uint64_t getSegmentCount() const;
+  // SidxMode::Single の中間ファイルのパス. それ以外では空になる
+  std::filesystem::path getIntermediateFilePath() const;
+
+ private:
+  struct PendingSample {
+    std::uint64_t timestamp;
+    std::uint32_t size;
+    bool is_key;
+  };
+
+  struct TrackState {
+    std::uint32_t track_id;
+    std::uint64_t timescale;
+    bool is_video;
+    std::vector<PendingSample> samples = {};
+    std::vector<std::uint8_t> data = {};
+    std::uint32_t last_duration = 0;
+  };
+
+  // sidx の 1 つの参照が指す範囲
+  struct IndexRange {
+    std::uint64_t size = 0;
+    std::uint64_t duration = 0;
+    bool has_reference_track = false;
+    std::uint64_t earliest_presentation_time = 0;
+    bool has_sap = false;
+    std::uint64_t sap_delta_time = 0;
+  };
+
+  // tfra の要素. offset は書き込みが終わるまでは書き込み前のバッファの中の位置になる
+  struct RandomAccessEntry {
+    std::uint32_t track_id;
+    std::uint64_t time;
+    std::uint64_t offset;
+    std::uint32_t sample_number;
+  };
+
+  std::ostream& m_os;
+  const box::FtypParameters m_ftyp_params;
+  const box::StypParameters m_styp_params;
+  const std::uint32_t m_chunk_duration_ms;
+  const std::uint32_t m_segment_duration_ms;
+  const SidxMode m_sidx_mode;
+  const bool m_write_mfra;
+  std::vector<TrackState> m_track_states = {};
+  bool m_has_video = false;
+  bool m_moov_written = false;
+  // moov を書き込む前に完成した moof と mdat
+  std::vector<char> m_pending_output = {};
+  std::vector<RandomAccessEntry> m_pending_entries = {};
+  std::uint64_t m_written_size = 0;
+  std::uint32_t m_sequence_number = 0;
+  std::uint64_t m_segment_count = 0;
+  std::uint64_t m_segment_start_ms = 0;
+  std::uint32_t m_reference_track_id = 0;
+  // sidx を書き込む場合に sidx の後に書き込む Box と sidx を挿入する位置
+  std::vector<char> m_segment_output = {};
+  std::size_t m_sidx_position = 0;
+  std::vector<IndexRange> m_index_ranges = {};
+  std::vector<RandomAccessEntry> m_segment_entries = {};
+  // SidxMode::Single では m_segment_output の代わりに中間ファイルに書き込む
+  std::filesystem::path m_segment_path = {};
+  std::FILE* m_segment_fd = nullptr;
+  std::uint64_t m_segment_file_size = 0;
+  // 書き込みが終わった moof の tfra の要素
+  std::vector<RandomAccessEntry> m_random_access_entries = {};
+
+  TrackState* getTrackState(const track::Track&);
+  bool startsSegment(const TrackState&, const PendingSample&) const;
+  void writeChunk(TrackState*, const std::uint64_t end_timestamp);
+  void addIndexRange(const TrackState&, const std::uint64_t size, const std::uint64_t end_timestamp);
+  void writeSegmentWithSidx();
+  void copySegmentFile(const std::vector<RandomAccessEntry>&);
+  void writeMfra();
+  void appendBox(BoxInfo*, std::vector<char>* buffer);
+  void output(const std::vector<char>&, const std::vector<RandomAccessEntry>& entries = {});
+  void writeBuffer(const std::vector<char>&, const std::vector<RandomAccessEntry>& entries = {});
+
+  void setOffsetAndSize() override;
+};
+
+}  // namespace shiguredo::mp4::writer
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "shiguredo/mp4/box/ftyp.hpp"
+#include "shiguredo/mp4/brand.hpp"
+#include "shiguredo/mp4/reader/fragmented_demuxer.hpp"
+#include "shiguredo/mp4/reader/sample_index.hpp"
+
+namespace shiguredo::mp4 {
+
+class BoxInfo;
+
+namespace reader {
+
+class SimpleReader;
+
+}
+
+}  // namespace shiguredo::mp4
+
+namespace shiguredo::mp4::writer {
+
+struct ProgressiveRemuxerParameters {
+  // サンプルのバイト列をコピーする際のバッファのサイズ
+  const std::size_t copy_buffer_size = 1024 * 1024;
+  const box::FtypParameters ftyp_params{.major_brand = BrandIsom,
+                                        .minor_version = 512,
+                                        .compatible_brands = {BrandIsom, BrandIso2, BrandMp41}};
+};
+
+// FragmentedWriter などで書き込んだ fragmented MP4 を, moov を先頭に置いた progressive な MP4 に変換する
+// 1 回目の走査では moov と moof のみを読み, mdat は読み飛ばしてサンプルのテーブルと moov のサイズを求める
+// 2 回目の走査で ftyp, moov, mdat を書き込み, 元のファイルで連続したサンプルの範囲をまとめて mdat にコピーする
+// トラック毎の最初の decode time の差は elst の空の edit に, fragment の間の空きは直前のサンプルの duration にする
+class ProgressiveRemuxer {
+ public:
+  // is の moov と moof を解析する. moov や tkhd がない場合などは std::runtime_error を送出する
+  ProgressiveRemuxer(std::istream&, const ProgressiveRemuxerParameters& params = {});
+  ~ProgressiveRemuxer();
+  ProgressiveRemuxer(const ProgressiveRemuxer&) = delete;
+  ProgressiveRemuxer& operator=(const ProgressiveRemuxer&) = delete;
+
+  void write(std::ostream&);
+  // write() で書き込むバイト数
+  std::uint64_t getOutputSize() const;
+  // サンプルの offset は元のファイルでの位置
+  const std::vector<reader::IndexedTrack>& getTracks() const;
+
+ private:
+  // 元のファイルで連続した 1 つのトラックのサンプルの範囲. 書き込む MP4 の chunk になる
+  struct Chunk {
+    std::size_t track_index;
+    std::size_t begin;
+    std::size_t end;
+    std::uint64_t size;
+  };
+
+  std::istream& m_is;
+  std::unique_ptr<reader::SimpleReader> m_reader;
+  std::unique_ptr<BoxInfo> m_ftyp;
+  BoxInfo* m_moov = nullptr;
+  std::vector<BoxInfo*> m_traks = {};
+  std::vector<BoxInfo*> m_stbls = {};
+  std::vector<reader::IndexedTrack> m_tracks = {};
+  std::vector<Chunk> m_chunks = {};
+  std::uint64_t m_mdat_data_size = 0;
+  std::uint64_t m_mdat_offset = 0;
+  std::uint64_t m_mdat_header_size = 0;
+  std::vector<char> m_copy_buffer;
+
+  std::map<std::uint32_t, reader::TrackFragmentDefaults> readMoov();
+  void readMoofs(const std::map<std::uint32_t, reader::TrackFragmentDefaults>&);
+  void makeMoov();
+  // トラックの先頭の空き (empty_duration) と元の elst の media_time から elst を作り直し, tkhd の duration を返す
+  std::uint64_t makeElst(const std::size_t track_index,
+                         const std::uint64_t mvhd_timescale,
+                         const std::uint64_t empty_duration,
+                         const std::uint64_t media_duration);
+  void setChunkOffsets(const std::uint64_t mdat_data_offset);
+};
+
+}  // namespace shiguredo::mp4::writer
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace shiguredo::mp4 {
+
+class BoxInfo;
+
+}  // namespace shiguredo::mp4
+
+namespace shiguredo::mp4::writer {
+
+// ProgressiveRemuxer と FragmentRemuxer で共通の処理
+
+// stbl からサンプルのテーブル (stts, ctts, stsc, stsz, stz2, stco, co64, stss, sdtp, sbgp) を取り除く
+void remove_sample_tables(BoxInfo* stbl);
+
+// adjustOffsetAndSize() の後に呼び出す. 子孫を含めて 1 度の ostream::write() で書き込む
+void write_box(const BoxInfo*, std::ostream&);
+
+// is の [offset, offset + size) を buffer の大きさずつ os にコピーする. 読み込みに失敗した場合は std::runtime_error を送出する
+void copy_range(std::istream& is,
+                std::ostream& os,
+                const std::uint64_t offset,
+                const std::uint64_t size,
+                std::vector<char>* buffer);
+
+}  // namespace shiguredo::mp4::writer
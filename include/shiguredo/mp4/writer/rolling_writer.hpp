@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "shiguredo/mp4/box/ftyp.hpp"
+#include "shiguredo/mp4/brand.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/simple_writer.hpp"
+#include "shiguredo/mp4/writer/writer.hpp"
+
+namespace shiguredo::mp4::writer {
+
+struct RollingWriterParameters {
+  const std::uint32_t mvhd_timescale = 1000;
+  // セグメントの長さ. この長さを超えた後の最初のキーフレームで次のセグメントに切り替える
+  const std::uint64_t segment_duration_ms = 600000;
+  const box::FtypParameters ftyp_params{.major_brand = BrandIsom,
+                                        .minor_version = 512,
+                                        .compatible_brands = {BrandIsom, BrandIso2, BrandMp41}};
+  // セグメントの番号を受け取り, 書き込み先を返す. 返した stream は on_segment_finished が呼ばれるまで有効にしておく
+  // stream は seekp() できる必要がある
+  const std::function<std::ostream*(const std::uint64_t)> open_segment;
+  // セグメントの moov の書き込みが終わると呼び出される. moov を書き込むスレッドから呼び出される場合がある
+  const std::function<void(const std::uint64_t)> on_segment_finished = {};
+};
+
+// 映像のキーフレームで出力を切り替え, 一定の長さの MP4 ファイルに分けて書き込む
+// 前のセグメントの moov は別のスレッドで書き込むので, 切り替え時にサンプルの書き込みが止まらない
+// 使い方は SimpleWriter と同じで, 最後に appendTrakAndUdtaBoxInfo() と writeMoovBox() を呼び出す
+// - 切り替えの判定は映像のトラック (ない場合は最初のトラック) のキーフレームで行う. まとめて追加したサンプルは切り替えるキーフレームの手前で分ける
+// - 各セグメントは切り替えたキーフレームの時刻を先頭とし, 他のトラックの最初のサンプルとの差は elst で表す
+// - トラックの duration は使わず, 最後のサンプルの duration は直前のサンプルと同じとする
+// - トラックは Track::clone() に対応している必要がある
+class RollingWriter : public Writer {
+ public:
+  explicit RollingWriter(const RollingWriterParameters&);
+  ~RollingWriter();
+  RollingWriter(const RollingWriter&) = delete;
+  RollingWriter& operator=(const RollingWriter&) = delete;
+
+  void setTracks(const std::vector<track::Track*>&);
+
+  void writeFtypBox() override;
+  // 最後のセグメントを含め, 全てのセグメントの moov の書き込みが終わるまで待つ
+  // moov を書き込むスレッドで発生した例外はここで送出する
+  void writeMoovBox() override;
+
+  void addMdatData(const std::uint8_t*, const std::size_t) override;
+  void addMdatSamples(const std::span<const track::Sample>) override;
+  std::size_t prepareTrackSamples(track::Track&, const std::span<const track::Sample>) override;
+  std::uint64_t tellCurrentMdatOffset() override;
+
+  // 最後のセグメントの moov の書き込みを依頼する
+  void appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>&) override;
+
+  std::uint64_t getSegmentIndex() const;
+
+ private:
+  struct Segment {
+    std::uint64_t index = 0;
+    std::ostream* os = nullptr;
+    std::unique_ptr<SimpleWriter> writer = nullptr;
+    std::vector<std::unique_ptr<track::Track>> tracks = {};
+  };
+
+  const std::uint64_t m_segment_duration_ms;
+  const box::FtypParameters m_ftyp_params;
+  const std::function<std::ostream*(const std::uint64_t)> m_open_segment;
+  const std::function<void(const std::uint64_t)> m_on_segment_finished;
+
+  std::vector<track::Track*> m_tracks = {};
+  track::Track* m_reference_track = nullptr;
+  std::uint64_t m_segment_index = 0;
+  std::optional<std::uint64_t> m_segment_start_ms = std::nullopt;
+  std::ostream* m_os = nullptr;
+  std::unique_ptr<SimpleWriter> m_writer = nullptr;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<Segment> m_segments = {};
+  bool m_stopped = false;
+  std::exception_ptr m_error = nullptr;
+  std::thread m_thread;
+
+  void setOffsetAndSize() override;
+  void openSegment();
+  // 最初のキーフレームか, セグメントの長さを超えた後のキーフレームの場合に true を返す
+  bool isSegmentBoundary(const track::Track&, const track::Sample&) const;
+  // 現在のセグメントのトラックを複製して moov の書き込みを依頼する. end_timestamp は基準のトラックの終了時刻
+  void queueSegment(const std::optional<std::uint64_t> end_timestamp);
+  void rethrowError();
+  void run();
+  void writeSegment(Segment*);
+};
+
+}  // namespace shiguredo::mp4::writer
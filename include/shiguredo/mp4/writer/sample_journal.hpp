@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <span>
+#include <vector>
+
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/simple_writer.hpp"
+
+namespace shiguredo::mp4::writer {
+
+struct SampleJournalParameters {
+  // この数のサンプルを記録する毎に fsync() する. 0 の場合は sync() を呼び出した場合のみ fsync() する
+  const std::uint32_t sync_interval = 64;
+};
+
+// SimpleWriter が mdat に書き込んだサンプルの情報をファイルに追記する
+// 1 サンプルは track_id, timestamp, size, flags の 17 バイトで, duration は次のサンプルの timestamp から求める
+// Track::getCodecConfig() が変わった場合は同じ形式の記録に続けて設定のバイト列を書き込む
+class SampleJournal {
+ public:
+  explicit SampleJournal(const std::filesystem::path&, const SampleJournalParameters& params = {});
+  ~SampleJournal();
+  SampleJournal(const SampleJournal&) = delete;
+  SampleJournal& operator=(const SampleJournal&) = delete;
+
+  void append(const track::Track&, const std::span<const track::Sample>);
+  // 記録した内容をディスクに書き込む
+  void sync();
+
+ private:
+  std::FILE* m_fp;
+  const std::uint32_t m_sync_interval;
+  std::uint32_t m_unsynced_count = 0;
+  std::vector<std::uint8_t> m_buffer = {};
+  // track_id 毎に最後に記録した設定
+  std::map<std::uint32_t, std::vector<std::uint8_t>> m_codec_configs = {};
+};
+
+struct JournalRecoveryWriterParameters {
+  const std::uint32_t mvhd_timescale = 1000;
+};
+
+// SimpleWriter で writeMoovBox() の前に中断したファイルを SampleJournal の記録から復旧する
+// サンプルのデータは読まずに, ジャーナルからサンプルのテーブルを作り, mdat のヘッダーと moov を書き込む
+// 記録されていてもファイルに書き込まれていなかったサンプルは捨て, moov の後ろに残ったデータは free で覆う
+// 使い方:
+//   JournalRecoveryWriter writer(file, {});
+//   // 記録時と同じ track_id とパラメーターで, writer にこのインスタンスを指定してトラックを作り直す
+//   writer.readJournal(journal_path, tracks);
+//   writer.appendTrakAndUdtaBoxInfo(tracks);
+//   writer.writeMoovBox();
+// サンプルのデータから得た設定 (H264Track の SPS/PPS など) はジャーナルの記録から Track::restoreCodecConfig() で戻す
+class JournalRecoveryWriter : public SimpleWriter {
+ public:
+  // file は SimpleWriter で書き込んだファイルを読み書きできるように開いたもの. ftyp がない場合は std::runtime_error を送出する
+  JournalRecoveryWriter(std::iostream&, const JournalRecoveryWriterParameters&);
+
+  // ジャーナルのサンプルを tracks に追加し, トラックと movie の duration を設定する. 復旧したサンプルの数を返す
+  std::uint64_t readJournal(const std::filesystem::path&, const std::vector<track::Track*>&);
+  void writeMoovBox() override;
+
+  void addMdatData(const std::uint8_t*, const std::size_t) override;
+  void addMdatSamples(const std::span<const track::Sample>) override;
+  void addTrackSamples(const track::Track&, const std::span<const track::Sample>) override;
+  std::uint64_t tellCurrentMdatOffset() override;
+
+ private:
+  std::iostream& m_file;
+  std::uint64_t m_file_size;
+};
+
+}  // namespace shiguredo::mp4::writer
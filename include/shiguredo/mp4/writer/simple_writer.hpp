@@ -2,12 +2,19 @@
 
 #include <cstdint>
 #include <ostream>
+#include <span>
 #include <vector>
 
 #include "shiguredo/mp4/box/ftyp.hpp"
 #include "shiguredo/mp4/brand.hpp"
 #include "shiguredo/mp4/writer/writer.hpp"
 
+namespace shiguredo::mp4::box {
+
+class Free;
+
+}
+
 namespace shiguredo::mp4::track {
 
 class Track;
@@ -16,32 +23,69 @@ class Track;
 
 namespace shiguredo::mp4::writer {
 
+class SampleJournal;
+
 struct SimpleWriterParameters {
   const std::uint32_t mvhd_timescale = 1000;
   const float duration;
   const box::FtypParameters ftyp_params{.major_brand = BrandIsom,
                                         .minor_version = 512,
                                         .compatible_brands = {BrandIsom, BrandIso2, BrandMp41}};
+  // 指定した場合は mdat に書き込んだサンプルの情報を記録する. writeMoovBox() の前に中断した場合の復旧に使う
+  SampleJournal* const journal = nullptr;
+  // 0 より大きい場合は setCheckpointTracks() で指定したトラックのサンプルの時刻がこの間隔を超える毎に writeCheckpoint() する
+  // サンプルを複数の mdat に分けて書き込むため journal とは同時に指定できない
+  const std::uint64_t checkpoint_interval_ms = 0;
 };
 
 class SimpleWriter : public Writer {
  public:
   SimpleWriter(std::ostream&, const SimpleWriterParameters&);
+  ~SimpleWriter();
 
   void writeFtypBox() override;
   void writeMoovBox() override;
   void writeFreeBoxAndMdatHeader();
 
   void addMdatData(const std::uint8_t*, const std::size_t) override;
+  void addMdatSamples(const std::span<const track::Sample>) override;
+  void commitTrackSamples(const track::Track&, const std::span<const track::Sample>) override;
   std::uint64_t tellCurrentMdatOffset() override;
 
   void appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>&) override;
 
+  void setCheckpointTracks(const std::vector<track::Track*>&);
+  // これまでに書き込んだサンプルの moov のスナップショットを mdat の後ろに書き込み, 続くサンプルは新しい mdat に書き込む
+  // 前のスナップショットは free にするので, 中断したファイルは最後のスナップショットまで再生できる
+  // スナップショットは free で詰めた領域に書き込み, 収まる間は同じ位置に上書きする. 収まらない場合は倍の大きさの領域に移すので,
+  // free になる領域の合計は最後のスナップショットの領域の大きさ未満になる
+  // サンプルのないトラックがある場合は書き込まずに false を返す
+  bool writeCheckpoint();
+
  private:
   std::ostream& m_os;
   const box::FtypParameters m_ftyp_params;
+  SampleJournal* m_journal;
+
+  const std::uint64_t m_checkpoint_interval_ms;
+  std::uint64_t m_next_checkpoint_ms;
+  std::vector<track::Track*> m_checkpoint_tracks = {};
+  BoxInfo* m_checkpoint_moov_box_info = nullptr;
+  box::Mvhd* m_checkpoint_mvhd_box = nullptr;
+  // スナップショットの moov の末尾で領域の残りを詰める free. 作り直さずに大きさだけを変える
+  BoxInfo* m_checkpoint_padding_box_info = nullptr;
+  box::Free* m_checkpoint_padding_box = nullptr;
+  // 最後に書き込んだスナップショットの領域の位置とサイズ
+  std::uint64_t m_checkpoint_moov_offset = 0;
+  std::uint64_t m_checkpoint_moov_size = 0;
+  // 最後のスナップショットより前の mdat のデータのサイズ
+  std::uint64_t m_checkpoint_mdat_data_size = 0;
 
   void setOffsetAndSize() override;
+  // サンプルを書き込んでいる mdat の free を含めた領域の先頭
+  std::uint64_t getCurrentMdatOffset() const;
+  std::uint64_t getDataEndOffset() const;
+  void writeFreeBoxAndMdatHeader(const std::uint64_t offset, const std::uint64_t data_size, const bool extend_to_eof);
 };
 
 }  // namespace shiguredo::mp4::writer
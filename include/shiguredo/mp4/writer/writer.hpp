@@ -2,10 +2,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <span>
 #include <vector>
 
 #include "shiguredo/mp4/box/data.hpp"
 #include "shiguredo/mp4/box/ftyp.hpp"
+#include "shiguredo/mp4/track/track.hpp"
 
 namespace shiguredo::mp4 {
 
@@ -17,12 +19,6 @@ class Mvhd;
 
 }  // namespace box
 
-namespace track {
-
-class Track;
-
-}
-
 }  // namespace shiguredo::mp4
 
 namespace shiguredo::mp4::writer {
@@ -36,6 +32,16 @@ class Writer {
 
   virtual void addMdatData(const std::uint8_t*, const std::size_t) = 0;
   void addMdatData(const std::vector<std::uint8_t>&);
+  virtual void addMdatSamples(const std::span<const track::Sample>);
+  // Track から呼び出される. トラック毎に書き込み先を変える Writer 以外は addMdatSamples() と同じ
+  virtual void addTrackSamples(const track::Track&, const std::span<const track::Sample>);
+  // addTrackSamples() で書き込んだサンプルを Track がテーブルに追加した後に呼び出される
+  virtual void commitTrackSamples(const track::Track&, const std::span<const track::Sample>);
+  // Track がサンプルをテーブルに追加する前に呼び出される. 先頭から現在の出力に書き込むサンプルの数を返す
+  // Track は残りのサンプルで再び呼び出す. 出力を切り替える Writer 以外は何もせずに全てのサンプルの数を返す
+  virtual std::size_t prepareTrackSamples(track::Track&, const std::span<const track::Sample>);
+  // false の場合 Track は moov の stbl に書き込むサンプルのテーブルを作らない
+  virtual bool usesSampleTables() const;
   virtual std::uint64_t tellCurrentMdatOffset() = 0;
 
   virtual void appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>&) = 0;
@@ -48,6 +54,9 @@ class Writer {
   std::uint64_t getTimeFromEpoch() const;
   std::uint32_t getMvhdTimescale() const;
   std::uint32_t getAndUpdateNextTrackID();
+  void setNextTrackID(const std::uint32_t);
+  // mvhd の duration を mvhd の timescale で設定する
+  void setMvhdDuration(const std::uint64_t);
 
  protected:
   std::uint32_t m_mvhd_timescale;
@@ -61,6 +70,11 @@ class Writer {
   box::Mvhd* m_mvhd_box;
 
   virtual void setOffsetAndSize() = 0;
+  // サンプルのデータを 1 度に書き込めるよう連続した領域にまとめる. 次に呼び出すまで有効
+  std::span<const char> gatherSamples(const std::span<const track::Sample>);
+
+ private:
+  std::vector<char> m_gather_buffer = {};
 };
 
 }  // namespace shiguredo::mp4::writer
@@ -85,4 +85,28 @@ std::istream& Reader::getIStream() const {
   return m_is;
 }
 
+std::uint64_t Reader::getRemainingSize() {
+  const auto offset = m_is.tellg();
+  m_is.seekg(0, std::ios_base::end);
+  const auto end_offset = m_is.tellg();
+  m_is.seekg(offset, std::ios_base::beg);
+  if (!m_is.good() || offset < 0 || end_offset < offset) {
+    throw std::runtime_error(
+        fmt::format("bitio::Reader::getRemainingSize(): istream::seekg() failed: rdstate={}", m_is.rdstate()));
+  }
+  return static_cast<std::uint64_t>(end_offset - offset);
+}
+
+void Reader::checkEntryCount(const std::uint64_t count, const std::uint64_t min_entry_size) {
+  if (count == 0 || min_entry_size == 0) {
+    return;
+  }
+  const auto remaining_size = getRemainingSize();
+  if (count > remaining_size / min_entry_size) {
+    throw std::runtime_error(
+        fmt::format("bitio::Reader::checkEntryCount(): entry count({}) * entry size({}) exceeds remaining size({})",
+                    count, min_entry_size, remaining_size));
+  }
+}
+
 }  // namespace shiguredo::mp4::bitio
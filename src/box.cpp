@@ -61,6 +61,10 @@ void Box::setHeader(BoxHeader* header) {
   m_header = header;
 }
 
+std::string Box::toStringOnlyDataWithMaxEntries(const std::size_t) const {
+  return toStringOnlyData();
+}
+
 std::string Box::toString() const {
   auto only_data = toStringOnlyData();
   if (!std::empty(only_data)) {
@@ -98,6 +102,13 @@ std::uint64_t Box::getSize() const {
   throw std::logic_error("Box::getSize(): header is not set");
 }
 
+std::uint64_t Box::getOffset() const {
+  if (m_header) {
+    return m_header->getOffset();
+  }
+  throw std::logic_error("Box::getOffset(): header is not set");
+}
+
 void Box::setOffsetAndDataSize(const std::uint64_t offset, const std::uint64_t data_size) {
   makeHeader();
   m_header->setOffsetAndDataSize(offset, data_size);
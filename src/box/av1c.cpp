@@ -16,10 +16,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_av1c() {
-  return BoxType("av1C");
-}
-
 AV1CodecConfiguration::AV1CodecConfiguration() {
   m_type = box_type_av1c();
 }
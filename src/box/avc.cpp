@@ -68,8 +68,8 @@ std::uint64_t AVCParameterSet::getSize() const {
   return 2 + std::size(m_nal_unit);
 }
 
-BoxType box_type_avcc() {
-  return BoxType("avcC");
+const std::vector<std::uint8_t>& AVCParameterSet::getNalUnit() const {
+  return m_nal_unit;
 }
 
 AVCDecoderConfiguration::AVCDecoderConfiguration() {
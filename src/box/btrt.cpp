@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_btrt() {
-  return BoxType("btrt");
-}
-
 Btrt::Btrt(const BtrtParameters& params)
     : m_decoding_buffer_size(params.decoding_buffer_size),
       m_max_bitrate(params.max_bitrate),
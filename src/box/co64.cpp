@@ -1,8 +1,8 @@
 #include "shiguredo/mp4/box/co64.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -16,10 +16,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_co64() {
-  return BoxType("co64");
-}
-
 Co64::Co64() {
   m_type = box_type_co64();
 }
@@ -31,8 +27,12 @@ Co64::Co64(const Co64Parameters& params) : m_chunk_offsets(params.chunk_offsets)
 }
 
 std::string Co64::toStringOnlyData() const {
-  return fmt::format("{} EntryCount={} ChunkOffsets=[{:#x}]", getVersionAndFlagsString(), std::size(m_chunk_offsets),
-                     fmt::join(m_chunk_offsets, ", "));
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Co64::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
+  return fmt::format("{} EntryCount={} ChunkOffsets=[{}]", getVersionAndFlagsString(), std::size(m_chunk_offsets),
+                     join_entries(m_chunk_offsets, max_entries, [](const auto o) { return fmt::format("{:#x}", o); }));
 }
 
 std::uint64_t Co64::writeData(std::ostream& os) const {
@@ -62,4 +62,12 @@ std::ostream& operator<<(std::ostream& os, const Co64& co64) {
   return os;
 }
 
+const std::vector<std::uint64_t>& Co64::getChunkOffsets() const {
+  return m_chunk_offsets;
+}
+
+void Co64::addChunkOffset(const std::uint64_t chunk_offset) {
+  m_chunk_offsets.push_back(chunk_offset);
+}
+
 }  // namespace shiguredo::mp4::box
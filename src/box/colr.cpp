@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_colr() {
-  return BoxType("colr");
-}
-
 Colr::Colr() {
   m_type = box_type_colr();
 }
@@ -1,7 +1,6 @@
 #include "shiguredo/mp4/box/ctts.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
 #include <algorithm>
 #include <cstddef>
@@ -39,10 +38,6 @@ std::uint64_t CttsEntry::readData(bitio::Reader* reader) {
   return rbits;
 }
 
-BoxType box_type_ctts() {
-  return BoxType("ctts");
-}
-
 Ctts::Ctts() {
   m_type = box_type_ctts();
 }
@@ -54,12 +49,12 @@ Ctts::Ctts(const CttsParameters& params) : m_entries(params.entries) {
 }
 
 std::string Ctts::toStringOnlyData() const {
-  std::vector<std::string> entries;
-  std::transform(std::begin(m_entries), std::end(m_entries), std::back_inserter(entries),
-                 [](const auto& e) { return e.toString(); });
+  return toStringOnlyDataWithMaxEntries(0);
+}
 
+std::string Ctts::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
   return fmt::format("{} EntryCount={} Entries=[{}]", getVersionAndFlagsString(), std::size(m_entries),
-                     fmt::join(entries, ", "));
+                     join_entries(m_entries, max_entries, [](const auto& e) { return e.toString(); }));
 }
 
 std::uint64_t Ctts::writeData(std::ostream& os) const {
@@ -76,6 +71,7 @@ std::uint64_t Ctts::readData(std::istream& is) {
   std::uint64_t rbits = readVersionAndFlag(&reader);
   std::uint32_t entry_count;
   rbits += bitio::read_uint<std::uint32_t>(&reader, &entry_count);
+  reader.checkEntryCount(entry_count, 8);
   m_entries.resize(entry_count);
   for (std::size_t i = 0; i < entry_count; ++i) {
     rbits += m_entries[i].readData(&reader);
@@ -87,4 +83,16 @@ std::uint64_t Ctts::getDataSize() const {
   return 8 + 8 * std::size(m_entries);
 }
 
+std::uint32_t CttsEntry::getSampleCount() const {
+  return m_sample_count;
+}
+
+std::int64_t CttsEntry::getSampleOffset() const {
+  return m_sample_offset;
+}
+
+const std::vector<CttsEntry>& Ctts::getEntries() const {
+  return m_entries;
+}
+
 }  // namespace shiguredo::mp4::box
@@ -15,10 +15,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_dOps() {
-  return BoxType("dOps");
-}
-
 DOps::DOps() {
   m_type = box_type_dOps();
 }
@@ -18,10 +18,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_data() {
-  return BoxType("data");
-}
-
 Data::Data() {
   m_type = box_type_data();
 }
@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_dinf() {
-  return BoxType("dinf");
-}
-
 Dinf::Dinf() {
   m_type = box_type_dinf();
 }
@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_dref() {
-  return BoxType("dref");
-}
-
 Dref::Dref() {
   m_type = box_type_dref();
 }
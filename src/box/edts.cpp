@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_edts() {
-  return BoxType("edts");
-}
-
 Edts::Edts() {
   m_type = box_type_edts();
 }
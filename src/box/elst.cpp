@@ -1,7 +1,6 @@
 #include "shiguredo/mp4/box/elst.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 #include <ext/alloc_traits.h>
 
 #include <algorithm>
@@ -9,6 +8,7 @@
 #include <cstdint>
 #include <istream>
 #include <iterator>
+#include <limits>
 #include <numeric>
 #include <string>
 #include <vector>
@@ -46,10 +46,6 @@ double ElstEntry::getMediaRate() const {
   return static_cast<double>(m_media_rate) / (1 << 16);
 }
 
-BoxType box_type_elst() {
-  return BoxType("elst");
-}
-
 Elst::Elst() {
   m_type = box_type_elst();
 }
@@ -61,12 +57,12 @@ Elst::Elst(const ElstParameters& params) : m_entries(params.entries) {
 }
 
 std::string Elst::toStringOnlyData() const {
-  std::vector<std::string> entries;
-  std::transform(std::begin(m_entries), std::end(m_entries), std::back_inserter(entries),
-                 [](const auto& e) { return e.toString(); });
+  return toStringOnlyDataWithMaxEntries(0);
+}
 
+std::string Elst::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
   return fmt::format("{} EntryCount={} Entries=[{}]", getVersionAndFlagsString(), std::size(m_entries),
-                     fmt::join(entries, ", "));
+                     join_entries(m_entries, max_entries, [](const auto& e) { return e.toString(); }));
 }
 
 std::uint64_t Elst::writeData(std::ostream& os) const {
@@ -88,6 +84,7 @@ std::uint64_t Elst::readData(std::istream& is) {
   std::uint64_t rbits = readVersionAndFlag(&reader);
   std::uint32_t entry_count;
   rbits += bitio::read_uint<std::uint32_t>(&reader, &entry_count);
+  reader.checkEntryCount(entry_count, m_version == 0 ? 12 : 20);
   m_entries.resize(entry_count);
   for (std::size_t i = 0; i < entry_count; ++i) {
     ElstEntry entry;
@@ -97,4 +94,26 @@ std::uint64_t Elst::readData(std::istream& is) {
   return rbits;
 }
 
+void Elst::setTrackDuration(const std::uint64_t track_duration) {
+  auto media = std::find_if(std::rbegin(m_entries), std::rend(m_entries),
+                            [](const auto& entry) { return entry.m_media_time != -1; });
+  if (media == std::rend(m_entries)) {
+    return;
+  }
+  // 最後の edit 以外の長さを除いた残りを最後の edit の長さにする
+  const std::uint64_t others =
+      std::accumulate(std::begin(m_entries), std::end(m_entries), std::uint64_t{0},
+                      [](const auto sum, const auto& entry) { return sum + entry.m_track_duration; }) -
+      media->m_track_duration;
+  media->m_track_duration = track_duration > others ? track_duration - others : 0;
+  // version 0 では 32 bit に収まらない
+  if (media->m_track_duration > std::numeric_limits<std::uint32_t>::max()) {
+    setVersion(1);
+  }
+}
+
+const std::vector<ElstEntry>& Elst::getEntries() const {
+  return m_entries;
+}
+
 }  // namespace shiguredo::mp4::box
@@ -17,10 +17,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_emsg() {
-  return BoxType("emsg");
-}
-
 Emsg::Emsg() {
   m_type = box_type_emsg();
 }
@@ -279,10 +279,6 @@ std::string SLConfigDescr::toString() const {
   return fmt::format("{{Tag=SLConfigDescr DataSize={} Data=[{:#x}]}}", getDataSize(), fmt::join(m_data, ", "));
 }
 
-BoxType box_type_esds() {
-  return BoxType("esds");
-}
-
 Esds::Esds() {
   m_type = box_type_esds();
 }
@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_fiel() {
-  return BoxType("fiel");
-}
-
 Fiel::Fiel(const FielParameters& params) : m_field_count(params.field_count), m_field_ordering(params.field_ordering) {
   m_type = box_type_fiel();
 }
@@ -1,8 +1,8 @@
 #include "shiguredo/mp4/box/free.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -17,10 +17,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_free() {
-  return BoxType("free");
-}
-
 Free::Free() {
   m_type = box_type_free();
 }
@@ -30,7 +26,12 @@ Free::Free(const FreeParameters& params) : m_data(params.data) {
 }
 
 std::string Free::toStringOnlyData() const {
-  return fmt::format("Data=[{:#x}]", fmt::join(m_data, ", "));
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Free::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
+  return fmt::format("Data=[{}]",
+                     join_entries(m_data, max_entries, [](const auto d) { return fmt::format("{:#x}", d); }));
 }
 
 std::uint64_t Free::writeData(std::ostream& os) const {
@@ -48,4 +49,8 @@ std::uint64_t Free::getDataSize() const {
   return std::size(m_data);
 }
 
+void Free::setDataSize(const std::size_t size) {
+  m_data.resize(size, 0);
+}
+
 }  // namespace shiguredo::mp4::box
@@ -22,10 +22,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_ftyp() {
-  return BoxType("ftyp");
-}
-
 Ftyp::Ftyp() {
   m_type = box_type_ftyp();
 }
@@ -16,10 +16,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_hdlr() {
-  return BoxType("hdlr");
-}
-
 Hdlr::Hdlr() {
   m_type = box_type_hdlr();
 }
@@ -80,4 +76,8 @@ std::uint64_t Hdlr::readData(std::istream& is) {
   return rbits + bitio::read_vector_uint<std::uint8_t>(&reader, (offset_to_end * 8) - name_rbits, &m_padding);
 }
 
+std::string Hdlr::getHandlerType() const {
+  return std::string(std::begin(m_handler_type), std::end(m_handler_type));
+}
+
 }  // namespace shiguredo::mp4::box
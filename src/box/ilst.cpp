@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_ilst() {
-  return BoxType("ilst");
-}
-
 Ilst::Ilst() {
   m_type = box_type_ilst();
 }
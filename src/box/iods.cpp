@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_iods() {
-  return BoxType("iods");
-}
-
 Iods::Iods() {
   m_type = box_type_iods();
 }
@@ -17,10 +17,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mdat() {
-  return BoxType("mdat");
-}
-
 Mdat::Mdat() {
   m_type = box_type_mdat();
 }
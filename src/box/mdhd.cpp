@@ -6,6 +6,7 @@
 #include <array>
 #include <cstdint>
 #include <istream>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -17,10 +18,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mdhd() {
-  return BoxType("mdhd");
-}
-
 Mdhd::Mdhd() {
   m_type = box_type_mdhd();
 }
@@ -91,4 +88,20 @@ std::array<std::uint8_t, 3> decode_language(const std::uint16_t enc) {
   return lng;
 }
 
+std::uint32_t Mdhd::getTimescale() const {
+  return m_timescale;
+}
+
+std::uint64_t Mdhd::getDuration() const {
+  return m_duration;
+}
+
+void Mdhd::setDuration(const std::uint64_t duration) {
+  m_duration = duration;
+  // version 0 では 32 bit に収まらない
+  if (duration > std::numeric_limits<std::uint32_t>::max()) {
+    setVersion(1);
+  }
+}
+
 }  // namespace shiguredo::mp4::box
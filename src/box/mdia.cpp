@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mdia() {
-  return BoxType("mdia");
-}
-
 Mdia::Mdia() {
   m_type = box_type_mdia();
 }
@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mehd() {
-  return BoxType("mehd");
-}
-
 Mehd::Mehd() {
   m_type = box_type_mehd();
 }
@@ -48,4 +44,8 @@ std::uint64_t Mehd::readData(std::istream& is) {
   return rbits + bitio::read_uint<std::uint64_t>(&reader, &m_fragment_duration, m_version == 0 ? 32 : 64);
 }
 
+std::uint64_t Mehd::getFragmentDuration() const {
+  return m_fragment_duration;
+}
+
 }  // namespace shiguredo::mp4::box
@@ -11,10 +11,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_meta() {
-  return BoxType("meta");
-}
-
 Meta::Meta() {
   m_type = box_type_meta();
 }
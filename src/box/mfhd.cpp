@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mfhd() {
-  return BoxType("mfhd");
-}
-
 Mfhd::Mfhd() {
   m_type = box_type_mfhd();
 }
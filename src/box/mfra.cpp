@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mfra() {
-  return BoxType("mfra");
-}
-
 Mfra::Mfra() {
   m_type = box_type_mfra();
 }
@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mfro() {
-  return BoxType("mfro");
-}
-
 Mfro::Mfro() {
   m_type = box_type_mfro();
 }
@@ -48,4 +44,8 @@ std::uint64_t Mfro::getDataSize() const {
   return 8;
 }
 
+std::uint32_t Mfro::getMfraSize() const {
+  return m_size;
+}
+
 }  // namespace shiguredo::mp4::box
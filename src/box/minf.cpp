@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_minf() {
-  return BoxType("minf");
-}
-
 Minf::Minf() {
   m_type = box_type_minf();
 }
@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_moof() {
-  return BoxType("moof");
-}
-
 Moof::Moof() {
   m_type = box_type_moof();
 }
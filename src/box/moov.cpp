@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_moov() {
-  return BoxType("moov");
-}
-
 Moov::Moov() {
   m_type = box_type_moov();
 }
@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mvex() {
-  return BoxType("mvex");
-}
-
 Mvex::Mvex() {
   m_type = box_type_mvex();
 }
@@ -5,6 +5,7 @@
 
 #include <cstdint>
 #include <istream>
+#include <limits>
 #include <iterator>
 #include <string>
 #include <vector>
@@ -17,10 +18,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_mvhd() {
-  return BoxType("mvhd");
-}
-
 Mvhd::Mvhd() {
   m_type = box_type_mvhd();
 }
@@ -105,4 +102,20 @@ void Mvhd::setNextTrackID(const std::uint32_t next_track_id) {
   m_next_track_id = next_track_id;
 }
 
+std::uint32_t Mvhd::getTimescale() const {
+  return m_timescale;
+}
+
+std::uint64_t Mvhd::getDuration() const {
+  return m_duration;
+}
+
+void Mvhd::setDuration(const std::uint64_t duration) {
+  m_duration = duration;
+  // version 0 では 32 bit に収まらない
+  if (duration > std::numeric_limits<std::uint32_t>::max()) {
+    setVersion(1);
+  }
+}
+
 }  // namespace shiguredo::mp4::box
@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_pasp() {
-  return BoxType("pasp");
-}
-
 PixelAspectRatio::PixelAspectRatio() {
   m_type = box_type_pasp();
 }
@@ -40,10 +40,6 @@ std::uint64_t PsshKID::readData(bitio::Reader* reader) {
   return rbits;
 }
 
-BoxType box_type_pssh() {
-  return BoxType("pssh");
-}
-
 Pssh::Pssh() {
   m_type = box_type_pssh();
 }
@@ -93,6 +89,7 @@ std::uint64_t Pssh::readData(std::istream& is) {
   if (m_version != 0) {
     std::uint32_t kid_count;
     rbits += bitio::read_uint<std::uint32_t>(&reader, &kid_count);
+    reader.checkEntryCount(kid_count, 16);
     m_kids.resize(static_cast<std::size_t>(kid_count));
     for (std::uint32_t i = 0; i < kid_count; ++i) {
       PsshKID kid;
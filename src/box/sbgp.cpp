@@ -1,9 +1,9 @@
 #include "shiguredo/mp4/box/sbgp.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -35,10 +35,6 @@ std::uint64_t SbgpEntry::readData(bitio::Reader* reader) {
   return rbits + bitio::read_uint<std::uint32_t>(reader, &m_group_description_index);
 }
 
-BoxType box_type_sbgp() {
-  return BoxType("sbgp");
-}
-
 Sbgp::Sbgp() {
   m_type = box_type_sbgp();
 }
@@ -53,15 +49,17 @@ Sbgp::Sbgp(const SbgpParameters& params)
 }
 
 std::string Sbgp::toStringOnlyData() const {
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Sbgp::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
   std::string grouping_type(std::begin(m_grouping_type), std::end(m_grouping_type));
   std::string s = fmt::format(R"({} GroupingType="{}")", getVersionAndFlagsString(), grouping_type);
   if (m_version != 0) {
     s += fmt::format(" GroupingTypeParameter={}", m_grouping_type_parameter);
   }
-  std::vector<std::string> entries;
-  std::transform(std::begin(m_entries), std::end(m_entries), std::back_inserter(entries),
-                 [](const auto& e) { return e.toString(); });
-  return s + fmt::format(" EntryCount={} Entries=[{}]", std::size(m_entries), fmt::join(entries, ", "));
+  return s + fmt::format(" EntryCount={} Entries=[{}]", std::size(m_entries),
+                         join_entries(m_entries, max_entries, [](const auto& e) { return e.toString(); }));
 }
 
 std::uint64_t Sbgp::writeData(std::ostream& os) const {
@@ -87,6 +85,7 @@ std::uint64_t Sbgp::readData(std::istream& is) {
 
   std::uint32_t size;
   rbits += bitio::read_uint<std::uint32_t>(&reader, &size);
+  reader.checkEntryCount(size, 8);
   m_entries.resize(size);
   for (std::size_t i = 0; i < size; ++i) {
     rbits += m_entries[i].readData(&reader);
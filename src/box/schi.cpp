@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_schi() {
-  return BoxType("schi");
-}
-
 Schi::Schi() {
   m_type = box_type_schi();
 }
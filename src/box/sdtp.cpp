@@ -1,7 +1,6 @@
 #include "shiguredo/mp4/box/sdtp.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
 #include <algorithm>
 #include <cstddef>
@@ -21,10 +20,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_sdtp() {
-  return BoxType("sdtp");
-}
-
 Sdtp::Sdtp() {
   m_type = box_type_sdtp();
 }
@@ -34,11 +29,12 @@ Sdtp::Sdtp(const SdtpParameters& params) : m_samples(params.samples) {
 }
 
 std::string Sdtp::toStringOnlyData() const {
-  std::vector<std::string> samples;
-  std::transform(std::begin(m_samples), std::end(m_samples), std::back_inserter(samples),
-                 [](const auto& s) { return s.toString(); });
+  return toStringOnlyDataWithMaxEntries(0);
+}
 
-  return fmt::format("{} Samples=[{}]", getVersionAndFlagsString(), fmt::join(samples, ", "));
+std::string Sdtp::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
+  return fmt::format("{} Samples=[{}]", getVersionAndFlagsString(),
+                     join_entries(m_samples, max_entries, [](const auto& s) { return s.toString(); }));
 }
 
 std::uint64_t Sdtp::writeData(std::ostream& os) const {
@@ -22,10 +22,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_sgpd() {
-  return BoxType("sgpd");
-}
-
 Sgpd::Sgpd() {
   m_type = box_type_sgpd();
 }
@@ -174,6 +170,7 @@ std::uint64_t Sgpd::readData(std::istream& is) {
   if (m_grouping_type == GroupingTypeRoll || m_grouping_type == GroupingTypeProl) {
     std::uint32_t size;
     rbits += bitio::read_uint<std::uint32_t>(&reader, &size);
+    reader.checkEntryCount(size, no_default_length ? 6 : 2);
     m_roll_distances.resize(size);
     for (std::size_t i = 0; i < size; ++i) {
       rbits += m_roll_distances[i].readData(&reader, no_default_length);
@@ -183,6 +180,7 @@ std::uint64_t Sgpd::readData(std::istream& is) {
   if (m_grouping_type == GroupingTypeAlst) {
     std::uint32_t size;
     rbits += bitio::read_uint<std::uint32_t>(&reader, &size);
+    reader.checkEntryCount(size, no_default_length ? 8 : 4);
     m_alternative_startup_entries.resize(size);
     for (std::size_t i = 0; i < size; ++i) {
       rbits += m_alternative_startup_entries[i].readData(&reader, m_default_length, no_default_length);
@@ -192,6 +190,7 @@ std::uint64_t Sgpd::readData(std::istream& is) {
   if (m_grouping_type == GroupingTypeRap) {
     std::uint32_t size;
     rbits += bitio::read_uint<std::uint32_t>(&reader, &size);
+    reader.checkEntryCount(size, no_default_length ? 5 : 1);
     m_visual_random_access_entries.resize(size);
     for (std::size_t i = 0; i < size; ++i) {
       rbits += m_visual_random_access_entries[i].readData(&reader, no_default_length);
@@ -201,6 +200,7 @@ std::uint64_t Sgpd::readData(std::istream& is) {
   if (m_grouping_type == GroupingTypeTele) {
     std::uint32_t size;
     rbits += bitio::read_uint<std::uint32_t>(&reader, &size);
+    reader.checkEntryCount(size, no_default_length ? 5 : 1);
     m_temporal_level_entries.resize(size);
     for (std::size_t i = 0; i < size; ++i) {
       rbits += m_temporal_level_entries[i].readData(&reader, no_default_length);
@@ -329,6 +329,8 @@ std::uint64_t AlternativeStartupEntry::readData(bitio::Reader* reader,
         fmt::format("AlternativeStartupEntry::readData(): invalid offset of AlternativeStartupEntry: {}", offset));
   }
   size = static_cast<std::size_t>(offset / 32);
+  // description_length や length はファイルの値なので, 残りのデータに収まらない場合は確保しない
+  reader->checkEntryCount(size, 4);
   m_opts.resize(size);
   for (std::size_t i = 0; i < size; ++i) {
     rbits += m_opts[i].readData(reader);
@@ -1,9 +1,9 @@
 #include "shiguredo/mp4/box/sidx.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -18,10 +18,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_sidx() {
-  return BoxType("sidx");
-}
-
 Sidx::Sidx() {
   m_type = box_type_sidx();
 }
@@ -38,15 +34,15 @@ Sidx::Sidx(const SidxParameters& params)
 }
 
 std::string Sidx::toStringOnlyData() const {
-  std::vector<std::string> references;
-  std::transform(std::begin(m_references), std::end(m_references), std::back_inserter(references),
-                 [](const auto& r) { return r.toString(); });
+  return toStringOnlyDataWithMaxEntries(0);
+}
 
+std::string Sidx::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
   return fmt::format(
       "{} ReferenceID={} Timescale={} EarliestPresentationTime={} "
       "FirstOffset={} ReferenceCount={} References=[{}]",
       getVersionAndFlagsString(), m_reference_id, m_timescale, m_earliest_presentation_time, m_first_offset,
-      std::size(references), fmt::join(references, ", "));
+      std::size(m_references), join_entries(m_references, max_entries, [](const auto& r) { return r.toString(); }));
 }
 
 std::uint64_t Sidx::writeData(std::ostream& os) const {
@@ -79,6 +75,7 @@ std::uint64_t Sidx::readData(std::istream& is) {
   rbits += bitio::read_uint<std::uint16_t>(&reader, &m_reserved);
   std::uint16_t size;
   rbits += bitio::read_uint<std::uint16_t>(&reader, &size);
+  reader.checkEntryCount(size, 12);
   m_references.resize(size);
   for (std::size_t i = 0; i < size; ++i) {
     rbits += m_references[i].readData(&reader);
@@ -87,6 +84,22 @@ std::uint64_t Sidx::readData(std::istream& is) {
   return rbits;
 }
 
+std::uint32_t Sidx::getReferenceID() const {
+  return m_reference_id;
+}
+
+std::uint64_t Sidx::getEarliestPresentationTime() const {
+  return m_earliest_presentation_time;
+}
+
+std::uint64_t Sidx::getFirstOffset() const {
+  return m_first_offset;
+}
+
+const std::vector<SidxReference>& Sidx::getReferences() const {
+  return m_references;
+}
+
 SidxReference::SidxReference(const SidxReferenceParameters& params)
     : m_reference_type(params.reference_type),
       m_reference_size(params.reference_size),
@@ -120,4 +133,16 @@ std::uint64_t SidxReference::readData(bitio::Reader* reader) {
   return rbits + bitio::read_uint<std::uint32_t>(reader, &m_sap_delta_time, 28);
 }
 
+std::uint32_t SidxReference::getReferenceSize() const {
+  return m_reference_size;
+}
+
+std::uint32_t SidxReference::getSubsegmentDuration() const {
+  return m_subsegument_duration;
+}
+
+bool SidxReference::getStartsWithSAP() const {
+  return m_starts_with_sap;
+}
+
 }  // namespace shiguredo::mp4::box
@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_sinf() {
-  return BoxType("sinf");
-}
-
 Sinf::Sinf() {
   m_type = box_type_sinf();
 }
@@ -1,8 +1,8 @@
 #include "shiguredo/mp4/box/skip.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -17,10 +17,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_skip() {
-  return BoxType("skip");
-}
-
 Skip::Skip() {
   m_type = box_type_skip();
 }
@@ -30,7 +26,12 @@ Skip::Skip(const SkipParameters& params) : m_data(params.data) {
 }
 
 std::string Skip::toStringOnlyData() const {
-  return fmt::format("Data=[{:#x}]", fmt::join(m_data, ", "));
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Skip::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
+  return fmt::format("Data=[{}]",
+                     join_entries(m_data, max_entries, [](const auto d) { return fmt::format("{:#x}", d); }));
 }
 
 std::uint64_t Skip::writeData(std::ostream& os) const {
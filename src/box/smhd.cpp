@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_smhd() {
-  return BoxType("smhd");
-}
-
 Smhd::Smhd() {
   m_type = box_type_smhd();
 }
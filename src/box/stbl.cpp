@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_stbl() {
-  return BoxType("stbl");
-}
-
 Stbl::Stbl() {
   m_type = box_type_stbl();
 }
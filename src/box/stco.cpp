@@ -1,8 +1,8 @@
 #include "shiguredo/mp4/box/stco.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -16,10 +16,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_stco() {
-  return BoxType("stco");
-}
-
 Stco::Stco() {
   m_type = box_type_stco();
 }
@@ -31,8 +27,12 @@ Stco::Stco(const StcoParameters& params) : m_chunk_offsets(params.chunk_offsets)
 }
 
 std::string Stco::toStringOnlyData() const {
-  return fmt::format("{} EntryCount={} ChunkOffsets=[{:#x}]", getVersionAndFlagsString(), std::size(m_chunk_offsets),
-                     fmt::join(m_chunk_offsets, ", "));
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Stco::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
+  return fmt::format("{} EntryCount={} ChunkOffsets=[{}]", getVersionAndFlagsString(), std::size(m_chunk_offsets),
+                     join_entries(m_chunk_offsets, max_entries, [](const auto o) { return fmt::format("{:#x}", o); }));
 }
 
 std::uint64_t Stco::writeData(std::ostream& os) const {
@@ -59,4 +59,12 @@ std::ostream& operator<<(std::ostream& os, const Stco& stco) {
   return os;
 }
 
+const std::vector<std::uint32_t>& Stco::getChunkOffsets() const {
+  return m_chunk_offsets;
+}
+
+void Stco::addChunkOffset(const std::uint32_t chunk_offset) {
+  m_chunk_offsets.push_back(chunk_offset);
+}
+
 }  // namespace shiguredo::mp4::box
@@ -1,9 +1,9 @@
 #include "shiguredo/mp4/box/stsc.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -19,10 +19,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_stsc() {
-  return BoxType("stsc");
-}
-
 Stsc::Stsc() {
   m_type = box_type_stsc();
 }
@@ -34,11 +30,12 @@ Stsc::Stsc(const StscParameters& params) : m_entries(params.entries) {
 }
 
 std::string Stsc::toStringOnlyData() const {
-  std::vector<std::string> entries;
-  std::transform(std::begin(m_entries), std::end(m_entries), std::back_inserter(entries),
-                 [](const auto& e) { return e.toString(); });
-  return fmt::format("{} EntryCount={} Entries=[{}]", getVersionAndFlagsString(), std::size(entries),
-                     fmt::join(entries, ", "));
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Stsc::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
+  return fmt::format("{} EntryCount={} Entries=[{}]", getVersionAndFlagsString(), std::size(m_entries),
+                     join_entries(m_entries, max_entries, [](const auto& e) { return e.toString(); }));
 }
 
 std::uint64_t Stsc::writeData(std::ostream& os) const {
@@ -60,6 +57,7 @@ std::uint64_t Stsc::readData(std::istream& is) {
   std::uint64_t rbits = readVersionAndFlag(&reader);
   std::uint32_t entry_count;
   rbits += bitio::read_uint<std::uint32_t>(&reader, &entry_count);
+  reader.checkEntryCount(entry_count, 12);
   m_entries.resize(entry_count);
   for (std::uint32_t i = 0; i < entry_count; ++i) {
     rbits += m_entries[i].readData(&reader);
@@ -94,4 +92,28 @@ std::ostream& operator<<(std::ostream& os, const StscEntry& entry) {
   return os;
 }
 
+std::uint32_t StscEntry::getFirstChunk() const {
+  return m_first_chunk;
+}
+
+std::uint32_t StscEntry::getSamplesPerChunk() const {
+  return m_sample_per_chunk;
+}
+
+std::uint32_t StscEntry::getSampleDescriptionIndex() const {
+  return m_sample_description_index;
+}
+
+const std::vector<StscEntry>& Stsc::getEntries() const {
+  return m_entries;
+}
+
+void Stsc::addChunk(const std::uint32_t chunk, const std::uint32_t samples_per_chunk) {
+  if (!std::empty(m_entries) && m_entries.back().getSamplesPerChunk() == samples_per_chunk) {
+    return;
+  }
+  m_entries.push_back(
+      StscEntry({.first_chunk = chunk, .samples_per_chunk = samples_per_chunk, .sample_description_index = 1}));
+}
+
 }  // namespace shiguredo::mp4::box
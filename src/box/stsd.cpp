@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_stsd() {
-  return BoxType("stsd");
-}
-
 Stsd::Stsd() {
   m_type = box_type_stsd();
 }
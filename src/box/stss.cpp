@@ -1,11 +1,12 @@
 #include "shiguredo/mp4/box/stss.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -16,10 +17,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_stss() {
-  return BoxType("stss");
-}
-
 Stss::Stss() {
   m_type = box_type_stss();
 }
@@ -31,8 +28,12 @@ Stss::Stss(const StssParmeters& params) : m_sample_numbers(params.sample_numbers
 }
 
 std::string Stss::toStringOnlyData() const {
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Stss::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
   return fmt::format("{} EntryCount={} SampleNumbers=[{}]", getVersionAndFlagsString(), std::size(m_sample_numbers),
-                     fmt::join(m_sample_numbers, ", "));
+                     join_entries(m_sample_numbers, max_entries, [](const auto n) { return fmt::format("{}", n); }));
 }
 
 std::uint64_t Stss::writeData(std::ostream& os) const {
@@ -55,4 +56,12 @@ std::uint64_t Stss::readData(std::istream& is) {
   return rbits += bitio::read_vector_uint<std::uint32_t>(&reader, entry_count, &m_sample_numbers);
 }
 
+const std::vector<std::uint32_t>& Stss::getSampleNumbers() const {
+  return m_sample_numbers;
+}
+
+void Stss::addSampleNumbers(const std::span<const std::uint32_t> sample_numbers) {
+  m_sample_numbers.insert(std::end(m_sample_numbers), std::begin(sample_numbers), std::end(sample_numbers));
+}
+
 }  // namespace shiguredo::mp4::box
@@ -1,11 +1,12 @@
 #include "shiguredo/mp4/box/stsz.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -16,10 +17,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_stsz() {
-  return BoxType("stsz");
-}
-
 Stsz::Stsz() {
   m_type = box_type_stsz();
 }
@@ -31,8 +28,13 @@ Stsz::Stsz(const StszParameters& params) : m_sample_size(params.sample_size), m_
 }
 
 std::string Stsz::toStringOnlyData() const {
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Stsz::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
   return fmt::format("{} SampleSize={} SampleCount={} EntrySizes=[{}]", getVersionAndFlagsString(), m_sample_size,
-                     std::size(m_entry_sizes), fmt::join(m_entry_sizes, ", "));
+                     std::size(m_entry_sizes),
+                     join_entries(m_entry_sizes, max_entries, [](const auto s) { return fmt::format("{}", s); }));
 }
 
 std::uint64_t Stsz::writeData(std::ostream& os) const {
@@ -59,9 +61,22 @@ std::uint64_t Stsz::readData(std::istream& is) {
   if (m_sample_size == 0) {
     rbits += bitio::read_vector_uint<std::uint32_t>(&reader, sample_count, &m_entry_sizes);
   } else {
-    m_entry_sizes.clear();
+    // sample_size が一定の場合も sample_count を保持する
+    m_entry_sizes.assign(sample_count, m_sample_size);
   }
   return rbits;
 }
 
+std::uint32_t Stsz::getSampleCount() const {
+  return static_cast<std::uint32_t>(std::size(m_entry_sizes));
+}
+
+const std::vector<std::uint32_t>& Stsz::getEntrySizes() const {
+  return m_entry_sizes;
+}
+
+void Stsz::addEntrySizes(const std::span<const std::uint32_t> entry_sizes) {
+  m_entry_sizes.insert(std::end(m_entry_sizes), std::begin(entry_sizes), std::end(entry_sizes));
+}
+
 }  // namespace shiguredo::mp4::box
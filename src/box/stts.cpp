@@ -1,9 +1,9 @@
 #include "shiguredo/mp4/box/stts.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -19,10 +19,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_stts() {
-  return BoxType("stts");
-}
-
 Stts::Stts() {
   m_type = box_type_stts();
 }
@@ -34,11 +30,12 @@ Stts::Stts(const SttsParameters& params) : m_entries(params.entries) {
 }
 
 std::string Stts::toStringOnlyData() const {
-  std::vector<std::string> entries;
-  std::transform(std::begin(m_entries), std::end(m_entries), std::back_inserter(entries),
-                 [](const auto& e) { return e.toString(); });
-  return fmt::format("{} EntryCount={} Entries=[{}]", getVersionAndFlagsString(), std::size(entries),
-                     fmt::join(entries, ", "));
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Stts::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
+  return fmt::format("{} EntryCount={} Entries=[{}]", getVersionAndFlagsString(), std::size(m_entries),
+                     join_entries(m_entries, max_entries, [](const auto& e) { return e.toString(); }));
 }
 
 std::uint64_t Stts::writeData(std::ostream& os) const {
@@ -60,6 +57,7 @@ std::uint64_t Stts::readData(std::istream& is) {
   std::uint64_t rbits = readVersionAndFlag(&reader);
   std::uint32_t entry_count;
   rbits += bitio::read_uint<std::uint32_t>(&reader, &entry_count);
+  reader.checkEntryCount(entry_count, 8);
   m_entries.resize(entry_count);
   for (std::uint32_t i = 0; i < entry_count; ++i) {
     rbits += m_entries[i].readData(&reader);
@@ -89,4 +87,38 @@ std::ostream& operator<<(std::ostream& os, const SttsEntry& entry) {
   return os;
 }
 
+std::uint32_t SttsEntry::getSampleCount() const {
+  return m_sample_count;
+}
+
+std::uint32_t SttsEntry::getSampleDuration() const {
+  return m_sample_duration;
+}
+
+const std::vector<SttsEntry>& Stts::getEntries() const {
+  return m_entries;
+}
+
+void Stts::addSample(const std::uint32_t sample_duration) {
+  if (!std::empty(m_entries) && m_entries.back().getSampleDuration() == sample_duration) {
+    const auto sample_count = m_entries.back().getSampleCount() + 1;
+    m_entries.back() = SttsEntry({.sample_count = sample_count, .sample_duration = sample_duration});
+  } else {
+    m_entries.push_back(SttsEntry({.sample_count = 1, .sample_duration = sample_duration}));
+  }
+}
+
+void Stts::removeLastSample() {
+  if (std::empty(m_entries)) {
+    return;
+  }
+  const auto& last = m_entries.back();
+  if (last.getSampleCount() > 1) {
+    m_entries.back() =
+        SttsEntry({.sample_count = last.getSampleCount() - 1, .sample_duration = last.getSampleDuration()});
+  } else {
+    m_entries.pop_back();
+  }
+}
+
 }  // namespace shiguredo::mp4::box
@@ -22,10 +22,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_styp() {
-  return BoxType("styp");
-}
-
 Styp::Styp() {
   m_type = box_type_styp();
 }
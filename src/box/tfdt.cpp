@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_tfdt() {
-  return BoxType("tfdt");
-}
-
 Tfdt::Tfdt() {
   m_type = box_type_tfdt();
 }
@@ -48,4 +44,8 @@ std::uint64_t Tfdt::readData(std::istream& is) {
   return rbits + bitio::read_uint<std::uint64_t>(&reader, &m_base_media_decode_time, m_version == 0 ? 32 : 64);
 }
 
+std::uint64_t Tfdt::getBaseMediaDecodeTime() const {
+  return m_base_media_decode_time;
+}
+
 }  // namespace shiguredo::mp4::box
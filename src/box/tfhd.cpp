@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_tfhd() {
-  return BoxType("tfhd");
-}
-
 Tfhd::Tfhd() {
   m_type = box_type_tfhd();
 }
@@ -122,4 +118,28 @@ std::uint64_t Tfhd::readData(std::istream& is) {
   return rbits;
 }
 
+std::uint32_t Tfhd::getTrackID() const {
+  return m_track_id;
+}
+
+std::uint64_t Tfhd::getBaseDataOffset() const {
+  return m_base_data_offset;
+}
+
+std::uint32_t Tfhd::getSampleDescriptionIndex() const {
+  return m_sample_description_index;
+}
+
+std::uint32_t Tfhd::getDefaultSampleDuration() const {
+  return m_default_sample_duration;
+}
+
+std::uint32_t Tfhd::getDefaultSampleSize() const {
+  return m_default_sample_size;
+}
+
+std::uint32_t Tfhd::getDefaultSampleFlags() const {
+  return m_default_sample_flags;
+}
+
 }  // namespace shiguredo::mp4::box
@@ -1,9 +1,9 @@
 #include "shiguredo/mp4/box/tfra.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -19,10 +19,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_tfra() {
-  return BoxType("tfra");
-}
-
 Tfra::Tfra() {
   m_type = box_type_tfra();
 }
@@ -39,14 +35,16 @@ Tfra::Tfra(const TfraParameters& params)
 }
 
 std::string Tfra::toStringOnlyData() const {
-  std::vector<std::string> entries;
-  std::transform(std::begin(m_entries), std::end(m_entries), std::back_inserter(entries),
-                 [](const auto& e) { return e.toString(); });
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Tfra::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
   return fmt::format(
       "{} TrackID={} LengthSizeOfTrafNum={:#x} LengthSizeOfTrunNum={:#x} LengthSizeOfSampleNum={:#x} NumberOfEntry={} "
       "Entries=[{}]",
       getVersionAndFlagsString(), m_track_id, m_length_size_of_traf_num, m_length_size_of_trun_num,
-      m_length_size_of_sample_num, std::size(entries), fmt::join(entries, ", "));
+      m_length_size_of_sample_num, std::size(m_entries),
+      join_entries(m_entries, max_entries, [](const auto& e) { return e.toString(); }));
 }
 
 std::uint64_t Tfra::writeData(std::ostream& os) const {
@@ -83,6 +81,9 @@ std::uint64_t Tfra::readData(std::istream& is) {
   rbits += bitio::read_uint<std::uint8_t>(&reader, &m_length_size_of_sample_num, 2);
   std::uint32_t entry_count;
   rbits += bitio::read_uint<std::uint32_t>(&reader, &entry_count);
+  const auto min_entry_size = static_cast<std::uint64_t>((m_version == 0 ? 8 : 16) + m_length_size_of_traf_num +
+                                                         m_length_size_of_trun_num + m_length_size_of_sample_num + 3);
+  reader.checkEntryCount(entry_count, min_entry_size);
   m_entries.resize(entry_count);
   for (std::uint32_t i = 0; i < entry_count; ++i) {
     rbits += m_entries[i].readData(&reader, m_version, m_length_size_of_traf_num, m_length_size_of_trun_num,
@@ -91,6 +92,14 @@ std::uint64_t Tfra::readData(std::istream& is) {
   return rbits;
 }
 
+std::uint32_t Tfra::getTrackID() const {
+  return m_track_id;
+}
+
+const std::vector<TfraEntry>& Tfra::getEntries() const {
+  return m_entries;
+}
+
 TfraEntry::TfraEntry(const TfraEntryParameters& params)
     : m_time(params.time),
       m_moof_offset(params.moof_offset),
@@ -145,4 +154,24 @@ std::uint64_t TfraEntry::readData(bitio::Reader* reader,
   return rbits;
 }
 
+std::uint64_t TfraEntry::getTime() const {
+  return m_time;
+}
+
+std::uint64_t TfraEntry::getMoofOffset() const {
+  return m_moof_offset;
+}
+
+std::uint32_t TfraEntry::getTrafNumber() const {
+  return m_traf_number;
+}
+
+std::uint32_t TfraEntry::getTrunNumber() const {
+  return m_trun_number;
+}
+
+std::uint32_t TfraEntry::getSampleNumber() const {
+  return m_sample_number;
+}
+
 }  // namespace shiguredo::mp4::box
@@ -5,6 +5,7 @@
 
 #include <cstdint>
 #include <istream>
+#include <limits>
 #include <iterator>
 #include <string>
 #include <vector>
@@ -17,10 +18,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_tkhd() {
-  return BoxType("tkhd");
-}
-
 Tkhd::Tkhd() {
   m_type = box_type_tkhd();
 }
@@ -119,4 +116,20 @@ double Tkhd::getHeight() const {
   return static_cast<double>(m_height) / (1 << 16);
 }
 
+std::uint32_t Tkhd::getTrackID() const {
+  return m_track_id;
+}
+
+std::uint64_t Tkhd::getDuration() const {
+  return m_duration;
+}
+
+void Tkhd::setDuration(const std::uint64_t duration) {
+  m_duration = duration;
+  // version 0 では 32 bit に収まらない
+  if (duration > std::numeric_limits<std::uint32_t>::max()) {
+    setVersion(1);
+  }
+}
+
 }  // namespace shiguredo::mp4::box
@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_traf() {
-  return BoxType("traf");
-}
-
 Traf::Traf() {
   m_type = box_type_traf();
 }
@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_trak() {
-  return BoxType("trak");
-}
-
 Trak::Trak() {
   m_type = box_type_trak();
 }
@@ -14,10 +14,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_trex() {
-  return BoxType("trex");
-}
-
 Trex::Trex() {
   m_type = box_type_trex();
 }
@@ -67,4 +63,24 @@ std::uint64_t Trex::readData(std::istream& is) {
   return rbits;
 }
 
+std::uint32_t Trex::getTrackID() const {
+  return m_track_id;
+}
+
+std::uint32_t Trex::getDefaultSampleDescriptionIndex() const {
+  return m_default_sample_description_index;
+}
+
+std::uint32_t Trex::getDefaultSampleDuration() const {
+  return m_default_sample_duration;
+}
+
+std::uint32_t Trex::getDefaultSampleSize() const {
+  return m_default_sample_size;
+}
+
+std::uint32_t Trex::getDefaultSampleFlags() const {
+  return m_default_sample_flags;
+}
+
 }  // namespace shiguredo::mp4::box
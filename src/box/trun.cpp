@@ -4,11 +4,13 @@
 #include <fmt/ranges.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
 #include <memory>
 #include <numeric>
+#include <stdexcept>
 #include <string>
 
 #include "shiguredo/mp4/bitio/bitio.hpp"
@@ -18,10 +20,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_trun() {
-  return BoxType("trun");
-}
-
 Trun::Trun() {
   m_type = box_type_trun();
 }
@@ -34,6 +32,10 @@ Trun::Trun(const TrunParameters& params)
 }
 
 std::string Trun::toStringOnlyData() const {
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Trun::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
   std::string s = fmt::format("{} SampleCount={}", getVersionAndFlagsString(), std::size(m_entries));
   const std::uint32_t flags = getFlags();
   if (flags & 0x1) {
@@ -42,10 +44,8 @@ std::string Trun::toStringOnlyData() const {
   if (flags & 0x4) {
     s += fmt::format(" FirstSampleFlags={:#x}", m_first_sample_flags);
   }
-  std::vector<std::string> entries;
-  std::transform(std::begin(m_entries), std::end(m_entries), std::back_inserter(entries),
-                 [flags](const auto& e) { return e.toString(flags); });
-  return s + fmt::format(" Entries=[{}]", fmt::join(entries, ", "));
+  return s + fmt::format(" Entries=[{}]",
+                         join_entries(m_entries, max_entries, [flags](const auto& e) { return e.toString(flags); }));
 }
 
 std::uint64_t Trun::writeData(std::ostream& os) const {
@@ -74,8 +74,8 @@ std::uint64_t Trun::getDataSize() const {
   if (flags & 0x4) {
     size += 4;
   }
-  size += std::accumulate(std::begin(m_entries), std::end(m_entries), 0UL,
-                          [&flags](const auto a, const auto& e) { return a + e.getSize(flags); });
+  // 各要素のサイズは flags のみで決まる
+  size += std::size(m_entries) * TrunEntry().getSize(flags);
 
   return size;
 }
@@ -92,6 +92,11 @@ std::uint64_t Trun::readData(std::istream& is) {
   if (flags & 0x4) {
     rbits += bitio::read_uint<std::uint32_t>(&reader, &m_first_sample_flags);
   }
+  const auto entry_size = TrunEntry().getSize(flags);
+  if (entry_size == 0 && sample_count > MaxSampleCountWithoutEntryFields) {
+    throw std::runtime_error(fmt::format("Trun::readData(): too many samples without entry fields: {}", sample_count));
+  }
+  reader.checkEntryCount(sample_count, entry_size);
   m_entries.resize(sample_count);
   for (std::size_t i = 0; i < sample_count; ++i) {
     rbits += m_entries[i].readData(&reader, flags);
@@ -175,4 +180,40 @@ std::uint64_t TrunEntry::readData(bitio::Reader* reader, const std::uint32_t fla
   return rbits;
 }
 
+std::uint32_t Trun::getSampleCount() const {
+  return static_cast<std::uint32_t>(std::size(m_entries));
+}
+
+void Trun::setDataOffset(const std::int32_t data_offset) {
+  m_data_offset = data_offset;
+}
+
+std::int32_t Trun::getDataOffset() const {
+  return m_data_offset;
+}
+
+std::uint32_t Trun::getFirstSampleFlags() const {
+  return m_first_sample_flags;
+}
+
+const std::vector<TrunEntry>& Trun::getEntries() const {
+  return m_entries;
+}
+
+std::uint32_t TrunEntry::getSampleDuration() const {
+  return m_sample_duration;
+}
+
+std::uint32_t TrunEntry::getSampleSize() const {
+  return m_sample_size;
+}
+
+std::uint32_t TrunEntry::getSampleFlags() const {
+  return m_sample_flags;
+}
+
+std::int64_t TrunEntry::getSampleCompositionTimeOffset() const {
+  return m_sample_composition_time_offset;
+}
+
 }  // namespace shiguredo::mp4::box
@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_udta() {
-  return BoxType("udta");
-}
-
 Udta::Udta() {
   m_type = box_type_udta();
 }
@@ -1,8 +1,8 @@
 #include "shiguredo/mp4/box/unsupported.hpp"
 
 #include <fmt/core.h>
-#include <fmt/ranges.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <iterator>
@@ -17,10 +17,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_unsupported() {
-  return BoxType("unsu");
-}
-
 Unsupported::Unsupported() {
   m_type = box_type_unsupported();
 }
@@ -30,7 +26,12 @@ Unsupported::Unsupported(const UnsupportedParameters& params) : m_data(params.da
 }
 
 std::string Unsupported::toStringOnlyData() const {
-  return fmt::format("(unsupported) Data=[{:#x}]", fmt::join(m_data, ", "));
+  return toStringOnlyDataWithMaxEntries(0);
+}
+
+std::string Unsupported::toStringOnlyDataWithMaxEntries(const std::size_t max_entries) const {
+  return fmt::format("(unsupported) Data=[{}]",
+                     join_entries(m_data, max_entries, [](const auto d) { return fmt::format("{:#x}", d); }));
 }
 
 std::uint64_t Unsupported::writeData(std::ostream& os) const {
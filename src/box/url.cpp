@@ -15,10 +15,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_url() {
-  return BoxType("url ");
-}
-
 Url::Url() {
   m_type = box_type_url();
   setFlags(UrlSelfContainedFlags);
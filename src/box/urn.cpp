@@ -15,10 +15,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_urn() {
-  return BoxType("urn ");
-}
-
 Urn::Urn() {
   m_type = box_type_urn();
   setFlags(UrnSelfContainedFlags);
@@ -15,10 +15,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_vmhd() {
-  return BoxType("vmhd");
-}
-
 Vmhd::Vmhd() {
   m_type = box_type_vmhd();
 }
@@ -15,10 +15,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_vpcc() {
-  return BoxType("vpcC");
-}
-
 VPCodecConfiguration::VPCodecConfiguration() {
   m_type = box_type_vpcc();
 }
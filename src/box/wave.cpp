@@ -8,10 +8,6 @@
 
 namespace shiguredo::mp4::box {
 
-BoxType box_type_wave() {
-  return BoxType("wave");
-}
-
 Wave::Wave() {
   m_type = box_type_wave();
 }
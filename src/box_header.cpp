@@ -78,23 +78,16 @@ std::uint64_t BoxHeader::write(std::ostream& os) {
   if (!os.good()) {
     throw std::runtime_error(fmt::format("BoxHeader::write() ostream::seekp() failed: rdstate={}", os.rdstate()));
   }
-  std::vector<std::uint8_t> data;
+  std::array<std::uint8_t, Constants::LARGE_HEADER_SIZE> data = {};
+  std::uint64_t header_size = Constants::SMALL_HEADER_SIZE;
 
   if (m_extend_to_eof) {
-    data.resize(Constants::SMALL_HEADER_SIZE);
-    data[0] = 0;
-    data[1] = 0;
-    data[2] = 0;
-    data[3] = 0;
+    // size は 0 のまま
   } else if (m_size <= std::numeric_limits<std::uint32_t>::max() && m_header_size != Constants::LARGE_HEADER_SIZE) {
-    data.resize(Constants::SMALL_HEADER_SIZE);
     auto a = endian::uint32_to_be(static_cast<std::uint32_t>(m_size));
     std::copy(std::begin(a), std::end(a), std::begin(data));
   } else {
-    data.resize(Constants::LARGE_HEADER_SIZE);
-    data[0] = 0;
-    data[1] = 0;
-    data[2] = 0;
+    header_size = Constants::LARGE_HEADER_SIZE;
     data[3] = 1;
     auto a = endian::uint64_to_be(m_size);
     std::copy(std::begin(a), std::end(a), std::begin(data) + 8);
@@ -105,9 +98,9 @@ std::uint64_t BoxHeader::write(std::ostream& os) {
   data[6] = type_data[2];
   data[7] = type_data[3];
 
-  std::copy(std::begin(data), std::end(data), std::ostreambuf_iterator<char>(os));
-  m_size += std::size(data) - m_header_size;
-  m_header_size = std::size(data);
+  os.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(header_size));
+  m_size += header_size - m_header_size;
+  m_header_size = header_size;
   return m_size;
 }
 
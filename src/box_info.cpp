@@ -6,24 +6,25 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
 
 #include "shiguredo/mp4/box.hpp"
 #include "shiguredo/mp4/box/sample_entry.hpp"
+#include "shiguredo/mp4/stream/stream.hpp"
 
 namespace shiguredo::mp4 {
 
-BoxInfo::BoxInfo(const BoxInfoParameters& params) : m_box(params.box) {
+BoxInfo::BoxInfo(const BoxInfoParameters& params) : m_box(params.box), m_parent(params.parent) {
   if (params.parent) {
     m_path = params.parent->getPath();
-    params.parent->addLeaf(this);
-    if (params.parent->getType() == BoxType("wave")) {
-      auto ase = dynamic_cast<box::AudioSampleEntry*>(m_box);
-      if (ase) {
-        spdlog::debug("BoxInfo::BoxInfo(): setUnderWave()");
-        ase->setUnderWave(true);
-      }
+    if (params.add_leaf) {
+      params.parent->addLeaf(this);
     }
+    set_parent_type(m_box, params.parent->getType());
   } else {
     m_path = {};
   }
@@ -51,6 +52,21 @@ std::uint64_t BoxInfo::getSize() const {
 
 void BoxInfo::addLeaf(BoxInfo* info) {
   m_leafs.push_back(info);
+  invalidateSize();
+}
+
+void BoxInfo::removeLeaf(BoxInfo* info) {
+  auto it = std::find(std::begin(m_leafs), std::end(m_leafs), info);
+  if (it == std::end(m_leafs)) {
+    throw std::invalid_argument(fmt::format("BoxInfo::removeLeaf(): not a leaf: {}", info->getType().toString()));
+  }
+  m_leafs.erase(it);
+  delete info;
+  invalidateSize();
+}
+
+const std::vector<BoxInfo*>& BoxInfo::getLeafs() const {
+  return m_leafs;
 }
 
 std::string BoxInfo::toString() const {
@@ -65,21 +81,41 @@ std::string BoxInfo::toString() const {
 }
 
 std::uint64_t BoxInfo::adjustOffsetAndSize(const std::uint64_t offset) {
-  std::uint64_t leafs_size = 0;
-  const std::uint64_t header_size = m_box->getHeaderSize();
-  const std::uint64_t data_size = m_box->getDataSize();
-  for (auto l : m_leafs) {
-    leafs_size += l->adjustOffsetAndSize(offset + header_size + data_size + leafs_size);
-  }
+  computeSize();
+  assignOffset(offset);
+  return m_box->getSize();
+}
 
-  m_box->setOffsetAndDataSize(offset, data_size + leafs_size);
+void BoxInfo::invalidateSize() {
+  // 子のサイズが計算済みでない場合は祖先も計算済みではない
+  for (BoxInfo* info = this; info && info->m_size_cached; info = info->m_parent) {
+    info->m_size_cached = false;
+  }
+}
 
-  if (header_size != m_box->getHeaderSize()) {
-    adjustOffsetAndSize(offset);
+std::uint64_t BoxInfo::computeSize() {
+  if (!m_size_cached) {
+    m_data_size = m_box->getDataSize();
+    m_leafs_size = 0;
+    for (auto l : m_leafs) {
+      m_leafs_size += l->computeSize();
+    }
+    // 全体のサイズによって header のサイズが決まるため, offset は assignOffset() で設定する
+    m_box->setOffsetAndDataSize(0, m_data_size + m_leafs_size);
+    m_size_cached = true;
   }
   return m_box->getSize();
 }
 
+void BoxInfo::assignOffset(const std::uint64_t offset) {
+  m_box->setOffsetAndDataSize(offset, m_data_size + m_leafs_size);
+  std::uint64_t leaf_offset = offset + m_box->getHeaderSize() + m_data_size;
+  for (auto l : m_leafs) {
+    l->assignOffset(leaf_offset);
+    leaf_offset += l->getSize();
+  }
+}
+
 void BoxInfo::write(std::ostream& os) const {
   spdlog::trace("BoxInfo::write(): {}", m_box->toString());
   m_box->write(os);
@@ -88,8 +124,58 @@ void BoxInfo::write(std::ostream& os) const {
   }
 }
 
+void BoxInfo::serialize(std::vector<char>* buffer) const {
+  const auto offset = m_box->getOffset();
+  const auto size = m_box->getSize();
+  buffer->resize(size);
+  // BoxHeader::write() の seekp() はメモリ上の位置の移動になる
+  stream::MemoryOutputStreamBuf buf(buffer->data(), size, offset);
+  std::ostream os(&buf);
+  write(os);
+  if (!os.good() || static_cast<std::uint64_t>(os.tellp()) != offset + size) {
+    throw std::runtime_error(fmt::format("BoxInfo::serialize(): written size does not match: type={} size={}",
+                                         getType().toString(), size));
+  }
+}
+
+void BoxInfo::writeAtOnce(std::ostream& os) const {
+  std::vector<char> buffer;
+  serialize(&buffer);
+  os.seekp(static_cast<std::streamoff>(m_box->getOffset()), std::ios_base::beg);
+  if (!os.good()) {
+    throw std::runtime_error(fmt::format("BoxInfo::writeAtOnce(): ostream::seekp() failed: rdstate={}", os.rdstate()));
+  }
+  os.write(buffer.data(), static_cast<std::streamsize>(std::size(buffer)));
+  if (!os.good()) {
+    throw std::runtime_error(fmt::format("BoxInfo::writeAtOnce(): ostream::write() failed: rdstate={}", os.rdstate()));
+  }
+}
+
 BoxType BoxInfo::getType() const {
   return m_box->getType();
 }
 
+void set_parent_type(Box* box, const BoxType& parent_type) {
+  if (parent_type != BoxType("wave")) {
+    return;
+  }
+  auto ase = dynamic_cast<box::AudioSampleEntry*>(box);
+  if (ase) {
+    spdlog::debug("set_parent_type(): setUnderWave()");
+    ase->setUnderWave(true);
+  }
+}
+
+BoxInfo* find_leaf(const BoxInfo* info, const BoxType& type) {
+  if (info == nullptr) {
+    return nullptr;
+  }
+  for (const auto leaf : info->getLeafs()) {
+    if (leaf->getType() == type) {
+      return leaf;
+    }
+  }
+  return nullptr;
+}
+
 }  // namespace shiguredo::mp4
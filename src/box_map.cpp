@@ -1,12 +1,10 @@
 #include "shiguredo/mp4/box_map.hpp"
 
-#include <bits/exception.h>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
 #include <iterator>
-#include <map>
-#include <memory>
+#include <span>
 #include <stdexcept>
 #include <utility>
 #include <vector>
@@ -17,57 +15,119 @@
 
 namespace shiguredo::mp4 {
 
-BoxDef::BoxDef(const BoxDefParameters& params) : factory(params.factory), versions(params.versions) {}
+namespace {
 
-void BoxMap::addBoxDef(const BoxFactory& factory, const BoxType& box_type, const std::vector<std::uint8_t>& versions) {
-  m_map[box_type] = std::make_unique<BoxDef>(BoxDefParameters{.factory = factory, .versions = versions});
+bool less_box_def(const BoxDef& def, const BoxType& type) {
+  return def.type < type;
 }
 
-Box* BoxMap::getBoxInstance(const BoxType& type) {
-  const auto it = m_map.find(type);
-  Box* box;
-  if (it == m_map.end()) {
-    spdlog::debug("BoxMap::getBoxInstance(): box not found: {}", type.toString());
-    box = new box::Unsupported();
-  } else {
-    box = it->second->factory();
-    auto any_type_box = dynamic_cast<AnyTypeBox*>(box);
-    if (any_type_box != nullptr) {
-      any_type_box->setType(type);
+}  // namespace
+
+BoxMap::BoxMap(const std::span<const BoxDef> defs) : m_defs(defs) {}
+
+BoxMap::BoxMap(const BoxMap& other) : m_defs(other.m_defs), m_owned_defs(other.m_owned_defs) {
+  if (other.ownsDefs()) {
+    m_defs = m_owned_defs;
+  }
+}
+
+BoxMap::BoxMap(BoxMap&& other) noexcept {
+  *this = std::move(other);
+}
+
+BoxMap& BoxMap::operator=(const BoxMap& other) {
+  if (this != &other) {
+    m_owned_defs = other.m_owned_defs;
+    m_defs = other.ownsDefs() ? std::span<const BoxDef>(m_owned_defs) : other.m_defs;
+  }
+  return *this;
+}
+
+BoxMap& BoxMap::operator=(BoxMap&& other) noexcept {
+  if (this != &other) {
+    const bool owns = other.ownsDefs();
+    m_defs = other.m_defs;
+    m_owned_defs = std::move(other.m_owned_defs);
+    if (owns) {
+      m_defs = m_owned_defs;
     }
+    other.m_owned_defs.clear();
+    other.m_defs = {};
+  }
+  return *this;
+}
+
+bool BoxMap::ownsDefs() const {
+  return !std::empty(m_owned_defs) && std::data(m_defs) == std::data(m_owned_defs);
+}
+
+void BoxMap::addBoxDef(const BoxDef& def) {
+  if (std::data(m_defs) != std::data(m_owned_defs)) {
+    m_owned_defs.assign(std::begin(m_defs), std::end(m_defs));
+  }
+  const auto it = std::lower_bound(std::begin(m_owned_defs), std::end(m_owned_defs), def.type, less_box_def);
+  if (it != std::end(m_owned_defs) && it->type == def.type) {
+    *it = def;
+  } else {
+    m_owned_defs.insert(it, def);
+  }
+  m_defs = m_owned_defs;
+}
+
+const BoxDef* BoxMap::find(const BoxType& type) const {
+  const auto it = std::lower_bound(std::begin(m_defs), std::end(m_defs), type, less_box_def);
+  if (it == std::end(m_defs) || it->type != type) {
+    return nullptr;
   }
+  return &*it;
+}
 
+Box* BoxMap::getBoxInstance(const BoxType& type) const {
+  const auto def = find(type);
+  if (def == nullptr) {
+    spdlog::debug("BoxMap::getBoxInstance(): box not found: {}", type.toString());
+    return new box::Unsupported();
+  }
+  Box* box = def->factory();
+  if (def->is_any_type) {
+    static_cast<AnyTypeBox*>(box)->setType(type);
+  }
   return box;
 }
 
-Box* BoxMap::getBoxInstance(BoxHeader* header) {
+Box* BoxMap::getBoxInstance(BoxHeader* header) const {
   Box* box = getBoxInstance(header->getType());
   box->setHeader(header);
   return box;
 }
 
 bool BoxMap::isSupported(const BoxType& box_type) const {
-  return m_map.contains(box_type);
+  return find(box_type) != nullptr;
 }
 
 std::vector<std::uint8_t> BoxMap::getSupportedVersions(const BoxType& box_type) const {
-  const auto it = m_map.find(box_type);
-  if (it == std::end(m_map)) {
+  const auto def = find(box_type);
+  if (def == nullptr) {
     throw std::runtime_error("BoxMap::getSupportedVersions(): not found");
   }
-  return it->second->versions;
+  std::vector<std::uint8_t> versions;
+  for (std::uint8_t v = 0; v < 32; ++v) {
+    if ((def->versions & (1U << v)) != 0) {
+      versions.push_back(v);
+    }
+  }
+  return versions;
 }
 
 bool BoxMap::isSupportedVersion(const BoxType& box_type, const std::uint8_t ver) const {
-  const auto it = m_map.find(box_type);
-  if (it == std::end(m_map)) {
+  const auto def = find(box_type);
+  if (def == nullptr) {
     return false;
   }
-  auto vs = it->second->versions;
-  if (std::empty(vs)) {
+  if (def->versions == 0) {
     return true;
   }
-  return std::any_of(std::begin(vs), std::end(vs), [ver](const auto v) { return ver == v; });
+  return ver < 32 && (def->versions & (1U << ver)) != 0;
 }
 
 }  // namespace shiguredo::mp4
@@ -1,8 +1,9 @@
 #include "shiguredo/mp4/box_types.hpp"
 
-#include <string>
-
-#include <boost/functional/factory.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
 
 #include "shiguredo/mp4/box/boxes.hpp"
 #include "shiguredo/mp4/box_map.hpp"
@@ -10,129 +11,156 @@
 
 namespace shiguredo::mp4 {
 
-void register_box_map(BoxMap* boxMap) {
-  boxMap->addBoxDef(boost::factory<box::Btrt*>(), BoxType("btrt"), {});
-  boxMap->addBoxDef(boost::factory<box::Co64*>(), BoxType("co64"), {0});
-  boxMap->addBoxDef(boost::factory<box::Colr*>(), BoxType("colr"), {});
-  boxMap->addBoxDef(boost::factory<box::Ctts*>(), BoxType("ctts"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Data*>(), BoxType("data"), {});
-  boxMap->addBoxDef(boost::factory<box::Dinf*>(), BoxType("dinf"), {});
-  boxMap->addBoxDef(boost::factory<box::DOps*>(), BoxType("dOps"), {});
-  boxMap->addBoxDef(boost::factory<box::Dref*>(), BoxType("dref"), {0});
-  boxMap->addBoxDef(boost::factory<box::Edts*>(), BoxType("edts"), {});
-  boxMap->addBoxDef(boost::factory<box::Elst*>(), BoxType("elst"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Emsg*>(), BoxType("emsg"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Esds*>(), BoxType("esds"), {0});
-  boxMap->addBoxDef(boost::factory<box::Fiel*>(), BoxType("fiel"), {});
-  boxMap->addBoxDef(boost::factory<box::Free*>(), BoxType("free"), {});
-  boxMap->addBoxDef(boost::factory<box::Ftyp*>(), BoxType("ftyp"), {});
-  boxMap->addBoxDef(boost::factory<box::Hdlr*>(), BoxType("hdlr"), {0});
-  boxMap->addBoxDef(boost::factory<box::Ilst*>(), BoxType("ilst"), {});
-  boxMap->addBoxDef(boost::factory<box::Iods*>(), BoxType("iods"), {0});
-  boxMap->addBoxDef(boost::factory<box::Mdat*>(), BoxType("mdat"), {});
-  boxMap->addBoxDef(boost::factory<box::Mdhd*>(), BoxType("mdhd"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Mdia*>(), BoxType("mdia"), {});
-  boxMap->addBoxDef(boost::factory<box::Mehd*>(), BoxType("mehd"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Meta*>(), BoxType("meta"), {0});
-  boxMap->addBoxDef(boost::factory<box::Mfhd*>(), BoxType("mfhd"), {0});
-  boxMap->addBoxDef(boost::factory<box::Mfra*>(), BoxType("mfra"), {});
-  boxMap->addBoxDef(boost::factory<box::Mfro*>(), BoxType("mfro"), {0});
-  boxMap->addBoxDef(boost::factory<box::Minf*>(), BoxType("minf"), {});
-  boxMap->addBoxDef(boost::factory<box::Moof*>(), BoxType("moof"), {});
-  boxMap->addBoxDef(boost::factory<box::Moov*>(), BoxType("moov"), {});
-  boxMap->addBoxDef(boost::factory<box::Mvex*>(), BoxType("mvex"), {});
-  boxMap->addBoxDef(boost::factory<box::Mvhd*>(), BoxType("mvhd"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Pssh*>(), BoxType("pssh"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Sbgp*>(), BoxType("sbgp"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Schi*>(), BoxType("schi"), {});
-  boxMap->addBoxDef(boost::factory<box::Sdtp*>(), BoxType("sdtp"), {0});
-  boxMap->addBoxDef(boost::factory<box::Sgpd*>(), BoxType("sgpd"), {1, 2});
-  boxMap->addBoxDef(boost::factory<box::Sidx*>(), BoxType("sidx"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Sinf*>(), BoxType("sinf"), {});
-  boxMap->addBoxDef(boost::factory<box::Skip*>(), BoxType("skip"), {});
-  boxMap->addBoxDef(boost::factory<box::Smhd*>(), BoxType("smhd"), {0});
-  boxMap->addBoxDef(boost::factory<box::Stbl*>(), BoxType("stbl"), {});
-  boxMap->addBoxDef(boost::factory<box::Stco*>(), BoxType("stco"), {});
-  boxMap->addBoxDef(boost::factory<box::Stsc*>(), BoxType("stsc"), {0});
-  boxMap->addBoxDef(boost::factory<box::Stsd*>(), BoxType("stsd"), {0});
-  boxMap->addBoxDef(boost::factory<box::Stss*>(), BoxType("stss"), {0});
-  boxMap->addBoxDef(boost::factory<box::Stsz*>(), BoxType("stsz"), {0});
-  boxMap->addBoxDef(boost::factory<box::Stts*>(), BoxType("stts"), {0});
-  boxMap->addBoxDef(boost::factory<box::Styp*>(), BoxType("styp"), {});
-  boxMap->addBoxDef(boost::factory<box::Tfdt*>(), BoxType("tfdt"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Tfhd*>(), BoxType("tfhd"), {0});
-  boxMap->addBoxDef(boost::factory<box::Tfra*>(), BoxType("tfra"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Tkhd*>(), BoxType("tkhd"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Traf*>(), BoxType("traf"), {});
-  boxMap->addBoxDef(boost::factory<box::Trak*>(), BoxType("trak"), {});
-  boxMap->addBoxDef(boost::factory<box::Trex*>(), BoxType("trex"), {0});
-  boxMap->addBoxDef(boost::factory<box::Trun*>(), BoxType("trun"), {0, 1});
-  boxMap->addBoxDef(boost::factory<box::Udta*>(), BoxType("udta"), {});
-  boxMap->addBoxDef(boost::factory<box::Vmhd*>(), BoxType("vmhd"), {0});
-  boxMap->addBoxDef(boost::factory<box::Url*>(), BoxType("url "), {0});
-  boxMap->addBoxDef(boost::factory<box::Urn*>(), BoxType("urn "), {0});
-  boxMap->addBoxDef(boost::factory<box::Wave*>(), BoxType("wave"), {0});
+namespace {
+
+template <std::size_t N>
+constexpr std::array<BoxDef, N> sort_box_defs(std::array<BoxDef, N> defs) {
+  std::sort(std::begin(defs), std::end(defs), [](const auto& a, const auto& b) { return a.type < b.type; });
+  return defs;
+}
+
+// コンパイル時に BoxType で整列しておき, 全ての Reader で共有する
+constexpr auto box_defs = sort_box_defs(std::array{
+    make_box_def<box::Btrt>(BoxType("btrt")),
+    make_box_def<box::Co64>(BoxType("co64"), {0}),
+    make_box_def<box::Colr>(BoxType("colr")),
+    make_box_def<box::Ctts>(BoxType("ctts"), {0, 1}),
+    make_box_def<box::Data>(BoxType("data")),
+    make_box_def<box::Dinf>(BoxType("dinf")),
+    make_box_def<box::DOps>(BoxType("dOps")),
+    make_box_def<box::Dref>(BoxType("dref"), {0}),
+    make_box_def<box::Edts>(BoxType("edts")),
+    make_box_def<box::Elst>(BoxType("elst"), {0, 1}),
+    make_box_def<box::Emsg>(BoxType("emsg"), {0, 1}),
+    make_box_def<box::Esds>(BoxType("esds"), {0}),
+    make_box_def<box::Fiel>(BoxType("fiel")),
+    make_box_def<box::Free>(BoxType("free")),
+    make_box_def<box::Ftyp>(BoxType("ftyp")),
+    make_box_def<box::Hdlr>(BoxType("hdlr"), {0}),
+    make_box_def<box::Ilst>(BoxType("ilst")),
+    make_box_def<box::Iods>(BoxType("iods"), {0}),
+    make_box_def<box::Mdat>(BoxType("mdat")),
+    make_box_def<box::Mdhd>(BoxType("mdhd"), {0, 1}),
+    make_box_def<box::Mdia>(BoxType("mdia")),
+    make_box_def<box::Mehd>(BoxType("mehd"), {0, 1}),
+    make_box_def<box::Meta>(BoxType("meta"), {0}),
+    make_box_def<box::Mfhd>(BoxType("mfhd"), {0}),
+    make_box_def<box::Mfra>(BoxType("mfra")),
+    make_box_def<box::Mfro>(BoxType("mfro"), {0}),
+    make_box_def<box::Minf>(BoxType("minf")),
+    make_box_def<box::Moof>(BoxType("moof")),
+    make_box_def<box::Moov>(BoxType("moov")),
+    make_box_def<box::Mvex>(BoxType("mvex")),
+    make_box_def<box::Mvhd>(BoxType("mvhd"), {0, 1}),
+    make_box_def<box::Pssh>(BoxType("pssh"), {0, 1}),
+    make_box_def<box::Sbgp>(BoxType("sbgp"), {0, 1}),
+    make_box_def<box::Schi>(BoxType("schi")),
+    make_box_def<box::Sdtp>(BoxType("sdtp"), {0}),
+    make_box_def<box::Sgpd>(BoxType("sgpd"), {1, 2}),
+    make_box_def<box::Sidx>(BoxType("sidx"), {0, 1}),
+    make_box_def<box::Sinf>(BoxType("sinf")),
+    make_box_def<box::Skip>(BoxType("skip")),
+    make_box_def<box::Smhd>(BoxType("smhd"), {0}),
+    make_box_def<box::Stbl>(BoxType("stbl")),
+    make_box_def<box::Stco>(BoxType("stco")),
+    make_box_def<box::Stsc>(BoxType("stsc"), {0}),
+    make_box_def<box::Stsd>(BoxType("stsd"), {0}),
+    make_box_def<box::Stss>(BoxType("stss"), {0}),
+    make_box_def<box::Stsz>(BoxType("stsz"), {0}),
+    make_box_def<box::Stts>(BoxType("stts"), {0}),
+    make_box_def<box::Styp>(BoxType("styp")),
+    make_box_def<box::Tfdt>(BoxType("tfdt"), {0, 1}),
+    make_box_def<box::Tfhd>(BoxType("tfhd"), {0}),
+    make_box_def<box::Tfra>(BoxType("tfra"), {0, 1}),
+    make_box_def<box::Tkhd>(BoxType("tkhd"), {0, 1}),
+    make_box_def<box::Traf>(BoxType("traf")),
+    make_box_def<box::Trak>(BoxType("trak")),
+    make_box_def<box::Trex>(BoxType("trex"), {0}),
+    make_box_def<box::Trun>(BoxType("trun"), {0, 1}),
+    make_box_def<box::Udta>(BoxType("udta")),
+    make_box_def<box::Vmhd>(BoxType("vmhd"), {0}),
+    make_box_def<box::Url>(BoxType("url "), {0}),
+    make_box_def<box::Urn>(BoxType("urn "), {0}),
+    make_box_def<box::Wave>(BoxType("wave"), {0}),
+
+    make_box_def<box::VisualSampleEntry>(BoxType("avc1"), {0}),
+    make_box_def<box::VisualSampleEntry>(BoxType("encv"), {0}),
+    make_box_def<box::VisualSampleEntry>(BoxType("vp08"), {0}),
+    make_box_def<box::VisualSampleEntry>(BoxType("vp09"), {0}),
+    make_box_def<box::VisualSampleEntry>(BoxType("vp10"), {0}),
+    make_box_def<box::VisualSampleEntry>(BoxType("av01"), {0}),
+    make_box_def<box::AudioSampleEntry>(BoxType("mp4a"), {0}),
+    make_box_def<box::AudioSampleEntry>(BoxType("enca"), {0}),
+    make_box_def<box::AudioSampleEntry>(BoxType("Opus"), {0}),
+    make_box_def<box::AVCDecoderConfiguration>(BoxType("avcC"), {0}),
+    make_box_def<box::VPCodecConfiguration>(BoxType("vpcC"), {0, 1}),
+    make_box_def<box::AV1CodecConfiguration>(BoxType("av1C")),
+    make_box_def<box::PixelAspectRatio>(BoxType("pasp"), {0}),
 
-  boxMap->addBoxDef(boost::factory<box::VisualSampleEntry*>(), BoxType("avc1"), {0});
-  boxMap->addBoxDef(boost::factory<box::VisualSampleEntry*>(), BoxType("encv"), {0});
-  boxMap->addBoxDef(boost::factory<box::VisualSampleEntry*>(), BoxType("vp08"), {0});
-  boxMap->addBoxDef(boost::factory<box::VisualSampleEntry*>(), BoxType("vp09"), {0});
-  boxMap->addBoxDef(boost::factory<box::VisualSampleEntry*>(), BoxType("vp10"), {0});
-  boxMap->addBoxDef(boost::factory<box::VisualSampleEntry*>(), BoxType("av01"), {0});
-  boxMap->addBoxDef(boost::factory<box::AudioSampleEntry*>(), BoxType("mp4a"), {0});
-  boxMap->addBoxDef(boost::factory<box::AudioSampleEntry*>(), BoxType("enca"), {0});
-  boxMap->addBoxDef(boost::factory<box::AudioSampleEntry*>(), BoxType("Opus"), {0});
-  boxMap->addBoxDef(boost::factory<box::AVCDecoderConfiguration*>(), BoxType("avcC"), {0});
-  boxMap->addBoxDef(boost::factory<box::VPCodecConfiguration*>(), BoxType("vpcC"), {1, 0});
-  boxMap->addBoxDef(boost::factory<box::AV1CodecConfiguration*>(), BoxType("av1C"), {});
-  boxMap->addBoxDef(boost::factory<box::PixelAspectRatio*>(), BoxType("pasp"), {0});
+    make_box_def<box::IlstMeta>(BoxType("----")),
+    make_box_def<box::IlstMeta>(BoxType("aART")),
+    make_box_def<box::IlstMeta>(BoxType("akID")),
+    make_box_def<box::IlstMeta>(BoxType("apID")),
+    make_box_def<box::IlstMeta>(BoxType("atID")),
+    make_box_def<box::IlstMeta>(BoxType("cmID")),
+    make_box_def<box::IlstMeta>(BoxType("cnID")),
+    make_box_def<box::IlstMeta>(BoxType("covr")),
+    make_box_def<box::IlstMeta>(BoxType("cpil")),
+    make_box_def<box::IlstMeta>(BoxType("cprt")),
+    make_box_def<box::IlstMeta>(BoxType("desc")),
+    make_box_def<box::IlstMeta>(BoxType("disk")),
+    make_box_def<box::IlstMeta>(BoxType("egid")),
+    make_box_def<box::IlstMeta>(BoxType("geID")),
+    make_box_def<box::IlstMeta>(BoxType("gnre")),
+    make_box_def<box::IlstMeta>(BoxType("pcst")),
+    make_box_def<box::IlstMeta>(BoxType("pgap")),
+    make_box_def<box::IlstMeta>(BoxType("plID")),
+    make_box_def<box::IlstMeta>(BoxType("purd")),
+    make_box_def<box::IlstMeta>(BoxType("purl")),
+    make_box_def<box::IlstMeta>(BoxType("rtng")),
+    make_box_def<box::IlstMeta>(BoxType("sfID")),
+    make_box_def<box::IlstMeta>(BoxType("soaa")),
+    make_box_def<box::IlstMeta>(BoxType("soal")),
+    make_box_def<box::IlstMeta>(BoxType("soar")),
+    make_box_def<box::IlstMeta>(BoxType("soco")),
+    make_box_def<box::IlstMeta>(BoxType("sonm")),
+    make_box_def<box::IlstMeta>(BoxType("sosn")),
+    make_box_def<box::IlstMeta>(BoxType("stik")),
+    make_box_def<box::IlstMeta>(BoxType("tmpo")),
+    make_box_def<box::IlstMeta>(BoxType("trkn")),
+    make_box_def<box::IlstMeta>(BoxType("tven")),
+    make_box_def<box::IlstMeta>(BoxType("tves")),
+    make_box_def<box::IlstMeta>(BoxType("tvnn")),
+    make_box_def<box::IlstMeta>(BoxType("tvsh")),
+    make_box_def<box::IlstMeta>(BoxType("tvsn")),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'A', 'R', 'T'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'a', 'l', 'b'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'c', 'm', 't'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'c', 'o', 'm'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'd', 'a', 'y'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'g', 'e', 'n'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'g', 'r', 'p'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'n', 'a', 'm'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 't', 'o', 'o'})),
+    make_box_def<box::IlstMeta>(BoxType(std::array<std::uint8_t, 4>{0xa9, 'w', 'r', 't'})),
+});
+
+static_assert(std::adjacent_find(std::begin(box_defs), std::end(box_defs), [](const auto& a, const auto& b) {
+                return a.type == b.type;
+              }) == std::end(box_defs),
+              "duplicated box type");
+
+}  // namespace
+
+const BoxMap& get_box_map() {
+  static const BoxMap box_map(box_defs);
+  return box_map;
+}
 
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("----"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("aART"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("akID"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("apID"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("atID"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("cmID"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("cnID"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("covr"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("cpil"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("cprt"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("desc"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("disk"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("egid"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("geID"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("gnre"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("pcst"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("pgap"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("plID"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("purd"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("purl"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("rtng"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("sfID"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("soaa"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("soal"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("soar"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("soco"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("sonm"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("sosn"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("stik"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("tmpo"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("trkn"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("tven"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("tves"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("tvnn"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("tvsh"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType("tvsn"), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'A', 'R', 'T'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'a', 'l', 'b'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'c', 'm', 't'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'c', 'o', 'm'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'd', 'a', 'y'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'g', 'e', 'n'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'g', 'r', 'p'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'n', 'a', 'm'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 't', 'o', 'o'}), {});
-  boxMap->addBoxDef(boost::factory<box::IlstMeta*>(), BoxType(std::array<std::uint8_t, 4>{0xa9, 'w', 'r', 't'}), {});
+void register_box_map(BoxMap* box_map) {
+  for (const auto& def : box_defs) {
+    box_map->addBoxDef(def);
+  }
 }
 
 }  // namespace shiguredo::mp4
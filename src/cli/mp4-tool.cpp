@@ -1,9 +1,22 @@
+#include <fmt/core.h>
+#include <fmt/ranges.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -12,7 +25,99 @@
 #include <CLI/Config.hpp>
 #include <CLI/Formatter.hpp>
 
-#include "shiguredo/mp4//reader/reader.hpp"
+#include "shiguredo/mp4/reader/dump.hpp"
+#include "shiguredo/mp4/reader/probe.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+
+namespace {
+
+using shiguredo::mp4::reader::escape_json;
+
+std::string to_json_line(const std::string& path, const shiguredo::mp4::reader::ProbeResult& result) {
+  std::vector<std::string> tracks;
+  for (const auto& track : result.tracks) {
+    tracks.push_back(fmt::format(
+        R"({{"id":{},"handler":"{}","codec":"{}","timescale":{},"duration":{},"samples":{}}})", track.track_id,
+        escape_json(track.handler_type), escape_json(track.codec), track.timescale, track.duration,
+        track.sample_count));
+  }
+  return fmt::format(
+      R"({{"path":"{}","size":{},"duration":{:.3f},"bitrate":{},"fragmented":{},"fragments":{},"tracks":[{}],"error":{}}})",
+      escape_json(path), result.file_size, result.getDurationSeconds(), result.getBitrate(), result.is_fragmented,
+      result.fragment_count, fmt::join(tracks, ","),
+      std::empty(result.error) ? "null" : fmt::format(R"("{}")", escape_json(result.error)));
+}
+
+std::vector<std::string> collect_files(const std::vector<std::string>& paths, const std::vector<std::string>& exts) {
+  std::vector<std::string> files;
+  const auto match_ext = [&exts](const std::filesystem::path& path) {
+    return std::find(std::begin(exts), std::end(exts), path.extension().string()) != std::end(exts);
+  };
+  for (const auto& path : paths) {
+    if (!std::filesystem::is_directory(path)) {
+      files.push_back(path);
+      continue;
+    }
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(
+             path, std::filesystem::directory_options::skip_permission_denied, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+      if (it->is_regular_file() && match_ext(it->path())) {
+        files.push_back(it->path().string());
+      }
+    }
+    if (ec) {
+      spdlog::warn("failed to walk directory: path={} error={}", path, ec.message());
+    }
+  }
+  return files;
+}
+
+int scan(const std::vector<std::string>& paths,
+         const std::vector<std::string>& exts,
+         const std::size_t thread_count,
+         std::ostream& os) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto files = collect_files(paths, exts);
+
+  // ファイル毎に処理時間が異なるため, 各スレッドは空いた時点で次のファイルを取得する
+  std::atomic<std::size_t> next_index = 0;
+  std::atomic<std::size_t> error_count = 0;
+  std::mutex output_mutex;
+  const auto worker = [&]() {
+    for (auto i = next_index++; i < std::size(files); i = next_index++) {
+      std::ifstream ifs(files[i], std::ios_base::binary);
+      const auto result = shiguredo::mp4::reader::probe(ifs);
+      if (!std::empty(result.error)) {
+        ++error_count;
+      }
+      const auto line = to_json_line(files[i], result);
+      std::lock_guard<std::mutex> lock(output_mutex);
+      os << line << '\n';
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < std::min(std::max<std::size_t>(thread_count, 1), std::size(files)); ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  os.flush();
+  if (!os.good()) {
+    spdlog::error("failed to write the results: rdstate={}", os.rdstate());
+    return 1;
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  spdlog::info("scanned {} files ({} errors) in {:.3f} s: {:.1f} files/s", std::size(files), error_count.load(),
+               elapsed.count(), elapsed.count() > 0 ? static_cast<double>(std::size(files)) / elapsed.count() : 0.0);
+  return error_count.load() == 0 ? 0 : 1;
+}
+
+}  // namespace
 
 int main(int argc, char** argv) {
   CLI::App app{"mp4-tool"};
@@ -29,9 +134,31 @@ int main(int argc, char** argv) {
   app.require_subcommand(1);
 
   std::string filename;
+  std::size_t thread_count = 0;
+  shiguredo::mp4::reader::DumpFormat dump_format = shiguredo::mp4::reader::DumpFormat::Text;
+  std::vector<std::pair<std::string, shiguredo::mp4::reader::DumpFormat>> dump_format_assoc{
+      {"text", shiguredo::mp4::reader::DumpFormat::Text},
+      {"json", shiguredo::mp4::reader::DumpFormat::JSON},
+  };
+  std::size_t max_entries = 0;
 
   auto dump = app.add_subcommand("dump");
   dump->add_option("-f,--file", filename, "filename");
+  dump->add_option("-j,--threads", thread_count,
+                   "number of threads to parse trak boxes in parallel. the whole box tree is built in memory");
+  dump->add_option("--format", dump_format, "Output format (text/json) default: text")
+      ->transform(CLI::CheckedTransformer(dump_format_assoc, CLI::ignore_case));
+  dump->add_option("--max-entries", max_entries, "max number of array entries to print. 0: unlimited");
+
+  std::vector<std::string> scan_paths;
+  std::vector<std::string> scan_exts = {".mp4", ".m4a", ".m4v", ".mov"};
+  std::size_t scan_thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+  std::string scan_output;
+  auto scan_command = app.add_subcommand("scan", "probe metadata of files and print JSON Lines");
+  scan_command->add_option("paths", scan_paths, "files or directories")->required();
+  scan_command->add_option("-e,--ext", scan_exts, "file extensions to scan in directories");
+  scan_command->add_option("-j,--threads", scan_thread_count, "number of threads");
+  scan_command->add_option("-o,--output", scan_output, "output filename. default: stdout");
 
   CLI11_PARSE(app, argc, argv);
 
@@ -42,8 +169,28 @@ int main(int argc, char** argv) {
 
   if (subcommands[0] == dump) {
     std::ifstream ifs(filename, std::ios_base::binary);
-    shiguredo::mp4::reader::SimpleReader reader(ifs);
-    reader.read();
+    if (thread_count > 1) {
+      shiguredo::mp4::reader::SimpleReader reader(ifs, {.thread_count = thread_count});
+      reader.read();
+    } else {
+      shiguredo::mp4::reader::dump(ifs, std::cout, {.format = dump_format, .max_entries = max_entries});
+    }
+  } else if (subcommands[0] == scan_command) {
+    if (std::empty(scan_output)) {
+      return scan(scan_paths, scan_exts, scan_thread_count, std::cout);
+    }
+    std::ofstream ofs(scan_output);
+    if (!ofs.is_open()) {
+      spdlog::error("cannot open the output file: {}", scan_output);
+      return 1;
+    }
+    const auto result = scan(scan_paths, scan_exts, scan_thread_count, ofs);
+    ofs.close();
+    if (!ofs.good()) {
+      spdlog::error("failed to write the output file: {}", scan_output);
+      return 1;
+    }
+    return result;
   }
 
   return 0;
@@ -0,0 +1,56 @@
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "shiguredo/mp4/box.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_map.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/box_types.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+
+namespace {
+
+// 入力全体を MP4 ファイルとして読み込む
+void fuzz_reader(const std::string& input) {
+  std::istringstream is(input);
+  try {
+    shiguredo::mp4::reader::SimpleReader reader(is);
+    reader.parse();
+  } catch (const std::exception&) {
+  }
+}
+
+// 先頭の 4 バイトを BoxType, 残りを payload として 1 つの Box を読み込む
+void fuzz_box(const std::string& input) {
+  if (std::size(input) < 4) {
+    return;
+  }
+  const shiguredo::mp4::BoxType type(input.substr(0, 4));
+  const auto payload = input.substr(4);
+  std::unique_ptr<shiguredo::mp4::Box> box(
+      shiguredo::mp4::get_box_map().getBoxInstance(new shiguredo::mp4::BoxHeader({
+          .size = shiguredo::mp4::Constants::SMALL_HEADER_SIZE + std::size(payload),
+          .type = type,
+      })));
+  std::istringstream is(payload);
+  try {
+    box->readData(is);
+    box->toStringOnlyData();
+  } catch (const std::exception&) {
+  }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+  const std::string input(reinterpret_cast<const char*>(data), size);
+  fuzz_reader(input);
+  fuzz_box(input);
+  return 0;
+}
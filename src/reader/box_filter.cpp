@@ -0,0 +1,55 @@
+#include "shiguredo/mp4/reader/box_filter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+
+namespace shiguredo::mp4::reader {
+
+BoxFilter::BoxFilter(const BoxFilterParameters& params)
+    : m_allow_paths(params.allow_paths), m_deny_types(params.deny_types), m_max_depth(params.max_depth) {}
+
+bool BoxFilter::match(const BoxPath& path) const {
+  if (std::empty(path)) {
+    return true;
+  }
+  if (m_max_depth != 0 && std::size(path) > m_max_depth) {
+    return false;
+  }
+  if (std::find(std::begin(m_deny_types), std::end(m_deny_types), path.back()) != std::end(m_deny_types)) {
+    return false;
+  }
+  if (std::empty(m_allow_paths)) {
+    return true;
+  }
+  return std::any_of(std::begin(m_allow_paths), std::end(m_allow_paths), [&path](const auto& allow_path) {
+    const auto n = std::min(std::size(allow_path), std::size(path));
+    return std::equal(std::begin(allow_path), std::begin(allow_path) + static_cast<std::ptrdiff_t>(n),
+                      std::begin(path), [](const auto& a, const auto& b) { return a.matchWith(b); });
+  });
+}
+
+BoxPath parse_box_path(const std::string& str) {
+  BoxPath path;
+  std::size_t start = 0;
+  while (start <= std::size(str)) {
+    auto end = str.find('/', start);
+    if (end == std::string::npos) {
+      end = std::size(str);
+    }
+    const auto element = str.substr(start, end - start);
+    if (element == "*") {
+      path.push_back(box_type_any());
+    } else if (!std::empty(element)) {
+      path.push_back(BoxType(element));
+    }
+    start = end + 1;
+  }
+  return path;
+}
+
+}  // namespace shiguredo::mp4::reader
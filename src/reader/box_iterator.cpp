@@ -0,0 +1,194 @@
+#include "shiguredo/mp4/reader/box_iterator.hpp"
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <stdexcept>
+
+#include "shiguredo/mp4/box.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_map.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/box_types.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/stream/stream.hpp"
+
+namespace shiguredo::mp4::reader {
+
+namespace {
+
+// 子の Box を持つ Box. 子の Box の位置は SimpleReader と同じく Box::readData() が読んだ Box 自身のフィールドの後とする
+constexpr std::array container_types = {
+    BoxType("moov"), BoxType("trak"), BoxType("mdia"), BoxType("minf"), BoxType("stbl"), BoxType("dinf"),
+    BoxType("edts"), BoxType("udta"), BoxType("mvex"), BoxType("moof"), BoxType("traf"), BoxType("mfra"),
+    BoxType("ilst"), BoxType("sinf"), BoxType("schi"), BoxType("wave"), BoxType("stsd"), BoxType("dref"),
+    BoxType("meta"), BoxType("avc1"), BoxType("encv"), BoxType("vp08"), BoxType("vp09"), BoxType("vp10"),
+    BoxType("av01"), BoxType("mp4a"), BoxType("enca"), BoxType("Opus"),
+};
+
+bool is_container_type(const BoxType& type) {
+  return std::find(std::begin(container_types), std::end(container_types), type) != std::end(container_types);
+}
+
+}  // namespace
+
+BoxIterator::BoxIterator(std::istream& t_is) : m_is(t_is), m_box_map(get_box_map()) {
+  m_is.seekg(0, std::ios_base::end);
+  m_total_size = static_cast<std::uint64_t>(m_is.tellg());
+  m_is.seekg(0, std::ios_base::beg);
+  spdlog::debug("BoxIterator::BoxIterator(): m_total_size={}", m_total_size);
+}
+
+BoxIterator::~BoxIterator() {
+  if (m_left_header) {
+    delete m_left_header;
+  }
+  for (auto& frame : m_stack) {
+    delete frame.header;
+  }
+}
+
+bool BoxIterator::next(BoxEvent* event) {
+  if (m_left_header) {
+    delete m_left_header;
+    m_left_header = nullptr;
+  }
+  if (m_entered) {
+    auto& frame = m_stack.back();
+    frame.next_offset =
+        m_skip ? frame.header->getOffset() + frame.header->getSize() : getChildrenOffset(frame.header);
+    m_entered = false;
+    m_skip = false;
+  }
+
+  BoxHeader* header = nullptr;
+  if (std::empty(m_stack)) {
+    if (m_next_offset >= m_total_size) {
+      return false;
+    }
+    header = readHeader(m_next_offset, m_total_size);
+    m_next_offset += header->getSize();
+  } else {
+    auto& frame = m_stack.back();
+    const auto end_offset = frame.header->getOffset() + frame.header->getSize();
+    // 子の Box のヘッダーが収まらない末尾の領域は読み飛ばす
+    if (frame.next_offset + Constants::SMALL_HEADER_SIZE > end_offset) {
+      m_left_header = frame.header;
+      m_stack.pop_back();
+      m_path.pop_back();
+      *event = {.type = BoxEventType::Leave, .header = m_left_header, .depth = std::size(m_stack) + 1};
+      return true;
+    }
+    header = readHeader(frame.next_offset, end_offset);
+    frame.next_offset += header->getSize();
+  }
+
+  spdlog::trace("BoxIterator::next(): Header={}", header->toString());
+  m_stack.push_back({.header = header, .next_offset = header->getOffset() + header->getSize()});
+  m_path.push_back(header->getType());
+  m_entered = true;
+  *event = {.type = BoxEventType::Enter, .header = header, .depth = std::size(m_stack)};
+  return true;
+}
+
+void BoxIterator::skip() {
+  if (!m_entered) {
+    throw std::logic_error("BoxIterator::skip(): current event is not Enter");
+  }
+  m_skip = true;
+}
+
+Box* BoxIterator::parse() {
+  if (!m_entered) {
+    throw std::logic_error("BoxIterator::parse(): current event is not Enter");
+  }
+  BoxHeader* header = m_stack.back().header;
+  stream::BoundedStreamBuf buf(m_is.rdbuf(), header->getOffset() + header->getHeaderSize(), header->getDataSize());
+  std::istream is(&buf);
+
+  Box* box = m_box_map.getBoxInstance(new BoxHeader(*header));
+  try {
+    box->readData(is);
+  } catch (...) {
+    delete box;
+    throw;
+  }
+  return box;
+}
+
+const BoxPath& BoxIterator::getPath() const {
+  return m_path;
+}
+
+BoxHeader* BoxIterator::readHeader(const std::uint64_t offset, const std::uint64_t end_offset) {
+  m_is.seekg(static_cast<std::streamoff>(offset), std::ios_base::beg);
+  if (!m_is.good()) {
+    throw std::runtime_error(
+        fmt::format("BoxIterator::readHeader(): istream::seekg() failed: rdstate={}", m_is.rdstate()));
+  }
+  BoxHeader* header = read_box_header(m_is);
+  if (header->getSize() < header->getHeaderSize() || header->getSize() > end_offset - offset) {
+    const auto size = header->getSize();
+    delete header;
+    throw std::runtime_error(fmt::format("corrupt file? box size({}) at offset({}) is out of range({})", size, offset,
+                                         end_offset - offset));
+  }
+  return header;
+}
+
+std::uint64_t BoxIterator::getChildrenOffset(const BoxHeader* header) {
+  const auto data_offset = header->getOffset() + header->getHeaderSize();
+  const auto parent_index = std::size(m_path) - 1;
+  // ilst の子は種類によらず data Box などを含む
+  const bool under_ilst = parent_index > 0 && m_path[parent_index - 1] == BoxType("ilst");
+  if (!is_container_type(header->getType()) && !under_ilst) {
+    return header->getOffset() + header->getSize();
+  }
+
+  // 子の Box を含む payload 全体はコピーせず, Box 自身のフィールドのみを読む
+  stream::BoundedStreamBuf buf(m_is.rdbuf(), data_offset, header->getDataSize());
+  std::istream is(&buf);
+  Box* box = m_box_map.getBoxInstance(header->getType());
+  // wave の中の mp4a などは親の Box によって Box 自身のフィールドの長さが変わる
+  if (parent_index > 0) {
+    set_parent_type(box, m_path[parent_index - 1]);
+  }
+  std::uint64_t rbits = 0;
+  try {
+    rbits = box->readData(is);
+  } catch (...) {
+    delete box;
+    throw;
+  }
+  delete box;
+  return data_offset + rbits / 8;
+}
+
+bool visit_boxes(std::istream& is, BoxVisitor* visitor) {
+  BoxIterator iterator(is);
+  BoxEvent event;
+  while (iterator.next(&event)) {
+    if (event.type == BoxEventType::Leave) {
+      visitor->onLeave(event);
+      continue;
+    }
+    switch (visitor->onEnter(&iterator, event)) {
+      case VisitResult::Continue:
+        break;
+      case VisitResult::Skip:
+        iterator.skip();
+        break;
+      case VisitResult::Stop:
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace shiguredo::mp4::reader
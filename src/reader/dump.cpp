@@ -0,0 +1,425 @@
+#include "shiguredo/mp4/reader/dump.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "shiguredo/mp4/box.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/box_iterator.hpp"
+
+namespace shiguredo::mp4::reader {
+
+namespace {
+
+// Box::toStringOnlyData() の `Key=Value` 形式の文字列を解析した値
+struct FieldValue;
+using Fields = std::vector<std::pair<std::string, FieldValue>>;
+
+struct FieldValue {
+  enum class Kind {
+    Scalar,
+    String,
+    List,
+    Object,
+  };
+  Kind kind = Kind::Scalar;
+  std::string scalar = "";
+  std::vector<FieldValue> items = {};
+  // Box::toStringOnlyDataWithMaxEntries() で "... N more" と省略された要素の数
+  std::size_t omitted = 0;
+  Fields fields = {};
+};
+
+class FieldParser {
+ public:
+  explicit FieldParser(std::string_view str) : m_str(str) {}
+
+  bool parse(Fields* fields) { return parseFields(fields, '\0') && m_pos == std::size(m_str); }
+
+ private:
+  std::string_view m_str;
+  std::size_t m_pos = 0;
+
+  static constexpr std::string_view OmittedPrefix = "... ";
+  static constexpr std::string_view OmittedSuffix = " more";
+
+  char peek() const { return m_pos < std::size(m_str) ? m_str[m_pos] : '\0'; }
+
+  bool parseOmitted(std::size_t* omitted) {
+    m_pos += std::size(OmittedPrefix);
+    const auto digits_begin = m_pos;
+    std::size_t n = 0;
+    while (peek() >= '0' && peek() <= '9') {
+      n = n * 10 + static_cast<std::size_t>(peek() - '0');
+      ++m_pos;
+    }
+    if (m_pos == digits_begin || !m_str.substr(m_pos).starts_with(OmittedSuffix)) {
+      return false;
+    }
+    m_pos += std::size(OmittedSuffix);
+    *omitted = n;
+    return true;
+  }
+
+  void skipSpaces() {
+    while (peek() == ' ') {
+      ++m_pos;
+    }
+  }
+
+  bool parseFields(Fields* fields, const char terminator) {
+    skipSpaces();
+    while (peek() != terminator) {
+      const auto eq = m_str.find('=', m_pos);
+      if (eq == std::string_view::npos) {
+        return false;
+      }
+      const auto key = m_str.substr(m_pos, eq - m_pos);
+      if (std::empty(key) || key.find_first_of(" ,[]{}\"") != std::string_view::npos) {
+        return false;
+      }
+      m_pos = eq + 1;
+      FieldValue value;
+      if (!parseValue(&value)) {
+        return false;
+      }
+      fields->emplace_back(std::string(key), std::move(value));
+      skipSpaces();
+    }
+    return true;
+  }
+
+  bool parseValue(FieldValue* value) {
+    switch (peek()) {
+      case '"': {
+        const auto end = m_str.find('"', m_pos + 1);
+        if (end == std::string_view::npos) {
+          return false;
+        }
+        value->kind = FieldValue::Kind::String;
+        value->scalar = m_str.substr(m_pos + 1, end - m_pos - 1);
+        m_pos = end + 1;
+        return true;
+      }
+      case '[':
+        ++m_pos;
+        value->kind = FieldValue::Kind::List;
+        skipSpaces();
+        while (peek() != ']') {
+          if (m_str.substr(m_pos).starts_with(OmittedPrefix)) {
+            // 省略された要素の数はリストの末尾にのみ置かれる
+            if (!parseOmitted(&value->omitted) || peek() != ']') {
+              return false;
+            }
+            break;
+          }
+          FieldValue item;
+          if (!parseValue(&item)) {
+            return false;
+          }
+          value->items.push_back(std::move(item));
+          skipSpaces();
+          if (peek() == ',') {
+            ++m_pos;
+            skipSpaces();
+          } else if (peek() != ']') {
+            return false;
+          }
+        }
+        ++m_pos;
+        return true;
+      case '{':
+        ++m_pos;
+        value->kind = FieldValue::Kind::Object;
+        if (!parseFields(&value->fields, '}')) {
+          return false;
+        }
+        ++m_pos;
+        return true;
+      default: {
+        const auto end = std::min(m_str.find_first_of(" ,]}", m_pos), std::size(m_str));
+        if (end == m_pos) {
+          return false;
+        }
+        value->kind = FieldValue::Kind::Scalar;
+        value->scalar = m_str.substr(m_pos, end - m_pos);
+        m_pos = end;
+        return true;
+      }
+    }
+  }
+};
+
+// str[pos] から始まる UTF-8 の 1 文字のバイト数. 不正な場合は 0 を返す
+std::size_t get_utf8_length(std::string_view str, const std::size_t pos) {
+  const auto byte = [&str](const std::size_t i) { return static_cast<unsigned char>(str[i]); };
+  const auto first = byte(pos);
+  if (first < 0x80) {
+    return 1;
+  }
+  std::size_t length = 0;
+  // 2 byte 目の範囲は冗長な表現とサロゲートと U+10FFFF を超える値を除く
+  unsigned char min = 0x80;
+  unsigned char max = 0xbf;
+  if (first >= 0xc2 && first <= 0xdf) {
+    length = 2;
+  } else if (first >= 0xe0 && first <= 0xef) {
+    length = 3;
+    min = first == 0xe0 ? 0xa0 : 0x80;
+    max = first == 0xed ? 0x9f : 0xbf;
+  } else if (first >= 0xf0 && first <= 0xf4) {
+    length = 4;
+    min = first == 0xf0 ? 0x90 : 0x80;
+    max = first == 0xf4 ? 0x8f : 0xbf;
+  } else {
+    return 0;
+  }
+  if (pos + length > std::size(str) || byte(pos + 1) < min || byte(pos + 1) > max) {
+    return 0;
+  }
+  for (std::size_t i = 2; i < length; ++i) {
+    if (byte(pos + i) < 0x80 || byte(pos + i) > 0xbf) {
+      return 0;
+    }
+  }
+  return length;
+}
+
+bool is_json_number(const std::string& str) {
+  std::size_t i = 0;
+  if (i < std::size(str) && str[i] == '-') {
+    ++i;
+  }
+  const auto digits_begin = i;
+  while (i < std::size(str) && str[i] >= '0' && str[i] <= '9') {
+    ++i;
+  }
+  if (i == digits_begin) {
+    return false;
+  }
+  if (i < std::size(str) && str[i] == '.') {
+    ++i;
+    const auto fraction_begin = i;
+    while (i < std::size(str) && str[i] >= '0' && str[i] <= '9') {
+      ++i;
+    }
+    if (i == fraction_begin) {
+      return false;
+    }
+  }
+  return i == std::size(str);
+}
+
+class FieldWriter {
+ public:
+  FieldWriter(std::ostream& os, const DumpParameters& params) : m_os(os), m_params(params) {}
+
+  void writeFields(const Fields& fields) {
+    if (m_params.format == DumpFormat::JSON) {
+      m_os << '{';
+    }
+    bool first = true;
+    for (const auto& [key, value] : fields) {
+      if (m_params.format == DumpFormat::JSON) {
+        m_os << (first ? "" : ",") << '"' << escape_json(key) << "\":";
+      } else {
+        m_os << (first ? "" : " ") << key << '=';
+      }
+      writeValue(value);
+      first = false;
+    }
+    if (m_params.format == DumpFormat::JSON) {
+      m_os << '}';
+    }
+  }
+
+ private:
+  std::ostream& m_os;
+  const DumpParameters& m_params;
+
+  void writeValue(const FieldValue& value) {
+    const bool json = m_params.format == DumpFormat::JSON;
+    switch (value.kind) {
+      case FieldValue::Kind::Scalar:
+        if (json && !is_json_number(value.scalar) && value.scalar != "true" && value.scalar != "false") {
+          m_os << '"' << escape_json(value.scalar) << '"';
+        } else {
+          m_os << value.scalar;
+        }
+        break;
+      case FieldValue::Kind::String:
+        m_os << '"' << (json ? escape_json(value.scalar) : value.scalar) << '"';
+        break;
+      case FieldValue::Kind::List: {
+        m_os << '[';
+        const auto size = std::size(value.items);
+        const auto n = m_params.max_entries == 0 ? size : std::min(size, m_params.max_entries);
+        for (std::size_t i = 0; i < n; ++i) {
+          m_os << (i == 0 ? "" : (json ? "," : ", "));
+          writeValue(value.items[i]);
+        }
+        const auto omitted = size - n + value.omitted;
+        if (omitted > 0) {
+          // JSON の場合は省略した要素の数を文字列として末尾に追加する
+          if (json) {
+            m_os << (n == 0 ? "" : ",") << "\"... " << omitted << " more\"";
+          } else {
+            m_os << (n == 0 ? "" : ", ") << "... " << omitted << " more";
+          }
+        }
+        m_os << ']';
+        break;
+      }
+      case FieldValue::Kind::Object:
+        if (json) {
+          writeFields(value.fields);
+        } else {
+          m_os << '{';
+          writeFields(value.fields);
+          m_os << '}';
+        }
+        break;
+    }
+  }
+};
+
+class Dumper {
+ public:
+  Dumper(std::ostream& os, const DumpParameters& params) : m_os(os), m_params(params) {}
+
+  void dump(std::istream& is) {
+    BoxIterator iterator(is);
+    BoxEvent event;
+    if (m_params.format == DumpFormat::JSON) {
+      m_os << '[';
+    }
+    while (iterator.next(&event)) {
+      if (event.type == BoxEventType::Enter) {
+        enter(&iterator, event);
+      } else {
+        leave();
+      }
+    }
+    if (m_params.format == DumpFormat::JSON) {
+      m_os << "\n]\n";
+    }
+    m_os.flush();
+  }
+
+ private:
+  std::ostream& m_os;
+  const DumpParameters& m_params;
+  // JSON の場合に, 各深さで最初の子かどうか
+  std::vector<bool> m_first_child = {true};
+
+  void enter(BoxIterator* iterator, const BoxEvent& event) {
+    const auto header = event.header;
+    std::string data;
+    if (header->getType() != BoxType("mdat")) {
+      std::unique_ptr<Box> box(iterator->parse());
+      // サンプルのテーブルなどは文字列を作る時点で要素を省略し, 全ての要素の文字列は作らない
+      data = box->toStringOnlyDataWithMaxEntries(m_params.max_entries);
+    }
+
+    if (m_params.format == DumpFormat::Text) {
+      m_os << std::string((event.depth - 1) * 2, ' ') << header->toString();
+      if (!std::empty(data)) {
+        m_os << ' ';
+        writeData(data);
+      }
+      m_os << '\n';
+      return;
+    }
+
+    m_os << (m_first_child.back() ? "\n" : ",\n") << std::string(event.depth * 2, ' ');
+    m_first_child.back() = false;
+    m_os << fmt::format(R"({{"type":"{}","offset":{},"size":{},"fields":)", escape_json(header->getType().toString()),
+                        header->getOffset(), header->getSize());
+    writeData(data);
+    m_os << R"(,"children":[)";
+    m_first_child.push_back(true);
+  }
+
+  void leave() {
+    if (m_params.format == DumpFormat::JSON) {
+      m_first_child.pop_back();
+      m_os << "]}";
+    }
+  }
+
+  void writeData(const std::string& data) {
+    // Text の場合も toStringOnlyDataWithMaxEntries() を override していない Box の配列を省略するために解析する
+    if (m_params.format == DumpFormat::Text && m_params.max_entries == 0) {
+      m_os << data;
+      return;
+    }
+    Fields fields;
+    FieldParser parser(data);
+    if (!parser.parse(&fields)) {
+      // 解析できない形式の場合はそのまま出力する
+      if (m_params.format == DumpFormat::JSON) {
+        m_os << R"({"raw":")" << escape_json(data) << "\"}";
+      } else {
+        m_os << data;
+      }
+      return;
+    }
+    FieldWriter(m_os, m_params).writeFields(fields);
+  }
+};
+
+}  // namespace
+
+void dump(std::istream& is, std::ostream& os, const DumpParameters& params) {
+  Dumper(os, params).dump(is);
+}
+
+std::string escape_json(std::string_view str) {
+  std::string escaped;
+  for (std::size_t i = 0; i < std::size(str);) {
+    const auto c = str[i];
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      case '\r':
+        escaped += "\\r";
+        break;
+      case '\t':
+        escaped += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          escaped += fmt::format("\\u{:04x}", static_cast<unsigned int>(c));
+        } else if (const auto length = get_utf8_length(str, i); length > 0) {
+          escaped.append(str.substr(i, length));
+          i += length;
+          continue;
+        } else {
+          // UTF-8 として不正なバイトは, そのバイトの値の符号位置として書き出す
+          escaped += fmt::format("\\u{:04x}", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+        }
+    }
+    ++i;
+  }
+  return escaped;
+}
+
+}  // namespace shiguredo::mp4::reader
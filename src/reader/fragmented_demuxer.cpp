@@ -0,0 +1,346 @@
+#include "shiguredo/mp4/reader/fragmented_demuxer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "shiguredo/mp4/box.hpp"
+#include "shiguredo/mp4/box/hdlr.hpp"
+#include "shiguredo/mp4/box/mdhd.hpp"
+#include "shiguredo/mp4/box/tfdt.hpp"
+#include "shiguredo/mp4/box/tfhd.hpp"
+#include "shiguredo/mp4/box/tkhd.hpp"
+#include "shiguredo/mp4/box/trex.hpp"
+#include "shiguredo/mp4/box/trun.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/endian/endian.hpp"
+#include "shiguredo/mp4/reader/box_iterator.hpp"
+#include "shiguredo/mp4/stream/stream.hpp"
+
+namespace shiguredo::mp4::reader {
+
+namespace {
+
+// sample_flags の sample_is_non_sync_sample
+const std::uint32_t SampleIsNonSyncSample = 0x00010000;
+
+// moov の中で子孫を解析する Box
+constexpr std::array moov_container_types = {
+    BoxType("moov"), BoxType("trak"), BoxType("mdia"), BoxType("minf"),
+    BoxType("stbl"), BoxType("stsd"), BoxType("mvex"),
+};
+
+template <class T>
+std::unique_ptr<T> parse_as(BoxIterator* iterator) {
+  std::unique_ptr<Box> box(iterator->parse());
+  auto typed = dynamic_cast<T*>(box.get());
+  if (typed == nullptr) {
+    return nullptr;
+  }
+  box.release();
+  return std::unique_ptr<T>(typed);
+}
+
+}  // namespace
+
+std::vector<DemuxedSample> parse_moof_samples(const std::span<const std::uint8_t> moof,
+                                              const std::uint64_t moof_offset,
+                                              const std::map<std::uint32_t, TrackFragmentDefaults>& trex_defaults,
+                                              std::map<std::uint32_t, std::uint64_t>* next_decode_times) {
+  stream::MemoryStreamBuf buf(reinterpret_cast<const char*>(moof.data()), std::size(moof));
+  std::istream is(&buf);
+  BoxIterator iterator(is);
+  BoxEvent event;
+  std::vector<DemuxedSample> samples;
+
+  // tfhd に base_data_offset も default-base-is-moof もない場合, 最初の traf は moof の先頭を,
+  // 2 番目以降の traf は直前の traf のデータの終わりを基準にする
+  std::uint64_t previous_traf_end = moof_offset;
+  std::uint32_t track_id = 0;
+  std::uint64_t base_offset = 0;
+  std::uint64_t data_end = 0;
+  std::uint64_t decode_time = 0;
+  TrackFragmentDefaults defaults;
+  while (iterator.next(&event)) {
+    const auto type = event.header->getType();
+    if (event.type == BoxEventType::Leave) {
+      if (type == BoxType("traf") && track_id != 0) {
+        (*next_decode_times)[track_id] = decode_time;
+        previous_traf_end = data_end;
+        track_id = 0;
+      }
+      continue;
+    }
+    if (type == BoxType("moof") || type == BoxType("traf")) {
+      continue;
+    }
+
+    if (type == BoxType("tfhd")) {
+      auto tfhd = parse_as<box::Tfhd>(&iterator);
+      if (!tfhd) {
+        continue;
+      }
+      track_id = tfhd->getTrackID();
+      const auto flags = tfhd->getFlags();
+      const auto trex = trex_defaults.find(track_id);
+      defaults = trex == std::end(trex_defaults) ? TrackFragmentDefaults{} : trex->second;
+      if (flags & box::TfhdSampleDescriptionIndexPresent) {
+        defaults.sample_description_index = tfhd->getSampleDescriptionIndex();
+      }
+      if (flags & box::TfhdDefaultSampleDurationPresent) {
+        defaults.sample_duration = tfhd->getDefaultSampleDuration();
+      }
+      if (flags & box::TfhdDefaultSampleSizePresent) {
+        defaults.sample_size = tfhd->getDefaultSampleSize();
+      }
+      if (flags & box::TfhdDefaultSampleFlagsPresent) {
+        defaults.sample_flags = tfhd->getDefaultSampleFlags();
+      }
+      if (flags & box::TfhdBaseDataOffsetPresent) {
+        base_offset = tfhd->getBaseDataOffset();
+      } else if (flags & box::TfhdDefaultBaseIsMoof) {
+        base_offset = moof_offset;
+      } else {
+        base_offset = previous_traf_end;
+      }
+      data_end = base_offset;
+      decode_time = (*next_decode_times)[track_id];
+    } else if (track_id != 0 && type == BoxType("tfdt")) {
+      if (auto tfdt = parse_as<box::Tfdt>(&iterator)) {
+        decode_time = tfdt->getBaseMediaDecodeTime();
+      }
+    } else if (track_id != 0 && type == BoxType("trun")) {
+      auto trun = parse_as<box::Trun>(&iterator);
+      if (!trun) {
+        continue;
+      }
+      const auto flags = trun->getFlags();
+      // data_offset がない trun は直前の trun のデータの終わりから続く
+      auto offset = data_end;
+      if (flags & box::TrunDataOffsetPresent) {
+        offset = static_cast<std::uint64_t>(static_cast<std::int64_t>(base_offset) + trun->getDataOffset());
+      }
+      const auto& entries = trun->getEntries();
+      for (std::size_t i = 0; i < std::size(entries); ++i) {
+        const auto& entry = entries[i];
+        auto sample_flags = defaults.sample_flags;
+        if (i == 0 && (flags & box::TrunFirstSampleFlagsPresent)) {
+          sample_flags = trun->getFirstSampleFlags();
+        } else if (flags & box::TrunSampleFlagsPresent) {
+          sample_flags = entry.getSampleFlags();
+        }
+        const auto duration =
+            (flags & box::TrunSampleDurationPresent) ? entry.getSampleDuration() : defaults.sample_duration;
+        const auto size = (flags & box::TrunSampleSizePresent) ? entry.getSampleSize() : defaults.sample_size;
+        const auto composition_time_offset =
+            (flags & box::TrunSampleCompositionTimeOffsetPresent) ? entry.getSampleCompositionTimeOffset() : 0;
+        samples.push_back({.track_id = track_id,
+                           .decode_time = decode_time,
+                           .composition_time_offset = composition_time_offset,
+                           .duration = duration,
+                           .sample_description_index = defaults.sample_description_index,
+                           .is_key = (sample_flags & SampleIsNonSyncSample) == 0,
+                           .offset = offset,
+                           .size = size});
+        decode_time += duration;
+        offset += size;
+      }
+      data_end = offset;
+    }
+    iterator.skip();
+  }
+  return samples;
+}
+
+FragmentedDemuxer::FragmentedDemuxer(FragmentedDemuxerHandler* handler, const FragmentedDemuxerParameters& params)
+    : m_handler(handler), m_max_box_size(params.max_box_size) {}
+
+void FragmentedDemuxer::push(const std::uint8_t* data, const std::size_t size) {
+  std::size_t position = 0;
+  while (position < size) {
+    if (!m_has_header) {
+      position += readHeader(data + position, size - position);
+      if (!m_has_header) {
+        break;
+      }
+      if (m_box_received_size < m_box_size) {
+        continue;
+      }
+    } else {
+      const auto length =
+          static_cast<std::size_t>(std::min<std::uint64_t>(m_box_size - m_box_received_size, size - position));
+      if (m_keeps_box) {
+        m_box_data.insert(std::end(m_box_data), data + position, data + position + length);
+      }
+      m_box_received_size += length;
+      position += length;
+    }
+    if (m_box_received_size == m_box_size) {
+      processBox();
+      m_box_offset += m_box_size;
+      m_has_header = false;
+      m_header_data.clear();
+      m_box_data.clear();
+    }
+  }
+  m_received_size += size;
+}
+
+std::uint64_t FragmentedDemuxer::getReceivedSize() const {
+  return m_received_size;
+}
+
+bool FragmentedDemuxer::isAtBoxBoundary() const {
+  return !m_has_header && std::empty(m_header_data);
+}
+
+const std::vector<DemuxedTrack>& FragmentedDemuxer::getTracks() const {
+  return m_tracks;
+}
+
+std::size_t FragmentedDemuxer::readHeader(const std::uint8_t* data, const std::size_t size) {
+  // size が 1 の場合は 64 bit の largesize が続く
+  std::size_t required = Constants::SMALL_HEADER_SIZE;
+  if (std::size(m_header_data) >= 4 &&
+      endian::be_to_uint32(m_header_data[0], m_header_data[1], m_header_data[2], m_header_data[3]) == 1) {
+    required = Constants::LARGE_HEADER_SIZE;
+  }
+  std::size_t position = 0;
+  while (position < size && std::size(m_header_data) < required) {
+    m_header_data.push_back(data[position++]);
+    if (std::size(m_header_data) == 4 &&
+        endian::be_to_uint32(m_header_data[0], m_header_data[1], m_header_data[2], m_header_data[3]) == 1) {
+      required = Constants::LARGE_HEADER_SIZE;
+    }
+  }
+  if (std::size(m_header_data) < required) {
+    return position;
+  }
+
+  std::uint64_t box_size = endian::be_to_uint32(m_header_data[0], m_header_data[1], m_header_data[2], m_header_data[3]);
+  m_box_type.setData(m_header_data[4], m_header_data[5], m_header_data[6], m_header_data[7]);
+  if (box_size == 1) {
+    box_size = endian::be_to_uint64(m_header_data[8], m_header_data[9], m_header_data[10], m_header_data[11],
+                                    m_header_data[12], m_header_data[13], m_header_data[14], m_header_data[15]);
+  } else if (box_size == 0) {
+    throw std::runtime_error(fmt::format(
+        "FragmentedDemuxer::push(): box extending to the end of stream is not supported: type={} offset={}",
+        m_box_type.toString(), m_box_offset));
+  }
+  if (box_size < required) {
+    throw std::runtime_error(fmt::format("FragmentedDemuxer::push(): invalid box size: type={} size={} offset={}",
+                                         m_box_type.toString(), box_size, m_box_offset));
+  }
+
+  m_has_header = true;
+  m_box_size = box_size;
+  m_box_header_size = required;
+  m_box_received_size = required;
+  m_keeps_box =
+      m_box_type == BoxType("moov") || m_box_type == BoxType("moof") || m_box_type == BoxType("mdat");
+  if (m_keeps_box) {
+    if (box_size > m_max_box_size) {
+      throw std::runtime_error(fmt::format("FragmentedDemuxer::push(): box is too large: type={} size={} max={}",
+                                           m_box_type.toString(), box_size, m_max_box_size));
+    }
+    m_box_data.reserve(static_cast<std::size_t>(box_size));
+    m_box_data.assign(std::begin(m_header_data), std::end(m_header_data));
+  }
+  return position;
+}
+
+void FragmentedDemuxer::processBox() {
+  if (m_box_type == BoxType("moov")) {
+    processMoov();
+  } else if (m_box_type == BoxType("moof")) {
+    processMoof();
+  } else if (m_box_type == BoxType("mdat")) {
+    processMdat();
+  }
+}
+
+void FragmentedDemuxer::processMoov() {
+  stream::MemoryStreamBuf buf(reinterpret_cast<const char*>(m_box_data.data()), std::size(m_box_data));
+  std::istream is(&buf);
+  BoxIterator iterator(is);
+  BoxEvent event;
+  m_tracks.clear();
+  m_trex_defaults.clear();
+  while (iterator.next(&event)) {
+    if (event.type == BoxEventType::Leave) {
+      continue;
+    }
+    const auto type = event.header->getType();
+    const auto& path = iterator.getPath();
+    const auto parent_type = std::size(path) > 1 ? path[std::size(path) - 2] : box_type_any();
+
+    if (type == BoxType("trak")) {
+      m_tracks.push_back({});
+    } else if (!std::empty(m_tracks) && parent_type == BoxType("trak") && type == BoxType("tkhd")) {
+      if (auto tkhd = parse_as<box::Tkhd>(&iterator)) {
+        m_tracks.back().track_id = tkhd->getTrackID();
+      }
+    } else if (!std::empty(m_tracks) && parent_type == BoxType("mdia") && type == BoxType("mdhd")) {
+      if (auto mdhd = parse_as<box::Mdhd>(&iterator)) {
+        m_tracks.back().timescale = mdhd->getTimescale();
+      }
+    } else if (!std::empty(m_tracks) && parent_type == BoxType("mdia") && type == BoxType("hdlr")) {
+      if (auto hdlr = parse_as<box::Hdlr>(&iterator)) {
+        m_tracks.back().handler_type = hdlr->getHandlerType();
+      }
+    } else if (!std::empty(m_tracks) && parent_type == BoxType("stsd")) {
+      if (std::empty(m_tracks.back().codec)) {
+        m_tracks.back().codec = type.toString();
+      }
+    } else if (parent_type == BoxType("mvex") && type == BoxType("trex")) {
+      if (auto trex = parse_as<box::Trex>(&iterator)) {
+        m_trex_defaults[trex->getTrackID()] = {.sample_description_index = trex->getDefaultSampleDescriptionIndex(),
+                                               .sample_duration = trex->getDefaultSampleDuration(),
+                                               .sample_size = trex->getDefaultSampleSize(),
+                                               .sample_flags = trex->getDefaultSampleFlags()};
+      }
+    }
+
+    if (std::find(std::begin(moov_container_types), std::end(moov_container_types), type) ==
+        std::end(moov_container_types)) {
+      iterator.skip();
+    }
+  }
+  m_has_moov = true;
+  m_handler->onInitSegment(m_tracks);
+}
+
+void FragmentedDemuxer::processMoof() {
+  if (!m_has_moov) {
+    throw std::runtime_error(fmt::format("FragmentedDemuxer::push(): moof before moov: offset={}", m_box_offset));
+  }
+  m_fragment_samples = parse_moof_samples(m_box_data, m_box_offset, m_trex_defaults, &m_next_decode_times);
+}
+
+void FragmentedDemuxer::processMdat() {
+  const auto payload_begin = m_box_offset + m_box_header_size;
+  const auto payload_end = m_box_offset + m_box_size;
+  for (auto& sample : m_fragment_samples) {
+    if (sample.offset < payload_begin || sample.offset + sample.size > payload_end) {
+      throw std::runtime_error(fmt::format(
+          "FragmentedDemuxer::push(): sample is out of mdat: track_id={} offset={} size={} mdat=[{}, {})",
+          sample.track_id, sample.offset, sample.size, payload_begin, payload_end));
+    }
+    sample.data = {m_box_data.data() + (sample.offset - m_box_offset), sample.size};
+    m_handler->onSample(sample);
+  }
+  m_fragment_samples.clear();
+}
+
+}  // namespace shiguredo::mp4::reader
@@ -0,0 +1,150 @@
+#include "shiguredo/mp4/reader/probe.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "shiguredo/mp4/box.hpp"
+#include "shiguredo/mp4/box/hdlr.hpp"
+#include "shiguredo/mp4/box/mdhd.hpp"
+#include "shiguredo/mp4/box/mehd.hpp"
+#include "shiguredo/mp4/box/mvhd.hpp"
+#include "shiguredo/mp4/box/stsz.hpp"
+#include "shiguredo/mp4/box/tfhd.hpp"
+#include "shiguredo/mp4/box/tkhd.hpp"
+#include "shiguredo/mp4/box/trun.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/box_iterator.hpp"
+
+namespace shiguredo::mp4::reader {
+
+namespace {
+
+// 子孫を解析する Box. これ以外の Box の子孫は読み飛ばす
+constexpr std::array probe_container_types = {
+    BoxType("moov"), BoxType("trak"), BoxType("mdia"), BoxType("minf"), BoxType("stbl"),
+    BoxType("stsd"), BoxType("mvex"), BoxType("moof"), BoxType("traf"),
+};
+
+template <class T>
+std::unique_ptr<T> parse_as(BoxIterator* iterator) {
+  std::unique_ptr<Box> box(iterator->parse());
+  auto typed = dynamic_cast<T*>(box.get());
+  if (typed == nullptr) {
+    return nullptr;
+  }
+  box.release();
+  return std::unique_ptr<T>(typed);
+}
+
+void probe_boxes(std::istream& is, ProbeResult* result) {
+  BoxIterator iterator(is);
+  BoxEvent event;
+  TrackProbe* fragment_track = nullptr;
+  while (iterator.next(&event)) {
+    if (event.type == BoxEventType::Leave) {
+      continue;
+    }
+    const auto type = event.header->getType();
+    const auto& path = iterator.getPath();
+    const auto parent_type = std::size(path) > 1 ? path[std::size(path) - 2] : box_type_any();
+
+    if (type == BoxType("trak")) {
+      result->tracks.push_back({});
+    } else if (type == BoxType("mvex")) {
+      result->is_fragmented = true;
+    } else if (type == BoxType("moof")) {
+      result->is_fragmented = true;
+      ++result->fragment_count;
+    } else if (type == BoxType("traf")) {
+      fragment_track = nullptr;
+    } else if (type == BoxType("mvhd")) {
+      if (auto mvhd = parse_as<box::Mvhd>(&iterator)) {
+        result->timescale = mvhd->getTimescale();
+        result->duration = std::max(result->duration, mvhd->getDuration());
+      }
+    } else if (type == BoxType("mehd")) {
+      if (auto mehd = parse_as<box::Mehd>(&iterator)) {
+        result->duration = std::max(result->duration, mehd->getFragmentDuration());
+      }
+    } else if (!std::empty(result->tracks) && parent_type == BoxType("trak") && type == BoxType("tkhd")) {
+      if (auto tkhd = parse_as<box::Tkhd>(&iterator)) {
+        result->tracks.back().track_id = tkhd->getTrackID();
+      }
+    } else if (!std::empty(result->tracks) && parent_type == BoxType("mdia") && type == BoxType("mdhd")) {
+      if (auto mdhd = parse_as<box::Mdhd>(&iterator)) {
+        result->tracks.back().timescale = mdhd->getTimescale();
+        result->tracks.back().duration = mdhd->getDuration();
+      }
+    } else if (!std::empty(result->tracks) && parent_type == BoxType("mdia") && type == BoxType("hdlr")) {
+      if (auto hdlr = parse_as<box::Hdlr>(&iterator)) {
+        result->tracks.back().handler_type = hdlr->getHandlerType();
+      }
+    } else if (!std::empty(result->tracks) && parent_type == BoxType("stsd")) {
+      if (std::empty(result->tracks.back().codec)) {
+        result->tracks.back().codec = type.toString();
+      }
+    } else if (!std::empty(result->tracks) && parent_type == BoxType("stbl") && type == BoxType("stsz")) {
+      if (auto stsz = parse_as<box::Stsz>(&iterator)) {
+        result->tracks.back().sample_count += stsz->getSampleCount();
+      }
+    } else if (parent_type == BoxType("traf") && type == BoxType("tfhd")) {
+      if (auto tfhd = parse_as<box::Tfhd>(&iterator)) {
+        const auto track_id = tfhd->getTrackID();
+        const auto it = std::find_if(std::begin(result->tracks), std::end(result->tracks),
+                                     [track_id](const auto& track) { return track.track_id == track_id; });
+        fragment_track = it == std::end(result->tracks) ? nullptr : &(*it);
+      }
+    } else if (fragment_track && parent_type == BoxType("traf") && type == BoxType("trun")) {
+      if (auto trun = parse_as<box::Trun>(&iterator)) {
+        fragment_track->sample_count += trun->getSampleCount();
+      }
+    }
+
+    if (std::find(std::begin(probe_container_types), std::end(probe_container_types), type) ==
+        std::end(probe_container_types)) {
+      iterator.skip();
+    }
+  }
+}
+
+}  // namespace
+
+double ProbeResult::getDurationSeconds() const {
+  if (timescale == 0) {
+    return 0;
+  }
+  return static_cast<double>(duration) / timescale;
+}
+
+std::uint64_t ProbeResult::getBitrate() const {
+  const auto seconds = getDurationSeconds();
+  if (seconds <= 0) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>(static_cast<double>(file_size) * 8 / seconds);
+}
+
+ProbeResult probe(std::istream& is) {
+  ProbeResult result;
+  try {
+    is.seekg(0, std::ios_base::end);
+    if (!is.good()) {
+      throw std::runtime_error("probe(): istream is not readable");
+    }
+    result.file_size = static_cast<std::uint64_t>(is.tellg());
+    is.seekg(0, std::ios_base::beg);
+    probe_boxes(is, &result);
+  } catch (const std::exception& e) {
+    result.error = e.what();
+  }
+  return result;
+}
+
+}  // namespace shiguredo::mp4::reader
@@ -0,0 +1,134 @@
+#include "shiguredo/mp4/reader/random_access.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "shiguredo/mp4/box.hpp"
+#include "shiguredo/mp4/box/mfro.hpp"
+#include "shiguredo/mp4/box/tfra.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/reader/box_iterator.hpp"
+
+namespace shiguredo::mp4::reader {
+
+namespace {
+
+// mfro は header, version と flags, size の 16 byte
+const std::uint64_t MfroSize = 16;
+
+void seek_to(std::istream& is, const std::uint64_t offset) {
+  is.seekg(static_cast<std::streamoff>(offset), std::ios_base::beg);
+  if (!is.good()) {
+    throw std::runtime_error(fmt::format("RandomAccessIndex: istream::seekg() failed: rdstate={}", is.rdstate()));
+  }
+}
+
+}  // namespace
+
+RandomAccessIndex::RandomAccessIndex(std::istream& is) {
+  is.seekg(0, std::ios_base::end);
+  if (!is.good()) {
+    throw std::runtime_error(fmt::format("RandomAccessIndex: istream::seekg() failed: rdstate={}", is.rdstate()));
+  }
+  const auto file_size = static_cast<std::uint64_t>(is.tellg());
+  if (file_size < MfroSize) {
+    throw std::runtime_error(fmt::format("RandomAccessIndex: file is too small: {}", file_size));
+  }
+
+  seek_to(is, file_size - MfroSize);
+  std::unique_ptr<BoxHeader> mfro_header(read_box_header(is));
+  if (mfro_header->getType() != BoxType("mfro") || mfro_header->getSize() != MfroSize) {
+    throw std::runtime_error(fmt::format("RandomAccessIndex: mfro not found: {}", mfro_header->toString()));
+  }
+  box::Mfro mfro;
+  mfro_header->seekToData(is);
+  mfro.readData(is);
+  const std::uint64_t mfra_size = mfro.getMfraSize();
+  if (mfra_size < Constants::SMALL_HEADER_SIZE + MfroSize || mfra_size > file_size) {
+    throw std::runtime_error(fmt::format("RandomAccessIndex: invalid mfra size: {}", mfra_size));
+  }
+
+  const auto mfra_offset = file_size - mfra_size;
+  seek_to(is, mfra_offset);
+  std::unique_ptr<BoxHeader> mfra_header(read_box_header(is));
+  if (mfra_header->getType() != BoxType("mfra") || mfra_header->getSize() != mfra_size) {
+    throw std::runtime_error(fmt::format("RandomAccessIndex: mfra not found: {}", mfra_header->toString()));
+  }
+
+  // mfra のみをメモリに読み込んで解析する
+  std::string data(mfra_size, '\0');
+  seek_to(is, mfra_offset);
+  is.read(data.data(), static_cast<std::streamsize>(mfra_size));
+  if (!is.good()) {
+    throw std::runtime_error(fmt::format("RandomAccessIndex: istream::read() failed: rdstate={}", is.rdstate()));
+  }
+  std::istringstream mfra_is(data);
+  BoxIterator iterator(mfra_is);
+  BoxEvent event;
+  while (iterator.next(&event)) {
+    if (event.type != BoxEventType::Enter || event.header->getType() != BoxType("tfra")) {
+      continue;
+    }
+    std::unique_ptr<Box> box(iterator.parse());
+    const auto tfra = dynamic_cast<box::Tfra*>(box.get());
+    if (tfra == nullptr) {
+      continue;
+    }
+    auto& points = m_points[tfra->getTrackID()];
+    for (const auto& entry : tfra->getEntries()) {
+      points.push_back({.time = entry.getTime(),
+                        .moof_offset = entry.getMoofOffset(),
+                        .traf_number = entry.getTrafNumber(),
+                        .trun_number = entry.getTrunNumber(),
+                        .sample_number = entry.getSampleNumber()});
+    }
+  }
+  // tfra の要素は時刻の昇順だが, 二分探索の前提なので念のため並べ替える
+  for (auto& [track_id, points] : m_points) {
+    std::stable_sort(std::begin(points), std::end(points),
+                     [](const auto& a, const auto& b) { return a.time < b.time; });
+  }
+}
+
+std::vector<std::uint32_t> RandomAccessIndex::getTrackIDs() const {
+  std::vector<std::uint32_t> track_ids;
+  std::transform(std::begin(m_points), std::end(m_points), std::back_inserter(track_ids),
+                 [](const auto& p) { return p.first; });
+  return track_ids;
+}
+
+const std::vector<RandomAccessPoint>& RandomAccessIndex::getPoints(const std::uint32_t track_id) const {
+  auto it = m_points.find(track_id);
+  if (it == std::end(m_points)) {
+    throw std::out_of_range(fmt::format("RandomAccessIndex::getPoints(): track not found: {}", track_id));
+  }
+  return it->second;
+}
+
+std::optional<RandomAccessPoint> RandomAccessIndex::seek(const std::uint32_t track_id, const std::uint64_t time) const {
+  auto it = m_points.find(track_id);
+  if (it == std::end(m_points)) {
+    return std::nullopt;
+  }
+  const auto& points = it->second;
+  auto next = std::upper_bound(std::begin(points), std::end(points), time,
+                               [](const auto t, const auto& point) { return t < point.time; });
+  if (next == std::begin(points)) {
+    return std::nullopt;
+  }
+  return *std::prev(next);
+}
+
+}  // namespace shiguredo::mp4::reader
@@ -4,24 +4,31 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
 #include <iostream>
 #include <istream>
 #include <iterator>
-#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include "shiguredo/mp4/box.hpp"
 #include "shiguredo/mp4/box_header.hpp"
 #include "shiguredo/mp4/box_info.hpp"
 #include "shiguredo/mp4/box_map.hpp"
 #include "shiguredo/mp4/box_types.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/stream/stream.hpp"
 
 namespace shiguredo::mp4::reader {
 
-SimpleReader::SimpleReader(std::istream& t_is) : m_is(t_is) {
-  register_box_map(&m_box_map);
+SimpleReader::SimpleReader(std::istream& t_is, const SimpleReaderParameters& params)
+    : m_is(t_is), m_box_map(get_box_map()), m_filter(params.filter), m_thread_count(params.thread_count) {
   m_is.seekg(0, std::ios_base::end);
   m_total_size = static_cast<std::uint64_t>(m_is.tellg());
   m_is.seekg(0, std::ios_base::beg);
@@ -35,50 +42,206 @@ SimpleReader::~SimpleReader() {
 }
 
 void SimpleReader::read() {
+  parse();
+  for (BoxInfo* i : m_boxes) {
+    std::cout << i->toString() << std::endl;
+  }
+}
+
+void SimpleReader::parse() {
   std::uint64_t size = 0;
   while (size < m_total_size) {
     size += readBox(nullptr);
   }
-  for (BoxInfo* i : m_boxes) {
-    std::cout << i->toString() << std::endl;
-  }
+}
+
+const std::vector<BoxInfo*>& SimpleReader::getBoxInfos() const {
+  return m_boxes;
 }
 
 std::uint64_t SimpleReader::readBox(BoxInfo* parent) {
-  BoxHeader* header = read_box_header(m_is);
-  header->seekToData(m_is);
-  std::stringstream ss;
+  std::uint64_t size = 0;
+  BoxInfo* info = parseBox(m_is, &m_path, parent, true, &size);
+  if (info && !parent) {
+    m_boxes.push_back(info);
+  }
+  return size;
+}
+
+BoxInfo* SimpleReader::parseBox(std::istream& is,
+                                BoxPath* path,
+                                BoxInfo* parent,
+                                const bool add_leaf,
+                                std::uint64_t* size) const {
+  BoxHeader* header = read_box_header(is);
   const auto remaining_size = m_total_size - header->getOffset() - header->getHeaderSize();
   if (header->getDataSize() > remaining_size) {
-    spdlog::trace("SimpleReader::readBox(): corrupt file? Header={}", header->toString());
+    spdlog::trace("SimpleReader::parseBox(): corrupt file? Header={}", header->toString());
+    const auto data_size = header->getDataSize();
+    delete header;
     throw std::runtime_error(fmt::format("corrupt file? box data size({}) is greater than remaining_size({})",
-                                         header->getDataSize(), remaining_size));
+                                         data_size, remaining_size));
+  }
+  if (std::size(*path) >= Constants::MAX_BOX_DEPTH) {
+    delete header;
+    const std::uint64_t max_depth = Constants::MAX_BOX_DEPTH;
+    throw std::runtime_error(fmt::format("corrupt file? box depth exceeds {}", max_depth));
+  }
+  *size = header->getSize();
+
+  path->push_back(header->getType());
+  if (!m_filter.match(*path)) {
+    // payload を読まずに次の Box まで 1 回の seek で進める
+    spdlog::trace("SimpleReader::parseBox(): skip: Header={}", header->toString());
+    path->pop_back();
+    const auto next_offset = header->getOffset() + header->getSize();
+    delete header;
+    is.seekg(static_cast<std::streamoff>(next_offset), std::ios_base::beg);
+    if (!is.good()) {
+      throw std::runtime_error(
+          fmt::format("SimpleReader::parseBox(): istream::seekg() failed: rdstate={}", is.rdstate()));
+    }
+    return nullptr;
   }
-  std::copy_n(std::istreambuf_iterator<char>(m_is), header->getDataSize(), std::ostreambuf_iterator<char>(ss));
 
-  spdlog::trace("SimpleReader::readBox(): Header={}", header->toString());
+  spdlog::trace("SimpleReader::parseBox(): Header={}", header->toString());
 
   Box* box = m_box_map.getBoxInstance(header);
   if (box == nullptr) {
-    throw std::runtime_error("SimpleReader::readBox(): BoxMap::getBoxInstance() returns nullptr");
+    throw std::runtime_error("SimpleReader::parseBox(): BoxMap::getBoxInstance() returns nullptr");
   }
-  BoxInfo* info = new BoxInfo({.parent = parent, .box = box});
-  if (!parent) {
-    m_boxes.push_back(info);
+  BoxInfo* info = new BoxInfo({.parent = parent, .box = box, .add_leaf = add_leaf});
+
+  try {
+    const auto data_offset = header->getOffset() + header->getHeaderSize();
+    if (m_thread_count > 1 && header->getType() == BoxType("moov")) {
+      // 子の Box を複数のスレッドで読むため, moov の payload のみをメモリに読み込んで共有する
+      header->seekToData(is);
+      std::string data(header->getDataSize(), '\0');
+      is.read(data.data(), static_cast<std::streamsize>(std::size(data)));
+      if (!is.good()) {
+        throw std::runtime_error(
+            fmt::format("SimpleReader::parseBox(): istream::read() failed: rdstate={}", is.rdstate()));
+      }
+      stream::MemoryStreamBuf buf(data.data(), std::size(data));
+      std::istream data_is(&buf);
+      const auto rbytes = box->readData(data_is) / 8;
+      parseChildrenInParallel(info, data, data_offset, data_offset + rbytes);
+      header->seekToEnd(is);
+    } else {
+      // Box 自身のフィールドのみを読み, 子の Box を含む payload 全体はコピーしない
+      stream::BoundedStreamBuf buf(is.rdbuf(), data_offset, header->getDataSize());
+      std::istream data_is(&buf);
+      std::uint64_t rbytes = box->readData(data_is) / 8;
+      is.seekg(static_cast<std::streamoff>(data_offset + rbytes));
+      if (!is.good()) {
+        throw std::runtime_error(
+            fmt::format("SimpleReader::parseBox(): istream::seekg() failed: rdstate={}", is.rdstate()));
+      }
+      while (header->getDataSize() > rbytes) {
+        std::uint64_t child_size = 0;
+        parseBox(is, path, info, true, &child_size);
+        rbytes += child_size;
+      }
+    }
+  } catch (...) {
+    if (!parent || !add_leaf) {
+      delete info;
+    }
+    throw;
+  }
+  path->pop_back();
+  return info;
+}
+
+void SimpleReader::parseChildrenInParallel(BoxInfo* parent,
+                                           const std::string& data,
+                                           const std::uint64_t data_offset,
+                                           const std::uint64_t children_offset) const {
+  struct Child {
+    std::uint64_t offset;
+    BoxInfo* info = nullptr;
+    std::exception_ptr error = nullptr;
+  };
+  std::vector<Child> children;
+  std::vector<std::size_t> trak_indices;
+
+  // 子の Box のヘッダーのみを先に走査する
+  stream::MemoryStreamBuf buf(data.data(), std::size(data), data_offset);
+  std::istream is(&buf);
+  const auto end_offset = data_offset + std::size(data);
+  for (auto offset = children_offset; offset < end_offset;) {
+    is.seekg(static_cast<std::streamoff>(offset), std::ios_base::beg);
+    BoxHeader* header = read_box_header(is);
+    // largesize が 0 の場合などに同じ位置を走査し続けないよう, parseBox() と同様に大きさを確認する
+    const auto size = header->getSize();
+    if (size < header->getHeaderSize() || size > end_offset - offset) {
+      spdlog::trace("SimpleReader::parseChildrenInParallel(): corrupt file? Header={}", header->toString());
+      delete header;
+      throw std::runtime_error(fmt::format("corrupt file? box size({}) is out of range: offset={} end_offset={}", size,
+                                           offset, end_offset));
+    }
+    if (header->getType() == BoxType("trak")) {
+      trak_indices.push_back(std::size(children));
+    }
+    children.push_back({.offset = offset});
+    offset += size;
+    delete header;
   }
+  spdlog::debug("SimpleReader::parseChildrenInParallel(): children={} trak={}", std::size(children),
+                std::size(trak_indices));
+
+  const auto parse_child = [this, parent](std::istream& child_is, Child* child) {
+    try {
+      BoxPath path = parent->getPath();
+      std::uint64_t size = 0;
+      child_is.seekg(static_cast<std::streamoff>(child->offset), std::ios_base::beg);
+      child->info = parseBox(child_is, &path, parent, false, &size);
+    } catch (...) {
+      child->error = std::current_exception();
+    }
+  };
+  std::atomic<std::size_t> next_index = 0;
+  const auto parse_traks = [&]() {
+    // スレッド毎に stream を持ち, moov の payload は共有する
+    stream::MemoryStreamBuf trak_buf(data.data(), std::size(data), data_offset);
+    std::istream trak_is(&trak_buf);
+    for (auto i = next_index++; i < std::size(trak_indices); i = next_index++) {
+      parse_child(trak_is, &children[trak_indices[i]]);
+    }
+  };
 
-  const auto rbits = box->readData(ss);
-  std::uint64_t rbytes = rbits / 8;
-  m_is.seekg(static_cast<std::streamoff>(header->getOffset() + header->getHeaderSize() + rbytes));
-  if (!m_is.good()) {
-    throw std::runtime_error(
-        fmt::format("SimpleReader::readBox(): istream::seekg() failed: rdstate={}", m_is.rdstate()));
+  // 呼び出し元のスレッドも trak の解析に加わる
+  std::vector<std::thread> threads;
+  const auto thread_count = std::min(m_thread_count, std::size(trak_indices));
+  for (std::size_t i = 1; i < thread_count; ++i) {
+    try {
+      threads.emplace_back(parse_traks);
+    } catch (const std::system_error& e) {
+      spdlog::warn("SimpleReader::parseChildrenInParallel(): failed to create thread: {}", e.what());
+      break;
+    }
+  }
+  for (std::size_t i = 0; i < std::size(children); ++i) {
+    if (std::find(std::begin(trak_indices), std::end(trak_indices), i) == std::end(trak_indices)) {
+      parse_child(is, &children[i]);
+    }
+  }
+  parse_traks();
+  for (auto& thread : threads) {
+    thread.join();
   }
 
-  while (header->getDataSize() > rbytes) {
-    rbytes += readBox(info);
+  for (const auto& child : children) {
+    if (child.info) {
+      parent->addLeaf(child.info);
+    }
+  }
+  for (const auto& child : children) {
+    if (child.error) {
+      std::rethrow_exception(child.error);
+    }
   }
-  return header->getSize();
 }
 
 }  // namespace shiguredo::mp4::reader
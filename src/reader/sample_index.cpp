@@ -0,0 +1,151 @@
+#include "shiguredo/mp4/reader/sample_index.hpp"
+
+#include <fmt/core.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "shiguredo/mp4/box.hpp"
+#include "shiguredo/mp4/box/co64.hpp"
+#include "shiguredo/mp4/box/ctts.hpp"
+#include "shiguredo/mp4/box/hdlr.hpp"
+#include "shiguredo/mp4/box/mdhd.hpp"
+#include "shiguredo/mp4/box/stco.hpp"
+#include "shiguredo/mp4/box/stsc.hpp"
+#include "shiguredo/mp4/box/stss.hpp"
+#include "shiguredo/mp4/box/stsz.hpp"
+#include "shiguredo/mp4/box/stts.hpp"
+#include "shiguredo/mp4/box/tkhd.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+
+namespace shiguredo::mp4::reader {
+
+namespace {
+
+std::vector<std::uint64_t> get_chunk_offsets(const BoxInfo* stbl) {
+  if (const auto stco = find_box<box::Stco>(stbl, BoxType("stco"))) {
+    const auto& offsets = stco->getChunkOffsets();
+    return {std::begin(offsets), std::end(offsets)};
+  }
+  if (const auto co64 = find_box<box::Co64>(stbl, BoxType("co64"))) {
+    return co64->getChunkOffsets();
+  }
+  throw std::runtime_error("build_sample_index(): stco or co64 not found");
+}
+
+}  // namespace
+
+IndexedTrack build_sample_index(const BoxInfo* trak) {
+  IndexedTrack track;
+  if (const auto tkhd = find_box<box::Tkhd>(trak, BoxType("tkhd"))) {
+    track.track_id = tkhd->getTrackID();
+  }
+  const auto mdia = find_leaf(trak, BoxType("mdia"));
+  if (const auto mdhd = find_box<box::Mdhd>(mdia, BoxType("mdhd"))) {
+    track.timescale = mdhd->getTimescale();
+  }
+  if (const auto hdlr = find_box<box::Hdlr>(mdia, BoxType("hdlr"))) {
+    track.handler_type = hdlr->getHandlerType();
+  }
+  const auto stbl = find_leaf(find_leaf(mdia, BoxType("minf")), BoxType("stbl"));
+  const auto stsz = find_box<box::Stsz>(stbl, BoxType("stsz"));
+  const auto stsc = find_box<box::Stsc>(stbl, BoxType("stsc"));
+  const auto stts = find_box<box::Stts>(stbl, BoxType("stts"));
+  if (stsz == nullptr || stsc == nullptr || stts == nullptr) {
+    throw std::runtime_error(
+        fmt::format("build_sample_index(): stsz, stsc or stts not found: track_id={}", track.track_id));
+  }
+
+  const auto& sizes = stsz->getEntrySizes();
+  const auto sample_count = std::size(sizes);
+  auto& samples = track.samples;
+  samples.resize(sample_count);
+  for (std::size_t i = 0; i < sample_count; ++i) {
+    samples[i].size = sizes[i];
+  }
+
+  // チャンクの中のサンプルは連続して並ぶ
+  const auto chunk_offsets = get_chunk_offsets(stbl);
+  const auto& stsc_entries = stsc->getEntries();
+  std::size_t sample_index = 0;
+  for (std::size_t i = 0; i < std::size(stsc_entries); ++i) {
+    const auto& entry = stsc_entries[i];
+    const std::size_t last_chunk = i + 1 < std::size(stsc_entries) ? stsc_entries[i + 1].getFirstChunk() - 1
+                                                                   : std::size(chunk_offsets);
+    if (entry.getFirstChunk() == 0 || last_chunk > std::size(chunk_offsets)) {
+      throw std::runtime_error(fmt::format("build_sample_index(): invalid stsc entry: track_id={} first_chunk={}",
+                                           track.track_id, entry.getFirstChunk()));
+    }
+    for (std::size_t chunk = entry.getFirstChunk(); chunk <= last_chunk; ++chunk) {
+      auto offset = chunk_offsets[chunk - 1];
+      for (std::uint32_t j = 0; j < entry.getSamplesPerChunk(); ++j, ++sample_index) {
+        if (sample_index >= sample_count) {
+          throw std::runtime_error(
+              fmt::format("build_sample_index(): stsc refers more samples than stsz: track_id={}", track.track_id));
+        }
+        samples[sample_index].offset = offset;
+        samples[sample_index].sample_description_index = entry.getSampleDescriptionIndex();
+        offset += samples[sample_index].size;
+      }
+    }
+  }
+  if (sample_index != sample_count) {
+    throw std::runtime_error(fmt::format("build_sample_index(): stsc and stsz mismatch: track_id={} {} {}",
+                                         track.track_id, sample_index, sample_count));
+  }
+
+  sample_index = 0;
+  std::uint64_t decode_time = 0;
+  for (const auto& entry : stts->getEntries()) {
+    for (std::uint32_t j = 0; j < entry.getSampleCount() && sample_index < sample_count; ++j, ++sample_index) {
+      samples[sample_index].decode_time = decode_time;
+      samples[sample_index].duration = entry.getSampleDuration();
+      decode_time += entry.getSampleDuration();
+    }
+  }
+  if (sample_index != sample_count) {
+    throw std::runtime_error(fmt::format("build_sample_index(): stts and stsz mismatch: track_id={} {} {}",
+                                         track.track_id, sample_index, sample_count));
+  }
+
+  if (const auto ctts = find_box<box::Ctts>(stbl, BoxType("ctts"))) {
+    sample_index = 0;
+    for (const auto& entry : ctts->getEntries()) {
+      for (std::uint32_t j = 0; j < entry.getSampleCount() && sample_index < sample_count; ++j, ++sample_index) {
+        samples[sample_index].composition_time_offset = entry.getSampleOffset();
+        track.has_composition_time_offset = track.has_composition_time_offset || entry.getSampleOffset() != 0;
+      }
+    }
+  }
+
+  if (const auto stss = find_box<box::Stss>(stbl, BoxType("stss"))) {
+    for (const auto number : stss->getSampleNumbers()) {
+      if (number == 0 || number > sample_count) {
+        throw std::runtime_error(
+            fmt::format("build_sample_index(): invalid stss sample number: track_id={} {}", track.track_id, number));
+      }
+      samples[number - 1].is_key = true;
+    }
+  } else {
+    for (auto& sample : samples) {
+      sample.is_key = true;
+    }
+  }
+  return track;
+}
+
+std::vector<IndexedTrack> build_sample_indexes(const BoxInfo* moov) {
+  std::vector<IndexedTrack> tracks;
+  for (const auto leaf : moov->getLeafs()) {
+    if (leaf->getType() == BoxType("trak")) {
+      tracks.push_back(build_sample_index(leaf));
+    }
+  }
+  return tracks;
+}
+
+}  // namespace shiguredo::mp4::reader
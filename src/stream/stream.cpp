@@ -2,6 +2,10 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <stdexcept>
 
 namespace shiguredo::mp4::stream {
@@ -30,4 +34,146 @@ std::streamoff get_istream_offset_to_end(std::istream& is) {
   return end_offset - offset;
 }
 
+MemoryStreamBuf::MemoryStreamBuf(const char* data, const std::size_t size, const std::uint64_t base_offset)
+    : m_base_offset(base_offset) {
+  // std::streambuf のインターフェースに合わせるため const を外すが, 書き込みは行わない
+  auto begin = const_cast<char*>(data);  // NOLINT
+  setg(begin, begin, begin + size);
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type off,
+                                                   std::ios_base::seekdir dir,
+                                                   std::ios_base::openmode which) {
+  if ((which & std::ios_base::in) == 0) {
+    return pos_type(off_type(-1));
+  }
+  off_type base;
+  switch (dir) {
+    case std::ios_base::beg:
+      base = 0;
+      break;
+    case std::ios_base::cur:
+      base = static_cast<off_type>(m_base_offset) + (gptr() - eback());
+      break;
+    case std::ios_base::end:
+      base = static_cast<off_type>(m_base_offset) + (egptr() - eback());
+      break;
+    default:
+      return pos_type(off_type(-1));
+  }
+  return seekpos(pos_type(base + off), which);
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+  const auto index = off_type(pos) - static_cast<off_type>(m_base_offset);
+  if ((which & std::ios_base::in) == 0 || index < 0 || index > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + index, egptr());
+  return pos;
+}
+
+BoundedStreamBuf::BoundedStreamBuf(std::streambuf* source, const std::uint64_t offset, const std::uint64_t size)
+    : m_source(source), m_offset(offset), m_size(size) {
+  setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+}
+
+BoundedStreamBuf::int_type BoundedStreamBuf::underflow() {
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  if (m_position >= m_size) {
+    return traits_type::eof();
+  }
+  const auto source_offset = static_cast<off_type>(m_offset + m_position);
+  if (m_source->pubseekpos(pos_type(source_offset), std::ios_base::in) != pos_type(source_offset)) {
+    return traits_type::eof();
+  }
+  const auto n = m_source->sgetn(
+      m_buffer.data(), static_cast<std::streamsize>(std::min<std::uint64_t>(std::size(m_buffer), m_size - m_position)));
+  if (n <= 0) {
+    return traits_type::eof();
+  }
+  m_position += static_cast<std::uint64_t>(n);
+  setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + n);
+  return traits_type::to_int_type(*gptr());
+}
+
+BoundedStreamBuf::pos_type BoundedStreamBuf::seekoff(off_type off,
+                                                     std::ios_base::seekdir dir,
+                                                     std::ios_base::openmode which) {
+  if ((which & std::ios_base::in) == 0) {
+    return pos_type(off_type(-1));
+  }
+  off_type base;
+  switch (dir) {
+    case std::ios_base::beg:
+      base = 0;
+      break;
+    case std::ios_base::cur:
+      base = static_cast<off_type>(m_position) - (egptr() - gptr());
+      break;
+    case std::ios_base::end:
+      base = static_cast<off_type>(m_size);
+      break;
+    default:
+      return pos_type(off_type(-1));
+  }
+  return seekpos(pos_type(base + off), which);
+}
+
+BoundedStreamBuf::pos_type BoundedStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+  const auto position = off_type(pos);
+  if ((which & std::ios_base::in) == 0 || position < 0 || position > static_cast<off_type>(m_size)) {
+    return pos_type(off_type(-1));
+  }
+  // バッファーの範囲内であれば読み直さない
+  const auto buffer_begin = static_cast<off_type>(m_position) - (egptr() - eback());
+  if (buffer_begin <= position && position <= static_cast<off_type>(m_position)) {
+    setg(eback(), eback() + (position - buffer_begin), egptr());
+  } else {
+    m_position = static_cast<std::uint64_t>(position);
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+  }
+  return pos;
+}
+
+MemoryOutputStreamBuf::MemoryOutputStreamBuf(char* data, const std::size_t size, const std::uint64_t base_offset)
+    : m_begin(data), m_end(data + size), m_base_offset(base_offset) {
+  setp(m_begin, m_end);
+}
+
+MemoryOutputStreamBuf::pos_type MemoryOutputStreamBuf::seekoff(off_type off,
+                                                               std::ios_base::seekdir dir,
+                                                               std::ios_base::openmode which) {
+  if ((which & std::ios_base::out) == 0) {
+    return pos_type(off_type(-1));
+  }
+  off_type base;
+  switch (dir) {
+    case std::ios_base::beg:
+      base = 0;
+      break;
+    case std::ios_base::cur:
+      base = static_cast<off_type>(m_base_offset) + (pptr() - m_begin);
+      break;
+    case std::ios_base::end:
+      base = static_cast<off_type>(m_base_offset) + (m_end - m_begin);
+      break;
+    default:
+      return pos_type(off_type(-1));
+  }
+  return seekpos(pos_type(base + off), which);
+}
+
+MemoryOutputStreamBuf::pos_type MemoryOutputStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+  const auto index = off_type(pos) - static_cast<off_type>(m_base_offset);
+  if ((which & std::ios_base::out) == 0 || index < 0 || index > m_end - m_begin) {
+    return pos_type(off_type(-1));
+  }
+  // pbump() は int の範囲しか進められないため, 書き込み位置から領域を設定し直す
+  setp(m_begin + index, m_end);
+  return pos;
+}
+
 }  // namespace shiguredo::mp4::stream
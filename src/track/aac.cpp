@@ -1,5 +1,10 @@
 #include "shiguredo/mp4/track/aac.hpp"
 
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
 #include <iterator>
 #include <memory>
 #include <stdexcept>
@@ -11,8 +16,22 @@
 
 namespace shiguredo::mp4::track {
 
+namespace {
+
+// ISO/IEC 14496-3 1.6.3.4 samplingFrequencyIndex
+const std::array<std::uint32_t, 13> sampling_frequencies = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
+                                                            22050, 16000, 12000, 11025, 8000,  7350};
+
+// 明示的な AudioSpecificConfig も ADTS ヘッダーも無い場合に利用する
+const std::vector<std::uint8_t> default_audio_specific_config = {0x11, 0x90};  // AACLC, @48khz, channel cfg 2
+
+}  // namespace
+
 AACTrack::AACTrack(const AACTrackParameters& params)
-    : m_buffer_size_db(params.buffer_size_db), m_max_bitrate(params.max_bitrate), m_avg_bitrate(params.avg_bitrate) {
+    : m_buffer_size_db(params.buffer_size_db),
+      m_max_bitrate(params.max_bitrate),
+      m_avg_bitrate(params.avg_bitrate),
+      m_audio_specific_config(params.audio_specific_config) {
   m_timescale = params.timescale;
   m_duration = params.duration;
   m_media_time = params.media_time;
@@ -26,27 +45,47 @@ AACTrack::AACTrack(const AACTrackParameters& params)
 }
 
 void AACTrack::makeStsdBoxInfo(BoxInfo* stbl) {
+  const auto statistics = getBitrateStatistics();
+  const auto max_bitrate = m_max_bitrate == 0 ? statistics.max_bitrate : m_max_bitrate;
+  const auto avg_bitrate = m_avg_bitrate == 0 ? statistics.avg_bitrate : m_avg_bitrate;
+  // ビットレートが指定されていない場合のみ btrt の decoding_buffer_size も埋める
+  const auto decoding_buffer_size = m_max_bitrate == 0 && m_avg_bitrate == 0 ? statistics.buffer_size : 0;
+
+  const auto& audio_specific_config =
+      std::empty(m_audio_specific_config) ? default_audio_specific_config : m_audio_specific_config;
+  AudioSpecificConfig asc;
+  std::uint16_t channel_count = 2;
+  std::uint32_t sample_rate = m_timescale;
+  if (parse_audio_specific_config(&asc, audio_specific_config)) {
+    channel_count = get_aac_channel_count(asc.channel_configuration);
+    sample_rate = asc.sampling_frequency;
+  } else {
+    spdlog::warn("AACTrack::makeStsdBoxInfo(): cannot parse AudioSpecificConfig");
+  }
+
+  // samplerate は 16.16 の固定小数点なので, 65536 以上の値は表せず 0 を書き込む
+  const std::uint32_t sample_rate_16_16 = sample_rate < 0x10000 ? sample_rate << 16 : 0;
+
   auto stsd = new BoxInfo({.parent = stbl, .box = new box::Stsd({.entry_count = 1})});
   auto mp4a = new BoxInfo({.parent = stsd,
                            .box = new box::AudioSampleEntry({
                                .type = BoxType("mp4a"),
                                .data_reference_index = 1,
                                .entry_version = 0,
-                               .channel_count = 2,
+                               .channel_count = channel_count,
                                .sample_size = 16,
-                               .sample_rate = m_timescale << 16,
+                               .sample_rate = sample_rate_16_16,
                            })});
   std::shared_ptr<box::DecoderConfigDescriptor> dcd(
       new box::DecoderConfigDescriptor({.object_type_indication = 0x40,  // Audio ISO/IEC 14496-3 (MPEG-4 Audio)
                                         .stream_type = 0x05,             // AudioStream
-                                        .buffer_size_db = m_buffer_size_db,
-                                        .max_bitrate = m_max_bitrate,
-                                        .avg_bitrate = m_avg_bitrate}));
+                                        .buffer_size_db = m_buffer_size_db.value_or(statistics.buffer_size),
+                                        .max_bitrate = max_bitrate,
+                                        .avg_bitrate = avg_bitrate}));
 
   // AAC Sequence header
   // https://titanwolf.org/Network/Articles/Article?AID=973232a4-5330-4b50-bfa8-8bde11c31399
-  std::shared_ptr<box::DecSpecificInfo> dsi(
-      new box::DecSpecificInfo({.data = {0x11, 0x90}}));  // AACLC, @48khz, channel cfg 2
+  std::shared_ptr<box::DecSpecificInfo> dsi(new box::DecSpecificInfo({.data = audio_specific_config}));
   std::shared_ptr<box::SLConfigDescr> scd(
       new box::SLConfigDescr({.data = {0x02}}));  // predefined, Reserved for use in MP4 files
   std::shared_ptr<box::ESDescriptor> esd(
@@ -55,9 +94,23 @@ void AACTrack::makeStsdBoxInfo(BoxInfo* stbl) {
   dcd->addSubDescriptor(dsi);
   esd->addSubDescriptor(scd);
   new BoxInfo({.parent = mp4a, .box = new box::Esds({.descriptors = {esd, dcd, dsi, scd}})});
-  new BoxInfo(
-      {.parent = mp4a,
-       .box = new box::Btrt({.decoding_buffer_size = 0, .max_bitrate = m_max_bitrate, .avg_bitrate = m_avg_bitrate})});
+  new BoxInfo({.parent = mp4a,
+               .box = new box::Btrt({.decoding_buffer_size = decoding_buffer_size,
+                                     .max_bitrate = max_bitrate,
+                                     .avg_bitrate = avg_bitrate})});
+}
+
+std::unique_ptr<Track> AACTrack::clone() const {
+  return std::make_unique<AACTrack>(*this);
+}
+
+std::vector<std::uint8_t> AACTrack::getCodecConfig() const {
+  return m_adts_input ? m_audio_specific_config : std::vector<std::uint8_t>{};
+}
+
+void AACTrack::restoreCodecConfig(const std::vector<std::uint8_t>& data) {
+  m_audio_specific_config = data;
+  m_adts_input = true;
 }
 
 void AACTrack::appendTrakBoxInfo(BoxInfo* moov) {
@@ -101,14 +154,197 @@ void AACTrack::makeSbgpBoxInfo(BoxInfo* stbl) {
 }
 
 void AACTrack::addData(const std::uint64_t timestamp, const std::vector<std::uint8_t>& data, bool is_key) {
-  addMdatData(timestamp, data, is_key);
+  addData(timestamp, data.data(), std::size(data), is_key);
 }
 
 void AACTrack::addData(const std::uint64_t timestamp,
                        const std::uint8_t* data,
                        const std::size_t data_size,
                        bool is_key) {
-  addMdatData(timestamp, data, data_size, is_key);
+  std::vector<Sample> raw_samples;
+  removeADTSHeader(&raw_samples, {.timestamp = timestamp, .data = data, .size = data_size, .is_key = is_key});
+  addMdatSamples(raw_samples);
+}
+
+void AACTrack::addSamples(const std::span<const Sample> samples) {
+  // AudioSpecificConfig が明示されている場合は raw AAC なので samples をそのまま書き込む
+  if (!std::empty(m_audio_specific_config) && !m_adts_input) {
+    addMdatSamples(samples);
+    return;
+  }
+  m_raw_samples.clear();
+  for (const auto& sample : samples) {
+    removeADTSHeader(&m_raw_samples, sample);
+  }
+  addMdatSamples(m_raw_samples);
+}
+
+void AACTrack::removeADTSHeader(std::vector<Sample>* raw_samples, const Sample& sample) {
+  // AudioSpecificConfig が明示されている場合は raw AAC として扱う
+  if (!std::empty(m_audio_specific_config) && !m_adts_input) {
+    raw_samples->push_back(sample);
+    return;
+  }
+  ADTSHeader header;
+  if (!parse_adts_header(&header, sample.data, sample.size)) {
+    if (m_adts_input) {
+      throw std::runtime_error(
+          fmt::format("AACTrack::addData(): invalid ADTS header: timestamp={}", sample.timestamp));
+    }
+    raw_samples->push_back(sample);
+    return;
+  }
+  if (!m_adts_input) {
+    make_audio_specific_config(&m_audio_specific_config, header);
+    m_adts_input = true;
+  }
+  // 複数の ADTS フレームが連続している場合はフレーム毎に 1 サンプルとし, 2 つ目以降の時刻は 1024 サンプルずつ進める
+  std::size_t offset = 0;
+  for (std::uint64_t i = 0;; ++i) {
+    if (header.number_of_raw_data_blocks_in_frame != 0) {
+      throw std::runtime_error(fmt::format("AACTrack::addData(): unsupported number_of_raw_data_blocks_in_frame: {}",
+                                           header.number_of_raw_data_blocks_in_frame));
+    }
+    const auto frame_timestamp =
+        sample.timestamp + i * 1024 * m_timescale / sampling_frequencies[header.sampling_frequency_index];
+    // ADTS ヘッダーを読み飛ばして payload だけを mdat に書き込む
+    raw_samples->push_back({.timestamp = frame_timestamp,
+                            .data = sample.data + offset + header.header_size,
+                            .size = header.frame_length - header.header_size,
+                            .is_key = sample.is_key});
+    offset += header.frame_length;
+    if (offset == sample.size) {
+      return;
+    }
+    if (!parse_adts_header(&header, sample.data + offset, sample.size - offset)) {
+      throw std::runtime_error(fmt::format("AACTrack::addData(): invalid ADTS header: timestamp={} offset={}",
+                                           sample.timestamp, offset));
+    }
+  }
+}
+
+bool operator==(AudioSpecificConfig const& left, AudioSpecificConfig const& right) {
+  return left.audio_object_type == right.audio_object_type && left.sampling_frequency == right.sampling_frequency &&
+         left.channel_configuration == right.channel_configuration;
+}
+
+std::ostream& operator<<(std::ostream& os, const AudioSpecificConfig& asc) {
+  os << "audio_object_type: " << static_cast<std::uint32_t>(asc.audio_object_type)
+     << " sampling_frequency: " << asc.sampling_frequency
+     << " channel_configuration: " << static_cast<std::uint32_t>(asc.channel_configuration);
+  return os;
+}
+
+bool operator==(ADTSHeader const& left, ADTSHeader const& right) {
+  return left.audio_object_type == right.audio_object_type &&
+         left.sampling_frequency_index == right.sampling_frequency_index &&
+         left.channel_configuration == right.channel_configuration && left.header_size == right.header_size &&
+         left.frame_length == right.frame_length &&
+         left.number_of_raw_data_blocks_in_frame == right.number_of_raw_data_blocks_in_frame;
+}
+
+std::ostream& operator<<(std::ostream& os, const ADTSHeader& header) {
+  os << "audio_object_type: " << static_cast<std::uint32_t>(header.audio_object_type)
+     << " sampling_frequency_index: " << static_cast<std::uint32_t>(header.sampling_frequency_index)
+     << " channel_configuration: " << static_cast<std::uint32_t>(header.channel_configuration)
+     << " header_size: " << header.header_size << " frame_length: " << header.frame_length
+     << " number_of_raw_data_blocks_in_frame: " << static_cast<std::uint32_t>(header.number_of_raw_data_blocks_in_frame);
+  return os;
+}
+
+bool parse_adts_header(ADTSHeader* header, const std::uint8_t* data, const std::size_t data_size) {
+  // ISO/IEC 14496-3 1.A.2.2 Audio_Data_Transport_Stream frame, ADTS
+  if (data_size < 7) {
+    return false;
+  }
+  // syncword: 0xfff, layer: 0
+  if (data[0] != 0xff || (data[1] & 0xf6) != 0xf0) {
+    return false;
+  }
+  const bool protection_absent = (data[1] & 0x01) == 1;
+  header->audio_object_type = static_cast<std::uint8_t>(((data[2] >> 6) & 0x03) + 1);
+  header->sampling_frequency_index = static_cast<std::uint8_t>((data[2] >> 2) & 0x0f);
+  header->channel_configuration = static_cast<std::uint8_t>(((data[2] & 0x01) << 2) | ((data[3] >> 6) & 0x03));
+  header->frame_length = (static_cast<std::size_t>(data[3] & 0x03) << 11) | (static_cast<std::size_t>(data[4]) << 3) |
+                         (static_cast<std::size_t>(data[5] >> 5) & 0x07);
+  header->number_of_raw_data_blocks_in_frame = static_cast<std::uint8_t>(data[6] & 0x03);
+  header->header_size = protection_absent ? 7 : 9;
+  if (header->sampling_frequency_index >= std::size(sampling_frequencies)) {
+    return false;
+  }
+  return header->frame_length >= header->header_size && header->frame_length <= data_size;
+}
+
+bool parse_audio_specific_config(AudioSpecificConfig* asc, const std::vector<std::uint8_t>& data) {
+  // ISO/IEC 14496-3 1.6.2.1 AudioSpecificConfig
+  // audioObjectType, samplingFrequency, channelConfiguration までを読む
+  std::uint64_t bits = 0;
+  std::size_t bits_size = 0;
+  for (std::size_t i = 0; i < std::min<std::size_t>(std::size(data), 8); ++i) {
+    bits = (bits << 8) | data[i];
+    bits_size += 8;
+  }
+  std::size_t position = 0;
+  auto read = [&bits, &bits_size, &position](std::uint32_t* value, const std::size_t size) {
+    if (position + size > bits_size) {
+      return false;
+    }
+    *value = static_cast<std::uint32_t>((bits >> (bits_size - position - size)) & ((1ULL << size) - 1));
+    position += size;
+    return true;
+  };
+  std::uint32_t audio_object_type;
+  if (!read(&audio_object_type, 5)) {
+    return false;
+  }
+  if (audio_object_type == 31) {
+    std::uint32_t audio_object_type_ext;
+    if (!read(&audio_object_type_ext, 6)) {
+      return false;
+    }
+    audio_object_type = 32 + audio_object_type_ext;
+  }
+  std::uint32_t sampling_frequency_index;
+  if (!read(&sampling_frequency_index, 4)) {
+    return false;
+  }
+  std::uint32_t sampling_frequency;
+  if (sampling_frequency_index == 0xf) {
+    if (!read(&sampling_frequency, 24)) {
+      return false;
+    }
+  } else if (sampling_frequency_index < std::size(sampling_frequencies)) {
+    sampling_frequency = sampling_frequencies[sampling_frequency_index];
+  } else {
+    return false;
+  }
+  std::uint32_t channel_configuration;
+  if (!read(&channel_configuration, 4)) {
+    return false;
+  }
+  asc->audio_object_type = static_cast<std::uint8_t>(audio_object_type);
+  asc->sampling_frequency = sampling_frequency;
+  asc->channel_configuration = static_cast<std::uint8_t>(channel_configuration);
+  return true;
+}
+
+void make_audio_specific_config(std::vector<std::uint8_t>* data, const ADTSHeader& header) {
+  // audioObjectType(5) samplingFrequencyIndex(4) channelConfiguration(4) GASpecificConfig(3)
+  const std::uint16_t v = static_cast<std::uint16_t>((header.audio_object_type << 11) |
+                                                     (header.sampling_frequency_index << 7) |
+                                                     (header.channel_configuration << 3));
+  *data = {static_cast<std::uint8_t>(v >> 8), static_cast<std::uint8_t>(v & 0xff)};
+}
+
+std::uint16_t get_aac_channel_count(const std::uint8_t channel_configuration) {
+  if (channel_configuration >= 1 && channel_configuration <= 6) {
+    return channel_configuration;
+  }
+  if (channel_configuration == 7) {
+    return 8;
+  }
+  // 0 の場合は program_config_element で定義されるが, 解釈しないので 2 とする
+  return 2;
 }
 
 }  // namespace shiguredo::mp4::track
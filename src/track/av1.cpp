@@ -51,6 +51,10 @@ void AV1Track::makeStsdBoxInfo(BoxInfo* stbl) {
                                                       .config_OBUs = m_config_OBUs})});
 }
 
+std::unique_ptr<Track> AV1Track::clone() const {
+  return std::make_unique<AV1Track>(*this);
+}
+
 void AV1Track::appendTrakBoxInfo(BoxInfo* moov) {
   finalize();
 
@@ -88,6 +92,10 @@ void AV1Track::addData(const std::uint64_t timestamp,
   addMdatData(timestamp, data, data_size, is_key);
 }
 
+void AV1Track::addSamples(const std::span<const Sample> samples) {
+  addMdatSamples(samples);
+}
+
 void AV1Track::setConfigOBUs(const std::vector<std::uint8_t>& config_OBUs) {
   // configOBUs を解釈し他のパラメーターを設定するほうが好ましいが, 煩雑になるので他のパラメーターは決め打ちとしている
   // https://github.com/dwbuiten/obuparse を利用してパースできる
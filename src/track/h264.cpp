@@ -4,9 +4,16 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <iterator>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
+#include "shiguredo/mp4/bitio/bitio.hpp"
+#include "shiguredo/mp4/bitio/reader.hpp"
+#include "shiguredo/mp4/bitio/writer.hpp"
 #include "shiguredo/mp4/box/boxes.hpp"
 #include "shiguredo/mp4/box_info.hpp"
 #include "shiguredo/mp4/writer/writer.hpp"
@@ -53,6 +60,50 @@ void H264Track::makeStsdBoxInfo(BoxInfo* stbl) {
   new BoxInfo({.parent = avc1, .box = avcc});
 }
 
+std::unique_ptr<Track> H264Track::clone() const {
+  return std::make_unique<H264Track>(*this);
+}
+
+std::vector<std::uint8_t> H264Track::getCodecConfig() const {
+  if (std::empty(m_sequence_parameter_sets) && std::empty(m_picture_parameter_sets)) {
+    return {};
+  }
+  std::stringstream ss;
+  bitio::Writer writer(ss);
+  bitio::write_uint<std::uint8_t>(&writer, m_profile);
+  bitio::write_uint<std::uint8_t>(&writer, m_profile_compatibility);
+  bitio::write_uint<std::uint8_t>(&writer, m_level);
+  bitio::write_uint<std::uint8_t>(&writer, static_cast<std::uint8_t>(std::size(m_sequence_parameter_sets)));
+  for (const auto& sps : m_sequence_parameter_sets) {
+    sps.writeData(&writer);
+  }
+  bitio::write_uint<std::uint8_t>(&writer, static_cast<std::uint8_t>(std::size(m_picture_parameter_sets)));
+  for (const auto& pps : m_picture_parameter_sets) {
+    pps.writeData(&writer);
+  }
+  const auto data = ss.str();
+  return {std::begin(data), std::end(data)};
+}
+
+void H264Track::restoreCodecConfig(const std::vector<std::uint8_t>& data) {
+  std::stringstream ss(std::string(std::begin(data), std::end(data)));
+  bitio::Reader reader(ss);
+  bitio::read_uint<std::uint8_t>(&reader, &m_profile);
+  bitio::read_uint<std::uint8_t>(&reader, &m_profile_compatibility);
+  bitio::read_uint<std::uint8_t>(&reader, &m_level);
+  std::uint8_t count;
+  bitio::read_uint<std::uint8_t>(&reader, &count);
+  m_sequence_parameter_sets.resize(count);
+  for (auto& sps : m_sequence_parameter_sets) {
+    sps.readData(&reader);
+  }
+  bitio::read_uint<std::uint8_t>(&reader, &count);
+  m_picture_parameter_sets.resize(count);
+  for (auto& pps : m_picture_parameter_sets) {
+    pps.readData(&reader);
+  }
+}
+
 void H264Track::appendTrakBoxInfo(BoxInfo* moov) {
   finalize();
 
@@ -195,12 +246,27 @@ NalUnit find_next_nal_unit(const std::uint8_t* data, const std::size_t data_size
   return NalUnit{start_code_size, start, data_size, header};
 }
 
+namespace {
+
+bool contains_parameter_set(const std::vector<shiguredo::mp4::box::AVCParameterSet>& sets,
+                            const shiguredo::mp4::box::AVCParameterSet& params) {
+  return std::any_of(std::begin(sets), std::end(sets),
+                     [&params](const auto& set) { return set.getNalUnit() == params.getNalUnit(); });
+}
+
+}  // namespace
+
+// キーフレーム毎に繰り返される同じ SPS/PPS は 1 つにまとめる
 void H264Track::appendSequenceParameterSets(const shiguredo::mp4::box::AVCParameterSet& params) {
-  m_sequence_parameter_sets.emplace_back(params);
+  if (!contains_parameter_set(m_sequence_parameter_sets, params)) {
+    m_sequence_parameter_sets.emplace_back(params);
+  }
 }
 
 void H264Track::appendPictureParameterSets(const shiguredo::mp4::box::AVCParameterSet& params) {
-  m_picture_parameter_sets.emplace_back(params);
+  if (!contains_parameter_set(m_picture_parameter_sets, params)) {
+    m_picture_parameter_sets.emplace_back(params);
+  }
 }
 
 }  // namespace shiguredo::mp4::track
@@ -24,6 +24,7 @@ MP3Track::MP3Track(const MP3TrackParameters& params)
 }
 
 void MP3Track::makeStsdBoxInfo(BoxInfo* stbl) {
+  const auto statistics = getBitrateStatistics();
   auto stsd = new BoxInfo({.parent = stbl, .box = new box::Stsd({.entry_count = 1})});
   auto mp4a = new BoxInfo({.parent = stsd,
                            .box = new box::AudioSampleEntry({
@@ -37,9 +38,9 @@ void MP3Track::makeStsdBoxInfo(BoxInfo* stbl) {
   std::shared_ptr<box::DecoderConfigDescriptor> dcd(
       new box::DecoderConfigDescriptor({.object_type_indication = 0x6b,  // Audio ISO/IEC 11172-3 (MPEG-1 Audio)
                                         .stream_type = 0x05,             // AudioStream
-                                        .buffer_size_db = m_buffer_size_db,
-                                        .max_bitrate = m_max_bitrate,
-                                        .avg_bitrate = m_avg_bitrate}));
+                                        .buffer_size_db = m_buffer_size_db.value_or(statistics.buffer_size),
+                                        .max_bitrate = m_max_bitrate == 0 ? statistics.max_bitrate : m_max_bitrate,
+                                        .avg_bitrate = m_avg_bitrate == 0 ? statistics.avg_bitrate : m_avg_bitrate}));
   std::shared_ptr<box::SLConfigDescr> scd(
       new box::SLConfigDescr({.data = {0x02}}));  // predefined, Reserved for use in MP4 files
   std::shared_ptr<box::ESDescriptor> esd(new box::ESDescriptor({.ESID = 0}));
@@ -48,6 +49,10 @@ void MP3Track::makeStsdBoxInfo(BoxInfo* stbl) {
   new BoxInfo({.parent = mp4a, .box = new box::Esds({.descriptors = {esd, dcd, scd}})});
 }
 
+std::unique_ptr<Track> MP3Track::clone() const {
+  return std::make_unique<MP3Track>(*this);
+}
+
 void MP3Track::appendTrakBoxInfo(BoxInfo* moov) {
   finalize();
 
@@ -84,4 +89,8 @@ void MP3Track::addData(const std::uint64_t timestamp,
   addMdatData(timestamp, data, data_size, is_key);
 }
 
+void MP3Track::addSamples(const std::span<const Sample> samples) {
+  addMdatSamples(samples);
+}
+
 }  // namespace shiguredo::mp4::track
@@ -1,17 +1,169 @@
 #include "shiguredo/mp4/track/opus.hpp"
 
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
 #include <iterator>
+#include <numeric>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
+#include "shiguredo/mp4/bitio/bitio.hpp"
+#include "shiguredo/mp4/bitio/reader.hpp"
+#include "shiguredo/mp4/bitio/writer.hpp"
 #include "shiguredo/mp4/box/boxes.hpp"
 #include "shiguredo/mp4/box_info.hpp"
 #include "shiguredo/mp4/writer/writer.hpp"
 
 namespace shiguredo::mp4::track {
 
+namespace {
+
+// 80ms 分の pre-roll
+// https://datatracker.ietf.org/doc/html/rfc7845#section-4.6
+constexpr std::uint32_t opus_pre_roll = 3840;
+constexpr std::size_t ogg_page_header_size = 27;
+
+std::uint16_t le_to_uint16(const std::uint8_t* data) {
+  return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+}
+
+std::uint32_t le_to_uint32(const std::uint8_t* data) {
+  return static_cast<std::uint32_t>(data[0]) | (static_cast<std::uint32_t>(data[1]) << 8) |
+         (static_cast<std::uint32_t>(data[2]) << 16) | (static_cast<std::uint32_t>(data[3]) << 24);
+}
+
+OpusHead make_opus_head(const OpusTrackParameters& params) {
+  if (params.opus_head) {
+    return *params.opus_head;
+  }
+  return {.pre_skip = static_cast<std::uint16_t>(params.pre_skip)};
+}
+
+}  // namespace
+
+bool parse_opus_head(OpusHead* head, const std::uint8_t* data, const std::size_t data_size) {
+  if (data_size < 19 || !std::equal(data, data + 8, "OpusHead")) {
+    return false;
+  }
+  // major version が 0 以外は互換性がない
+  if ((data[8] & 0xf0) != 0) {
+    return false;
+  }
+  const std::uint8_t channel_count = data[9];
+  const std::uint8_t channel_mapping_family = data[18];
+  if (channel_count == 0) {
+    return false;
+  }
+  std::uint8_t stream_count = 1;
+  std::uint8_t coupled_count = static_cast<std::uint8_t>(channel_count - 1);
+  std::vector<std::uint8_t> channel_mapping;
+  if (channel_mapping_family == 0) {
+    if (channel_count > 2) {
+      return false;
+    }
+  } else {
+    if (channel_mapping_family == 1 && channel_count > 8) {
+      return false;
+    }
+    if (data_size < 21 + static_cast<std::size_t>(channel_count)) {
+      return false;
+    }
+    stream_count = data[19];
+    coupled_count = data[20];
+    if (stream_count == 0 || coupled_count > stream_count || stream_count + coupled_count > 255) {
+      return false;
+    }
+    channel_mapping.assign(data + 21, data + 21 + channel_count);
+    const auto decoded_channel_count = stream_count + coupled_count;
+    if (std::any_of(std::begin(channel_mapping), std::end(channel_mapping),
+                    [decoded_channel_count](const auto m) { return m != 255 && m >= decoded_channel_count; })) {
+      return false;
+    }
+  }
+
+  head->version = data[8];
+  head->channel_count = channel_count;
+  head->pre_skip = le_to_uint16(data + 10);
+  head->input_sample_rate = le_to_uint32(data + 12);
+  head->output_gain = static_cast<std::int16_t>(le_to_uint16(data + 16));
+  head->channel_mapping_family = channel_mapping_family;
+  head->stream_count = stream_count;
+  head->coupled_count = coupled_count;
+  head->channel_mapping = channel_mapping;
+  return true;
+}
+
+std::uint32_t get_opus_packet_duration(const std::uint8_t* data, const std::size_t data_size) {
+  // https://datatracker.ietf.org/doc/html/rfc6716#section-3.1
+  if (data_size < 1) {
+    return 0;
+  }
+  const std::uint8_t config = data[0] >> 3;
+  std::uint32_t frame_size;
+  if (config < 12) {
+    // SILK-only: 10, 20, 40, 60ms
+    static const std::array<std::uint32_t, 4> silk_frame_sizes = {480, 960, 1920, 2880};
+    frame_size = silk_frame_sizes[config & 0x3];
+  } else if (config < 16) {
+    // Hybrid: 10, 20ms
+    frame_size = (config & 0x1) == 0 ? 480 : 960;
+  } else {
+    // CELT-only: 2.5, 5, 10, 20ms
+    frame_size = 120U << (config & 0x3);
+  }
+  std::uint32_t frame_count;
+  switch (data[0] & 0x3) {
+    case 0:
+      frame_count = 1;
+      break;
+    case 1:
+    case 2:
+      frame_count = 2;
+      break;
+    default:
+      if (data_size < 2) {
+        return 0;
+      }
+      frame_count = data[1] & 0x3f;
+      break;
+  }
+  const auto duration = frame_size * frame_count;
+  // 1 パケットは 120ms を越えない
+  if (duration == 0 || duration > 5760) {
+    return 0;
+  }
+  return duration;
+}
+
+bool operator==(OpusHead const& left, OpusHead const& right) {
+  return left.version == right.version && left.channel_count == right.channel_count &&
+         left.pre_skip == right.pre_skip && left.input_sample_rate == right.input_sample_rate &&
+         left.output_gain == right.output_gain && left.channel_mapping_family == right.channel_mapping_family &&
+         left.stream_count == right.stream_count && left.coupled_count == right.coupled_count &&
+         left.channel_mapping == right.channel_mapping;
+}
+
+std::ostream& operator<<(std::ostream& os, const OpusHead& head) {
+  os << "version: " << static_cast<std::uint32_t>(head.version)
+     << " channel_count: " << static_cast<std::uint32_t>(head.channel_count) << " pre_skip: " << head.pre_skip
+     << " input_sample_rate: " << head.input_sample_rate << " output_gain: " << head.output_gain
+     << " channel_mapping_family: " << static_cast<std::uint32_t>(head.channel_mapping_family)
+     << " stream_count: " << static_cast<std::uint32_t>(head.stream_count)
+     << " coupled_count: " << static_cast<std::uint32_t>(head.coupled_count) << " channel_mapping: [";
+  for (std::size_t i = 0; i < std::size(head.channel_mapping); ++i) {
+    os << (i == 0 ? "" : ", ") << static_cast<std::uint32_t>(head.channel_mapping[i]);
+  }
+  os << "]";
+  return os;
+}
+
 OpusTrack::OpusTrack(const OpusTrackParameters& params)
-    : m_pre_skip(params.pre_skip), m_roll_distance(params.roll_distance) {
+    : m_opus_head(make_opus_head(params)), m_roll_distance(params.roll_distance) {
   m_timescale = 48000;
   m_duration = params.duration;
   m_media_time = params.media_time;
@@ -31,16 +183,43 @@ void OpusTrack::makeStsdBoxInfo(BoxInfo* stbl) {
                                .type = BoxType("Opus"),
                                .data_reference_index = 1,
                                .entry_version = 0,
-                               .channel_count = 2,
+                               .channel_count = m_opus_head.channel_count,
                                .sample_size = 16,
                                .sample_rate = 48000L << 16,
                            })});
-  new BoxInfo({.parent = opus,
-               .box = new box::DOps({.output_channel_count = 2,
-                                     .pre_skip = static_cast<std::uint16_t>(m_pre_skip),
-                                     .input_sample_rate = 48000,
-                                     .output_gain = 0,
-                                     .channel_mapping_family = 0})});
+  new BoxInfo(
+      {.parent = opus,
+       .box = new box::DOps({.output_channel_count = m_opus_head.channel_count,
+                             .pre_skip = m_opus_head.pre_skip,
+                             .input_sample_rate = m_opus_head.input_sample_rate,
+                             .output_gain = m_opus_head.output_gain,
+                             .channel_mapping_family = m_opus_head.channel_mapping_family,
+                             .channel_mapping_table = box::DOpsChannelMappingTable({
+                                 .stream_count = m_opus_head.stream_count,
+                                 .coupled_count = m_opus_head.coupled_count,
+                                 .channel_mapping = m_opus_head.channel_mapping,
+                             })})});
+}
+
+std::unique_ptr<Track> OpusTrack::clone() const {
+  return std::make_unique<OpusTrack>(*this);
+}
+
+std::vector<std::uint8_t> OpusTrack::getCodecConfig() const {
+  if (m_first_packet_duration == 0) {
+    return {};
+  }
+  std::stringstream ss;
+  bitio::Writer writer(ss);
+  bitio::write_uint<std::uint32_t>(&writer, m_first_packet_duration);
+  const auto data = ss.str();
+  return {std::begin(data), std::end(data)};
+}
+
+void OpusTrack::restoreCodecConfig(const std::vector<std::uint8_t>& data) {
+  std::stringstream ss(std::string(std::begin(data), std::end(data)));
+  bitio::Reader reader(ss);
+  bitio::read_uint<std::uint32_t>(&reader, &m_first_packet_duration);
 }
 
 void OpusTrack::appendTrakBoxInfo(BoxInfo* moov) {
@@ -75,7 +254,18 @@ void OpusTrack::makeSgpdBoxInfo(BoxInfo* stbl) {
   // ffmpeg and vimeo seem to use roll_distance[0] = -4
   // https://vfrmaniac.fushizen.eu/contents/opus_in_isobmff.html uses roll_distance[0] = -2
   new BoxInfo({.parent = stbl,
-               .box = new box::Sgpd({.roll_distances = {box::RollDistance({.roll_distance = m_roll_distance})}})});
+               .box = new box::Sgpd({.roll_distances = {box::RollDistance({.roll_distance = getRollDistance()})}})});
+}
+
+std::int16_t OpusTrack::getRollDistance() const {
+  if (m_roll_distance) {
+    return *m_roll_distance;
+  }
+  if (m_first_packet_duration == 0) {
+    return -4;
+  }
+  return static_cast<std::int16_t>(
+      -static_cast<std::int32_t>((opus_pre_roll + m_first_packet_duration - 1) / m_first_packet_duration));
 }
 
 void OpusTrack::makeSbgpBoxInfo(BoxInfo* stbl) {
@@ -86,14 +276,137 @@ void OpusTrack::makeSbgpBoxInfo(BoxInfo* stbl) {
 }
 
 void OpusTrack::addData(const std::uint64_t timestamp, const std::vector<std::uint8_t>& data, bool is_key) {
-  addMdatData(timestamp, data, is_key);
+  addData(timestamp, data.data(), std::size(data), is_key);
 }
 
 void OpusTrack::addData(const std::uint64_t timestamp,
                         const std::uint8_t* data,
                         const std::size_t data_size,
                         bool is_key) {
+  if (m_first_packet_duration == 0) {
+    m_first_packet_duration = get_opus_packet_duration(data, data_size);
+  }
   addMdatData(timestamp, data, data_size, is_key);
 }
 
+void OpusTrack::addSamples(const std::span<const Sample> samples) {
+  if (m_first_packet_duration == 0 && !std::empty(samples)) {
+    m_first_packet_duration = get_opus_packet_duration(samples[0].data, samples[0].size);
+  }
+  addMdatSamples(samples);
+}
+
+OggOpusReader::OggOpusReader(std::istream& is) : m_is(is) {
+  const std::uint8_t* data;
+  std::size_t data_size;
+  if (!readRawPacket(&data, &data_size) || !parse_opus_head(&m_opus_head, data, data_size)) {
+    throw std::runtime_error("OggOpusReader::OggOpusReader(): invalid OpusHead");
+  }
+  if (!readRawPacket(&data, &data_size) || data_size < 8 || !std::equal(data, data + 8, "OpusTags")) {
+    throw std::runtime_error("OggOpusReader::OggOpusReader(): invalid OpusTags");
+  }
+}
+
+const OpusHead& OggOpusReader::getOpusHead() const {
+  return m_opus_head;
+}
+
+bool OggOpusReader::readPacket(OpusPacket* packet) {
+  const std::uint8_t* data;
+  std::size_t data_size;
+  do {
+    if (!readRawPacket(&data, &data_size)) {
+      return false;
+    }
+  } while (data_size == 0);
+  const auto duration = get_opus_packet_duration(data, data_size);
+  if (duration == 0) {
+    throw std::runtime_error(fmt::format("OggOpusReader::readPacket(): invalid packet: timestamp={}", m_timestamp));
+  }
+  packet->timestamp = m_timestamp;
+  packet->data = data;
+  packet->size = data_size;
+  m_timestamp += duration;
+  return true;
+}
+
+bool OggOpusReader::readPage() {
+  // https://datatracker.ietf.org/doc/html/rfc3533#section-6
+  while (true) {
+    std::array<std::uint8_t, ogg_page_header_size> header;
+    m_is.read(reinterpret_cast<char*>(header.data()), ogg_page_header_size);
+    if (m_is.gcount() == 0 && m_is.eof()) {
+      return false;
+    }
+    if (static_cast<std::size_t>(m_is.gcount()) != ogg_page_header_size ||
+        !std::equal(std::begin(header), std::begin(header) + 4, "OggS") || header[4] != 0) {
+      throw std::runtime_error("OggOpusReader::readPage(): invalid page header");
+    }
+    const bool continued = (header[5] & 0x01) != 0;
+    const auto serial_number = le_to_uint32(header.data() + 14);
+    m_lacing_values.resize(header[26]);
+    m_is.read(reinterpret_cast<char*>(m_lacing_values.data()), static_cast<std::streamsize>(header[26]));
+    const auto body_size = std::accumulate(std::begin(m_lacing_values), std::end(m_lacing_values), std::size_t{0});
+    m_page.resize(body_size);
+    m_is.read(reinterpret_cast<char*>(m_page.data()), static_cast<std::streamsize>(body_size));
+    if (!m_is) {
+      throw std::runtime_error("OggOpusReader::readPage(): truncated page");
+    }
+    if (!m_has_serial_number) {
+      m_serial_number = serial_number;
+      m_has_serial_number = true;
+    }
+    // 最初の論理ストリーム以外は読み飛ばす
+    if (serial_number != m_serial_number) {
+      continue;
+    }
+    if (!continued && !std::empty(m_packet)) {
+      spdlog::warn("OggOpusReader::readPage(): discard incomplete packet");
+      m_packet.clear();
+    }
+    m_segment_index = 0;
+    m_page_offset = 0;
+    return true;
+  }
+}
+
+bool OggOpusReader::readRawPacket(const std::uint8_t** data, std::size_t* data_size) {
+  if (m_packet_reassembled) {
+    m_packet.clear();
+    m_packet_reassembled = false;
+  }
+  while (true) {
+    if (m_segment_index == std::size(m_lacing_values)) {
+      if (!readPage()) {
+        return false;
+      }
+      continue;
+    }
+    const auto start = m_page_offset;
+    bool completed = false;
+    while (m_segment_index < std::size(m_lacing_values)) {
+      const auto lacing_value = m_lacing_values[m_segment_index++];
+      m_page_offset += lacing_value;
+      if (lacing_value < 255) {
+        completed = true;
+        break;
+      }
+    }
+    if (completed && std::empty(m_packet)) {
+      // ページ内で完結するパケットはコピーせずにページのバッファを参照する
+      *data = m_page.data() + start;
+      *data_size = m_page_offset - start;
+      return true;
+    }
+    // ページをまたぐパケットは結合する
+    m_packet.insert(std::end(m_packet), m_page.data() + start, m_page.data() + m_page_offset);
+    if (completed) {
+      *data = m_packet.data();
+      *data_size = std::size(m_packet);
+      m_packet_reassembled = true;
+      return true;
+    }
+  }
+}
+
 }  // namespace shiguredo::mp4::track
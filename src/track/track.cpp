@@ -6,9 +6,12 @@
 #include <cstdint>
 #include <iterator>
 #include <limits>
+#include <span>
+#include <stdexcept>
 
 #include "shiguredo/mp4/box/boxes.hpp"
 #include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
 #include "shiguredo/mp4/writer/writer.hpp"
 
 namespace shiguredo::mp4::track {
@@ -28,23 +31,147 @@ void Track::addMdatData(const std::uint64_t timestamp,
                         const std::uint8_t* data,
                         const std::size_t data_size,
                         bool is_key) {
+  const Sample sample{.timestamp = timestamp, .data = data, .size = data_size, .is_key = is_key};
+  addMdatSamples({&sample, 1});
+}
+
+void Track::addSamples(const std::span<const Sample> samples) {
+  for (const auto& sample : samples) {
+    addData(sample.timestamp, sample.data, sample.size, sample.is_key);
+  }
+}
+
+void Track::restoreSamples(const std::span<const Sample> samples) {
+  addMdatSamples(samples);
+}
+
+std::vector<std::uint8_t> Track::getCodecConfig() const {
+  return {};
+}
+
+void Track::restoreCodecConfig(const std::vector<std::uint8_t>&) {}
+
+namespace {
+
+template <typename T>
+void reserve_additional(std::vector<T>* v, const std::size_t n) {
+  // 小さいバッチが続いても再確保の回数が増えないように倍々で確保する
+  const auto required = std::size(*v) + n;
+  if (v->capacity() < required) {
+    v->reserve(std::max(required, v->capacity() * 2));
+  }
+}
+
+}  // namespace
+
+void Track::addMdatSamples(const std::span<const Sample> samples) {
+  if (std::empty(samples)) {
+    return;
+  }
+  if (!m_writer->usesSampleTables()) {
+    m_writer->addTrackSamples(*this, samples);
+    return;
+  }
+  // セグメントを切り替える Writer は切り替えるキーフレームの手前でサンプルを分け, resetSamples() を呼び出す場合がある
+  auto rest = samples;
+  while (!std::empty(rest)) {
+    const auto count = std::clamp<std::size_t>(m_writer->prepareTrackSamples(*this, rest), 1, std::size(rest));
+    addSamplesToTables(rest.first(count));
+    rest = rest.subspan(count);
+  }
+}
+
+void Track::addSamplesToTables(const std::span<const Sample> samples) {
+  const auto chunk_offset =
+      m_current_chunk_info.initialized ? m_current_chunk_info.offset : m_writer->tellCurrentMdatOffset();
+  // 書き込みに失敗した場合にテーブルがファイルと食い違わないよう, 書き込んだ後でテーブルに追加する
+  m_writer->addTrackSamples(*this, samples);
+
+  if (m_restart_timestamp) {
+    m_restart_timestamp = false;
+    m_start_timestamp = samples.front().timestamp;
+  }
   if (!m_current_chunk_info.initialized) {
     m_current_chunk_info.initialized = true;
-    m_current_chunk_info.offset = m_writer->tellCurrentMdatOffset();
+    m_current_chunk_info.offset = chunk_offset;
   }
-  ++m_current_chunk_info.number_of_samples;
+  m_current_chunk_info.number_of_samples += static_cast<std::uint32_t>(std::size(samples));
+
+  reserve_additional(&m_mdat_sample_sizes, std::size(samples));
+  reserve_additional(&m_sample_durations, std::size(samples));
+  const bool is_vide = m_handler_type == HandlerType::vide;
+  for (const auto& sample : samples) {
+    if (!std::empty(m_mdat_sample_sizes)) {
+      spdlog::trace("Track::addMdatSamples(): duration: {} {}", sample.timestamp, m_prev_timestamp);
+      m_sample_durations.push_back(static_cast<std::uint32_t>(sample.timestamp - m_prev_timestamp));
+    }
+    m_prev_timestamp = sample.timestamp;
 
-  if (!std::empty(m_mdat_sample_sizes)) {
-    spdlog::trace("Track::addMdatData(): duration: {} {}", timestamp, m_prev_timestamp);
-    m_sample_durations.push_back(static_cast<std::uint32_t>(timestamp - m_prev_timestamp));
+    m_mdat_sample_sizes.push_back(static_cast<std::uint32_t>(sample.size));
+    updateBitrateStatistics(sample.timestamp, static_cast<std::uint32_t>(sample.size));
+    if (is_vide && sample.is_key) {
+      m_key_sample_numbers.push_back(static_cast<std::uint32_t>(std::size(m_mdat_sample_sizes)));
+    }
+  }
+  m_writer->commitTrackSamples(*this, samples);
+}
+
+void Track::updateBitrateStatistics(const std::uint64_t timestamp, const std::uint32_t sample_size) {
+  if (std::size(m_mdat_sample_sizes) == 1) {
+    m_first_timestamp = timestamp;
+    m_window_start_timestamp = timestamp;
   }
-  m_prev_timestamp = timestamp;
+  const auto bits = static_cast<std::uint64_t>(sample_size) * 8;
+  m_total_bits += bits;
+  m_window_bits += bits;
+  // (timestamp - 1 秒, timestamp] の範囲外になったサンプルをウィンドウから外す
+  // 既に保持している m_mdat_sample_sizes と m_sample_durations を参照するので追加のメモリは不要
+  while (m_window_start_timestamp + m_timescale <= timestamp) {
+    m_window_bits -= static_cast<std::uint64_t>(m_mdat_sample_sizes[m_window_start_index]) * 8;
+    m_window_start_timestamp += m_sample_durations[m_window_start_index];
+    ++m_window_start_index;
+  }
+  m_max_window_bits = std::max(m_max_window_bits, m_window_bits);
+  m_max_sample_size = std::max(m_max_sample_size, sample_size);
+}
 
-  m_writer->addMdatData(data, data_size);
-  m_mdat_sample_sizes.push_back(static_cast<std::uint32_t>(data_size));
-  if (m_handler_type == HandlerType::vide && is_key) {
-    m_key_sample_numbers.push_back(static_cast<std::uint32_t>(std::size(m_mdat_sample_sizes)));
+BitrateStatistics Track::getBitrateStatistics() const {
+  BitrateStatistics statistics{.buffer_size = m_max_sample_size};
+  if (std::empty(m_mdat_sample_sizes)) {
+    return statistics;
+  }
+  auto total_duration = m_prev_timestamp - m_first_timestamp;
+  if (m_finalized) {
+    total_duration += m_sample_durations.back();
+  }
+  if (total_duration == 0) {
+    return statistics;
   }
+  const std::uint64_t max_value = std::numeric_limits<std::uint32_t>::max();
+  const auto avg_bitrate = std::min(m_total_bits * m_timescale / total_duration, max_value);
+  statistics.avg_bitrate = static_cast<std::uint32_t>(avg_bitrate);
+  // 1 秒に満たないトラックではウィンドウ内のビット数が実際のビットレートより小さくなるので平均値で補う
+  statistics.max_bitrate = static_cast<std::uint32_t>(std::min(std::max(m_max_window_bits, avg_bitrate), max_value));
+  statistics.buffer_size = static_cast<std::uint32_t>(std::min(getLeakyBucketSize(statistics.max_bitrate), max_value));
+  return statistics;
+}
+
+std::uint64_t Track::getLeakyBucketSize(const std::uint64_t bitrate) const {
+  // 既に保持している m_mdat_sample_sizes と m_sample_durations から求めるので追加のメモリは不要
+  std::uint64_t level_bits = 0;
+  std::uint64_t max_level_bits = 0;
+  for (std::size_t i = 0; i < std::size(m_mdat_sample_sizes); ++i) {
+    if (i > 0) {
+      const auto duration = m_sample_durations[i - 1];
+      // bitrate * duration が溢れないように秒と端数に分ける
+      const auto drained_bits =
+          bitrate * (duration / m_timescale) + bitrate * (duration % m_timescale) / m_timescale;
+      level_bits = level_bits > drained_bits ? level_bits - drained_bits : 0;
+    }
+    level_bits += static_cast<std::uint64_t>(m_mdat_sample_sizes[i]) * 8;
+    max_level_bits = std::max(max_level_bits, level_bits);
+  }
+  return (max_level_bits + 7) / 8;
 }
 
 void Track::finalize() {
@@ -57,7 +184,8 @@ void Track::finalize() {
   }
 
   if (!std::empty(m_mdat_sample_sizes)) {
-    m_sample_durations.push_back(static_cast<std::uint32_t>(getDurationInTimescale() - m_prev_timestamp));
+    m_sample_durations.push_back(
+        static_cast<std::uint32_t>(getDurationInTimescale() - (m_prev_timestamp - m_start_timestamp)));
   }
 }
 
@@ -155,11 +283,25 @@ void Track::setMediaTime(const std::int64_t media_time) {
   m_media_time = media_time;
 }
 
+void Track::setDuration(const float duration) {
+  m_duration = duration;
+}
+
 std::uint64_t Track::getDurationInTimescale() const {
+  if (m_end_timestamp.has_value()) {
+    return *m_end_timestamp - m_start_timestamp;
+  }
   return static_cast<std::uint64_t>(static_cast<float>(m_timescale) * m_duration);
 }
 
 std::uint64_t Track::getDurationInMvhdTimescale() const {
+  if (m_end_timestamp.has_value()) {
+    const auto start_timestamp = getPresentationStartTimestamp();
+    if (*m_end_timestamp <= start_timestamp) {
+      return 0;
+    }
+    return (*m_end_timestamp - start_timestamp) * m_mvhd_timescale / m_timescale;
+  }
   return static_cast<std::uint64_t>(static_cast<float>(m_mvhd_timescale) * m_duration);
 }
 
@@ -171,10 +313,27 @@ BoxInfo* Track::makeEdtsBoxInfo(BoxInfo* trak) {
   return new BoxInfo({.parent = trak, .box = new box::Edts()});
 }
 
+std::uint64_t Track::getPresentationStartTimestamp() const {
+  return m_presentation_start_timestamp.value_or(m_start_timestamp);
+}
+
 void Track::makeElstBoxInfo(BoxInfo* edts) {
-  new BoxInfo({.parent = edts,
-               .box = new box::Elst({.entries = {box::ElstEntry({.track_duration = getDurationInMvhdTimescale(),
-                                                                 .media_time = m_media_time})}})});
+  const auto duration = getDurationInMvhdTimescale();
+  const auto start_timestamp = getPresentationStartTimestamp();
+  std::vector<box::ElstEntry> entries;
+  if (m_start_timestamp > start_timestamp) {
+    // 最初のサンプルがトラックの先頭より後ろにある場合は, その間を空の edit にする
+    const auto empty_duration =
+        std::min(duration, (m_start_timestamp - start_timestamp) * m_mvhd_timescale / m_timescale);
+    entries.push_back(box::ElstEntry({.track_duration = empty_duration, .media_time = -1}));
+    entries.push_back(box::ElstEntry({.track_duration = duration - empty_duration, .media_time = m_media_time}));
+  } else {
+    // 最初のサンプルがトラックの先頭より前にある場合は, その間を飛ばして再生する
+    entries.push_back(box::ElstEntry(
+        {.track_duration = duration,
+         .media_time = m_media_time + static_cast<std::int64_t>(start_timestamp - m_start_timestamp)}));
+  }
+  new BoxInfo({.parent = edts, .box = new box::Elst({.entries = entries})});
 }
 
 BoxInfo* Track::makeMdiaBoxInfo(BoxInfo* trak) {
@@ -213,6 +372,185 @@ std::uint64_t Track::getTimescale() const {
   return m_timescale;
 }
 
+std::uint32_t Track::getTrackID() const {
+  return m_track_id;
+}
+
+HandlerType Track::getHandlerType() const {
+  return m_handler_type;
+}
+
+std::size_t Track::getSampleCount() const {
+  return std::size(m_mdat_sample_sizes);
+}
+
+namespace {
+
+BoxInfo* find_box_info(BoxInfo* info, const BoxType& type) {
+  if (info->getType() == type) {
+    return info;
+  }
+  for (const auto leaf : info->getLeafs()) {
+    if (const auto found = find_box_info(leaf, type); found != nullptr) {
+      return found;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+std::uint64_t Track::updateSnapshotTrakBoxInfo(BoxInfo* moov) {
+  if (m_finalized) {
+    throw std::logic_error("Track::updateSnapshotTrakBoxInfo(): already finalized");
+  }
+  // スナップショットの後のサンプルは別の位置に書き込まれるため chunk を区切る
+  terminateCurrentChunk();
+  const bool has_samples = !std::empty(m_mdat_sample_sizes);
+  const std::uint32_t last_duration = std::empty(m_sample_durations) ? 0 : m_sample_durations.back();
+  const std::uint64_t end_timestamp = getEndTimestamp() - m_start_timestamp;
+  const std::uint64_t duration_in_mvhd_timescale = end_timestamp * m_mvhd_timescale / m_timescale;
+
+  if (m_snapshot.stbl == nullptr) {
+    // finalize() の代わりに最後のサンプルの duration を仮に追加して trak を作り, 元に戻す
+    const auto duration = m_duration;
+    m_duration = static_cast<float>(static_cast<double>(end_timestamp) / static_cast<double>(m_timescale));
+    if (has_samples) {
+      m_sample_durations.push_back(last_duration);
+    }
+    m_finalized = true;
+    appendTrakBoxInfo(moov);
+    m_finalized = false;
+    if (has_samples) {
+      m_sample_durations.pop_back();
+    }
+    m_duration = duration;
+
+    const auto trak = moov->getLeafs().back();
+    m_snapshot.tkhd = find_box_info(trak, BoxType("tkhd"));
+    m_snapshot.elst = find_box_info(trak, BoxType("elst"));
+    m_snapshot.mdhd = find_box_info(trak, BoxType("mdhd"));
+    m_snapshot.stbl = find_box_info(trak, BoxType("stbl"));
+    if (m_snapshot.tkhd == nullptr || m_snapshot.mdhd == nullptr || m_snapshot.stbl == nullptr) {
+      throw std::runtime_error("Track::updateSnapshotTrakBoxInfo(): tkhd, mdhd or stbl not found");
+    }
+    m_snapshot.stts = find_box_info(m_snapshot.stbl, BoxType("stts"));
+    m_snapshot.stss = find_box_info(m_snapshot.stbl, BoxType("stss"));
+    m_snapshot.stsc = find_box_info(m_snapshot.stbl, BoxType("stsc"));
+    m_snapshot.stsz = find_box_info(m_snapshot.stbl, BoxType("stsz"));
+    m_snapshot.offset = find_box_info(m_snapshot.stbl, BoxType("stco"));
+    if (m_snapshot.offset == nullptr) {
+      m_snapshot.offset = find_box_info(m_snapshot.stbl, BoxType("co64"));
+    }
+    if (m_snapshot.stts == nullptr || m_snapshot.stsc == nullptr || m_snapshot.stsz == nullptr ||
+        m_snapshot.offset == nullptr) {
+      throw std::runtime_error("Track::updateSnapshotTrakBoxInfo(): sample table not found");
+    }
+  } else {
+    auto stts = static_cast<box::Stts*>(m_snapshot.stts->getBox());
+    // 前回仮に追加した最後のサンプルの duration を取り除く
+    if (m_snapshot.sample_count > 0) {
+      stts->removeLastSample();
+    }
+    for (auto i = m_snapshot.sample_duration_count; i < std::size(m_sample_durations); ++i) {
+      stts->addSample(m_sample_durations[i]);
+    }
+    if (has_samples) {
+      stts->addSample(last_duration);
+    }
+    m_snapshot.stts->invalidateSize();
+
+    static_cast<box::Stsz*>(m_snapshot.stsz->getBox())
+        ->addEntrySizes(std::span(m_mdat_sample_sizes).subspan(m_snapshot.sample_count));
+    m_snapshot.stsz->invalidateSize();
+    if (m_snapshot.stss != nullptr) {
+      static_cast<box::Stss*>(m_snapshot.stss->getBox())
+          ->addSampleNumbers(std::span(m_key_sample_numbers).subspan(m_snapshot.key_sample_count));
+      m_snapshot.stss->invalidateSize();
+    }
+
+    auto stsc = static_cast<box::Stsc*>(m_snapshot.stsc->getBox());
+    for (auto i = m_snapshot.chunk_count; i < std::size(m_chunk_infos); ++i) {
+      stsc->addChunk(static_cast<std::uint32_t>(i + 1), m_chunk_infos[i].number_of_samples);
+    }
+    m_snapshot.stsc->invalidateSize();
+
+    const bool uses_stco = m_snapshot.offset->getType() == BoxType("stco");
+    if (uses_stco && !std::empty(m_chunk_infos) &&
+        m_chunk_infos.back().offset > std::numeric_limits<std::uint32_t>::max()) {
+      // 32 bit に収まらなくなった場合のみ co64 を作り直す
+      m_snapshot.stbl->removeLeaf(m_snapshot.offset);
+      m_snapshot.offset = new BoxInfo({.parent = m_snapshot.stbl, .box = make_offset_box(m_chunk_infos)});
+    } else {
+      for (auto i = m_snapshot.chunk_count; i < std::size(m_chunk_infos); ++i) {
+        if (uses_stco) {
+          static_cast<box::Stco*>(m_snapshot.offset->getBox())
+              ->addChunkOffset(static_cast<std::uint32_t>(m_chunk_infos[i].offset));
+        } else {
+          static_cast<box::Co64*>(m_snapshot.offset->getBox())->addChunkOffset(m_chunk_infos[i].offset);
+        }
+      }
+      m_snapshot.offset->invalidateSize();
+    }
+  }
+
+  static_cast<box::Tkhd*>(m_snapshot.tkhd->getBox())->setDuration(duration_in_mvhd_timescale);
+  m_snapshot.tkhd->invalidateSize();
+  static_cast<box::Mdhd*>(m_snapshot.mdhd->getBox())->setDuration(end_timestamp);
+  m_snapshot.mdhd->invalidateSize();
+  if (m_snapshot.elst != nullptr) {
+    static_cast<box::Elst*>(m_snapshot.elst->getBox())->setTrackDuration(duration_in_mvhd_timescale);
+    m_snapshot.elst->invalidateSize();
+  }
+
+  m_snapshot.sample_count = std::size(m_mdat_sample_sizes);
+  m_snapshot.sample_duration_count = std::size(m_sample_durations);
+  m_snapshot.key_sample_count = std::size(m_key_sample_numbers);
+  m_snapshot.chunk_count = std::size(m_chunk_infos);
+  return duration_in_mvhd_timescale;
+}
+
+std::unique_ptr<Track> Track::clone() const {
+  throw std::logic_error("Track::clone(): not supported");
+}
+
+void Track::resetSamples(const std::optional<std::uint64_t> start_timestamp) {
+  m_finalized = false;
+  m_mdat_sample_sizes.clear();
+  m_chunk_infos.clear();
+  m_current_chunk_info = {};
+  m_prev_timestamp = 0;
+  m_sample_durations.clear();
+  m_key_sample_numbers.clear();
+  m_snapshot = {};
+  m_restart_timestamp = true;
+  m_end_timestamp = std::nullopt;
+  // サンプルを追加しない場合も duration が 0 になるように, 先頭の時刻で仮に置き換える
+  m_presentation_start_timestamp = start_timestamp;
+  if (start_timestamp.has_value()) {
+    m_start_timestamp = *start_timestamp;
+  }
+
+  m_first_timestamp = 0;
+  m_total_bits = 0;
+  m_window_bits = 0;
+  m_max_window_bits = 0;
+  m_window_start_timestamp = 0;
+  m_window_start_index = 0;
+  m_max_sample_size = 0;
+}
+
+void Track::setEndTimestamp(const std::uint64_t end_timestamp) {
+  m_end_timestamp = end_timestamp;
+}
+
+std::uint64_t Track::getEndTimestamp() const {
+  if (std::empty(m_mdat_sample_sizes)) {
+    return m_start_timestamp;
+  }
+  return m_prev_timestamp + (std::empty(m_sample_durations) ? 0 : m_sample_durations.back());
+}
+
 void Track::resetChunkOffsets(std::uint64_t diff) {
   finalize();
   for (auto& co : m_chunk_infos) {
@@ -1,14 +1,83 @@
 #include "shiguredo/mp4/track/vpx.hpp"
 
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
+#include "shiguredo/mp4/bitio/bitio.hpp"
+#include "shiguredo/mp4/bitio/reader.hpp"
+#include "shiguredo/mp4/bitio/writer.hpp"
 #include "shiguredo/mp4/box/boxes.hpp"
 #include "shiguredo/mp4/box_info.hpp"
 #include "shiguredo/mp4/writer/writer.hpp"
 
 namespace shiguredo::mp4::track {
 
+namespace {
+
+// フレームヘッダーの先頭数バイトだけを読むための最小限のビットリーダー
+class FrameHeaderBitReader {
+ public:
+  FrameHeaderBitReader(const std::uint8_t* data, const std::size_t data_size) : m_data(data), m_data_size(data_size) {}
+
+  bool read(std::uint32_t* value, const std::size_t bits) {
+    if (m_position + bits > m_data_size * 8) {
+      return false;
+    }
+    std::uint32_t v = 0;
+    for (std::size_t i = 0; i < bits; ++i, ++m_position) {
+      v = (v << 1) | static_cast<std::uint32_t>((m_data[m_position / 8] >> (7 - m_position % 8)) & 0x1);
+    }
+    *value = v;
+    return true;
+  }
+
+ private:
+  const std::uint8_t* m_data;
+  const std::size_t m_data_size;
+  std::size_t m_position = 0;
+};
+
+// VP9 の color_space を ISO/IEC 23091-2 の値に変換する
+// color_space は主に matrix_coefficients を表すので, sRGB 以外の primaries, transfer は Unspecified のままとする
+void set_vp9_color_space(VPXFrameHeader* header, const std::uint32_t color_space) {
+  switch (color_space) {
+    case 1:  // CS_BT_601
+      header->matrix_coefficients = 5;
+      break;
+    case 2:  // CS_BT_709
+      header->matrix_coefficients = 1;
+      break;
+    case 3:  // CS_SMPTE_170
+      header->matrix_coefficients = 6;
+      break;
+    case 4:  // CS_SMPTE_240
+      header->matrix_coefficients = 7;
+      break;
+    case 5:  // CS_BT_2020
+      header->matrix_coefficients = 9;
+      break;
+    case 7:  // CS_RGB
+      header->colour_primaries = 1;
+      header->transfer_characteristics = 13;
+      header->matrix_coefficients = 0;
+      break;
+    default:  // CS_UNKNOWN, CS_RESERVED
+      header->matrix_coefficients = 2;
+      break;
+  }
+}
+
+}  // namespace
+
 VPXTrack::VPXTrack(const VPXTrackParameters& params) : m_codec(params.codec) {
   m_timescale = params.timescale;
   m_duration = params.duration;
@@ -27,6 +96,12 @@ VPXTrack::VPXTrack(const VPXTrackParameters& params) : m_codec(params.codec) {
 }
 
 void VPXTrack::makeStsdBoxInfo(BoxInfo* stbl) {
+  const auto statistics = getBitrateStatistics();
+  const auto max_bitrate = m_max_bitrate == 0 ? statistics.max_bitrate : m_max_bitrate;
+  const auto avg_bitrate = m_avg_bitrate == 0 ? statistics.avg_bitrate : m_avg_bitrate;
+  // ビットレートが指定されていない場合のみ decoding_buffer_size も埋める
+  const auto decoding_buffer_size = m_max_bitrate == 0 && m_avg_bitrate == 0 ? statistics.buffer_size : 0;
+
   // https://www.webmproject.org/vp9/mp4/
   auto stsd = new BoxInfo({.parent = stbl, .box = new box::Stsd({.entry_count = 1})});
   auto vp0x = new BoxInfo({.parent = stsd,
@@ -36,12 +111,62 @@ void VPXTrack::makeStsdBoxInfo(BoxInfo* stbl) {
                                .width = static_cast<std::uint16_t>(m_width),
                                .height = static_cast<std::uint16_t>(m_height),
                            })});
-  new BoxInfo({.parent = vp0x, .box = new box::VPCodecConfiguration({.version = 1, .level = 21})});
+  new BoxInfo({.parent = vp0x,
+               .box = new box::VPCodecConfiguration({
+                   .version = 1,
+                   .profile = m_configuration.profile,
+                   .level = 21,
+                   .bit_depth = m_configuration.bit_depth,
+                   .chroma_sub_sampling = m_configuration.chroma_sub_sampling,
+                   .video_full_range_flag = m_configuration.video_full_range_flag,
+                   .colour_primaries = m_configuration.colour_primaries,
+                   .transfer_characteristics = m_configuration.transfer_characteristics,
+                   .matrix_coefficients = m_configuration.matrix_coefficients,
+               })});
   new BoxInfo({.parent = vp0x, .box = new box::Fiel({.field_count = 1, .field_ordering = 0})});
   new BoxInfo({.parent = vp0x, .box = new box::PixelAspectRatio({.h_spacing = 1})});
-  new BoxInfo(
-      {.parent = vp0x,
-       .box = new box::Btrt({.decoding_buffer_size = 0, .max_bitrate = m_max_bitrate, .avg_bitrate = m_avg_bitrate})});
+  new BoxInfo({.parent = vp0x,
+               .box = new box::Btrt({.decoding_buffer_size = decoding_buffer_size,
+                                     .max_bitrate = max_bitrate,
+                                     .avg_bitrate = avg_bitrate})});
+}
+
+std::unique_ptr<Track> VPXTrack::clone() const {
+  return std::make_unique<VPXTrack>(*this);
+}
+
+std::vector<std::uint8_t> VPXTrack::getCodecConfig() const {
+  if (!m_has_configuration) {
+    return {};
+  }
+  std::stringstream ss;
+  bitio::Writer writer(ss);
+  bitio::write_uint<std::uint8_t>(&writer, m_configuration.profile);
+  bitio::write_uint<std::uint8_t>(&writer, m_configuration.bit_depth);
+  bitio::write_uint<std::uint8_t>(&writer, m_configuration.chroma_sub_sampling);
+  bitio::write_uint<std::uint8_t>(&writer, m_configuration.video_full_range_flag);
+  bitio::write_uint<std::uint8_t>(&writer, m_configuration.colour_primaries);
+  bitio::write_uint<std::uint8_t>(&writer, m_configuration.transfer_characteristics);
+  bitio::write_uint<std::uint8_t>(&writer, m_configuration.matrix_coefficients);
+  bitio::write_uint<std::uint32_t>(&writer, m_width);
+  bitio::write_uint<std::uint32_t>(&writer, m_height);
+  const auto data = ss.str();
+  return {std::begin(data), std::end(data)};
+}
+
+void VPXTrack::restoreCodecConfig(const std::vector<std::uint8_t>& data) {
+  std::stringstream ss(std::string(std::begin(data), std::end(data)));
+  bitio::Reader reader(ss);
+  bitio::read_uint<std::uint8_t>(&reader, &m_configuration.profile);
+  bitio::read_uint<std::uint8_t>(&reader, &m_configuration.bit_depth);
+  bitio::read_uint<std::uint8_t>(&reader, &m_configuration.chroma_sub_sampling);
+  bitio::read_uint<std::uint8_t>(&reader, &m_configuration.video_full_range_flag);
+  bitio::read_uint<std::uint8_t>(&reader, &m_configuration.colour_primaries);
+  bitio::read_uint<std::uint8_t>(&reader, &m_configuration.transfer_characteristics);
+  bitio::read_uint<std::uint8_t>(&reader, &m_configuration.matrix_coefficients);
+  bitio::read_uint<std::uint32_t>(&reader, &m_width);
+  bitio::read_uint<std::uint32_t>(&reader, &m_height);
+  m_has_configuration = true;
 }
 
 void VPXTrack::appendTrakBoxInfo(BoxInfo* moov) {
@@ -71,14 +196,214 @@ void VPXTrack::appendTrakBoxInfo(BoxInfo* moov) {
 }
 
 void VPXTrack::addData(const std::uint64_t timestamp, const std::vector<std::uint8_t>& data, bool is_key) {
-  addMdatData(timestamp, data, is_key);
+  addData(timestamp, data.data(), data.size(), is_key);
 }
 
 void VPXTrack::addData(const std::uint64_t timestamp,
                        const std::uint8_t* data,
                        const std::size_t data_size,
                        bool is_key) {
-  addMdatData(timestamp, data, data_size, is_key);
+  const Sample sample{.timestamp = timestamp, .data = data, .size = data_size, .is_key = is_key};
+  addMdatData(timestamp, data, data_size, detectKeyFrame(sample));
+}
+
+void VPXTrack::addSamples(const std::span<const Sample> samples) {
+  // is_key がフレームヘッダーと一致する間は samples をそのまま使い, 異なるサンプルが現れた場合のみ書き換えた Sample を作る
+  bool overridden = false;
+  m_key_detected_samples.clear();
+  for (std::size_t i = 0; i < std::size(samples); ++i) {
+    const auto is_key = detectKeyFrame(samples[i]);
+    if (!overridden && is_key != samples[i].is_key) {
+      overridden = true;
+      m_key_detected_samples.assign(std::begin(samples), std::begin(samples) + static_cast<std::ptrdiff_t>(i));
+    }
+    if (overridden) {
+      m_key_detected_samples.push_back(samples[i]);
+      m_key_detected_samples.back().is_key = is_key;
+    }
+  }
+  if (overridden) {
+    addMdatSamples(m_key_detected_samples);
+  } else {
+    addMdatSamples(samples);
+  }
+}
+
+bool VPXTrack::detectKeyFrame(const Sample& sample) {
+  VPXFrameHeader header;
+  const bool parsed = m_codec == VPXCodec::VP8 ? parse_vp8_frame_header(&header, sample.data, sample.size)
+                                              : parse_vp9_frame_header(&header, sample.data, sample.size);
+  if (!parsed) {
+    spdlog::debug("VPXTrack::addData(): cannot parse the frame header: timestamp={} data_size={}", sample.timestamp,
+                  sample.size);
+    return sample.is_key;
+  }
+  // ビットストリームの内容を優先する
+  if (header.is_key != sample.is_key) {
+    spdlog::debug("VPXTrack::addData(): is_key={} is overridden by the frame header: timestamp={}", sample.is_key,
+                  sample.timestamp);
+  }
+  if (header.is_key) {
+    updateConfiguration(header);
+  }
+  return header.is_key;
+}
+
+void VPXTrack::updateConfiguration(const VPXFrameHeader& header) {
+  // 解像度が変わる場合はサンプルエントリーに最大の解像度を記録する
+  m_width = std::max(m_width, header.width);
+  m_height = std::max(m_height, header.height);
+  if (!m_has_configuration) {
+    m_configuration = header;
+    m_has_configuration = true;
+    return;
+  }
+  if (m_configuration.profile != header.profile || m_configuration.bit_depth != header.bit_depth ||
+      m_configuration.chroma_sub_sampling != header.chroma_sub_sampling) {
+    spdlog::warn(
+        "VPXTrack::updateConfiguration(): configuration is changed: profile={} bit_depth={} chroma_sub_sampling={}",
+        header.profile, header.bit_depth, header.chroma_sub_sampling);
+  }
+}
+
+bool operator==(VPXFrameHeader const& left, VPXFrameHeader const& right) {
+  return left.is_key == right.is_key && left.profile == right.profile && left.bit_depth == right.bit_depth &&
+         left.chroma_sub_sampling == right.chroma_sub_sampling &&
+         left.video_full_range_flag == right.video_full_range_flag &&
+         left.colour_primaries == right.colour_primaries &&
+         left.transfer_characteristics == right.transfer_characteristics &&
+         left.matrix_coefficients == right.matrix_coefficients && left.width == right.width &&
+         left.height == right.height;
+}
+
+std::ostream& operator<<(std::ostream& os, const VPXFrameHeader& header) {
+  os << "is_key: " << header.is_key << " profile: " << static_cast<std::uint32_t>(header.profile)
+     << " bit_depth: " << static_cast<std::uint32_t>(header.bit_depth)
+     << " chroma_sub_sampling: " << static_cast<std::uint32_t>(header.chroma_sub_sampling)
+     << " video_full_range_flag: " << static_cast<std::uint32_t>(header.video_full_range_flag)
+     << " colour_primaries: " << static_cast<std::uint32_t>(header.colour_primaries)
+     << " transfer_characteristics: " << static_cast<std::uint32_t>(header.transfer_characteristics)
+     << " matrix_coefficients: " << static_cast<std::uint32_t>(header.matrix_coefficients)
+     << " width: " << header.width << " height: " << header.height;
+  return os;
+}
+
+bool parse_vp8_frame_header(VPXFrameHeader* header, const std::uint8_t* data, const std::size_t data_size) {
+  // RFC 6386 9.1. Uncompressed Data Chunk
+  if (data_size < 3) {
+    return false;
+  }
+  header->is_key = (data[0] & 0x01) == 0;
+  header->profile = static_cast<std::uint8_t>((data[0] >> 1) & 0x07);
+  if (header->profile > 3) {
+    return false;
+  }
+  if (!header->is_key) {
+    return true;
+  }
+  if (data_size < 10 || data[3] != 0x9d || data[4] != 0x01 || data[5] != 0x2a) {
+    return false;
+  }
+  // 上位 2 bit は scale
+  header->width = static_cast<std::uint32_t>(data[6] | (data[7] << 8)) & 0x3fff;
+  header->height = static_cast<std::uint32_t>(data[8] | (data[9] << 8)) & 0x3fff;
+  return true;
+}
+
+bool parse_vp9_frame_header(VPXFrameHeader* header, const std::uint8_t* data, const std::size_t data_size) {
+  // VP9 Bitstream & Decoding Process Specification 6.2 Uncompressed header syntax
+  FrameHeaderBitReader reader(data, data_size);
+  std::uint32_t frame_marker;
+  std::uint32_t profile_low_bit;
+  std::uint32_t profile_high_bit;
+  if (!reader.read(&frame_marker, 2) || frame_marker != 2 || !reader.read(&profile_low_bit, 1) ||
+      !reader.read(&profile_high_bit, 1)) {
+    return false;
+  }
+  header->profile = static_cast<std::uint8_t>((profile_high_bit << 1) | profile_low_bit);
+  std::uint32_t v;
+  if (header->profile == 3 && (!reader.read(&v, 1) || v != 0)) {
+    return false;
+  }
+
+  std::uint32_t show_existing_frame;
+  if (!reader.read(&show_existing_frame, 1)) {
+    return false;
+  }
+  if (show_existing_frame == 1) {
+    header->is_key = false;
+    return true;
+  }
+  std::uint32_t frame_type;
+  if (!reader.read(&frame_type, 1)) {
+    return false;
+  }
+  header->is_key = frame_type == 0;
+  if (!header->is_key) {
+    return true;
+  }
+
+  // show_frame, error_resilient_mode
+  std::uint32_t frame_sync_code;
+  if (!reader.read(&v, 2) || !reader.read(&frame_sync_code, 24) || frame_sync_code != 0x498342) {
+    return false;
+  }
+
+  // color_config()
+  header->bit_depth = 8;
+  if (header->profile >= 2) {
+    if (!reader.read(&v, 1)) {
+      return false;
+    }
+    header->bit_depth = v == 1 ? 12 : 10;
+  }
+  std::uint32_t color_space;
+  if (!reader.read(&color_space, 3)) {
+    return false;
+  }
+  set_vp9_color_space(header, color_space);
+  std::uint32_t subsampling_x = 1;
+  std::uint32_t subsampling_y = 1;
+  if (color_space != 7) {
+    if (!reader.read(&v, 1)) {
+      return false;
+    }
+    header->video_full_range_flag = static_cast<std::uint8_t>(v);
+    if (header->profile == 1 || header->profile == 3) {
+      if (!reader.read(&subsampling_x, 1) || !reader.read(&subsampling_y, 1) || !reader.read(&v, 1)) {
+        return false;
+      }
+    }
+  } else {
+    header->video_full_range_flag = 1;
+    if (header->profile == 1 || header->profile == 3) {
+      subsampling_x = 0;
+      subsampling_y = 0;
+      if (!reader.read(&v, 1)) {
+        return false;
+      }
+    }
+  }
+  // vpcC の chromaSubsampling: 1: 4:2:0 colocated with luma, 2: 4:2:2, 3: 4:4:4
+  if (subsampling_x == 1 && subsampling_y == 1) {
+    header->chroma_sub_sampling = 1;
+  } else if (subsampling_x == 1 && subsampling_y == 0) {
+    header->chroma_sub_sampling = 2;
+  } else if (subsampling_x == 0 && subsampling_y == 0) {
+    header->chroma_sub_sampling = 3;
+  } else {
+    return false;
+  }
+
+  // frame_size()
+  std::uint32_t frame_width_minus_1;
+  std::uint32_t frame_height_minus_1;
+  if (!reader.read(&frame_width_minus_1, 16) || !reader.read(&frame_height_minus_1, 16)) {
+    return false;
+  }
+  header->width = frame_width_minus_1 + 1;
+  header->height = frame_height_minus_1 + 1;
+  return true;
 }
 
 }  // namespace shiguredo::mp4::track
@@ -99,6 +99,15 @@ void FaststartWriter::addMdatData(const std::uint8_t* data, const std::size_t da
   m_mdat_data_size += static_cast<std::uint64_t>(data_size);
 }
 
+void FaststartWriter::addMdatSamples(const std::span<const track::Sample> samples) {
+  const auto data = gatherSamples(samples);
+  if (const auto ret = fwrite(data.data(), 1, std::size(data), m_mdat_fd); ret != std::size(data)) {
+    throw std::runtime_error(
+        fmt::format("FaststartWriter::addMdatSamples(): fwrite() failed: data_size={} ret={}", std::size(data), ret));
+  }
+  m_mdat_data_size += static_cast<std::uint64_t>(std::size(data));
+}
+
 void FaststartWriter::setOffsetAndSize() {
   m_moov_box_info->adjustOffsetAndSize(m_ftyp_size);
 }
@@ -113,15 +122,9 @@ std::uint64_t FaststartWriter::tellCurrentMdatOffset() {
 }
 
 void FaststartWriter::writeMoovBox() {
-  m_os.seekp(static_cast<std::streamoff>(m_ftyp_size), std::ios_base::beg);
-  if (!m_os.good()) {
-    throw std::runtime_error(
-        fmt::format("FaststartWriter::writeFtypBox(): ostream::seekp() failed: rdstate={}", m_os.rdstate()));
-  }
-
   m_mvhd_box->setNextTrackID(m_next_track_id);
 
-  m_moov_box_info->write(m_os);
+  m_moov_box_info->writeAtOnce(m_os);
 }
 
 std::uint64_t FaststartWriter::getFtypSize() const {
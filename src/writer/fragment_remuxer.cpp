@@ -0,0 +1,268 @@
+#include "shiguredo/mp4/writer/fragment_remuxer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/reader/box_filter.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/stream/stream.hpp"
+#include "shiguredo/mp4/writer/fragment_run.hpp"
+#include "shiguredo/mp4/writer/remux.hpp"
+
+namespace shiguredo::mp4::writer {
+
+namespace {
+
+std::vector<FragmentSample> make_fragment_samples(const std::vector<reader::IndexedSample>& samples,
+                                                  const std::size_t begin,
+                                                  const std::size_t end) {
+  std::vector<FragmentSample> fragment_samples;
+  fragment_samples.reserve(end - begin);
+  for (std::size_t i = begin; i < end; ++i) {
+    const auto& sample = samples[i];
+    fragment_samples.push_back({.duration = sample.duration,
+                                .size = sample.size,
+                                .flags = sample.is_key ? KeySampleFlags : NonKeySampleFlags,
+                                .composition_time_offset = sample.composition_time_offset});
+  }
+  return fragment_samples;
+}
+
+}  // namespace
+
+FragmentRemuxer::FragmentRemuxer(std::istream& t_is, const FragmentRemuxerParameters& params)
+    : m_is(t_is), m_ftyp_params(params.ftyp_params), m_copy_buffer(std::max<std::size_t>(params.copy_buffer_size, 1)) {
+  m_reader = std::make_unique<reader::SimpleReader>(
+      m_is, reader::SimpleReaderParameters{.filter = reader::BoxFilter({.allow_paths = {{BoxType("moov")}}})});
+  m_reader->parse();
+  m_is.clear();
+  for (const auto info : m_reader->getBoxInfos()) {
+    if (info->getType() == BoxType("moov")) {
+      m_moov = info;
+    }
+  }
+  if (m_moov == nullptr) {
+    throw std::runtime_error("FragmentRemuxer::FragmentRemuxer(): moov not found");
+  }
+  m_tracks = reader::build_sample_indexes(m_moov);
+  if (std::empty(m_tracks)) {
+    throw std::runtime_error("FragmentRemuxer::FragmentRemuxer(): trak not found");
+  }
+  makeFragments(params.fragment_duration_ms);
+  makeInitMoov();
+}
+
+FragmentRemuxer::~FragmentRemuxer() = default;
+
+void FragmentRemuxer::writeInitSegment(std::ostream& os) {
+  BoxInfo ftyp({.box = new box::Ftyp(m_ftyp_params)});
+  ftyp.adjustOffsetAndSize(0);
+  write_box(&ftyp, os);
+  m_moov->adjustOffsetAndSize(0);
+  write_box(m_moov, os);
+  if (!os.good()) {
+    throw std::runtime_error(
+        fmt::format("FragmentRemuxer::writeInitSegment(): ostream::write() failed: rdstate={}", os.rdstate()));
+  }
+}
+
+std::size_t FragmentRemuxer::getFragmentCount() const {
+  return std::size(m_fragments);
+}
+
+void FragmentRemuxer::writeFragment(std::ostream& os, const std::size_t index) {
+  if (index >= std::size(m_fragments)) {
+    throw std::out_of_range(fmt::format("FragmentRemuxer::writeFragment(): invalid index: {}", index));
+  }
+  const auto& ranges = m_fragments[index];
+
+  BoxInfo moof({.box = new box::Moof()});
+  new BoxInfo({.parent = &moof, .box = new box::Mfhd({.sequence_number = static_cast<std::uint32_t>(index + 1)})});
+  std::vector<box::Trun*> truns;
+  std::vector<std::uint64_t> traf_data_sizes;
+  for (std::size_t t = 0; t < std::size(m_tracks); ++t) {
+    const auto& track = m_tracks[t];
+    const auto& range = ranges[t];
+    if (range.begin == range.end) {
+      continue;
+    }
+    const auto samples = make_fragment_samples(track.samples, range.begin, range.end);
+    std::uint64_t data_size = 0;
+    for (const auto& sample : samples) {
+      data_size += sample.size;
+    }
+    const auto run = make_fragment_run(samples, m_trex_defaults[t]);
+
+    auto traf = new BoxInfo({.parent = &moof, .box = new box::Traf()});
+    new BoxInfo({.parent = traf,
+                 .box = new box::Tfhd({.flags = box::TfhdDefaultBaseIsMoof | run.tfhd_flags,
+                                       .track_id = track.track_id,
+                                       .default_sample_duration = run.tfhd_defaults.duration,
+                                       .default_sample_size = run.tfhd_defaults.size,
+                                       .default_sample_flags = run.tfhd_defaults.flags})});
+    new BoxInfo(
+        {.parent = traf,
+         .box = new box::Tfdt({.version = 1, .base_media_decode_time = track.samples[range.begin].decode_time})});
+    auto trun = new box::Trun({.version = run.trun_version,
+                               .flags = run.trun_flags,
+                               .first_sample_flags = run.first_sample_flags,
+                               .entries = run.entries});
+    new BoxInfo({.parent = traf, .box = trun});
+    truns.push_back(trun);
+    traf_data_sizes.push_back(data_size);
+  }
+
+  const auto moof_size = moof.adjustOffsetAndSize(0);
+  std::uint64_t mdat_data_size = 0;
+  for (const auto size : traf_data_sizes) {
+    mdat_data_size += size;
+  }
+  BoxHeader mdat({.type = BoxType("mdat")});
+  mdat.setOffsetAndDataSize(moof_size, mdat_data_size);
+  // default-base-is-moof なので data_offset は moof の先頭からの traf のサンプルの位置になる
+  std::uint64_t data_offset = moof_size + mdat.getHeaderSize();
+  for (std::size_t i = 0; i < std::size(truns); ++i) {
+    if (data_offset > static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max())) {
+      throw std::runtime_error(
+          fmt::format("FragmentRemuxer::writeFragment(): fragment is too large: index={} size={}", index, data_offset));
+    }
+    truns[i]->setDataOffset(static_cast<std::int32_t>(data_offset));
+    data_offset += traf_data_sizes[i];
+  }
+  write_box(&moof, os);
+
+  std::array<char, Constants::LARGE_HEADER_SIZE> header_data;
+  stream::MemoryOutputStreamBuf header_buf(header_data.data(), std::size(header_data), mdat.getOffset());
+  std::ostream header_os(&header_buf);
+  mdat.write(header_os);
+  os.write(header_data.data(), static_cast<std::streamsize>(mdat.getHeaderSize()));
+
+  // 元のファイルで連続しているサンプルはまとめてコピーする
+  for (std::size_t t = 0; t < std::size(m_tracks); ++t) {
+    const auto& samples = m_tracks[t].samples;
+    const auto& range = ranges[t];
+    std::size_t i = range.begin;
+    while (i < range.end) {
+      const auto offset = samples[i].offset;
+      std::uint64_t size = 0;
+      for (; i < range.end && samples[i].offset == offset + size; ++i) {
+        size += samples[i].size;
+      }
+      copy_range(m_is, os, offset, size, &m_copy_buffer);
+    }
+  }
+  if (!os.good()) {
+    throw std::runtime_error(
+        fmt::format("FragmentRemuxer::writeFragment(): ostream::write() failed: rdstate={}", os.rdstate()));
+  }
+}
+
+void FragmentRemuxer::write(std::ostream& os) {
+  writeInitSegment(os);
+  for (std::size_t i = 0; i < std::size(m_fragments); ++i) {
+    writeFragment(os, i);
+  }
+}
+
+const std::vector<reader::IndexedTrack>& FragmentRemuxer::getTracks() const {
+  return m_tracks;
+}
+
+void FragmentRemuxer::makeFragments(const std::uint32_t fragment_duration_ms) {
+  auto reference = std::find_if(std::begin(m_tracks), std::end(m_tracks),
+                                [](const auto& track) { return track.handler_type == "vide"; });
+  if (reference == std::end(m_tracks)) {
+    reference = std::begin(m_tracks);
+  }
+  const std::uint64_t timescale = reference->timescale;
+  const std::uint64_t fragment_duration = fragment_duration_ms * timescale / 1000;
+
+  // 参照トラックの timescale での fragment の開始時刻
+  std::vector<std::uint64_t> boundaries = {0};
+  for (const auto& sample : reference->samples) {
+    if (sample.is_key && sample.decode_time >= boundaries.back() + fragment_duration &&
+        sample.decode_time > boundaries.back()) {
+      boundaries.push_back(sample.decode_time);
+    }
+  }
+
+  m_fragments.assign(std::size(boundaries), std::vector<SampleRange>(std::size(m_tracks), SampleRange{0, 0}));
+  for (std::size_t t = 0; t < std::size(m_tracks); ++t) {
+    const auto& track = m_tracks[t];
+    std::size_t fragment = 0;
+    m_fragments[0][t].begin = 0;
+    for (std::size_t i = 0; i < std::size(track.samples); ++i) {
+      const auto time = track.timescale == 0 ? 0 : track.samples[i].decode_time * timescale / track.timescale;
+      while (fragment + 1 < std::size(boundaries) && time >= boundaries[fragment + 1]) {
+        m_fragments[fragment][t].end = i;
+        ++fragment;
+        m_fragments[fragment][t].begin = i;
+      }
+    }
+    m_fragments[fragment][t].end = std::size(track.samples);
+    for (++fragment; fragment < std::size(boundaries); ++fragment) {
+      m_fragments[fragment][t] = {std::size(track.samples), std::size(track.samples)};
+    }
+  }
+}
+
+void FragmentRemuxer::makeInitMoov() {
+  std::vector<BoxInfo*> traks;
+  std::uint64_t duration = 0;
+  for (const auto leaf : std::vector<BoxInfo*>(m_moov->getLeafs())) {
+    if (leaf->getType() == BoxType("trak")) {
+      traks.push_back(leaf);
+    } else if (leaf->getType() == BoxType("mvex")) {
+      m_moov->removeLeaf(leaf);
+    } else if (leaf->getType() == BoxType("mvhd")) {
+      duration = dynamic_cast<box::Mvhd*>(leaf->getBox())->getDuration();
+    }
+  }
+
+  // トラック全体で最も多い値を trex に置き, 多くの fragment で tfhd と trun の値を省略できるようにする
+  for (const auto& track : m_tracks) {
+    m_trex_defaults.push_back(make_trex_defaults(make_fragment_samples(track.samples, 0, std::size(track.samples))));
+  }
+
+  auto mvex = new BoxInfo({.parent = m_moov, .box = new box::Mvex()});
+  new BoxInfo({.parent = mvex,
+               .box = new box::Mehd({.version = static_cast<std::uint8_t>(
+                                         duration > std::numeric_limits<std::uint32_t>::max() ? 1 : 0),
+                                     .fragment_duration = duration})});
+  for (std::size_t t = 0; t < std::size(traks); ++t) {
+    auto stbl = find_leaf(find_leaf(find_leaf(traks[t], BoxType("mdia")), BoxType("minf")), BoxType("stbl"));
+    // fragmented MP4 の初期化セグメントでは stbl のサンプルのテーブルを空にする
+    if (stbl != nullptr) {
+      remove_sample_tables(stbl);
+      new BoxInfo({.parent = stbl, .box = new box::Stts({.entries = {}})});
+      new BoxInfo({.parent = stbl, .box = new box::Stsc({.entries = {}})});
+      new BoxInfo({.parent = stbl, .box = new box::Stsz({.entry_sizes = {}})});
+      new BoxInfo({.parent = stbl, .box = new box::Stco({.chunk_offsets = {}})});
+    }
+    const auto& defaults = m_trex_defaults[t];
+    new BoxInfo({.parent = mvex,
+                 .box = new box::Trex({.track_id = m_tracks[t].track_id,
+                                       .default_sample_description_index = 1,
+                                       .default_sample_duration = defaults.duration,
+                                       .default_sample_size = defaults.size,
+                                       .default_sample_flags = defaults.flags})});
+  }
+}
+
+}  // namespace shiguredo::mp4::writer
@@ -0,0 +1,97 @@
+#include "shiguredo/mp4/writer/fragment_run.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "shiguredo/mp4/box/tfhd.hpp"
+#include "shiguredo/mp4/box/trun.hpp"
+
+namespace shiguredo::mp4::writer {
+
+namespace {
+
+template <class F>
+bool all_equal(const std::span<const FragmentSample> samples, F get) {
+  return std::all_of(std::begin(samples), std::end(samples),
+                     [&samples, &get](const auto& sample) { return get(sample) == get(samples.front()); });
+}
+
+template <class F>
+std::uint32_t most_frequent(const std::span<const FragmentSample> samples, F get) {
+  std::map<std::uint32_t, std::size_t> counts;
+  for (const auto& sample : samples) {
+    ++counts[get(sample)];
+  }
+  auto found = std::max_element(std::begin(counts), std::end(counts),
+                                [](const auto& a, const auto& b) { return a.second < b.second; });
+  return found == std::end(counts) ? 0 : found->first;
+}
+
+}  // namespace
+
+FragmentRun make_fragment_run(const std::span<const FragmentSample> samples,
+                              const FragmentSampleDefaults& trex_defaults) {
+  if (std::empty(samples)) {
+    throw std::invalid_argument("make_fragment_run(): samples is empty");
+  }
+  FragmentRun run{.trun_flags = box::TrunDataOffsetPresent};
+  const auto& first = samples.front();
+
+  if (!all_equal(samples, [](const auto& s) { return s.duration; })) {
+    run.trun_flags |= box::TrunSampleDurationPresent;
+  } else if (first.duration != trex_defaults.duration) {
+    run.tfhd_flags |= box::TfhdDefaultSampleDurationPresent;
+    run.tfhd_defaults.duration = first.duration;
+  }
+
+  if (!all_equal(samples, [](const auto& s) { return s.size; })) {
+    run.trun_flags |= box::TrunSampleSizePresent;
+  } else if (first.size != trex_defaults.size) {
+    run.tfhd_flags |= box::TfhdDefaultSampleSizePresent;
+    run.tfhd_defaults.size = first.size;
+  }
+
+  // 先頭がキーフレームで残りが non-sync サンプルの映像の run では, 先頭のみを first_sample_flags にする
+  const auto rest = std::size(samples) > 1 ? samples.subspan(1) : samples;
+  if (!all_equal(rest, [](const auto& s) { return s.flags; })) {
+    run.trun_flags |= box::TrunSampleFlagsPresent;
+  } else {
+    const auto rest_flags = rest.front().flags;
+    if (rest_flags != trex_defaults.flags) {
+      run.tfhd_flags |= box::TfhdDefaultSampleFlagsPresent;
+      run.tfhd_defaults.flags = rest_flags;
+    }
+    if (first.flags != rest_flags) {
+      run.trun_flags |= box::TrunFirstSampleFlagsPresent;
+      run.first_sample_flags = first.flags;
+    }
+  }
+
+  bool has_negative_offset = false;
+  run.entries.reserve(std::size(samples));
+  for (const auto& sample : samples) {
+    if (sample.composition_time_offset != 0) {
+      run.trun_flags |= box::TrunSampleCompositionTimeOffsetPresent;
+    }
+    has_negative_offset = has_negative_offset || sample.composition_time_offset < 0;
+    run.entries.emplace_back(box::TrunEntryParameters{.sample_duration = sample.duration,
+                                                      .sample_size = sample.size,
+                                                      .sample_flags = sample.flags,
+                                                      .sample_composition_time_offset = sample.composition_time_offset});
+  }
+  run.trun_version = has_negative_offset ? 1 : 0;
+  return run;
+}
+
+FragmentSampleDefaults make_trex_defaults(const std::span<const FragmentSample> samples) {
+  return {.duration = most_frequent(samples, [](const auto& s) { return s.duration; }),
+          .size = most_frequent(samples, [](const auto& s) { return s.size; }),
+          .flags = most_frequent(samples, [](const auto& s) { return s.flags; })};
+}
+
+}  // namespace shiguredo::mp4::writer
@@ -0,0 +1,546 @@
+#include "shiguredo/mp4/writer/fragmented_writer.hpp"
+
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/stream/stream.hpp"
+#include "shiguredo/mp4/time/time.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/faststart_writer.hpp"
+#include "shiguredo/mp4/writer/fragment_run.hpp"
+
+namespace shiguredo::mp4::writer {
+
+namespace {
+
+// trex の default_sample_flags. 映像は non-sync サンプル, 音声は全て同期サンプルとし, trun で省略できるようにする
+// duration と size は moov を書き込む時点では分からないので tfhd に置く
+FragmentSampleDefaults get_trex_defaults(const bool is_video) {
+  return {.flags = is_video ? NonKeySampleFlags : KeySampleFlags};
+}
+
+// offset を base だけ移動して dst に追加する
+template <class T>
+void append_entries(std::vector<T>* dst, const std::vector<T>& src, const std::uint64_t base) {
+  for (auto entry : src) {
+    entry.offset += base;
+    dst->push_back(entry);
+  }
+}
+
+// value を表すのに必要なバイト数から 1 を引いた値. tfra の length_size_of_* に使う
+std::uint8_t get_length_size(const std::uint32_t value) {
+  std::uint8_t length_size = 0;
+  while (length_size < 3 && (value >> (8 * (length_size + 1))) != 0) {
+    ++length_size;
+  }
+  return length_size;
+}
+
+std::uint64_t to_milliseconds(const std::uint64_t timestamp, const std::uint64_t timescale) {
+  if (timescale == 0) {
+    return 0;
+  }
+  return timestamp * 1000 / timescale;
+}
+
+}  // namespace
+
+FragmentedWriter::FragmentedWriter(std::ostream& t_os, const FragmentedWriterParameters& params)
+    : m_os(t_os),
+      m_ftyp_params(params.ftyp_params),
+      m_styp_params(params.styp_params),
+      m_chunk_duration_ms(params.chunk_duration_ms),
+      m_segment_duration_ms(params.segment_duration_ms),
+      m_sidx_mode(params.sidx_mode),
+      m_write_mfra(params.write_mfra) {
+  m_mvhd_timescale = params.mvhd_timescale;
+  m_duration = 0;
+  m_ftyp_size = 0;
+  std::chrono::system_clock::time_point p = std::chrono::system_clock::now();
+  m_time_from_epoch = time::convert_to_epoch_19040101(
+      static_cast<std::uint64_t>(duration_cast<std::chrono::seconds>(p.time_since_epoch()).count()));
+
+  m_moov_box_info = new BoxInfo({.box = new box::Moov()});
+  m_mvhd_box = new box::Mvhd({.creation_time = m_time_from_epoch,
+                              .modification_time = m_time_from_epoch,
+                              .timescale = m_mvhd_timescale,
+                              .duration = 0,
+                              .next_track_id = m_next_track_id});
+  new BoxInfo({.parent = m_moov_box_info, .box = m_mvhd_box});
+
+  if (m_sidx_mode != SidxMode::Single) {
+    return;
+  }
+  char* segment_filename = ::strdup(params.segment_path_template.c_str());
+  int fd = ::mkstemp(segment_filename);
+  if (fd == -1) {
+    std::free(segment_filename);
+    throw std::runtime_error("FragmentedWriter::FragmentedWriter(): cannot open an intermediate file: mkstemp()");
+  }
+  m_segment_path = segment_filename;
+  std::free(segment_filename);
+  spdlog::debug("FragmentedWriter::FragmentedWriter(): m_segment_path: {}", m_segment_path.string());
+  m_segment_fd = ::fdopen(fd, "w+");
+  if (m_segment_fd == nullptr) {
+    ::close(fd);
+    std::filesystem::remove(m_segment_path);
+    throw std::runtime_error(fmt::format(
+        "FragmentedWriter::FragmentedWriter(): cannot open an intermediate file: fdopen(), m_segment_path={}",
+        m_segment_path.string()));
+  }
+}
+
+FragmentedWriter::~FragmentedWriter() {
+  if (m_segment_fd == nullptr) {
+    return;
+  }
+  std::fclose(m_segment_fd);
+  std::error_code ec;
+  if (!std::filesystem::remove(m_segment_path, ec)) {
+    spdlog::warn("FragmentedWriter::~FragmentedWriter(): cannot remove the intermediate file: {}",
+                 m_segment_path.string());
+  }
+}
+
+void FragmentedWriter::writeFtypBox() {
+  BoxInfo ftyp({.box = new box::Ftyp(m_ftyp_params)});
+  std::vector<char> buffer;
+  appendBox(&ftyp, &buffer);
+  m_ftyp_size = ftyp.getSize();
+  writeBuffer(buffer);
+}
+
+void FragmentedWriter::writeMoovBox() {
+  m_mvhd_box->setNextTrackID(m_next_track_id);
+  std::vector<char> buffer;
+  appendBox(m_moov_box_info, &buffer);
+  writeBuffer(buffer);
+  m_moov_written = true;
+
+  if (!std::empty(m_pending_output)) {
+    writeBuffer(m_pending_output, m_pending_entries);
+    m_pending_output.clear();
+    m_pending_output.shrink_to_fit();
+    m_pending_entries.clear();
+  }
+}
+
+void FragmentedWriter::addMdatData(const std::uint8_t*, const std::size_t) {
+  throw std::logic_error("FragmentedWriter::addMdatData(): use Track::addData() instead");
+}
+
+void FragmentedWriter::addTrackSamples(const track::Track& track, const std::span<const track::Sample> samples) {
+  auto state = getTrackState(track);
+  const auto chunk_duration = static_cast<std::uint64_t>(m_chunk_duration_ms) * state->timescale / 1000;
+  for (const auto& sample : samples) {
+    // Track::addMdatSamples() と同様に is_key は映像でのみ使い, 映像以外のサンプルは全て同期サンプルとする
+    const PendingSample pending{.timestamp = sample.timestamp,
+                                .size = static_cast<std::uint32_t>(sample.size),
+                                .is_key = !state->is_video || sample.is_key};
+    if (!std::empty(state->samples)) {
+      const auto chunk_start = state->samples.front().timestamp;
+      // 新しいセグメントを始めるサンプルは chunk の先頭にする
+      if (sample.timestamp >= chunk_start + chunk_duration || (m_segment_count > 0 && startsSegment(*state, pending))) {
+        writeChunk(state, sample.timestamp);
+      }
+    }
+    state->samples.push_back(pending);
+    state->data.insert(std::end(state->data), sample.data, sample.data + sample.size);
+  }
+}
+
+std::uint64_t FragmentedWriter::tellCurrentMdatOffset() {
+  return m_written_size + std::size(m_pending_output) + std::size(m_segment_output) + m_segment_file_size;
+}
+
+bool FragmentedWriter::usesSampleTables() const {
+  return false;
+}
+
+void FragmentedWriter::appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>& tracks) {
+  for (auto t : tracks) {
+    t->appendTrakBoxInfo(getMoovBoxInfo());
+  }
+  auto mvex = new BoxInfo({.parent = m_moov_box_info, .box = new box::Mvex()});
+  for (auto t : tracks) {
+    const auto defaults = get_trex_defaults(getTrackState(*t)->is_video);
+    new BoxInfo({.parent = mvex,
+                 .box = new box::Trex({.track_id = t->getTrackID(),
+                                       .default_sample_description_index = 1,
+                                       .default_sample_duration = defaults.duration,
+                                       .default_sample_size = defaults.size,
+                                       .default_sample_flags = defaults.flags})});
+  }
+  appendUdtaBoxInfo();
+  setOffsetAndSize();
+}
+
+void FragmentedWriter::flush() {
+  for (auto& state : m_track_states) {
+    if (std::empty(state.samples)) {
+      continue;
+    }
+    writeChunk(&state, state.samples.back().timestamp + state.last_duration);
+  }
+  if (m_sidx_mode != SidxMode::None) {
+    writeSegmentWithSidx();
+  }
+  if (m_write_mfra) {
+    writeMfra();
+  }
+}
+
+std::uint32_t FragmentedWriter::getSequenceNumber() const {
+  return m_sequence_number;
+}
+
+std::uint64_t FragmentedWriter::getSegmentCount() const {
+  return m_segment_count;
+}
+
+std::filesystem::path FragmentedWriter::getIntermediateFilePath() const {
+  return m_segment_path;
+}
+
+FragmentedWriter::TrackState* FragmentedWriter::getTrackState(const track::Track& track) {
+  const auto track_id = track.getTrackID();
+  auto it = std::find_if(std::begin(m_track_states), std::end(m_track_states),
+                         [track_id](const auto& state) { return state.track_id == track_id; });
+  if (it != std::end(m_track_states)) {
+    return &(*it);
+  }
+  const bool is_video = track.getHandlerType() == track::HandlerType::vide;
+  if (m_reference_track_id == 0 || (is_video && !m_has_video)) {
+    m_reference_track_id = track_id;
+  }
+  m_has_video = m_has_video || is_video;
+  m_track_states.push_back({.track_id = track_id, .timescale = track.getTimescale(), .is_video = is_video});
+  return &m_track_states.back();
+}
+
+bool FragmentedWriter::startsSegment(const TrackState& state, const PendingSample& sample) const {
+  if (m_segment_count == 0) {
+    return true;
+  }
+  // 映像のトラックがある場合は, 映像のキーフレームからセグメントを始める
+  if (m_has_video && !(state.is_video && sample.is_key)) {
+    return false;
+  }
+  return to_milliseconds(sample.timestamp, state.timescale) >= m_segment_start_ms + m_segment_duration_ms;
+}
+
+void FragmentedWriter::writeChunk(TrackState* state, const std::uint64_t end_timestamp) {
+  std::vector<char> buffer;
+  const auto& first = state->samples.front();
+  if (startsSegment(*state, first)) {
+    if (m_sidx_mode == SidxMode::Segment) {
+      writeSegmentWithSidx();
+    }
+    BoxInfo styp({.box = new box::Styp(m_styp_params)});
+    appendBox(&styp, &buffer);
+    ++m_segment_count;
+    m_segment_start_ms = to_milliseconds(first.timestamp, state->timescale);
+    if (m_sidx_mode == SidxMode::Segment) {
+      m_sidx_position = std::size(buffer);
+    } else if (m_sidx_mode == SidxMode::Single) {
+      m_index_ranges.push_back({.size = std::size(buffer)});
+    }
+  }
+
+  std::vector<FragmentSample> samples;
+  samples.reserve(std::size(state->samples));
+  for (std::size_t i = 0; i < std::size(state->samples); ++i) {
+    const auto& sample = state->samples[i];
+    const auto next_timestamp = i + 1 < std::size(state->samples) ? state->samples[i + 1].timestamp : end_timestamp;
+    const auto duration = static_cast<std::uint32_t>(next_timestamp - sample.timestamp);
+    samples.push_back(
+        {.duration = duration, .size = sample.size, .flags = sample.is_key ? KeySampleFlags : NonKeySampleFlags});
+    state->last_duration = duration;
+  }
+  const auto run = make_fragment_run(samples, get_trex_defaults(state->is_video));
+
+  const auto chunk_offset = std::size(buffer);
+  BoxInfo moof({.box = new box::Moof()});
+  new BoxInfo({.parent = &moof, .box = new box::Mfhd({.sequence_number = ++m_sequence_number})});
+  auto traf = new BoxInfo({.parent = &moof, .box = new box::Traf()});
+  new BoxInfo({.parent = traf,
+               .box = new box::Tfhd({.flags = box::TfhdDefaultBaseIsMoof | run.tfhd_flags,
+                                     .track_id = state->track_id,
+                                     .default_sample_duration = run.tfhd_defaults.duration,
+                                     .default_sample_size = run.tfhd_defaults.size,
+                                     .default_sample_flags = run.tfhd_defaults.flags})});
+  new BoxInfo({.parent = traf, .box = new box::Tfdt({.version = 1, .base_media_decode_time = first.timestamp})});
+  auto trun = new box::Trun({.version = run.trun_version,
+                             .flags = run.trun_flags,
+                             .first_sample_flags = run.first_sample_flags,
+                             .entries = run.entries});
+  new BoxInfo({.parent = traf, .box = trun});
+
+  const auto moof_offset = tellCurrentMdatOffset() + std::size(buffer);
+  const auto moof_size = moof.adjustOffsetAndSize(moof_offset);
+  BoxHeader mdat({.type = BoxType("mdat")});
+  mdat.setOffsetAndDataSize(moof_offset + moof_size, std::size(state->data));
+  // default-base-is-moof なので data_offset は moof の先頭からの mdat の payload の位置になる
+  trun->setDataOffset(static_cast<std::int32_t>(moof_size + mdat.getHeaderSize()));
+  appendBox(&moof, &buffer);
+
+  std::array<char, Constants::LARGE_HEADER_SIZE> header_data;
+  stream::MemoryOutputStreamBuf header_buf(header_data.data(), std::size(header_data), mdat.getOffset());
+  std::ostream header_os(&header_buf);
+  mdat.write(header_os);
+  buffer.insert(std::end(buffer), header_data.data(), header_data.data() + mdat.getHeaderSize());
+  buffer.insert(std::end(buffer), std::begin(state->data), std::end(state->data));
+
+  std::vector<RandomAccessEntry> random_access_entries;
+  if (m_write_mfra) {
+    auto key = std::find_if(std::begin(state->samples), std::end(state->samples),
+                            [](const auto& sample) { return sample.is_key; });
+    if (key != std::end(state->samples)) {
+      random_access_entries.push_back(
+          {.track_id = state->track_id,
+           .time = key->timestamp,
+           .offset = chunk_offset,
+           .sample_number = static_cast<std::uint32_t>(std::distance(std::begin(state->samples), key) + 1)});
+    }
+  }
+  if (m_sidx_mode != SidxMode::None) {
+    addIndexRange(*state, std::size(buffer) - chunk_offset, end_timestamp);
+  }
+  state->samples.clear();
+  state->data.clear();
+  if (m_sidx_mode == SidxMode::None) {
+    output(buffer, random_access_entries);
+  } else if (m_segment_fd != nullptr) {
+    if (const auto ret = std::fwrite(buffer.data(), 1, std::size(buffer), m_segment_fd); ret != std::size(buffer)) {
+      throw std::runtime_error(fmt::format(
+          "FragmentedWriter::writeChunk(): cannot write to the intermediate file: size={} ret={} m_segment_path={}",
+          std::size(buffer), ret, m_segment_path.string()));
+    }
+    append_entries(&m_segment_entries, random_access_entries, m_segment_file_size);
+    m_segment_file_size += std::size(buffer);
+  } else {
+    append_entries(&m_segment_entries, random_access_entries, std::size(m_segment_output));
+    m_segment_output.insert(std::end(m_segment_output), std::begin(buffer), std::end(buffer));
+  }
+}
+
+void FragmentedWriter::addIndexRange(const TrackState& state,
+                                     const std::uint64_t size,
+                                     const std::uint64_t end_timestamp) {
+  const bool is_reference_track = state.track_id == m_reference_track_id;
+  // Segment では参照トラックの moof 毎に参照を分け, 他のトラックの moof は直前の参照に含める
+  if (std::empty(m_index_ranges) || (m_sidx_mode == SidxMode::Segment && is_reference_track)) {
+    m_index_ranges.push_back({});
+  }
+  auto& range = m_index_ranges.back();
+  range.size += size;
+  if (!is_reference_track) {
+    return;
+  }
+  const auto start = state.samples.front().timestamp;
+  if (!range.has_reference_track) {
+    range.has_reference_track = true;
+    range.earliest_presentation_time = start;
+  }
+  if (!range.has_sap) {
+    auto key = std::find_if(std::begin(state.samples), std::end(state.samples),
+                            [](const auto& sample) { return sample.is_key; });
+    if (key != std::end(state.samples)) {
+      range.has_sap = true;
+      range.sap_delta_time = range.duration + key->timestamp - start;
+    }
+  }
+  range.duration += end_timestamp - start;
+}
+
+void FragmentedWriter::writeSegmentWithSidx() {
+  if (std::empty(m_index_ranges)) {
+    return;
+  }
+  std::uint64_t timescale = 0;
+  for (const auto& state : m_track_states) {
+    if (state.track_id == m_reference_track_id) {
+      timescale = state.timescale;
+    }
+  }
+  std::uint64_t earliest_presentation_time = 0;
+  auto first = std::find_if(std::begin(m_index_ranges), std::end(m_index_ranges),
+                            [](const auto& range) { return range.has_reference_track; });
+  if (first != std::end(m_index_ranges)) {
+    earliest_presentation_time = first->earliest_presentation_time;
+  }
+  if (std::size(m_index_ranges) > std::numeric_limits<std::uint16_t>::max()) {
+    throw std::runtime_error(
+        fmt::format("FragmentedWriter::writeSegmentWithSidx(): too many references: {}", std::size(m_index_ranges)));
+  }
+
+  std::vector<box::SidxReference> references;
+  references.reserve(std::size(m_index_ranges));
+  for (const auto& range : m_index_ranges) {
+    // referenced_size は 31 bit, SAP_delta_time は 28 bit
+    if (range.size >= (1UL << 31) || range.duration > std::numeric_limits<std::uint32_t>::max() ||
+        range.sap_delta_time >= (1UL << 28)) {
+      throw std::runtime_error(fmt::format(
+          "FragmentedWriter::writeSegmentWithSidx(): reference out of range: size={} duration={} sap_delta_time={}",
+          range.size, range.duration, range.sap_delta_time));
+    }
+    references.emplace_back(
+        box::SidxReferenceParameters{.reference_type = false,
+                                     .reference_size = static_cast<std::uint32_t>(range.size),
+                                     .subsegument_duration = static_cast<std::uint32_t>(range.duration),
+                                     .starts_with_sap = range.has_sap && range.sap_delta_time == 0,
+                                     .sap_type = static_cast<std::uint8_t>(range.has_sap ? 1 : 0),
+                                     .sap_delta_time = static_cast<std::uint32_t>(range.sap_delta_time)});
+  }
+
+  std::vector<char> buffer(std::begin(m_segment_output),
+                           std::begin(m_segment_output) + static_cast<std::ptrdiff_t>(m_sidx_position));
+  // 参照する範囲は sidx の直後から始まるので first_offset は 0 になる
+  BoxInfo sidx({.box = new box::Sidx({.version = static_cast<std::uint8_t>(
+                                          earliest_presentation_time > std::numeric_limits<std::uint32_t>::max()),
+                                      .reference_id = m_reference_track_id,
+                                      .timescale = static_cast<std::uint32_t>(timescale),
+                                      .earliest_presentation_time = earliest_presentation_time,
+                                      .first_offset = 0,
+                                      .references = references})});
+  sidx.adjustOffsetAndSize(m_written_size + std::size(m_pending_output) + std::size(buffer));
+  std::vector<char> sidx_data;
+  sidx.serialize(&sidx_data);
+  buffer.insert(std::end(buffer), std::begin(sidx_data), std::end(sidx_data));
+  buffer.insert(std::end(buffer), std::begin(m_segment_output) + static_cast<std::ptrdiff_t>(m_sidx_position),
+                std::end(m_segment_output));
+
+  std::vector<RandomAccessEntry> segment_entries;
+  segment_entries.swap(m_segment_entries);
+  m_segment_output.clear();
+  m_sidx_position = 0;
+  m_index_ranges.clear();
+  if (m_segment_fd != nullptr) {
+    // SidxMode::Single では sidx の後に中間ファイルの moof と mdat を書き戻す
+    output(buffer);
+    copySegmentFile(segment_entries);
+    return;
+  }
+
+  // moof は全て sidx の後にあるので, sidx のサイズだけ後ろに移動する
+  std::vector<RandomAccessEntry> entries;
+  append_entries(&entries, segment_entries, std::size(sidx_data));
+  output(buffer, entries);
+}
+
+void FragmentedWriter::copySegmentFile(const std::vector<RandomAccessEntry>& entries) {
+  if (std::fflush(m_segment_fd) != 0 || std::fseek(m_segment_fd, 0, SEEK_SET) != 0) {
+    throw std::runtime_error(fmt::format("FragmentedWriter::copySegmentFile(): cannot seek the intermediate file: {}",
+                                         m_segment_path.string()));
+  }
+  std::vector<char> buffer;
+  std::uint64_t remaining = m_segment_file_size;
+  bool first = true;
+  while (remaining > 0) {
+    buffer.resize(static_cast<std::size_t>(std::min<std::uint64_t>(remaining, COPY_MDAT_DATA_BUFFER_SIZE)));
+    if (const auto ret = std::fread(buffer.data(), 1, std::size(buffer), m_segment_fd); ret != std::size(buffer)) {
+      throw std::runtime_error(fmt::format(
+          "FragmentedWriter::copySegmentFile(): cannot read the intermediate file: size={} ret={} m_segment_path={}",
+          std::size(buffer), ret, m_segment_path.string()));
+    }
+    // entries の位置は中間ファイルの先頭からなので, 最初のブロックと一緒に渡す
+    output(buffer, first ? entries : std::vector<RandomAccessEntry>{});
+    first = false;
+    remaining -= std::size(buffer);
+  }
+  // flush() の後にサンプルを追加した場合に備えて中間ファイルを先頭から使い直す
+  if (std::fseek(m_segment_fd, 0, SEEK_SET) != 0) {
+    throw std::runtime_error(fmt::format("FragmentedWriter::copySegmentFile(): cannot seek the intermediate file: {}",
+                                         m_segment_path.string()));
+  }
+  m_segment_file_size = 0;
+}
+
+void FragmentedWriter::writeMfra() {
+  BoxInfo mfra({.box = new box::Mfra()});
+  for (const auto& state : m_track_states) {
+    std::vector<box::TfraEntry> entries;
+    std::uint32_t max_sample_number = 0;
+    for (const auto& entry : m_random_access_entries) {
+      if (entry.track_id != state.track_id) {
+        continue;
+      }
+      entries.emplace_back(box::TfraEntryParameters{.time = entry.time,
+                                                    .moof_offset = entry.offset,
+                                                    .traf_number = 1,
+                                                    .trun_number = 1,
+                                                    .sample_number = entry.sample_number});
+      max_sample_number = std::max(max_sample_number, entry.sample_number);
+    }
+    new BoxInfo({.parent = &mfra,
+                 .box = new box::Tfra({.version = 1,
+                                       .track_id = state.track_id,
+                                       .length_size_of_traf_num = 0,
+                                       .length_size_of_trun_num = 0,
+                                       .length_size_of_sample_num = get_length_size(max_sample_number),
+                                       .entries = entries})});
+  }
+  // mfro は mfra の最後の 16 byte で, mfro を含む mfra のサイズを持つ
+  const auto mfra_size = mfra.adjustOffsetAndSize(0) + 16;
+  new BoxInfo({.parent = &mfra, .box = new box::Mfro({.size = static_cast<std::uint32_t>(mfra_size)})});
+
+  std::vector<char> buffer;
+  appendBox(&mfra, &buffer);
+  output(buffer);
+}
+
+void FragmentedWriter::appendBox(BoxInfo* info, std::vector<char>* buffer) {
+  info->adjustOffsetAndSize(tellCurrentMdatOffset() + std::size(*buffer));
+  std::vector<char> data;
+  info->serialize(&data);
+  buffer->insert(std::end(*buffer), std::begin(data), std::end(data));
+}
+
+void FragmentedWriter::output(const std::vector<char>& buffer, const std::vector<RandomAccessEntry>& entries) {
+  if (!m_moov_written) {
+    append_entries(&m_pending_entries, entries, std::size(m_pending_output));
+    m_pending_output.insert(std::end(m_pending_output), std::begin(buffer), std::end(buffer));
+    return;
+  }
+  writeBuffer(buffer, entries);
+}
+
+void FragmentedWriter::writeBuffer(const std::vector<char>& buffer, const std::vector<RandomAccessEntry>& entries) {
+  append_entries(&m_random_access_entries, entries, m_written_size);
+  m_os.write(buffer.data(), static_cast<std::streamsize>(std::size(buffer)));
+  // chunk を受け取った側がすぐに送出できるように flush する
+  m_os.flush();
+  if (!m_os.good()) {
+    throw std::runtime_error(
+        fmt::format("FragmentedWriter::writeBuffer(): ostream::write() failed: rdstate={}", m_os.rdstate()));
+  }
+  m_written_size += std::size(buffer);
+}
+
+void FragmentedWriter::setOffsetAndSize() {
+  m_moov_box_info->adjustOffsetAndSize(m_ftyp_size);
+}
+
+}  // namespace shiguredo::mp4::writer
@@ -0,0 +1,393 @@
+#include "shiguredo/mp4/writer/progressive_remuxer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/reader/box_filter.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/stream/stream.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/remux.hpp"
+
+namespace shiguredo::mp4::writer {
+
+ProgressiveRemuxer::ProgressiveRemuxer(std::istream& t_is, const ProgressiveRemuxerParameters& params)
+    : m_is(t_is),
+      m_ftyp(std::make_unique<BoxInfo>(BoxInfoParameters{.box = new box::Ftyp(params.ftyp_params)})),
+      m_copy_buffer(std::max<std::size_t>(params.copy_buffer_size, 1)) {
+  const auto trex_defaults = readMoov();
+  readMoofs(trex_defaults);
+  makeMoov();
+}
+
+ProgressiveRemuxer::~ProgressiveRemuxer() = default;
+
+void ProgressiveRemuxer::write(std::ostream& os) {
+  write_box(m_ftyp.get(), os);
+  write_box(m_moov, os);
+
+  BoxHeader mdat({.offset = m_mdat_offset,
+                  .size = m_mdat_data_size + m_mdat_header_size,
+                  .header_size = m_mdat_header_size,
+                  .type = BoxType("mdat")});
+  std::array<char, Constants::LARGE_HEADER_SIZE> header_data;
+  stream::MemoryOutputStreamBuf header_buf(header_data.data(), std::size(header_data), m_mdat_offset);
+  std::ostream header_os(&header_buf);
+  mdat.write(header_os);
+  os.write(header_data.data(), static_cast<std::streamsize>(m_mdat_header_size));
+
+  // 元のファイルで連続している chunk はまとめてコピーする
+  std::size_t i = 0;
+  while (i < std::size(m_chunks)) {
+    const auto offset = m_tracks[m_chunks[i].track_index].samples[m_chunks[i].begin].offset;
+    std::uint64_t size = 0;
+    for (; i < std::size(m_chunks); ++i) {
+      const auto& chunk = m_chunks[i];
+      if (m_tracks[chunk.track_index].samples[chunk.begin].offset != offset + size) {
+        break;
+      }
+      size += chunk.size;
+    }
+    copy_range(m_is, os, offset, size, &m_copy_buffer);
+  }
+  if (!os.good()) {
+    throw std::runtime_error(
+        fmt::format("ProgressiveRemuxer::write(): ostream::write() failed: rdstate={}", os.rdstate()));
+  }
+}
+
+std::uint64_t ProgressiveRemuxer::getOutputSize() const {
+  return m_mdat_offset + m_mdat_header_size + m_mdat_data_size;
+}
+
+const std::vector<reader::IndexedTrack>& ProgressiveRemuxer::getTracks() const {
+  return m_tracks;
+}
+
+std::map<std::uint32_t, reader::TrackFragmentDefaults> ProgressiveRemuxer::readMoov() {
+  m_reader = std::make_unique<reader::SimpleReader>(
+      m_is, reader::SimpleReaderParameters{.filter = reader::BoxFilter({.allow_paths = {{BoxType("moov")}}})});
+  m_reader->parse();
+  m_is.clear();
+  for (const auto info : m_reader->getBoxInfos()) {
+    if (info->getType() == BoxType("moov")) {
+      m_moov = info;
+    }
+  }
+  if (m_moov == nullptr) {
+    throw std::runtime_error("ProgressiveRemuxer::ProgressiveRemuxer(): moov not found");
+  }
+
+  std::map<std::uint32_t, reader::TrackFragmentDefaults> trex_defaults;
+  for (const auto leaf : m_moov->getLeafs()) {
+    if (leaf->getType() == BoxType("mvex")) {
+      for (const auto mvex_leaf : leaf->getLeafs()) {
+        if (const auto trex = dynamic_cast<box::Trex*>(mvex_leaf->getBox())) {
+          trex_defaults[trex->getTrackID()] = {.sample_description_index = trex->getDefaultSampleDescriptionIndex(),
+                                               .sample_duration = trex->getDefaultSampleDuration(),
+                                               .sample_size = trex->getDefaultSampleSize(),
+                                               .sample_flags = trex->getDefaultSampleFlags()};
+        }
+      }
+    }
+    if (leaf->getType() != BoxType("trak")) {
+      continue;
+    }
+    const auto tkhd = find_box<box::Tkhd>(leaf, BoxType("tkhd"));
+    const auto mdia = find_leaf(leaf, BoxType("mdia"));
+    const auto mdhd = find_box<box::Mdhd>(mdia, BoxType("mdhd"));
+    const auto stbl = find_leaf(find_leaf(mdia, BoxType("minf")), BoxType("stbl"));
+    if (tkhd == nullptr || mdhd == nullptr || stbl == nullptr) {
+      throw std::runtime_error("ProgressiveRemuxer::ProgressiveRemuxer(): tkhd, mdhd or stbl not found");
+    }
+    reader::IndexedTrack track{.track_id = tkhd->getTrackID(), .timescale = mdhd->getTimescale()};
+    if (const auto hdlr = find_box<box::Hdlr>(mdia, BoxType("hdlr"))) {
+      track.handler_type = hdlr->getHandlerType();
+    }
+    m_tracks.push_back(track);
+    m_traks.push_back(leaf);
+    m_stbls.push_back(stbl);
+  }
+  if (std::empty(m_tracks)) {
+    throw std::runtime_error("ProgressiveRemuxer::ProgressiveRemuxer(): trak not found");
+  }
+  return trex_defaults;
+}
+
+void ProgressiveRemuxer::readMoofs(const std::map<std::uint32_t, reader::TrackFragmentDefaults>& trex_defaults) {
+  std::map<std::uint32_t, std::size_t> track_indexes;
+  for (std::size_t t = 0; t < std::size(m_tracks); ++t) {
+    track_indexes[m_tracks[t].track_id] = t;
+  }
+
+  m_is.seekg(0, std::ios_base::end);
+  const auto file_size = static_cast<std::uint64_t>(m_is.tellg());
+  if (!m_is.good()) {
+    throw std::runtime_error(
+        fmt::format("ProgressiveRemuxer::readMoofs(): istream::tellg() failed: rdstate={}", m_is.rdstate()));
+  }
+
+  // moof のみを読み込み, mdat などは Box のヘッダーのみを読んで読み飛ばす
+  std::map<std::uint32_t, std::uint64_t> next_decode_times;
+  std::vector<std::uint8_t> moof_data;
+  std::uint64_t offset = 0;
+  while (offset < file_size) {
+    m_is.seekg(static_cast<std::streamoff>(offset), std::ios_base::beg);
+    std::unique_ptr<BoxHeader> header(read_box_header(m_is));
+    if (header->getSize() < header->getHeaderSize()) {
+      throw std::runtime_error(fmt::format("ProgressiveRemuxer::readMoofs(): invalid box size: type={} offset={}",
+                                           header->getType().toString(), offset));
+    }
+    if (header->getType() == BoxType("moof")) {
+      moof_data.resize(static_cast<std::size_t>(header->getSize()));
+      m_is.seekg(static_cast<std::streamoff>(offset), std::ios_base::beg);
+      m_is.read(reinterpret_cast<char*>(moof_data.data()), static_cast<std::streamsize>(std::size(moof_data)));
+      if (!m_is.good()) {
+        throw std::runtime_error(fmt::format(
+            "ProgressiveRemuxer::readMoofs(): istream::read() failed: offset={} rdstate={}", offset, m_is.rdstate()));
+      }
+      for (const auto& sample : reader::parse_moof_samples(moof_data, offset, trex_defaults, &next_decode_times)) {
+        const auto index = track_indexes.find(sample.track_id);
+        if (index == std::end(track_indexes)) {
+          throw std::runtime_error(
+              fmt::format("ProgressiveRemuxer::readMoofs(): unknown track_id: {} offset={}", sample.track_id, offset));
+        }
+        const auto t = index->second;
+        auto& track = m_tracks[t];
+        // 同じトラックのサンプルが元のファイルで続いている場合は同じ chunk にする
+        if (!std::empty(m_chunks) && m_chunks.back().track_index == t) {
+          const auto& last = track.samples.back();
+          if (last.offset + last.size == sample.offset &&
+              last.sample_description_index == sample.sample_description_index) {
+            ++m_chunks.back().end;
+            m_chunks.back().size += sample.size;
+          } else {
+            m_chunks.push_back({t, std::size(track.samples), std::size(track.samples) + 1, sample.size});
+          }
+        } else {
+          m_chunks.push_back({t, std::size(track.samples), std::size(track.samples) + 1, sample.size});
+        }
+        track.samples.push_back({.offset = sample.offset,
+                                 .size = sample.size,
+                                 .decode_time = sample.decode_time,
+                                 .composition_time_offset = sample.composition_time_offset,
+                                 .duration = sample.duration,
+                                 .sample_description_index = sample.sample_description_index,
+                                 .is_key = sample.is_key});
+        track.has_composition_time_offset = track.has_composition_time_offset || sample.composition_time_offset != 0;
+        m_mdat_data_size += sample.size;
+      }
+    }
+    offset += header->getSize();
+  }
+  m_is.clear();
+}
+
+void ProgressiveRemuxer::makeMoov() {
+  for (const auto leaf : std::vector<BoxInfo*>(m_moov->getLeafs())) {
+    if (leaf->getType() == BoxType("mvex")) {
+      m_moov->removeLeaf(leaf);
+    }
+  }
+  auto mvhd = find_box<box::Mvhd>(m_moov, BoxType("mvhd"));
+  if (mvhd == nullptr) {
+    throw std::runtime_error("ProgressiveRemuxer::ProgressiveRemuxer(): mvhd not found");
+  }
+  const std::uint64_t mvhd_timescale = mvhd->getTimescale();
+
+  // トラック毎の chunk のサンプル数と sample_description_index
+  std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> track_chunks(std::size(m_tracks));
+  for (const auto& chunk : m_chunks) {
+    const auto& sample = m_tracks[chunk.track_index].samples[chunk.begin];
+    track_chunks[chunk.track_index].emplace_back(static_cast<std::uint32_t>(chunk.end - chunk.begin),
+                                                 sample.sample_description_index);
+  }
+
+  // 最初のサンプルの decode time が最も早いトラックの先頭を movie の先頭にする
+  std::optional<std::uint64_t> movie_start;
+  for (const auto& track : m_tracks) {
+    if (!std::empty(track.samples) && track.timescale != 0) {
+      const auto start = track.samples.front().decode_time * mvhd_timescale / track.timescale;
+      movie_start = std::min(movie_start.value_or(start), start);
+    }
+  }
+
+  std::uint64_t movie_duration = 0;
+  for (std::size_t t = 0; t < std::size(m_tracks); ++t) {
+    const auto& track = m_tracks[t];
+    // 元の stbl のサンプルのテーブルは削除して作り直す
+    auto stbl = m_stbls[t];
+    remove_sample_tables(stbl);
+
+    std::vector<std::uint32_t> durations;
+    std::vector<std::uint32_t> sizes;
+    std::vector<std::uint32_t> key_sample_numbers;
+    durations.reserve(std::size(track.samples));
+    sizes.reserve(std::size(track.samples));
+    std::uint64_t duration = 0;
+    bool has_negative_offset = false;
+    for (std::size_t i = 0; i < std::size(track.samples); ++i) {
+      const auto& sample = track.samples[i];
+      // fragment の間の空きは前のサンプルの duration に含め, 元のファイルの decode time を保つ
+      std::uint64_t sample_duration = sample.duration;
+      if (i + 1 < std::size(track.samples)) {
+        const auto next_decode_time = track.samples[i + 1].decode_time;
+        if (next_decode_time < sample.decode_time + sample.duration) {
+          throw std::runtime_error(fmt::format(
+              "ProgressiveRemuxer::makeMoov(): overlapping samples: track_id={} decode_time={} next_decode_time={}",
+              track.track_id, sample.decode_time, next_decode_time));
+        }
+        sample_duration = next_decode_time - sample.decode_time;
+        if (sample_duration > std::numeric_limits<std::uint32_t>::max()) {
+          throw std::runtime_error(fmt::format(
+              "ProgressiveRemuxer::makeMoov(): too large gap: track_id={} decode_time={} next_decode_time={}",
+              track.track_id, sample.decode_time, next_decode_time));
+        }
+      }
+      durations.push_back(static_cast<std::uint32_t>(sample_duration));
+      sizes.push_back(sample.size);
+      if (sample.is_key) {
+        key_sample_numbers.push_back(static_cast<std::uint32_t>(i + 1));
+      }
+      duration += sample_duration;
+      has_negative_offset = has_negative_offset || sample.composition_time_offset < 0;
+    }
+
+    std::vector<box::SttsEntry> stts_entries;
+    track::make_stts_entries(&stts_entries, durations);
+    new BoxInfo({.parent = stbl, .box = new box::Stts({.entries = stts_entries})});
+    if (track.has_composition_time_offset) {
+      std::vector<box::CttsEntry> ctts_entries;
+      for (const auto& sample : track.samples) {
+        if (!std::empty(ctts_entries) && ctts_entries.back().getSampleOffset() == sample.composition_time_offset) {
+          ctts_entries.back() =
+              box::CttsEntry(ctts_entries.back().getSampleCount() + 1, sample.composition_time_offset);
+        } else {
+          ctts_entries.emplace_back(1, sample.composition_time_offset);
+        }
+      }
+      new BoxInfo({.parent = stbl,
+                   .box = new box::Ctts({.version = static_cast<std::uint8_t>(has_negative_offset ? 1 : 0),
+                                         .entries = ctts_entries})});
+    }
+    std::vector<box::StscEntry> stsc_entries;
+    for (std::size_t c = 0; c < std::size(track_chunks[t]); ++c) {
+      const auto [samples_per_chunk, sample_description_index] = track_chunks[t][c];
+      if (c == 0 || track_chunks[t][c - 1] != track_chunks[t][c]) {
+        stsc_entries.emplace_back(box::StscEntryParameters{.first_chunk = static_cast<std::uint32_t>(c + 1),
+                                                           .samples_per_chunk = samples_per_chunk,
+                                                           .sample_description_index = sample_description_index});
+      }
+    }
+    new BoxInfo({.parent = stbl, .box = new box::Stsc({.entries = stsc_entries})});
+    new BoxInfo({.parent = stbl, .box = new box::Stsz({.entry_sizes = sizes})});
+    // 全てのサンプルが同期サンプルの場合は stss を省略する
+    if (std::size(key_sample_numbers) != std::size(track.samples)) {
+      new BoxInfo({.parent = stbl, .box = new box::Stss({.sample_numbers = key_sample_numbers})});
+    }
+
+    const auto media_duration = track.timescale == 0 ? 0 : duration * mvhd_timescale / track.timescale;
+    std::uint64_t empty_duration = 0;
+    if (!std::empty(track.samples) && track.timescale != 0) {
+      empty_duration = track.samples.front().decode_time * mvhd_timescale / track.timescale - movie_start.value();
+    }
+    const auto tkhd_duration = makeElst(t, mvhd_timescale, empty_duration, media_duration);
+    find_box<box::Tkhd>(m_traks[t], BoxType("tkhd"))->setDuration(tkhd_duration);
+    find_box<box::Mdhd>(find_leaf(m_traks[t], BoxType("mdia")), BoxType("mdhd"))->setDuration(duration);
+    movie_duration = std::max(movie_duration, tkhd_duration);
+  }
+  mvhd->setDuration(movie_duration);
+
+  // moov のサイズは stco から co64 への切り替えでのみ変わるので, 変わらなくなるまで繰り返す
+  const auto ftyp_size = m_ftyp->adjustOffsetAndSize(0);
+  m_mdat_header_size = m_mdat_data_size > std::numeric_limits<std::uint32_t>::max() - Constants::SMALL_HEADER_SIZE
+                           ? Constants::LARGE_HEADER_SIZE
+                           : Constants::SMALL_HEADER_SIZE;
+  std::uint64_t moov_size = 0;
+  std::uint64_t previous_moov_size = 0;
+  do {
+    previous_moov_size = moov_size;
+    setChunkOffsets(ftyp_size + moov_size + m_mdat_header_size);
+    moov_size = m_moov->adjustOffsetAndSize(ftyp_size);
+  } while (moov_size != previous_moov_size);
+  m_mdat_offset = ftyp_size + moov_size;
+}
+
+std::uint64_t ProgressiveRemuxer::makeElst(const std::size_t t,
+                                           const std::uint64_t mvhd_timescale,
+                                           const std::uint64_t empty_duration,
+                                           const std::uint64_t media_duration) {
+  const auto& track = m_tracks[t];
+  auto edts = find_leaf(m_traks[t], BoxType("edts"));
+  // 元の elst の media_time (Opus の pre-skip など) は引き継ぐ
+  std::int64_t media_time = 0;
+  if (const auto elst_info = find_leaf(edts, BoxType("elst"))) {
+    for (const auto& entry : dynamic_cast<box::Elst*>(elst_info->getBox())->getEntries()) {
+      if (entry.m_media_time != -1) {
+        media_time = entry.m_media_time;
+      }
+    }
+    edts->removeLeaf(elst_info);
+  }
+  if (edts == nullptr && empty_duration == 0 && media_time == 0) {
+    return media_duration;
+  }
+  if (edts == nullptr) {
+    edts = new BoxInfo({.parent = m_traks[t], .box = new box::Edts()});
+  }
+
+  const auto skipped_duration =
+      track.timescale == 0 ? 0 : static_cast<std::uint64_t>(media_time) * mvhd_timescale / track.timescale;
+  std::vector<box::ElstEntry> entries;
+  if (empty_duration > 0) {
+    // 最初のサンプルが movie の先頭より後ろにある場合は, その間を空の edit にする
+    entries.push_back(box::ElstEntry({.track_duration = empty_duration, .media_time = -1}));
+  }
+  const auto track_duration = media_duration - std::min(media_duration, skipped_duration);
+  entries.push_back(box::ElstEntry({.track_duration = track_duration, .media_time = media_time}));
+  // version 0 では 32 bit に収まらない
+  const std::uint8_t version =
+      empty_duration + track_duration > std::numeric_limits<std::uint32_t>::max() ? 1 : 0;
+  new BoxInfo({.parent = edts, .box = new box::Elst({.version = version, .entries = entries})});
+  return empty_duration + track_duration;
+}
+
+void ProgressiveRemuxer::setChunkOffsets(const std::uint64_t mdat_data_offset) {
+  std::vector<std::vector<track::ChunkInfo>> chunk_infos(std::size(m_tracks));
+  std::uint64_t offset = mdat_data_offset;
+  for (const auto& chunk : m_chunks) {
+    chunk_infos[chunk.track_index].push_back(
+        {.offset = offset, .number_of_samples = static_cast<std::uint32_t>(chunk.end - chunk.begin)});
+    offset += chunk.size;
+  }
+  for (std::size_t t = 0; t < std::size(m_stbls); ++t) {
+    auto stbl = m_stbls[t];
+    for (const auto leaf : std::vector<BoxInfo*>(stbl->getLeafs())) {
+      if (leaf->getType() == BoxType("stco") || leaf->getType() == BoxType("co64")) {
+        stbl->removeLeaf(leaf);
+      }
+    }
+    new BoxInfo({.parent = stbl, .box = track::make_offset_box(chunk_infos[t])});
+  }
+}
+
+}  // namespace shiguredo::mp4::writer
@@ -0,0 +1,62 @@
+#include "shiguredo/mp4/writer/remux.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+
+namespace shiguredo::mp4::writer {
+
+namespace {
+
+constexpr std::array sample_table_types = {
+    BoxType("stts"), BoxType("ctts"), BoxType("stsc"), BoxType("stsz"), BoxType("stz2"),
+    BoxType("stco"), BoxType("co64"), BoxType("stss"), BoxType("sdtp"), BoxType("sbgp"),
+};
+
+}  // namespace
+
+void remove_sample_tables(BoxInfo* stbl) {
+  for (const auto leaf : std::vector<BoxInfo*>(stbl->getLeafs())) {
+    if (std::find(std::begin(sample_table_types), std::end(sample_table_types), leaf->getType()) !=
+        std::end(sample_table_types)) {
+      stbl->removeLeaf(leaf);
+    }
+  }
+}
+
+void write_box(const BoxInfo* info, std::ostream& os) {
+  std::vector<char> data;
+  info->serialize(&data);
+  os.write(data.data(), static_cast<std::streamsize>(std::size(data)));
+}
+
+void copy_range(std::istream& is,
+                std::ostream& os,
+                const std::uint64_t offset,
+                const std::uint64_t size,
+                std::vector<char>* buffer) {
+  is.seekg(static_cast<std::streamoff>(offset), std::ios_base::beg);
+  std::uint64_t remaining = size;
+  while (remaining > 0) {
+    const auto length = static_cast<std::streamsize>(std::min<std::uint64_t>(remaining, std::size(*buffer)));
+    is.read(buffer->data(), length);
+    if (!is.good()) {
+      throw std::runtime_error(fmt::format("copy_range(): istream::read() failed: offset={} size={} rdstate={}",
+                                           offset, size, is.rdstate()));
+    }
+    os.write(buffer->data(), length);
+    remaining -= static_cast<std::uint64_t>(length);
+  }
+}
+
+}  // namespace shiguredo::mp4::writer
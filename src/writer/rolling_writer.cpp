@@ -0,0 +1,227 @@
+#include "shiguredo/mp4/writer/rolling_writer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "shiguredo/mp4/time/time.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+
+namespace shiguredo::mp4::writer {
+
+RollingWriter::RollingWriter(const RollingWriterParameters& params)
+    : m_segment_duration_ms(params.segment_duration_ms),
+      m_ftyp_params(params.ftyp_params),
+      m_open_segment(params.open_segment),
+      m_on_segment_finished(params.on_segment_finished) {
+  if (!m_open_segment) {
+    throw std::invalid_argument("RollingWriter::RollingWriter(): open_segment is not set");
+  }
+  m_mvhd_timescale = params.mvhd_timescale;
+  m_duration = 0;
+  std::chrono::system_clock::time_point p = std::chrono::system_clock::now();
+  m_time_from_epoch = time::convert_to_epoch_19040101(
+      static_cast<std::uint64_t>(duration_cast<std::chrono::seconds>(p.time_since_epoch()).count()));
+  m_thread = std::thread([this] { run(); });
+}
+
+RollingWriter::~RollingWriter() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+  m_cv.notify_one();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+void RollingWriter::setTracks(const std::vector<track::Track*>& tracks) {
+  m_tracks = tracks;
+  const auto found = std::find_if(std::begin(m_tracks), std::end(m_tracks), [](const auto t) {
+    return t->getHandlerType() == track::HandlerType::vide;
+  });
+  if (found != std::end(m_tracks)) {
+    m_reference_track = *found;
+  } else {
+    m_reference_track = std::empty(m_tracks) ? nullptr : m_tracks.front();
+  }
+}
+
+void RollingWriter::writeFtypBox() {
+  openSegment();
+}
+
+void RollingWriter::openSegment() {
+  m_os = m_open_segment(m_segment_index);
+  if (m_os == nullptr) {
+    throw std::runtime_error(
+        fmt::format("RollingWriter::openSegment(): open_segment returned nullptr: index={}", m_segment_index));
+  }
+  m_writer = std::make_unique<SimpleWriter>(
+      *m_os, SimpleWriterParameters{.mvhd_timescale = m_mvhd_timescale, .duration = 0, .ftyp_params = m_ftyp_params});
+  m_writer->writeFtypBox();
+}
+
+void RollingWriter::writeMoovBox() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+  m_cv.notify_one();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+  rethrowError();
+}
+
+void RollingWriter::addMdatData(const std::uint8_t* data, const std::size_t data_size) {
+  m_writer->addMdatData(data, data_size);
+}
+
+void RollingWriter::addMdatSamples(const std::span<const track::Sample> samples) {
+  m_writer->addMdatSamples(samples);
+}
+
+std::size_t RollingWriter::prepareTrackSamples(track::Track& track, const std::span<const track::Sample> samples) {
+  if (&track != m_reference_track) {
+    return std::size(samples);
+  }
+  if (isSegmentBoundary(track, samples.front())) {
+    const auto timestamp = samples.front().timestamp;
+    const auto timestamp_ms = timestamp * 1000 / track.getTimescale();
+    if (m_segment_start_ms.has_value()) {
+      queueSegment(timestamp);
+      // 全てのトラックで切り替えたキーフレームの時刻を次のセグメントの先頭とし, トラック間の時刻のずれを保つ
+      for (const auto t : m_tracks) {
+        t->resetSamples(timestamp * t->getTimescale() / track.getTimescale());
+      }
+      ++m_segment_index;
+      openSegment();
+    }
+    m_segment_start_ms = timestamp_ms;
+  }
+  // 続くサンプルに切り替えるキーフレームがある場合は, その手前までを現在のセグメントに書き込ませる
+  for (std::size_t i = 1; i < std::size(samples); ++i) {
+    if (isSegmentBoundary(track, samples[i])) {
+      return i;
+    }
+  }
+  return std::size(samples);
+}
+
+bool RollingWriter::isSegmentBoundary(const track::Track& track, const track::Sample& sample) const {
+  if (!sample.is_key) {
+    return false;
+  }
+  if (!m_segment_start_ms.has_value()) {
+    return true;
+  }
+  return sample.timestamp * 1000 / track.getTimescale() >= *m_segment_start_ms + m_segment_duration_ms;
+}
+
+std::uint64_t RollingWriter::tellCurrentMdatOffset() {
+  return m_writer->tellCurrentMdatOffset();
+}
+
+void RollingWriter::appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>& tracks) {
+  m_tracks = tracks;
+  queueSegment(std::nullopt);
+}
+
+std::uint64_t RollingWriter::getSegmentIndex() const {
+  return m_segment_index;
+}
+
+void RollingWriter::setOffsetAndSize() {}
+
+void RollingWriter::queueSegment(const std::optional<std::uint64_t> end_timestamp) {
+  rethrowError();
+  if (!m_writer) {
+    throw std::logic_error("RollingWriter::queueSegment(): writeFtypBox() is not called");
+  }
+  Segment segment{.index = m_segment_index, .os = m_os};
+  for (const auto t : m_tracks) {
+    auto cloned = t->clone();
+    if (t == m_reference_track && end_timestamp.has_value()) {
+      cloned->setEndTimestamp(*end_timestamp);
+    } else {
+      cloned->setEndTimestamp(t->getEndTimestamp());
+    }
+    segment.tracks.push_back(std::move(cloned));
+  }
+  segment.writer = std::move(m_writer);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_segments.push_back(std::move(segment));
+  }
+  m_cv.notify_one();
+}
+
+void RollingWriter::rethrowError() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_error) {
+    std::rethrow_exception(std::exchange(m_error, nullptr));
+  }
+}
+
+void RollingWriter::run() {
+  while (true) {
+    Segment segment;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stopped || !std::empty(m_segments); });
+      if (std::empty(m_segments)) {
+        return;
+      }
+      segment = std::move(m_segments.front());
+      m_segments.pop_front();
+    }
+    try {
+      writeSegment(&segment);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_error) {
+        m_error = std::current_exception();
+      }
+    }
+  }
+}
+
+void RollingWriter::writeSegment(Segment* segment) {
+  std::vector<track::Track*> tracks;
+  std::uint32_t next_track_id = 1;
+  std::uint64_t duration = 0;
+  for (const auto& t : segment->tracks) {
+    tracks.push_back(t.get());
+    next_track_id = std::max(next_track_id, t->getTrackID() + 1);
+    duration = std::max(duration, t->getDurationInMvhdTimescale());
+  }
+  auto writer = segment->writer.get();
+  writer->appendTrakAndUdtaBoxInfo(tracks);
+  writer->setNextTrackID(next_track_id);
+  writer->setMvhdDuration(duration);
+  // moov を最後に書き込み, stream の位置をファイルの末尾にする
+  writer->writeFreeBoxAndMdatHeader();
+  writer->writeMoovBox();
+  segment->os->flush();
+  if (!segment->os->good()) {
+    throw std::runtime_error(fmt::format("RollingWriter::writeSegment(): ostream::write() failed: index={} rdstate={}",
+                                         segment->index, segment->os->rdstate()));
+  }
+  segment->writer.reset();
+  segment->tracks.clear();
+  if (m_on_segment_finished) {
+    m_on_segment_finished(segment->index);
+  }
+}
+
+}  // namespace shiguredo::mp4::writer
@@ -0,0 +1,299 @@
+#include "shiguredo/mp4/writer/sample_journal.hpp"
+
+#include <fmt/core.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "shiguredo/mp4/box/mvhd.hpp"
+#include "shiguredo/mp4/box_header.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/constants.hpp"
+#include "shiguredo/mp4/endian/endian.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+
+namespace shiguredo::mp4::writer {
+
+namespace {
+
+constexpr std::array<std::uint8_t, 4> JournalMagic = {'m', 'p', '4', 'j'};
+const std::uint32_t JournalVersion = 2;
+const std::size_t JournalHeaderSize = 8;
+// track_id (32 bit), timestamp (64 bit), size (32 bit), flags (8 bit)
+const std::size_t JournalRecordSize = 17;
+const std::uint8_t JournalKeySampleFlag = 0x01;
+// Track::getCodecConfig() の記録. timestamp は 0 で, 記録の後ろに size バイトの設定が続く
+const std::uint8_t JournalCodecConfigFlag = 0x80;
+// 復旧時に一度に読み込むサンプルの数
+const std::size_t JournalReadRecordCount = 4096;
+
+template <std::size_t N>
+void append_bytes(std::vector<std::uint8_t>* buffer, const std::array<std::uint8_t, N>& data) {
+  buffer->insert(std::end(*buffer), std::begin(data), std::end(data));
+}
+
+}  // namespace
+
+SampleJournal::SampleJournal(const std::filesystem::path& path, const SampleJournalParameters& params)
+    : m_sync_interval(params.sync_interval) {
+  m_fp = std::fopen(path.c_str(), "wb");
+  if (m_fp == nullptr) {
+    throw std::runtime_error(fmt::format("SampleJournal::SampleJournal(): cannot open the journal: {}", path.string()));
+  }
+  append_bytes(&m_buffer, JournalMagic);
+  append_bytes(&m_buffer, endian::uint32_to_be(JournalVersion));
+  if (std::fwrite(m_buffer.data(), 1, std::size(m_buffer), m_fp) != std::size(m_buffer)) {
+    std::fclose(m_fp);
+    throw std::runtime_error(fmt::format("SampleJournal::SampleJournal(): fwrite() failed: {}", path.string()));
+  }
+  sync();
+}
+
+SampleJournal::~SampleJournal() {
+  std::fclose(m_fp);
+}
+
+void SampleJournal::append(const track::Track& track, const std::span<const track::Sample> samples) {
+  m_buffer.clear();
+  m_buffer.reserve(std::size(samples) * JournalRecordSize);
+  const auto track_id = endian::uint32_to_be(track.getTrackID());
+  // 設定はサンプルのデータを解析して得るので, 変わった場合のみサンプルより前に記録する
+  const auto codec_config = track.getCodecConfig();
+  auto& recorded_codec_config = m_codec_configs[track.getTrackID()];
+  if (codec_config != recorded_codec_config) {
+    append_bytes(&m_buffer, track_id);
+    append_bytes(&m_buffer, endian::uint64_to_be(0));
+    append_bytes(&m_buffer, endian::uint32_to_be(static_cast<std::uint32_t>(std::size(codec_config))));
+    m_buffer.push_back(JournalCodecConfigFlag);
+    m_buffer.insert(std::end(m_buffer), std::begin(codec_config), std::end(codec_config));
+    recorded_codec_config = codec_config;
+  }
+  for (const auto& sample : samples) {
+    append_bytes(&m_buffer, track_id);
+    append_bytes(&m_buffer, endian::uint64_to_be(sample.timestamp));
+    append_bytes(&m_buffer, endian::uint32_to_be(static_cast<std::uint32_t>(sample.size)));
+    m_buffer.push_back(sample.is_key ? JournalKeySampleFlag : 0);
+  }
+  if (std::fwrite(m_buffer.data(), 1, std::size(m_buffer), m_fp) != std::size(m_buffer)) {
+    throw std::runtime_error("SampleJournal::append(): fwrite() failed");
+  }
+  m_unsynced_count += static_cast<std::uint32_t>(std::size(samples));
+  if (m_sync_interval > 0 && m_unsynced_count >= m_sync_interval) {
+    sync();
+  }
+}
+
+void SampleJournal::sync() {
+  if (std::fflush(m_fp) != 0) {
+    throw std::runtime_error("SampleJournal::sync(): fflush() failed");
+  }
+  if (::fsync(::fileno(m_fp)) != 0) {
+    throw std::runtime_error("SampleJournal::sync(): fsync() failed");
+  }
+  m_unsynced_count = 0;
+}
+
+JournalRecoveryWriter::JournalRecoveryWriter(std::iostream& t_file, const JournalRecoveryWriterParameters& params)
+    : SimpleWriter(t_file, {.mvhd_timescale = params.mvhd_timescale, .duration = 0}), m_file(t_file) {
+  m_file.seekg(0, std::ios_base::end);
+  m_file_size = static_cast<std::uint64_t>(m_file.tellg());
+  m_file.seekg(0, std::ios_base::beg);
+  if (!m_file.good()) {
+    throw std::runtime_error(fmt::format(
+        "JournalRecoveryWriter::JournalRecoveryWriter(): istream::seekg() failed: rdstate={}", m_file.rdstate()));
+  }
+  std::unique_ptr<BoxHeader> ftyp(read_box_header(m_file));
+  if (ftyp->getType() != BoxType("ftyp")) {
+    throw std::runtime_error(fmt::format("JournalRecoveryWriter::JournalRecoveryWriter(): ftyp not found: type={}",
+                                         ftyp->getType().toString()));
+  }
+  m_ftyp_size = ftyp->getSize();
+}
+
+std::uint64_t JournalRecoveryWriter::readJournal(const std::filesystem::path& path,
+                                                 const std::vector<track::Track*>& tracks) {
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> fp(std::fopen(path.c_str(), "rb"), &std::fclose);
+  if (!fp) {
+    throw std::runtime_error(
+        fmt::format("JournalRecoveryWriter::readJournal(): cannot open the journal: {}", path.string()));
+  }
+  std::array<std::uint8_t, JournalHeaderSize> header;
+  if (std::fread(header.data(), 1, std::size(header), fp.get()) != std::size(header) ||
+      !std::equal(std::begin(JournalMagic), std::end(JournalMagic), std::begin(header)) ||
+      endian::be_to_uint32(header[4], header[5], header[6], header[7]) != JournalVersion) {
+    throw std::runtime_error(fmt::format("JournalRecoveryWriter::readJournal(): invalid journal: {}", path.string()));
+  }
+
+  struct TrackState {
+    std::uint64_t sample_count = 0;
+    std::uint64_t last_timestamp = 0;
+    std::uint64_t last_duration = 0;
+  };
+  std::map<std::uint32_t, track::Track*> tracks_by_id;
+  for (const auto t : tracks) {
+    tracks_by_id[t->getTrackID()] = t;
+  }
+  std::map<track::Track*, TrackState> states;
+
+  // mdat のデータの先頭は SimpleWriter::writeFtypBox() で確保した mdat のヘッダーの後ろ
+  const std::uint64_t data_offset = m_ftyp_size + Constants::LARGE_HEADER_SIZE;
+  std::uint64_t data_size = 0;
+  std::uint64_t restored_count = 0;
+  track::Track* current_track = nullptr;
+  std::vector<track::Sample> samples;
+  std::vector<std::uint8_t> buffer(JournalRecordSize * JournalReadRecordCount);
+  std::size_t position = 0;
+  std::size_t buffered_size = 0;
+  // 未処理のデータを先頭に寄せて読み足し, size バイト以上あるかを返す
+  const auto fill = [&buffer, &position, &buffered_size, &fp](const std::size_t size) {
+    if (buffered_size - position >= size) {
+      return true;
+    }
+    std::copy(std::begin(buffer) + static_cast<std::ptrdiff_t>(position),
+              std::begin(buffer) + static_cast<std::ptrdiff_t>(buffered_size), std::begin(buffer));
+    buffered_size -= position;
+    position = 0;
+    buffered_size += std::fread(buffer.data() + buffered_size, 1, std::size(buffer) - buffered_size, fp.get());
+    return buffered_size >= size;
+  };
+  const auto restore_samples = [&samples, &current_track]() {
+    if (current_track != nullptr && !std::empty(samples)) {
+      current_track->restoreSamples(samples);
+      samples.clear();
+    }
+  };
+  // 書き込み途中で中断した最後の記録は捨てる
+  while (fill(JournalRecordSize)) {
+    const auto record = buffer.data() + position;
+    const auto track_id = endian::be_to_uint32(record[0], record[1], record[2], record[3]);
+    const auto timestamp =
+        endian::be_to_uint64(record[4], record[5], record[6], record[7], record[8], record[9], record[10], record[11]);
+    const auto size = endian::be_to_uint32(record[12], record[13], record[14], record[15]);
+    const auto flags = record[16];
+    position += JournalRecordSize;
+    const auto found = tracks_by_id.find(track_id);
+    if (found == std::end(tracks_by_id)) {
+      throw std::runtime_error(fmt::format("JournalRecoveryWriter::readJournal(): unknown track_id: {}", track_id));
+    }
+    if ((flags & JournalCodecConfigFlag) != 0) {
+      // 設定は SPS/PPS などの小さなデータなので, 読み込み用の領域に収まらない場合は不正な記録とする
+      if (size > std::size(buffer)) {
+        throw std::runtime_error(
+            fmt::format("JournalRecoveryWriter::readJournal(): invalid codec config size: {}", size));
+      }
+      if (!fill(size)) {
+        break;
+      }
+      found->second->restoreCodecConfig(
+          std::vector<std::uint8_t>(buffer.data() + position, buffer.data() + position + size));
+      position += size;
+      continue;
+    }
+    if (data_offset + data_size + size > m_file_size) {
+      break;
+    }
+    // 別のトラックのサンプルが続く場合は chunk を区切る
+    if (found->second != current_track) {
+      if (current_track != nullptr) {
+        restore_samples();
+        current_track->terminateCurrentChunk();
+      }
+      current_track = found->second;
+    }
+    samples.push_back(
+        {.timestamp = timestamp, .data = nullptr, .size = size, .is_key = (flags & JournalKeySampleFlag) != 0});
+    if (std::size(samples) >= JournalReadRecordCount) {
+      restore_samples();
+    }
+
+    auto& state = states[current_track];
+    if (state.sample_count > 0) {
+      state.last_duration = timestamp - state.last_timestamp;
+    }
+    state.last_timestamp = timestamp;
+    ++state.sample_count;
+    data_size += size;
+    ++restored_count;
+  }
+  restore_samples();
+
+  // 最後のサンプルの duration は直前のサンプルと同じとする
+  float max_duration = 0;
+  for (const auto& [t, state] : states) {
+    const auto end_timestamp = state.last_timestamp + state.last_duration;
+    const auto timescale = t->getTimescale();
+    auto duration = static_cast<float>(static_cast<double>(end_timestamp) / static_cast<double>(timescale));
+    // float の丸めで最後のサンプルより前にならないようにする
+    while (static_cast<std::uint64_t>(static_cast<float>(timescale) * duration) < end_timestamp) {
+      duration = std::nextafter(duration, std::numeric_limits<float>::max());
+    }
+    t->setDuration(duration);
+    max_duration = std::max(max_duration, duration);
+  }
+  m_duration = max_duration;
+  m_mvhd_box->setDuration(static_cast<std::uint64_t>(static_cast<float>(m_mvhd_timescale) * m_duration));
+  return restored_count;
+}
+
+void JournalRecoveryWriter::writeMoovBox() {
+  writeFreeBoxAndMdatHeader();
+  const std::uint64_t moov_offset = m_ftyp_size + Constants::LARGE_HEADER_SIZE + m_mdat_data_size;
+  m_file.seekp(static_cast<std::streamoff>(moov_offset), std::ios_base::beg);
+  if (!m_file.good()) {
+    throw std::runtime_error(fmt::format("JournalRecoveryWriter::writeMoovBox(): ostream::seekp() failed: rdstate={}",
+                                         m_file.rdstate()));
+  }
+  SimpleWriter::writeMoovBox();
+
+  // 記録されずに残ったサンプルのデータを free で覆う
+  const auto moov_end = moov_offset + getMoovBoxInfo()->getSize();
+  if (m_file_size > moov_end) {
+    const auto remaining = m_file_size - moov_end;
+    const auto header_size = remaining > std::numeric_limits<std::uint32_t>::max() ? Constants::LARGE_HEADER_SIZE
+                                                                                    : Constants::SMALL_HEADER_SIZE;
+    BoxHeader free({.offset = moov_end,
+                    .size = std::max<std::uint64_t>(remaining, header_size),
+                    .header_size = header_size,
+                    .type = BoxType("free")});
+    free.write(m_file);
+  }
+  m_file.flush();
+  if (!m_file.good()) {
+    throw std::runtime_error(fmt::format("JournalRecoveryWriter::writeMoovBox(): ostream::write() failed: rdstate={}",
+                                         m_file.rdstate()));
+  }
+}
+
+void JournalRecoveryWriter::addMdatData(const std::uint8_t*, const std::size_t data_size) {
+  m_mdat_data_size += data_size;
+}
+
+void JournalRecoveryWriter::addMdatSamples(const std::span<const track::Sample> samples) {
+  for (const auto& sample : samples) {
+    m_mdat_data_size += sample.size;
+  }
+}
+
+void JournalRecoveryWriter::addTrackSamples(const track::Track&, const std::span<const track::Sample> samples) {
+  addMdatSamples(samples);
+}
+
+std::uint64_t JournalRecoveryWriter::tellCurrentMdatOffset() {
+  return m_ftyp_size + Constants::LARGE_HEADER_SIZE + m_mdat_data_size;
+}
+
+}  // namespace shiguredo::mp4::writer
@@ -10,6 +10,7 @@
 #include <limits>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "shiguredo/mp4/box/boxes.hpp"
 #include "shiguredo/mp4/box_header.hpp"
@@ -17,11 +18,20 @@
 #include "shiguredo/mp4/box_type.hpp"
 #include "shiguredo/mp4/time/time.hpp"
 #include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/sample_journal.hpp"
 
 namespace shiguredo::mp4::writer {
 
 SimpleWriter::SimpleWriter(std::ostream& t_os, const SimpleWriterParameters& params)
-    : m_os(t_os), m_ftyp_params(params.ftyp_params) {
+    : m_os(t_os),
+      m_ftyp_params(params.ftyp_params),
+      m_journal(params.journal),
+      m_checkpoint_interval_ms(params.checkpoint_interval_ms),
+      m_next_checkpoint_ms(params.checkpoint_interval_ms) {
+  if (m_journal != nullptr && m_checkpoint_interval_ms > 0) {
+    throw std::invalid_argument(
+        "SimpleWriter::SimpleWriter(): journal and checkpoint_interval_ms cannot be used together");
+  }
   m_mvhd_timescale = params.mvhd_timescale;
   m_duration = params.duration;
   std::chrono::system_clock::time_point p = std::chrono::system_clock::now();
@@ -39,6 +49,10 @@ SimpleWriter::SimpleWriter(std::ostream& t_os, const SimpleWriterParameters& par
   new BoxInfo({.parent = m_moov_box_info, .box = m_mvhd_box});
 }
 
+SimpleWriter::~SimpleWriter() {
+  delete m_checkpoint_moov_box_info;
+}
+
 void SimpleWriter::writeFtypBox() {
   BoxInfo* ftyp = new BoxInfo({.box = new box::Ftyp(m_ftyp_params)});
 
@@ -55,14 +69,32 @@ void SimpleWriter::writeFtypBox() {
 }
 
 void SimpleWriter::writeFreeBoxAndMdatHeader() {
-  m_os.seekp(static_cast<std::streamoff>(m_ftyp_size), std::ios_base::beg);
+  writeFreeBoxAndMdatHeader(getCurrentMdatOffset(), m_mdat_data_size - m_checkpoint_mdat_data_size, false);
+  // 最後のスナップショットは writeMoovBox() で書き込んだ moov に置き換わる
+  if (m_checkpoint_moov_size > 0) {
+    BoxHeader free({.offset = m_checkpoint_moov_offset,
+                    .size = m_checkpoint_moov_size,
+                    .header_size = Constants::SMALL_HEADER_SIZE,
+                    .type = BoxType("free")});
+    free.write(m_os);
+    if (!m_os.good()) {
+      throw std::runtime_error(fmt::format(
+          "SimpleWriter::writeFreeBoxAndMdatHeader(): ostream::write() failed: rdstate={}", m_os.rdstate()));
+    }
+  }
+}
+
+void SimpleWriter::writeFreeBoxAndMdatHeader(const std::uint64_t offset,
+                                             const std::uint64_t data_size,
+                                             const bool extend_to_eof) {
+  m_os.seekp(static_cast<std::streamoff>(offset), std::ios_base::beg);
   if (!m_os.good()) {
     throw std::runtime_error(
         fmt::format("SimpleWriter::writeFreeBoxAndMdatHeader(): ostream::seekp() failed: rdstate={}", m_os.rdstate()));
   }
-  if (m_mdat_data_size > (std::numeric_limits<std::uint32_t>::max() - 8)) {
-    BoxHeader mdat({.offset = m_ftyp_size,
-                    .size = m_mdat_data_size + Constants::LARGE_HEADER_SIZE,
+  if (!extend_to_eof && data_size > (std::numeric_limits<std::uint32_t>::max() - 8)) {
+    BoxHeader mdat({.offset = offset,
+                    .size = data_size + Constants::LARGE_HEADER_SIZE,
                     .header_size = Constants::LARGE_HEADER_SIZE,
                     .type = BoxType("mdat")});
     mdat.write(m_os);
@@ -72,16 +104,17 @@ void SimpleWriter::writeFreeBoxAndMdatHeader() {
     }
   } else {
     BoxInfo* free = new BoxInfo({.box = new box::Free()});
-    free->adjustOffsetAndSize(m_ftyp_size);
+    free->adjustOffsetAndSize(offset);
     free->write(m_os);
     if (!m_os.good()) {
       throw std::runtime_error(fmt::format(
           "SimpleWriter::writeFreeBoxAndMdatHeader(): ostream::write() failed: rdstate={}", m_os.rdstate()));
     }
-    BoxHeader mdat({.offset = m_ftyp_size + free->getSize(),
-                    .size = m_mdat_data_size + Constants::SMALL_HEADER_SIZE,
+    BoxHeader mdat({.offset = offset + free->getSize(),
+                    .size = data_size + Constants::SMALL_HEADER_SIZE,
                     .header_size = Constants::SMALL_HEADER_SIZE,
-                    .type = BoxType("mdat")});
+                    .type = BoxType("mdat"),
+                    .extend_to_eof = extend_to_eof});
     delete free;
     mdat.write(m_os);
     if (!m_os.good()) {
@@ -92,7 +125,7 @@ void SimpleWriter::writeFreeBoxAndMdatHeader() {
 }
 
 void SimpleWriter::addMdatData(const std::uint8_t* data, const std::size_t data_size) {
-  std::copy_n(data, data_size, std::ostreambuf_iterator<char>(m_os));
+  m_os.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(data_size));
   if (!m_os.good()) {
     throw std::runtime_error(
         fmt::format("SimpleWriter::addMdatData(): ostream::write() failed: rdstate={}", m_os.rdstate()));
@@ -100,9 +133,42 @@ void SimpleWriter::addMdatData(const std::uint8_t* data, const std::size_t data_
   m_mdat_data_size += static_cast<std::uint64_t>(data_size);
 }
 
+void SimpleWriter::addMdatSamples(const std::span<const track::Sample> samples) {
+  const auto data = gatherSamples(samples);
+  m_os.write(data.data(), static_cast<std::streamsize>(std::size(data)));
+  if (!m_os.good()) {
+    throw std::runtime_error(
+        fmt::format("SimpleWriter::addMdatSamples(): ostream::write() failed: rdstate={}", m_os.rdstate()));
+  }
+  m_mdat_data_size += std::size(data);
+}
+
+void SimpleWriter::commitTrackSamples(const track::Track& track, const std::span<const track::Sample> samples) {
+  // mdat への書き込みが終わったサンプルのみを記録する
+  if (m_journal != nullptr) {
+    m_journal->append(track, samples);
+  }
+  if (m_checkpoint_interval_ms > 0 && !std::empty(samples)) {
+    const auto timestamp_ms = samples.back().timestamp * 1000 / track.getTimescale();
+    if (timestamp_ms >= m_next_checkpoint_ms && writeCheckpoint()) {
+      m_next_checkpoint_ms = timestamp_ms + m_checkpoint_interval_ms;
+    }
+  }
+}
+
 void SimpleWriter::setOffsetAndSize() {
-  const std::uint64_t offset = m_ftyp_size + Constants::LARGE_HEADER_SIZE + m_mdat_data_size;
-  m_moov_box_info->adjustOffsetAndSize(offset);
+  m_moov_box_info->adjustOffsetAndSize(getDataEndOffset());
+}
+
+std::uint64_t SimpleWriter::getCurrentMdatOffset() const {
+  if (m_checkpoint_moov_size > 0) {
+    return m_checkpoint_moov_offset + m_checkpoint_moov_size;
+  }
+  return m_ftyp_size;
+}
+
+std::uint64_t SimpleWriter::getDataEndOffset() const {
+  return getCurrentMdatOffset() + Constants::LARGE_HEADER_SIZE + m_mdat_data_size - m_checkpoint_mdat_data_size;
 }
 
 std::uint64_t SimpleWriter::tellCurrentMdatOffset() {
@@ -118,7 +184,7 @@ void SimpleWriter::writeMoovBox() {
   setOffsetAndSize();
   m_mvhd_box->setNextTrackID(m_next_track_id);
 
-  m_moov_box_info->write(m_os);
+  m_moov_box_info->writeAtOnce(m_os);
 }
 
 void SimpleWriter::appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>& tracks) {
@@ -128,4 +194,87 @@ void SimpleWriter::appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::tr
   appendUdtaBoxInfo();
 }
 
+void SimpleWriter::setCheckpointTracks(const std::vector<track::Track*>& tracks) {
+  m_checkpoint_tracks = tracks;
+}
+
+bool SimpleWriter::writeCheckpoint() {
+  if (std::empty(m_checkpoint_tracks) ||
+      std::any_of(std::begin(m_checkpoint_tracks), std::end(m_checkpoint_tracks),
+                  [](const auto t) { return t->getSampleCount() == 0; })) {
+    return false;
+  }
+  if (m_checkpoint_moov_box_info == nullptr) {
+    m_checkpoint_moov_box_info = new BoxInfo({.box = new box::Moov()});
+    m_checkpoint_mvhd_box = new box::Mvhd({.creation_time = m_time_from_epoch,
+                                           .modification_time = m_time_from_epoch,
+                                           .timescale = m_mvhd_timescale,
+                                           .duration = 0,
+                                           .next_track_id = m_next_track_id});
+    new BoxInfo({.parent = m_checkpoint_moov_box_info, .box = m_checkpoint_mvhd_box});
+  }
+  // 2 回目以降は前回のスナップショットから増えたサンプルのみを trak に追加する
+  std::uint64_t duration = 0;
+  for (const auto t : m_checkpoint_tracks) {
+    duration = std::max(duration, t->updateSnapshotTrakBoxInfo(m_checkpoint_moov_box_info));
+  }
+  m_checkpoint_mvhd_box->setDuration(duration);
+  m_checkpoint_mvhd_box->setNextTrackID(m_next_track_id);
+  m_checkpoint_moov_box_info->getLeafs().front()->invalidateSize();
+  if (m_checkpoint_padding_box_info == nullptr) {
+    m_checkpoint_padding_box = new box::Free();
+    m_checkpoint_padding_box_info =
+        new BoxInfo({.parent = m_checkpoint_moov_box_info, .box = m_checkpoint_padding_box});
+  }
+
+  // moov の末尾の free の大きさを変えて領域の大きさに揃える.
+  // 前の領域に収まる場合は同じ位置に上書きし, 収まらない場合は倍の大きさの領域を mdat の後ろに確保する
+  const auto moov_size =
+      m_checkpoint_moov_box_info->adjustOffsetAndSize(0) - m_checkpoint_padding_box->getDataSize();
+  const bool fits = m_checkpoint_moov_size >= moov_size;
+  const auto capacity = fits ? m_checkpoint_moov_size : moov_size * 2;
+  const auto moov_offset = fits ? m_checkpoint_moov_offset : getDataEndOffset();
+  m_checkpoint_padding_box->setDataSize(static_cast<std::size_t>(capacity - moov_size));
+  m_checkpoint_padding_box_info->invalidateSize();
+  m_checkpoint_moov_box_info->adjustOffsetAndSize(moov_offset);
+  // 1 度の ostream::write() でも途中までしか書き込まれない場合がある.
+  // 同じ位置に上書きする場合は, 書き込みの途中で中断すると壊れた moov が残り, 前のスナップショットも読めなくなる
+  m_checkpoint_moov_box_info->writeAtOnce(m_os);
+
+  if (fits) {
+    // 続くサンプルは前回のスナップショットの後ろのファイルの末尾まで続く mdat に書き込み続ける
+    m_os.seekp(static_cast<std::streamoff>(getDataEndOffset()), std::ios_base::beg);
+    m_os.flush();
+    if (!m_os.good()) {
+      throw std::runtime_error(
+          fmt::format("SimpleWriter::writeCheckpoint(): ostream::write() failed: rdstate={}", m_os.rdstate()));
+    }
+    return true;
+  }
+
+  // mdat のサイズを確定すると新しいスナップショットが読めるようになる
+  // 前のスナップショットを free にするまでは, 先にある前のスナップショットが使われる
+  writeFreeBoxAndMdatHeader(getCurrentMdatOffset(), m_mdat_data_size - m_checkpoint_mdat_data_size, false);
+  if (m_checkpoint_moov_size > 0) {
+    BoxHeader free({.offset = m_checkpoint_moov_offset,
+                    .size = m_checkpoint_moov_size,
+                    .header_size = Constants::SMALL_HEADER_SIZE,
+                    .type = BoxType("free")});
+    free.write(m_os);
+  }
+  m_checkpoint_moov_offset = moov_offset;
+  m_checkpoint_moov_size = capacity;
+  m_checkpoint_mdat_data_size = m_mdat_data_size;
+
+  // 続くサンプルはファイルの末尾まで続く mdat に書き込む
+  writeFreeBoxAndMdatHeader(getCurrentMdatOffset(), 0, true);
+  m_os.seekp(static_cast<std::streamoff>(getDataEndOffset()), std::ios_base::beg);
+  m_os.flush();
+  if (!m_os.good()) {
+    throw std::runtime_error(
+        fmt::format("SimpleWriter::writeCheckpoint(): ostream::write() failed: rdstate={}", m_os.rdstate()));
+  }
+  return true;
+}
+
 }  // namespace shiguredo::mp4::writer
@@ -3,7 +3,9 @@
 #include <array>
 #include <cstdint>
 #include <iterator>
+#include <span>
 #include <string>
+#include <vector>
 
 #include "shiguredo/mp4/box/boxes.hpp"
 #include "shiguredo/mp4/box_info.hpp"
@@ -21,6 +23,38 @@ void Writer::addMdatData(const std::vector<std::uint8_t>& data) {
   addMdatData(data.data(), std::size(data));
 }
 
+void Writer::addMdatSamples(const std::span<const track::Sample> samples) {
+  for (const auto& sample : samples) {
+    addMdatData(sample.data, sample.size);
+  }
+}
+
+void Writer::addTrackSamples(const track::Track&, const std::span<const track::Sample> samples) {
+  addMdatSamples(samples);
+}
+
+void Writer::commitTrackSamples(const track::Track&, const std::span<const track::Sample>) {}
+
+std::span<const char> Writer::gatherSamples(const std::span<const track::Sample> samples) {
+  if (std::size(samples) == 1) {
+    return {reinterpret_cast<const char*>(samples.front().data), samples.front().size};
+  }
+  m_gather_buffer.clear();
+  for (const auto& sample : samples) {
+    const auto data = reinterpret_cast<const char*>(sample.data);
+    m_gather_buffer.insert(std::end(m_gather_buffer), data, data + sample.size);
+  }
+  return m_gather_buffer;
+}
+
+std::size_t Writer::prepareTrackSamples(track::Track&, const std::span<const track::Sample> samples) {
+  return std::size(samples);
+}
+
+bool Writer::usesSampleTables() const {
+  return true;
+}
+
 BoxInfo* Writer::getMoovBoxInfo() const {
   return m_moov_box_info;
 }
@@ -39,6 +73,16 @@ std::uint32_t Writer::getAndUpdateNextTrackID() {
   return track_id;
 }
 
+void Writer::setNextTrackID(const std::uint32_t next_track_id) {
+  m_next_track_id = next_track_id;
+}
+
+void Writer::setMvhdDuration(const std::uint64_t duration) {
+  m_mvhd_box->setDuration(duration);
+  // version が変わるとサイズが変わる
+  m_moov_box_info->getLeafs().front()->invalidateSize();
+}
+
 void Writer::appendUdtaBoxInfo(const box::DataParameters& data_params) {
   auto udta = new BoxInfo({.parent = m_moov_box_info, .box = new box::Udta()});
   auto meta = new BoxInfo({.parent = udta, .box = new box::Meta()});
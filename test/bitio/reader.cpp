@@ -150,4 +150,26 @@ BOOST_AUTO_TEST_CASE(reader_seek_invalid_argument) {
   BOOST_REQUIRE_EQUAL_COLLECTIONS(expected, expected + 1, data.data(), data.data() + std::size(data));
 }
 
+BOOST_AUTO_TEST_CASE(reader_check_entry_count) {
+  std::stringstream ss;
+  shiguredo::mp4::bitio::Reader reader(ss);
+  const std::uint8_t buf[] = {
+      0x6c, 0x82, 0x41, 0x35, 0x71, 0xa4, 0xcd, 0x9f,
+  };
+  ss.write(reinterpret_cast<const char*>(buf), std::size(buf));
+
+  std::vector<std::uint8_t> data;
+  data.resize(2);
+  BOOST_REQUIRE_NO_THROW(reader.read(&data));
+  BOOST_REQUIRE_EQUAL(6, reader.getRemainingSize());
+  BOOST_REQUIRE_NO_THROW(reader.checkEntryCount(3, 2));
+  BOOST_REQUIRE_NO_THROW(reader.checkEntryCount(0xffffffff, 0));
+  BOOST_REQUIRE_THROW(reader.checkEntryCount(4, 2), std::runtime_error);
+  BOOST_REQUIRE_THROW(reader.checkEntryCount(0xffffffff, 8), std::runtime_error);
+  // 確認によって読み込み位置は変わらない
+  BOOST_REQUIRE_NO_THROW(reader.read(&data));
+  const std::uint8_t expected[] = {0x41, 0x35};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(expected, expected + 2, data.data(), data.data() + std::size(data));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
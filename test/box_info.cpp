@@ -1,3 +1,8 @@
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include <boost/test/unit_test.hpp>
 
 #include "shiguredo/mp4/box/boxes.hpp"
@@ -20,4 +25,68 @@ BOOST_AUTO_TEST_CASE(box_info_tree) {
   delete moov;
 }
 
+BOOST_AUTO_TEST_CASE(box_info_cached_size) {
+  auto moov = new shiguredo::mp4::BoxInfo({.box = new shiguredo::mp4::box::Moov()});
+  auto udta = new shiguredo::mp4::BoxInfo({.parent = moov, .box = new shiguredo::mp4::box::Udta()});
+  new shiguredo::mp4::BoxInfo({.parent = udta, .box = new shiguredo::mp4::box::Free({.data = {1, 2, 3, 4}})});
+  BOOST_REQUIRE_EQUAL(28, moov->adjustOffsetAndSize(100));
+
+  // サイズは再利用し, offset のみ設定し直す
+  BOOST_REQUIRE_EQUAL(28, moov->adjustOffsetAndSize(0));
+  BOOST_REQUIRE_EQUAL(R"([moov] Offset=0 Size=28
+  [udta] Offset=8 Size=20
+    [free] Offset=16 Size=12 Data=[0x1, 0x2, 0x3, 0x4])",
+                      moov->toString());
+
+  // 孫に Box を追加すると祖先のサイズも再計算する
+  new shiguredo::mp4::BoxInfo({.parent = udta, .box = new shiguredo::mp4::box::Free({.data = {5, 6}})});
+  BOOST_REQUIRE_EQUAL(38, moov->adjustOffsetAndSize(0));
+  BOOST_REQUIRE_EQUAL(R"([moov] Offset=0 Size=38
+  [udta] Offset=8 Size=30
+    [free] Offset=16 Size=12 Data=[0x1, 0x2, 0x3, 0x4]
+    [free] Offset=28 Size=10 Data=[0x5, 0x6])",
+                      moov->toString());
+
+  delete moov;
+}
+
+BOOST_AUTO_TEST_CASE(box_info_find_leaf) {
+  auto moov = new shiguredo::mp4::BoxInfo({.box = new shiguredo::mp4::box::Moov()});
+  auto udta = new shiguredo::mp4::BoxInfo({.parent = moov, .box = new shiguredo::mp4::box::Udta()});
+  auto free = new shiguredo::mp4::BoxInfo({.parent = udta, .box = new shiguredo::mp4::box::Free()});
+
+  BOOST_REQUIRE_EQUAL(udta, shiguredo::mp4::find_leaf(moov, shiguredo::mp4::BoxType("udta")));
+  // 子のみを探す
+  BOOST_REQUIRE(shiguredo::mp4::find_leaf(moov, shiguredo::mp4::BoxType("free")) == nullptr);
+  BOOST_REQUIRE(shiguredo::mp4::find_leaf(nullptr, shiguredo::mp4::BoxType("free")) == nullptr);
+  BOOST_REQUIRE_EQUAL(free->getBox(), shiguredo::mp4::find_box<shiguredo::mp4::box::Free>(
+                                          shiguredo::mp4::find_leaf(moov, shiguredo::mp4::BoxType("udta")),
+                                          shiguredo::mp4::BoxType("free")));
+  BOOST_REQUIRE(shiguredo::mp4::find_box<shiguredo::mp4::box::Mvhd>(udta, shiguredo::mp4::BoxType("free")) == nullptr);
+
+  delete moov;
+}
+
+BOOST_AUTO_TEST_CASE(box_info_serialize) {
+  auto moov = new shiguredo::mp4::BoxInfo({.box = new shiguredo::mp4::box::Moov()});
+  auto udta = new shiguredo::mp4::BoxInfo({.parent = moov, .box = new shiguredo::mp4::box::Udta()});
+  new shiguredo::mp4::BoxInfo({.parent = udta, .box = new shiguredo::mp4::box::Free({.data = {1, 2, 3, 4}})});
+  moov->adjustOffsetAndSize(3);
+
+  std::stringstream expected;
+  expected << "abc";
+  moov->write(expected);
+
+  std::vector<char> buffer;
+  moov->serialize(&buffer);
+  BOOST_REQUIRE_EQUAL(expected.str().substr(3), std::string(std::begin(buffer), std::end(buffer)));
+
+  std::stringstream ss;
+  ss << "abc";
+  moov->writeAtOnce(ss);
+  BOOST_REQUIRE_EQUAL(expected.str(), ss.str());
+
+  delete moov;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
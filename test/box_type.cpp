@@ -1,5 +1,8 @@
 #include <array>
 #include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
 
 #include <boost/test/unit_test.hpp>
 
@@ -17,4 +20,19 @@ BOOST_AUTO_TEST_CASE(box_type_to_string) {
                       shiguredo::mp4::BoxType(std::array<std::uint8_t, 4>{'x', 'x', 0xab, 'x'}).toString());
 }
 
+BOOST_AUTO_TEST_CASE(box_type_constexpr) {
+  using shiguredo::mp4::literals::operator""_box;
+  static_assert("moov"_box == shiguredo::mp4::BoxType("moov"));
+  static_assert("moov"_box.getValue() == 0x6d6f6f76);
+  static_assert("moov"_box < "mvhd"_box);
+  static_assert("moov"_box.matchWith(shiguredo::mp4::box_type_any()));
+  static_assert(!"moov"_box.matchWith("mvhd"_box));
+  constexpr std::array<std::uint8_t, 4> data = {'t', 'r', 'a', 'k'};
+  static_assert(shiguredo::mp4::BoxType(data).getData() == data);
+
+  BOOST_REQUIRE("trak"_box == shiguredo::mp4::BoxType(std::string("trak")));
+  BOOST_REQUIRE_EQUAL(std::hash<shiguredo::mp4::BoxType>{}("trak"_box), std::hash<std::uint32_t>{}(0x7472616b));
+  BOOST_REQUIRE_THROW(shiguredo::mp4::BoxType(std::string("trak1")), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,10 +1,15 @@
+#include <array>
 #include <cstdint>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
 #include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box/unsupported.hpp"
 #include "shiguredo/mp4/box_map.hpp"
 #include "shiguredo/mp4/box_type.hpp"
 #include "shiguredo/mp4/box_types.hpp"
@@ -2207,4 +2212,101 @@ BOOST_AUTO_TEST_CASE(box) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(elst_set_track_duration) {
+  shiguredo::mp4::box::Elst elst(
+      {.entries = {shiguredo::mp4::box::ElstEntry({.track_duration = 100, .media_time = -1}),
+                   shiguredo::mp4::box::ElstEntry({.track_duration = 1000, .media_time = 0})}});
+  // 空の edit の長さは変えず, 残りを空でない edit の長さにする
+  elst.setTrackDuration(1500);
+  BOOST_REQUIRE_EQUAL(100, elst.getEntries()[0].m_track_duration);
+  BOOST_REQUIRE_EQUAL(1400, elst.getEntries()[1].m_track_duration);
+  BOOST_REQUIRE_EQUAL(0, elst.getVersion());
+
+  elst.setTrackDuration(50);
+  BOOST_REQUIRE_EQUAL(100, elst.getEntries()[0].m_track_duration);
+  BOOST_REQUIRE_EQUAL(0, elst.getEntries()[1].m_track_duration);
+
+  elst.setTrackDuration(0x100000064);
+  BOOST_REQUIRE_EQUAL(0x100000000, elst.getEntries()[1].m_track_duration);
+  BOOST_REQUIRE_EQUAL(1, elst.getVersion());
+}
+
+BOOST_AUTO_TEST_CASE(box_map) {
+  const auto& default_box_map = shiguredo::mp4::get_box_map();
+  BOOST_REQUIRE(default_box_map.isSupported(shiguredo::mp4::BoxType("moov")));
+  BOOST_REQUIRE(
+      default_box_map.isSupported(shiguredo::mp4::BoxType(std::array<std::uint8_t, 4>{0xa9, 'n', 'a', 'm'})));
+  BOOST_REQUIRE(!default_box_map.isSupported(shiguredo::mp4::BoxType("xxxx")));
+
+  BOOST_REQUIRE(default_box_map.isSupportedVersion(shiguredo::mp4::BoxType("sgpd"), 1));
+  BOOST_REQUIRE(!default_box_map.isSupportedVersion(shiguredo::mp4::BoxType("sgpd"), 0));
+  BOOST_REQUIRE(default_box_map.isSupportedVersion(shiguredo::mp4::BoxType("btrt"), 200));
+  const std::vector<std::uint8_t> versions = {0, 1};
+  BOOST_REQUIRE(versions == default_box_map.getSupportedVersions(shiguredo::mp4::BoxType("vpcC")));
+
+  auto box = default_box_map.getBoxInstance(shiguredo::mp4::BoxType("vp09"));
+  BOOST_REQUIRE(dynamic_cast<shiguredo::mp4::box::VisualSampleEntry*>(box) != nullptr);
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("vp09") == box->getType());
+  delete box;
+
+  box = default_box_map.getBoxInstance(shiguredo::mp4::BoxType("xxxx"));
+  BOOST_REQUIRE(dynamic_cast<shiguredo::mp4::box::Unsupported*>(box) != nullptr);
+  delete box;
+
+  // 既定の定義に独自の定義を追加する
+  shiguredo::mp4::BoxMap custom_box_map;
+  shiguredo::mp4::register_box_map(&custom_box_map);
+  custom_box_map.addBoxDef(
+      shiguredo::mp4::make_box_def<shiguredo::mp4::box::VisualSampleEntry>(shiguredo::mp4::BoxType("hvc1"), {0}));
+  BOOST_REQUIRE(custom_box_map.isSupported(shiguredo::mp4::BoxType("hvc1")));
+  BOOST_REQUIRE(custom_box_map.isSupported(shiguredo::mp4::BoxType("moov")));
+  BOOST_REQUIRE(!default_box_map.isSupported(shiguredo::mp4::BoxType("hvc1")));
+
+  // コピーは元の BoxMap の定義を参照しない
+  shiguredo::mp4::BoxMap copied(custom_box_map);
+  shiguredo::mp4::BoxMap assigned;
+  assigned = custom_box_map;
+  custom_box_map.addBoxDef(shiguredo::mp4::make_box_def<shiguredo::mp4::box::Moov>(shiguredo::mp4::BoxType("hvc1")));
+  for (const auto& m : {copied, assigned}) {
+    box = m.getBoxInstance(shiguredo::mp4::BoxType("hvc1"));
+    BOOST_REQUIRE(dynamic_cast<shiguredo::mp4::box::VisualSampleEntry*>(box) != nullptr);
+    delete box;
+  }
+  const shiguredo::mp4::BoxMap moved(std::move(copied));
+  box = moved.getBoxInstance(shiguredo::mp4::BoxType("hvc1"));
+  BOOST_REQUIRE(dynamic_cast<shiguredo::mp4::box::VisualSampleEntry*>(box) != nullptr);
+  delete box;
+}
+
+BOOST_AUTO_TEST_CASE(box_entry_count_exceeds_payload) {
+  // entry_count が payload に収まらない場合は要素を確保せずに例外を送出する
+  const std::vector<std::uint8_t> bin = {
+      0,                       // version
+      0x00, 0x00, 0x00,        // flags
+      0xff, 0xff, 0xff, 0xff,  // entry count
+      0x00, 0x00, 0x00, 0x01,  // sample count
+      0x00, 0x00, 0x04, 0x00,  // sample delta
+  };
+  std::stringstream ss;
+  ss.write(reinterpret_cast<const char*>(bin.data()), static_cast<std::streamsize>(std::size(bin)));
+  shiguredo::mp4::box::Stts stts;
+  BOOST_REQUIRE_THROW(stts.readData(ss), std::runtime_error);
+
+  // alst の opts の数は default_length から求めるので, payload に収まらない場合は確保しない
+  const std::vector<std::uint8_t> alst_bin = {
+      1,                       // version
+      0x00, 0x00, 0x00,        // flags
+      'a',  'l',  's',  't',   // grouping type
+      0x10, 0x00, 0x00, 0x04,  // default length
+      0x00, 0x00, 0x00, 0x01,  // entry count
+      0x00, 0x00,              // roll count
+      0x00, 0x00,              // first output sample
+      0x00, 0x01, 0x00, 0x02,  // opt
+  };
+  std::stringstream alst_ss;
+  alst_ss.write(reinterpret_cast<const char*>(alst_bin.data()), static_cast<std::streamsize>(std::size(alst_bin)));
+  shiguredo::mp4::box::Sgpd sgpd;
+  BOOST_REQUIRE_THROW(sgpd.readData(alst_ss), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
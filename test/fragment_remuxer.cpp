@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/fragmented_demuxer.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/fragment_remuxer.hpp"
+#include "shiguredo/mp4/writer/simple_writer.hpp"
+#include "test_track.hpp"
+
+BOOST_AUTO_TEST_SUITE(fragment_remuxer)
+
+using test_track::TestTrack;
+using test_track::write_samples;
+
+namespace {
+
+// 映像: timescale 1000 で 40ms 毎のサンプル 50 個. 10 サンプル毎にキーフレーム
+// 音声: timescale 48000 で 20ms 毎のサンプル 100 個
+// 200ms 毎に映像 5 サンプル, 音声 10 サンプルの chunk を交互に書き込む
+std::string make_progressive_mp4() {
+  // stringstream は末尾より後ろに seekp() できないため, 十分な大きさの領域を上書きする
+  std::stringstream ss(std::string(4096, '\0'));
+  shiguredo::mp4::writer::SimpleWriter writer(ss, {.duration = 2.0f});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer, {.duration = 2.0f});
+  TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer, {.duration = 2.0f});
+  writer.writeFtypBox();
+  write_samples(&video, &audio);
+  std::vector<shiguredo::mp4::track::Track*> tracks = {&video, &audio};
+  writer.appendTrakAndUdtaBoxInfo(tracks);
+  writer.writeMoovBox();
+  const auto size = static_cast<std::size_t>(ss.tellp());
+  writer.writeFreeBoxAndMdatHeader();
+  return ss.str().substr(0, size);
+}
+
+class RecordingHandler : public shiguredo::mp4::reader::FragmentedDemuxerHandler {
+ public:
+  struct Record {
+    std::uint32_t track_id;
+    std::uint64_t decode_time;
+    std::uint32_t duration;
+    bool is_key;
+    std::vector<std::uint8_t> data;
+  };
+
+  void onSample(const shiguredo::mp4::reader::DemuxedSample& sample) override {
+    records.push_back({.track_id = sample.track_id,
+                       .decode_time = sample.decode_time,
+                       .duration = sample.duration,
+                       .is_key = sample.is_key,
+                       .data = {std::begin(sample.data), std::end(sample.data)}});
+  }
+
+  std::vector<Record> records;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(fragment_remuxer_write) {
+  std::stringstream is(make_progressive_mp4());
+  shiguredo::mp4::writer::FragmentRemuxer remuxer(is, {.fragment_duration_ms = 500, .copy_buffer_size = 16});
+  BOOST_REQUIRE_EQUAL(2, std::size(remuxer.getTracks()));
+  BOOST_REQUIRE_EQUAL(50, std::size(remuxer.getTracks()[0].samples));
+  BOOST_REQUIRE_EQUAL(100, std::size(remuxer.getTracks()[1].samples));
+  BOOST_REQUIRE_EQUAL(40, remuxer.getTracks()[0].samples[49].duration);
+  BOOST_REQUIRE(!remuxer.getTracks()[0].samples[1].is_key);
+  BOOST_REQUIRE(remuxer.getTracks()[1].samples[1].is_key);
+  // 500ms を過ぎた最初のキーフレームの 0ms, 800ms, 1600ms で区切る
+  BOOST_REQUIRE_EQUAL(3, remuxer.getFragmentCount());
+
+  std::stringstream os;
+  remuxer.write(os);
+  const auto output = os.str();
+
+  std::stringstream ss(output);
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  std::vector<std::string> types;
+  for (const auto info : reader.getBoxInfos()) {
+    types.push_back(info->getType().toString());
+  }
+  const std::vector<std::string> expected = {"ftyp", "moov", "moof", "mdat", "moof", "mdat", "moof", "mdat"};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(types), std::end(types), std::begin(expected), std::end(expected));
+
+  RecordingHandler handler;
+  shiguredo::mp4::reader::FragmentedDemuxer demuxer(&handler);
+  // 小さく分割して渡しても同じ結果になる
+  for (std::size_t i = 0; i < std::size(output); i += 7) {
+    demuxer.push(reinterpret_cast<const std::uint8_t*>(output.data()) + i,
+                 std::min<std::size_t>(7, std::size(output) - i));
+  }
+  BOOST_REQUIRE(demuxer.isAtBoxBoundary());
+  BOOST_REQUIRE_EQUAL(2, std::size(demuxer.getTracks()));
+  BOOST_REQUIRE_EQUAL(150, std::size(handler.records));
+
+  std::size_t video_count = 0;
+  std::size_t audio_count = 0;
+  for (const auto& record : handler.records) {
+    if (record.track_id == 1) {
+      const auto i = video_count++;
+      BOOST_REQUIRE_EQUAL(i * 40, record.decode_time);
+      BOOST_REQUIRE_EQUAL(40, record.duration);
+      BOOST_REQUIRE_EQUAL(i % 10 == 0, record.is_key);
+      BOOST_REQUIRE_EQUAL(10 + i, std::size(record.data));
+      BOOST_REQUIRE_EQUAL(static_cast<std::uint8_t>(i), record.data.front());
+    } else {
+      BOOST_REQUIRE_EQUAL(2, record.track_id);
+      const auto i = audio_count++;
+      BOOST_REQUIRE_EQUAL(i * 960, record.decode_time);
+      BOOST_REQUIRE_EQUAL(960, record.duration);
+      BOOST_REQUIRE(record.is_key);
+      BOOST_REQUIRE_EQUAL(5, std::size(record.data));
+      BOOST_REQUIRE_EQUAL(static_cast<std::uint8_t>(0x80 | i), record.data.back());
+    }
+  }
+  BOOST_REQUIRE_EQUAL(50, video_count);
+  BOOST_REQUIRE_EQUAL(100, audio_count);
+
+  // fragment は個別に書き込める
+  std::stringstream fragment;
+  remuxer.writeFragment(fragment, 1);
+  const auto fragment_data = fragment.str();
+  BOOST_REQUIRE_NE(std::string::npos, output.find(fragment_data));
+  BOOST_REQUIRE_THROW(remuxer.writeFragment(fragment, 3), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(fragment_remuxer_without_moov) {
+  std::stringstream ss;
+  shiguredo::mp4::BoxInfo ftyp({.box = new shiguredo::mp4::box::Ftyp({.major_brand = shiguredo::mp4::BrandIsom,
+                                                                      .minor_version = 0,
+                                                                      .compatible_brands = {}})});
+  ftyp.adjustOffsetAndSize(0);
+  ftyp.write(ss);
+  BOOST_REQUIRE_THROW(shiguredo::mp4::writer::FragmentRemuxer(ss, {}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
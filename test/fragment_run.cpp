@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/tfhd.hpp"
+#include "shiguredo/mp4/box/trun.hpp"
+#include "shiguredo/mp4/writer/fragment_run.hpp"
+
+BOOST_AUTO_TEST_SUITE(fragment_run)
+
+using shiguredo::mp4::writer::FragmentSample;
+using shiguredo::mp4::writer::KeySampleFlags;
+using shiguredo::mp4::writer::make_fragment_run;
+using shiguredo::mp4::writer::make_trex_defaults;
+using shiguredo::mp4::writer::NonKeySampleFlags;
+
+BOOST_AUTO_TEST_CASE(fragment_run_constant_frame_rate_video) {
+  std::vector<FragmentSample> samples;
+  for (std::uint32_t i = 0; i < 5; ++i) {
+    samples.push_back({.duration = 3000, .size = 100 + i, .flags = i == 0 ? KeySampleFlags : NonKeySampleFlags});
+  }
+  // trex に non-sync サンプルの flags がある場合, duration のみを tfhd に置く
+  const auto run = make_fragment_run(samples, {.flags = NonKeySampleFlags});
+  BOOST_REQUIRE_EQUAL(shiguredo::mp4::box::TfhdDefaultSampleDurationPresent, run.tfhd_flags);
+  BOOST_REQUIRE_EQUAL(3000, run.tfhd_defaults.duration);
+  BOOST_REQUIRE_EQUAL(shiguredo::mp4::box::TrunDataOffsetPresent | shiguredo::mp4::box::TrunFirstSampleFlagsPresent |
+                          shiguredo::mp4::box::TrunSampleSizePresent,
+                      run.trun_flags);
+  BOOST_REQUIRE_EQUAL(KeySampleFlags, run.first_sample_flags);
+  BOOST_REQUIRE_EQUAL(5, std::size(run.entries));
+  BOOST_REQUIRE_EQUAL(104, run.entries[4].getSampleSize());
+
+  // trex の既定値がない場合は flags も tfhd に置く
+  const auto without_trex = make_fragment_run(samples, {});
+  BOOST_REQUIRE_EQUAL(
+      shiguredo::mp4::box::TfhdDefaultSampleDurationPresent | shiguredo::mp4::box::TfhdDefaultSampleFlagsPresent,
+      without_trex.tfhd_flags);
+  BOOST_REQUIRE_EQUAL(NonKeySampleFlags, without_trex.tfhd_defaults.flags);
+}
+
+BOOST_AUTO_TEST_CASE(fragment_run_trex_defaults) {
+  // 全て同期サンプルで duration と size が一定の音声は trex の既定値のみで表せる
+  std::vector<FragmentSample> samples(10, {.duration = 960, .size = 6, .flags = KeySampleFlags});
+  samples.push_back({.duration = 480, .size = 6, .flags = KeySampleFlags});
+  const auto defaults = make_trex_defaults(samples);
+  BOOST_REQUIRE_EQUAL(960, defaults.duration);
+  BOOST_REQUIRE_EQUAL(6, defaults.size);
+  BOOST_REQUIRE_EQUAL(KeySampleFlags, defaults.flags);
+
+  const auto run = make_fragment_run(std::vector<FragmentSample>(std::begin(samples), std::begin(samples) + 5),
+                                     defaults);
+  BOOST_REQUIRE_EQUAL(0, run.tfhd_flags);
+  BOOST_REQUIRE_EQUAL(shiguredo::mp4::box::TrunDataOffsetPresent, run.trun_flags);
+  BOOST_REQUIRE_EQUAL(8 + 4, shiguredo::mp4::box::Trun({.flags = run.trun_flags, .entries = run.entries}).getDataSize());
+
+  // duration が一定でない最後の run は各要素に duration を書き込む
+  const auto last = make_fragment_run(std::vector<FragmentSample>(std::begin(samples) + 5, std::end(samples)), defaults);
+  BOOST_REQUIRE_EQUAL(0, last.tfhd_flags);
+  BOOST_REQUIRE_EQUAL(shiguredo::mp4::box::TrunDataOffsetPresent | shiguredo::mp4::box::TrunSampleDurationPresent,
+                      last.trun_flags);
+}
+
+BOOST_AUTO_TEST_CASE(fragment_run_variable_samples) {
+  const std::vector<FragmentSample> samples = {
+      {.duration = 10, .size = 1, .flags = NonKeySampleFlags, .composition_time_offset = 20},
+      {.duration = 20, .size = 2, .flags = KeySampleFlags, .composition_time_offset = -10},
+      {.duration = 10, .size = 3, .flags = NonKeySampleFlags, .composition_time_offset = 0},
+  };
+  const auto run = make_fragment_run(samples, {});
+  BOOST_REQUIRE_EQUAL(0, run.tfhd_flags);
+  BOOST_REQUIRE_EQUAL(shiguredo::mp4::box::TrunDataOffsetPresent | shiguredo::mp4::box::TrunSampleDurationPresent |
+                          shiguredo::mp4::box::TrunSampleSizePresent | shiguredo::mp4::box::TrunSampleFlagsPresent |
+                          shiguredo::mp4::box::TrunSampleCompositionTimeOffsetPresent,
+                      run.trun_flags);
+  BOOST_REQUIRE_EQUAL(1, run.trun_version);
+
+  BOOST_REQUIRE_THROW(make_fragment_run(std::vector<FragmentSample>{}, {}), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
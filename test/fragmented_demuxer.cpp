@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/reader/fragmented_demuxer.hpp"
+
+BOOST_AUTO_TEST_SUITE(fragmented_demuxer)
+
+namespace {
+
+struct Sample {
+  std::uint32_t track_id;
+  std::uint64_t decode_time;
+  std::uint32_t duration;
+  bool is_key;
+  std::uint64_t offset;
+  std::vector<std::uint8_t> data;
+
+  bool operator==(const Sample&) const = default;
+};
+
+std::ostream& operator<<(std::ostream& os, const Sample& s) {
+  return os << "{track_id=" << s.track_id << " decode_time=" << s.decode_time << " duration=" << s.duration
+            << " is_key=" << s.is_key << " offset=" << s.offset << " size=" << std::size(s.data) << "}";
+}
+
+class TestHandler : public shiguredo::mp4::reader::FragmentedDemuxerHandler {
+ public:
+  std::vector<shiguredo::mp4::reader::DemuxedTrack> tracks;
+  std::vector<Sample> samples;
+
+  void onInitSegment(const std::vector<shiguredo::mp4::reader::DemuxedTrack>& t_tracks) override { tracks = t_tracks; }
+  void onSample(const shiguredo::mp4::reader::DemuxedSample& sample) override {
+    samples.push_back({.track_id = sample.track_id,
+                       .decode_time = sample.decode_time,
+                       .duration = sample.duration,
+                       .is_key = sample.is_key,
+                       .offset = sample.offset,
+                       .data = {std::begin(sample.data), std::end(sample.data)}});
+  }
+};
+
+void append_box(shiguredo::mp4::BoxInfo* info, std::string* out) {
+  info->adjustOffsetAndSize(std::size(*out));
+  std::vector<char> data;
+  info->serialize(&data);
+  out->append(data.data(), std::size(data));
+}
+
+// trex の既定値を使う moov と, tfhd と trun の既定値の規則が異なる 2 つの fragment
+std::string make_stream() {
+  std::string out;
+  shiguredo::mp4::BoxInfo moov({.box = new shiguredo::mp4::box::Moov()});
+  new shiguredo::mp4::BoxInfo({.parent = &moov,
+                               .box = new shiguredo::mp4::box::Mvhd({.creation_time = 0,
+                                                                     .modification_time = 0,
+                                                                     .timescale = 1000,
+                                                                     .duration = 0,
+                                                                     .next_track_id = 2})});
+  auto trak = new shiguredo::mp4::BoxInfo({.parent = &moov, .box = new shiguredo::mp4::box::Trak()});
+  new shiguredo::mp4::BoxInfo(
+      {.parent = trak,
+       .box = new shiguredo::mp4::box::Tkhd(
+           {.creation_time = 0, .modification_time = 0, .track_id = 1, .duration = 0})});
+  auto mdia = new shiguredo::mp4::BoxInfo({.parent = trak, .box = new shiguredo::mp4::box::Mdia()});
+  new shiguredo::mp4::BoxInfo(
+      {.parent = mdia,
+       .box = new shiguredo::mp4::box::Mdhd(
+           {.creation_time = 0, .modification_time = 0, .timescale = 90000, .duration = 0})});
+  new shiguredo::mp4::BoxInfo(
+      {.parent = mdia, .box = new shiguredo::mp4::box::Hdlr({.handler_type = {'v', 'i', 'd', 'e'}, .name = "test"})});
+  auto mvex = new shiguredo::mp4::BoxInfo({.parent = &moov, .box = new shiguredo::mp4::box::Mvex()});
+  new shiguredo::mp4::BoxInfo({.parent = mvex,
+                               .box = new shiguredo::mp4::box::Trex({.track_id = 1,
+                                                                     .default_sample_description_index = 1,
+                                                                     .default_sample_duration = 3000,
+                                                                     .default_sample_size = 0,
+                                                                     .default_sample_flags = 0x01010000})});
+  append_box(&moov, &out);
+
+  // 1 つ目: default-base-is-moof, tfhd の default_sample_size, trun の first_sample_flags
+  {
+    shiguredo::mp4::BoxInfo moof({.box = new shiguredo::mp4::box::Moof()});
+    new shiguredo::mp4::BoxInfo({.parent = &moof, .box = new shiguredo::mp4::box::Mfhd({.sequence_number = 1})});
+    auto traf = new shiguredo::mp4::BoxInfo({.parent = &moof, .box = new shiguredo::mp4::box::Traf()});
+    new shiguredo::mp4::BoxInfo(
+        {.parent = traf,
+         .box = new shiguredo::mp4::box::Tfhd(
+             {.flags = shiguredo::mp4::box::TfhdDefaultBaseIsMoof | shiguredo::mp4::box::TfhdDefaultSampleSizePresent,
+              .track_id = 1,
+              .default_sample_size = 4})});
+    new shiguredo::mp4::BoxInfo(
+        {.parent = traf, .box = new shiguredo::mp4::box::Tfdt({.version = 1, .base_media_decode_time = 9000})});
+    auto trun = new shiguredo::mp4::box::Trun(
+        {.flags = shiguredo::mp4::box::TrunDataOffsetPresent | shiguredo::mp4::box::TrunFirstSampleFlagsPresent,
+         .first_sample_flags = 0x02000000,
+         .entries = std::vector<shiguredo::mp4::box::TrunEntry>(3)});
+    new shiguredo::mp4::BoxInfo({.parent = traf, .box = trun});
+    const auto moof_size = moof.adjustOffsetAndSize(std::size(out));
+    trun->setDataOffset(static_cast<std::int32_t>(moof_size + 8));
+    append_box(&moof, &out);
+    shiguredo::mp4::BoxInfo mdat(
+        {.box = new shiguredo::mp4::box::Mdat({.data = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}})});
+    append_box(&mdat, &out);
+  }
+
+  shiguredo::mp4::BoxInfo free({.box = new shiguredo::mp4::box::Free({.data = {1, 2, 3}})});
+  append_box(&free, &out);
+
+  // 2 つ目: tfhd に base-data-offset がなく tfdt もない. decode time は直前の fragment から続ける
+  {
+    shiguredo::mp4::BoxInfo moof({.box = new shiguredo::mp4::box::Moof()});
+    new shiguredo::mp4::BoxInfo({.parent = &moof, .box = new shiguredo::mp4::box::Mfhd({.sequence_number = 2})});
+    auto traf = new shiguredo::mp4::BoxInfo({.parent = &moof, .box = new shiguredo::mp4::box::Traf()});
+    new shiguredo::mp4::BoxInfo({.parent = traf, .box = new shiguredo::mp4::box::Tfhd({.track_id = 1})});
+    auto trun = new shiguredo::mp4::box::Trun(
+        {.flags = shiguredo::mp4::box::TrunDataOffsetPresent | shiguredo::mp4::box::TrunSampleSizePresent,
+         .entries = {shiguredo::mp4::box::TrunEntry({.sample_size = 2}),
+                     shiguredo::mp4::box::TrunEntry({.sample_size = 3})}});
+    new shiguredo::mp4::BoxInfo({.parent = traf, .box = trun});
+    const auto moof_size = moof.adjustOffsetAndSize(std::size(out));
+    trun->setDataOffset(static_cast<std::int32_t>(moof_size + 8));
+    append_box(&moof, &out);
+    shiguredo::mp4::BoxInfo mdat({.box = new shiguredo::mp4::box::Mdat({.data = {20, 21, 22, 23, 24}})});
+    append_box(&mdat, &out);
+  }
+  return out;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(fragmented_demuxer_defaults) {
+  const auto stream = make_stream();
+  const auto data = reinterpret_cast<const std::uint8_t*>(stream.data());
+
+  std::vector<Sample> expected;
+  for (std::size_t chunk_size : {std::size(stream), std::size_t{1}, std::size_t{7}, std::size_t{13}}) {
+    TestHandler handler;
+    shiguredo::mp4::reader::FragmentedDemuxer demuxer(&handler);
+    for (std::size_t i = 0; i < std::size(stream); i += chunk_size) {
+      demuxer.push(data + i, std::min(chunk_size, std::size(stream) - i));
+    }
+    BOOST_REQUIRE(demuxer.isAtBoxBoundary());
+    BOOST_REQUIRE_EQUAL(std::size(stream), demuxer.getReceivedSize());
+    BOOST_REQUIRE_EQUAL(1, std::size(handler.tracks));
+    BOOST_REQUIRE_EQUAL(1, handler.tracks[0].track_id);
+    BOOST_REQUIRE_EQUAL(90000, handler.tracks[0].timescale);
+    BOOST_REQUIRE_EQUAL("vide", handler.tracks[0].handler_type);
+
+    if (std::empty(expected)) {
+      BOOST_REQUIRE_EQUAL(5, std::size(handler.samples));
+      const std::vector<std::uint64_t> decode_times = {9000, 12000, 15000, 18000, 21000};
+      const std::vector<std::size_t> sizes = {4, 4, 4, 2, 3};
+      for (std::size_t i = 0; i < 5; ++i) {
+        const auto& sample = handler.samples[i];
+        BOOST_REQUIRE_EQUAL(decode_times[i], sample.decode_time);
+        BOOST_REQUIRE_EQUAL(3000, sample.duration);
+        BOOST_REQUIRE_EQUAL(i == 0, sample.is_key);
+        BOOST_REQUIRE_EQUAL(sizes[i], std::size(sample.data));
+        BOOST_REQUIRE_EQUAL(stream.substr(sample.offset, sizes[i]),
+                            std::string(std::begin(sample.data), std::end(sample.data)));
+      }
+      BOOST_REQUIRE_EQUAL(8, handler.samples[2].data[0]);
+      BOOST_REQUIRE_EQUAL(22, handler.samples[4].data[0]);
+      expected = handler.samples;
+    } else {
+      BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected), std::end(expected), std::begin(handler.samples),
+                                      std::end(handler.samples));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(fragmented_demuxer_errors) {
+  const auto stream = make_stream();
+  const auto data = reinterpret_cast<const std::uint8_t*>(stream.data());
+  {
+    // moov を受け取る前の moof
+    TestHandler handler;
+    shiguredo::mp4::reader::FragmentedDemuxer demuxer(&handler);
+    const auto moof_offset = stream.find("moof") - 4;
+    BOOST_REQUIRE_THROW(demuxer.push(data + moof_offset, std::size(stream) - moof_offset), std::runtime_error);
+  }
+  {
+    TestHandler handler;
+    shiguredo::mp4::reader::FragmentedDemuxer demuxer(&handler, {.max_box_size = 64});
+    BOOST_REQUIRE_THROW(demuxer.push(data, std::size(stream)), std::runtime_error);
+  }
+  {
+    // 途中までの Box
+    TestHandler handler;
+    shiguredo::mp4::reader::FragmentedDemuxer demuxer(&handler);
+    demuxer.push(data, 6);
+    BOOST_REQUIRE(!demuxer.isAtBoxBoundary());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
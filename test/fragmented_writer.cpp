@@ -0,0 +1,352 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/random_access.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/fragmented_writer.hpp"
+#include "test_track.hpp"
+
+BOOST_AUTO_TEST_SUITE(fragmented_writer)
+
+using test_track::TestTrack;
+
+namespace {
+
+// seekp() や tellp() に対応しない ostream の書き込み先
+class AppendOnlyStreamBuf : public std::streambuf {
+ public:
+  const std::string& getData() const { return m_data; }
+
+ protected:
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      m_data.push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+  }
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    m_data.append(s, static_cast<std::size_t>(n));
+    return n;
+  }
+
+ private:
+  std::string m_data;
+};
+
+// 40ms 毎のサンプル 50 個. 25 サンプル毎にキーフレーム. i 番目のサンプルのサイズは 10 + i
+void write_samples(shiguredo::mp4::writer::FragmentedWriter* writer, TestTrack* track) {
+  std::vector<std::uint8_t> data(100);
+  writer->writeFtypBox();
+  std::vector<shiguredo::mp4::track::Track*> tracks = {track};
+  writer->appendTrakAndUdtaBoxInfo(tracks);
+  writer->writeMoovBox();
+  for (std::uint64_t i = 0; i < 50; ++i) {
+    track->addData(i * 40, data.data(), 10 + i, i % 25 == 0);
+  }
+  writer->flush();
+}
+
+std::vector<std::string> get_types(const std::vector<shiguredo::mp4::BoxInfo*>& infos) {
+  std::vector<std::string> types;
+  for (const auto info : infos) {
+    types.push_back(info->getType().toString());
+  }
+  return types;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(fragmented_writer_chunks) {
+  AppendOnlyStreamBuf buf;
+  std::ostream os(&buf);
+  shiguredo::mp4::writer::FragmentedWriter writer(os, {.chunk_duration_ms = 200, .segment_duration_ms = 1000});
+  TestTrack track(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+
+  // 40ms 毎のサンプル 50 個. 25 サンプル毎にキーフレーム
+  std::vector<std::uint8_t> data(100);
+  for (std::size_t i = 0; i < std::size(data); ++i) {
+    data[i] = static_cast<std::uint8_t>(i);
+  }
+  writer.writeFtypBox();
+  for (std::uint64_t i = 0; i < 50; ++i) {
+    if (i == 7) {
+      // moov の前に完成した chunk は moov の後に書き込む
+      std::vector<shiguredo::mp4::track::Track*> tracks = {&track};
+      writer.appendTrakAndUdtaBoxInfo(tracks);
+      writer.writeMoovBox();
+    }
+    track.addData(i * 40, data.data() + i, 10 + i, i % 25 == 0);
+  }
+  writer.flush();
+  BOOST_REQUIRE_EQUAL(10, writer.getSequenceNumber());
+  BOOST_REQUIRE_EQUAL(2, writer.getSegmentCount());
+
+  std::stringstream ss(buf.getData());
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  const auto types = get_types(reader.getBoxInfos());
+  std::vector<std::string> expected = {"ftyp", "moov", "styp"};
+  for (std::size_t i = 0; i < 10; ++i) {
+    if (i == 5) {
+      expected.push_back("styp");
+    }
+    expected.push_back("moof");
+    expected.push_back("mdat");
+  }
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected), std::end(expected), std::begin(types), std::end(types));
+
+  // 最初の moof: 5 サンプルで, data_offset は mdat の payload の先頭を指す
+  const auto moof = reader.getBoxInfos()[3];
+  const auto mdat = reader.getBoxInfos()[4];
+  const auto trun = moof->getLeafs()[1]->getLeafs()[2];
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("trun") == trun->getType());
+  BOOST_REQUIRE_EQUAL(5, dynamic_cast<shiguredo::mp4::box::Trun*>(trun->getBox())->getSampleCount());
+  const auto trun_str = trun->getBox()->toStringOnlyData();
+  BOOST_REQUIRE(trun_str.find("DataOffset=" + std::to_string(moof->getSize() + 8)) != std::string::npos);
+  BOOST_REQUIRE_EQUAL(8 + 10 + 11 + 12 + 13 + 14, mdat->getSize());
+  const auto mdat_offset = mdat->getBox()->getOffset();
+  BOOST_REQUIRE_EQUAL(std::string(reinterpret_cast<const char*>(data.data()), 10),
+                      buf.getData().substr(mdat_offset + 8, 10));
+
+  // キーフレームで始まる chunk は先頭のサンプルのみ first_sample_flags を持ち, 残りは trex の既定値を使う
+  BOOST_REQUIRE(trun_str.find("FirstSampleFlags=0x2000000") != std::string::npos);
+  BOOST_REQUIRE(trun_str.find("SampleFlags=0x1010000") == std::string::npos);
+
+  // 最後の chunk の最後のサンプルの duration は直前のサンプルと同じにするので, duration は tfhd の既定値になる
+  const auto last_moof = reader.getBoxInfos()[std::size(reader.getBoxInfos()) - 2];
+  const auto last_tfhd = dynamic_cast<shiguredo::mp4::box::Tfhd*>(last_moof->getLeafs()[1]->getLeafs()[0]->getBox());
+  BOOST_REQUIRE(last_tfhd->getFlags() & shiguredo::mp4::box::TfhdDefaultSampleDurationPresent);
+  BOOST_REQUIRE_EQUAL(40, last_tfhd->getDefaultSampleDuration());
+  const auto last_trun_str = last_moof->getLeafs()[1]->getLeafs()[2]->getBox()->toStringOnlyData();
+  BOOST_REQUIRE(last_trun_str.find("SampleSize=59") != std::string::npos);
+  BOOST_REQUIRE(last_trun_str.find("SampleDuration=") == std::string::npos);
+
+  // init segment の mvex に trex を追加する
+  const auto moov = reader.getBoxInfos()[1];
+  bool has_trex = false;
+  for (const auto leaf : moov->getLeafs()) {
+    if (leaf->getType() == shiguredo::mp4::BoxType("mvex")) {
+      has_trex = leaf->getLeafs()[0]->getType() == shiguredo::mp4::BoxType("trex");
+    }
+  }
+  BOOST_REQUIRE(has_trex);
+}
+
+BOOST_AUTO_TEST_CASE(fragmented_writer_sidx_segment) {
+  AppendOnlyStreamBuf buf;
+  std::ostream os(&buf);
+  shiguredo::mp4::writer::FragmentedWriter writer(os, {.chunk_duration_ms = 200,
+                                                       .segment_duration_ms = 1000,
+                                                       .sidx_mode = shiguredo::mp4::writer::SidxMode::Segment});
+  TestTrack track(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  write_samples(&writer, &track);
+
+  std::stringstream ss(buf.getData());
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  const auto infos = reader.getBoxInfos();
+  const auto types = get_types(infos);
+  std::vector<std::string> expected = {"ftyp", "moov"};
+  for (std::size_t i = 0; i < 10; ++i) {
+    if (i % 5 == 0) {
+      expected.push_back("styp");
+      expected.push_back("sidx");
+    }
+    expected.push_back("moof");
+    expected.push_back("mdat");
+  }
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected), std::end(expected), std::begin(types), std::end(types));
+
+  // 2 番目のセグメントの sidx は moof 毎に参照を持ち, 参照の合計はセグメントの終わりまでになる
+  const auto sidx_info = infos[15];
+  const auto sidx = dynamic_cast<shiguredo::mp4::box::Sidx*>(sidx_info->getBox());
+  BOOST_REQUIRE_EQUAL(1, sidx->getReferenceID());
+  BOOST_REQUIRE_EQUAL(1000, sidx->getEarliestPresentationTime());
+  BOOST_REQUIRE_EQUAL(0, sidx->getFirstOffset());
+  const auto& references = sidx->getReferences();
+  BOOST_REQUIRE_EQUAL(5, std::size(references));
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < std::size(references); ++i) {
+    BOOST_REQUIRE_EQUAL(200, references[i].getSubsegmentDuration());
+    BOOST_REQUIRE_EQUAL(i == 0, references[i].getStartsWithSAP());
+    BOOST_REQUIRE_EQUAL(infos[16 + i * 2]->getSize() + infos[17 + i * 2]->getSize(), references[i].getReferenceSize());
+    total += references[i].getReferenceSize();
+  }
+  BOOST_REQUIRE_EQUAL(std::size(buf.getData()), sidx_info->getBox()->getOffset() + sidx_info->getSize() + total);
+}
+
+BOOST_AUTO_TEST_CASE(fragmented_writer_sidx_single) {
+  AppendOnlyStreamBuf buf;
+  std::ostream os(&buf);
+  shiguredo::mp4::writer::FragmentedWriter writer(os, {.chunk_duration_ms = 200,
+                                                       .segment_duration_ms = 1000,
+                                                       .sidx_mode = shiguredo::mp4::writer::SidxMode::Single});
+  TestTrack track(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  write_samples(&writer, &track);
+
+  std::stringstream ss(buf.getData());
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  const auto infos = reader.getBoxInfos();
+  BOOST_REQUIRE_EQUAL(3 + 2 + 20, std::size(infos));
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("sidx") == infos[2]->getType());
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("styp") == infos[3]->getType());
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("styp") == infos[14]->getType());
+
+  // セグメント毎の参照は styp から次の styp の直前までを指す
+  const auto sidx = dynamic_cast<shiguredo::mp4::box::Sidx*>(infos[2]->getBox());
+  BOOST_REQUIRE_EQUAL(0, sidx->getEarliestPresentationTime());
+  const auto& references = sidx->getReferences();
+  BOOST_REQUIRE_EQUAL(2, std::size(references));
+  BOOST_REQUIRE_EQUAL(infos[14]->getBox()->getOffset() - infos[3]->getBox()->getOffset(),
+                      references[0].getReferenceSize());
+  BOOST_REQUIRE_EQUAL(std::size(buf.getData()) - infos[14]->getBox()->getOffset(), references[1].getReferenceSize());
+  for (const auto& reference : references) {
+    BOOST_REQUIRE_EQUAL(1000, reference.getSubsegmentDuration());
+    BOOST_REQUIRE(reference.getStartsWithSAP());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(fragmented_writer_sidx_single_intermediate_file) {
+  AppendOnlyStreamBuf buf;
+  std::ostream os(&buf);
+  const auto segment_path_template = (std::filesystem::temp_directory_path() / "segmentXXXXXX").string();
+  std::filesystem::path segment_path;
+  {
+    shiguredo::mp4::writer::FragmentedWriter writer(os, {.chunk_duration_ms = 200,
+                                                         .segment_duration_ms = 1000,
+                                                         .sidx_mode = shiguredo::mp4::writer::SidxMode::Single,
+                                                         .segment_path_template = segment_path_template,
+                                                         .write_mfra = true});
+    segment_path = writer.getIntermediateFilePath();
+    BOOST_REQUIRE(std::filesystem::exists(segment_path));
+    TestTrack track(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+    write_samples(&writer, &track);
+  }
+  // 中間ファイルは FragmentedWriter の破棄時に削除する
+  BOOST_REQUIRE(!std::filesystem::exists(segment_path));
+
+  std::stringstream ss(buf.getData());
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  const auto infos = reader.getBoxInfos();
+  BOOST_REQUIRE_EQUAL(3 + 2 + 20 + 1, std::size(infos));
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("sidx") == infos[2]->getType());
+
+  // 中間ファイルから書き戻した moof の位置を tfra が指す
+  shiguredo::mp4::reader::RandomAccessIndex index(ss);
+  const auto first = index.seek(1, 0);
+  BOOST_REQUIRE(first.has_value());
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("moof") == infos[4]->getType());
+  BOOST_REQUIRE_EQUAL(infos[4]->getBox()->getOffset(), first->moof_offset);
+  const auto second = index.seek(1, 1000);
+  BOOST_REQUIRE(second.has_value());
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("moof") == infos[15]->getType());
+  BOOST_REQUIRE_EQUAL(infos[15]->getBox()->getOffset(), second->moof_offset);
+}
+
+BOOST_AUTO_TEST_CASE(fragmented_writer_mfra) {
+  AppendOnlyStreamBuf buf;
+  std::ostream os(&buf);
+  shiguredo::mp4::writer::FragmentedWriter writer(os, {.chunk_duration_ms = 200,
+                                                       .segment_duration_ms = 1000,
+                                                       .sidx_mode = shiguredo::mp4::writer::SidxMode::Segment,
+                                                       .write_mfra = true});
+  TestTrack track(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  write_samples(&writer, &track);
+
+  std::stringstream ss(buf.getData());
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  const auto infos = reader.getBoxInfos();
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("mfra") == infos.back()->getType());
+
+  // キーフレームを含む moof は各セグメントの最初の moof のみ
+  shiguredo::mp4::reader::RandomAccessIndex index(ss);
+  BOOST_REQUIRE_EQUAL(1, std::size(index.getTrackIDs()));
+  BOOST_REQUIRE_EQUAL(2, std::size(index.getPoints(1)));
+  const auto first = index.seek(1, 999);
+  BOOST_REQUIRE(first.has_value());
+  BOOST_REQUIRE_EQUAL(0, first->time);
+  BOOST_REQUIRE_EQUAL(infos[4]->getBox()->getOffset(), first->moof_offset);
+  BOOST_REQUIRE_EQUAL(1, first->sample_number);
+  const auto second = index.seek(1, 1500);
+  BOOST_REQUIRE(second.has_value());
+  BOOST_REQUIRE_EQUAL(1000, second->time);
+  BOOST_REQUIRE(shiguredo::mp4::BoxType("moof") == infos[16]->getType());
+  BOOST_REQUIRE_EQUAL(infos[16]->getBox()->getOffset(), second->moof_offset);
+  BOOST_REQUIRE(!index.seek(2, 0).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(fragmented_writer_audio) {
+  AppendOnlyStreamBuf buf;
+  std::ostream os(&buf);
+  shiguredo::mp4::writer::FragmentedWriter writer(os, {.chunk_duration_ms = 200,
+                                                       .segment_duration_ms = 1000,
+                                                       .sidx_mode = shiguredo::mp4::writer::SidxMode::Segment,
+                                                       .write_mfra = true});
+  TestTrack track(1, 48000, shiguredo::mp4::track::HandlerType::soun, &writer);
+  std::vector<std::uint8_t> data(5);
+  writer.writeFtypBox();
+  std::vector<shiguredo::mp4::track::Track*> tracks = {&track};
+  writer.appendTrakAndUdtaBoxInfo(tracks);
+  writer.writeMoovBox();
+  // 音声のサンプルは is_key が false でも同期サンプルとして書き込む
+  for (std::uint64_t i = 0; i < 100; ++i) {
+    track.addData(i * 960, data, false);
+  }
+  writer.flush();
+
+  std::stringstream ss(buf.getData());
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  std::size_t moof_count = 0;
+  for (const auto info : reader.getBoxInfos()) {
+    if (info->getType() == shiguredo::mp4::BoxType("sidx")) {
+      for (const auto& reference : dynamic_cast<shiguredo::mp4::box::Sidx*>(info->getBox())->getReferences()) {
+        BOOST_REQUIRE(reference.getStartsWithSAP());
+      }
+    }
+    if (info->getType() != shiguredo::mp4::BoxType("moof")) {
+      continue;
+    }
+    ++moof_count;
+    // trex の既定値が同期サンプルなので, tfhd と trun にサンプルの flags を書き込まない
+    const auto traf = info->getLeafs()[1];
+    BOOST_REQUIRE(!(traf->getLeafs()[0]->getBox()->getFlags() & shiguredo::mp4::box::TfhdDefaultSampleFlagsPresent));
+    const auto trun_flags = traf->getLeafs()[2]->getBox()->getFlags();
+    BOOST_REQUIRE(!(trun_flags & shiguredo::mp4::box::TrunFirstSampleFlagsPresent));
+    BOOST_REQUIRE(!(trun_flags & shiguredo::mp4::box::TrunSampleFlagsPresent));
+  }
+  BOOST_REQUIRE(moof_count > 1);
+
+  // 全ての moof が tfra の要素になる
+  shiguredo::mp4::reader::RandomAccessIndex index(ss);
+  BOOST_REQUIRE_EQUAL(moof_count, std::size(index.getPoints(1)));
+}
+
+BOOST_AUTO_TEST_CASE(random_access_index_without_mfra) {
+  AppendOnlyStreamBuf buf;
+  std::ostream os(&buf);
+  shiguredo::mp4::writer::FragmentedWriter writer(os, {});
+  TestTrack track(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  write_samples(&writer, &track);
+
+  std::stringstream ss(buf.getData());
+  BOOST_REQUIRE_THROW(shiguredo::mp4::reader::RandomAccessIndex index(ss), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,166 @@
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/reader/sample_index.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/fragmented_writer.hpp"
+#include "shiguredo/mp4/writer/progressive_remuxer.hpp"
+#include "test_track.hpp"
+
+BOOST_AUTO_TEST_SUITE(progressive_remuxer)
+
+using test_track::find_leaf;
+using test_track::TestTrack;
+using test_track::write_samples;
+
+namespace {
+
+// 映像: timescale 1000 で 40ms 毎のサンプル 50 個. 10 サンプル毎にキーフレーム
+// 音声: timescale 48000 で 20ms 毎のサンプル 100 個
+std::string make_fragmented_mp4() {
+  std::stringstream ss;
+  shiguredo::mp4::writer::FragmentedWriter writer(ss, {.chunk_duration_ms = 200, .segment_duration_ms = 400});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer);
+  writer.writeFtypBox();
+  std::vector<shiguredo::mp4::track::Track*> tracks = {&video, &audio};
+  writer.appendTrakAndUdtaBoxInfo(tracks);
+  writer.writeMoovBox();
+  write_samples(&video, &audio);
+  writer.flush();
+  return ss.str();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(progressive_remuxer_write) {
+  std::stringstream is(make_fragmented_mp4());
+  shiguredo::mp4::writer::ProgressiveRemuxer remuxer(is, {.copy_buffer_size = 16});
+  BOOST_REQUIRE_EQUAL(2, std::size(remuxer.getTracks()));
+  BOOST_REQUIRE_EQUAL(50, std::size(remuxer.getTracks()[0].samples));
+  BOOST_REQUIRE_EQUAL(100, std::size(remuxer.getTracks()[1].samples));
+
+  std::stringstream os;
+  remuxer.write(os);
+  const auto output = os.str();
+  BOOST_REQUIRE_EQUAL(remuxer.getOutputSize(), std::size(output));
+
+  std::stringstream ss(output);
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  std::vector<std::string> types;
+  for (const auto info : reader.getBoxInfos()) {
+    types.push_back(info->getType().toString());
+  }
+  const std::vector<std::string> expected = {"ftyp", "moov", "mdat"};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(types), std::end(types), std::begin(expected), std::end(expected));
+
+  auto moov = reader.getBoxInfos()[1];
+  BOOST_REQUIRE(find_leaf(moov, "mvex") == nullptr);
+  BOOST_REQUIRE_EQUAL(2000, dynamic_cast<shiguredo::mp4::box::Mvhd*>(find_leaf(moov, "mvhd")->getBox())->getDuration());
+
+  const auto tracks = shiguredo::mp4::reader::build_sample_indexes(moov);
+  BOOST_REQUIRE_EQUAL(2, std::size(tracks));
+  const auto& video = tracks[0];
+  BOOST_REQUIRE_EQUAL(1, video.track_id);
+  BOOST_REQUIRE_EQUAL(50, std::size(video.samples));
+  for (std::size_t i = 0; i < std::size(video.samples); ++i) {
+    const auto& sample = video.samples[i];
+    BOOST_REQUIRE_EQUAL(i * 40, sample.decode_time);
+    BOOST_REQUIRE_EQUAL(40, sample.duration);
+    BOOST_REQUIRE_EQUAL(i % 10 == 0, sample.is_key);
+    BOOST_REQUIRE_EQUAL(10 + i, sample.size);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(i), output[sample.offset]);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(i), output[sample.offset + sample.size - 1]);
+  }
+  const auto& audio = tracks[1];
+  BOOST_REQUIRE_EQUAL(2, audio.track_id);
+  BOOST_REQUIRE_EQUAL(100, std::size(audio.samples));
+  for (std::size_t i = 0; i < std::size(audio.samples); ++i) {
+    const auto& sample = audio.samples[i];
+    BOOST_REQUIRE_EQUAL(i * 960, sample.decode_time);
+    BOOST_REQUIRE_EQUAL(960, sample.duration);
+    BOOST_REQUIRE(sample.is_key);
+    BOOST_REQUIRE_EQUAL(5, sample.size);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(0x80 | i), output[sample.offset]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(progressive_remuxer_track_start_and_gap) {
+  // 音声は映像より 100ms 後に始まり, 20 番目から 24 番目のサンプルが欠けて fragment の間に空きがある
+  std::stringstream fragmented;
+  shiguredo::mp4::writer::FragmentedWriter writer(fragmented, {.chunk_duration_ms = 200, .segment_duration_ms = 400});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer);
+  writer.writeFtypBox();
+  std::vector<shiguredo::mp4::track::Track*> tracks = {&video, &audio};
+  writer.appendTrakAndUdtaBoxInfo(tracks);
+  writer.writeMoovBox();
+  std::vector<std::uint8_t> data(5);
+  for (std::uint64_t i = 0; i < 50; ++i) {
+    video.addData(i * 40, data, i % 10 == 0);
+    if (i < 20 || i >= 25) {
+      audio.addData(4800 + i * 960, data, true);
+    }
+  }
+  writer.flush();
+
+  std::stringstream is(fragmented.str());
+  shiguredo::mp4::writer::ProgressiveRemuxer remuxer(is);
+  std::stringstream os;
+  remuxer.write(os);
+  shiguredo::mp4::reader::SimpleReader reader(os);
+  reader.parse();
+  auto moov = reader.getBoxInfos()[1];
+  BOOST_REQUIRE_EQUAL(2000, dynamic_cast<shiguredo::mp4::box::Mvhd*>(find_leaf(moov, "mvhd")->getBox())->getDuration());
+
+  std::vector<shiguredo::mp4::BoxInfo*> traks;
+  for (const auto leaf : moov->getLeafs()) {
+    if (leaf->getType() == shiguredo::mp4::BoxType("trak")) {
+      traks.push_back(leaf);
+    }
+  }
+  BOOST_REQUIRE_EQUAL(2, std::size(traks));
+  BOOST_REQUIRE(find_leaf(traks[0], "edts") == nullptr);
+  const auto audio_trak = traks[1];
+  BOOST_REQUIRE_EQUAL(1100,
+                      dynamic_cast<shiguredo::mp4::box::Tkhd*>(find_leaf(audio_trak, "tkhd")->getBox())->getDuration());
+  const auto elst = find_leaf(find_leaf(audio_trak, "edts"), "elst");
+  const auto& entries = dynamic_cast<shiguredo::mp4::box::Elst*>(elst->getBox())->getEntries();
+  BOOST_REQUIRE_EQUAL(2, std::size(entries));
+  BOOST_REQUIRE_EQUAL(100, entries[0].m_track_duration);
+  BOOST_REQUIRE_EQUAL(-1, entries[0].m_media_time);
+  BOOST_REQUIRE_EQUAL(1000, entries[1].m_track_duration);
+  BOOST_REQUIRE_EQUAL(0, entries[1].m_media_time);
+
+  // 欠けたサンプルの分は直前のサンプルの duration になり, 以降のサンプルの decode time は元のファイルと同じ間隔になる
+  const auto indexes = shiguredo::mp4::reader::build_sample_indexes(moov);
+  const auto& audio_samples = indexes[1].samples;
+  BOOST_REQUIRE_EQUAL(45, std::size(audio_samples));
+  BOOST_REQUIRE_EQUAL(960 * 6, audio_samples[19].duration);
+  BOOST_REQUIRE_EQUAL(960 * 25, audio_samples[20].decode_time);
+  BOOST_REQUIRE_EQUAL(960 * 49, audio_samples[44].decode_time);
+}
+
+BOOST_AUTO_TEST_CASE(progressive_remuxer_without_moov) {
+  std::stringstream ss;
+  shiguredo::mp4::BoxInfo ftyp({.box = new shiguredo::mp4::box::Ftyp({.major_brand = shiguredo::mp4::BrandIsom,
+                                                                      .minor_version = 0,
+                                                                      .compatible_brands = {}})});
+  ftyp.adjustOffsetAndSize(0);
+  ftyp.write(ss);
+  BOOST_REQUIRE_THROW(shiguredo::mp4::writer::ProgressiveRemuxer(ss, {}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
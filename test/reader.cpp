@@ -0,0 +1,404 @@
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <fmt/core.h>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/box_filter.hpp"
+#include "shiguredo/mp4/reader/box_iterator.hpp"
+#include "shiguredo/mp4/reader/dump.hpp"
+#include "shiguredo/mp4/reader/probe.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/stream/stream.hpp"
+
+BOOST_AUTO_TEST_SUITE(reader)
+
+namespace {
+
+void write_test_mp4(std::ostream& os, const std::size_t trak_count = 1) {
+  shiguredo::mp4::BoxInfo ftyp({.box = new shiguredo::mp4::box::Free({.data = {0x00, 0x01}})});
+  std::uint64_t offset = ftyp.adjustOffsetAndSize(0);
+  ftyp.write(os);
+
+  shiguredo::mp4::BoxInfo moov({.box = new shiguredo::mp4::box::Moov()});
+  new shiguredo::mp4::BoxInfo(
+      {.parent = &moov,
+       .box = new shiguredo::mp4::box::Mvhd(
+           {.creation_time = 0, .modification_time = 0, .timescale = 1000, .duration = 3000, .next_track_id = 2})});
+  for (std::size_t i = 0; i < trak_count; ++i) {
+    auto trak = new shiguredo::mp4::BoxInfo({.parent = &moov, .box = new shiguredo::mp4::box::Trak()});
+    auto mdia = new shiguredo::mp4::BoxInfo({.parent = trak, .box = new shiguredo::mp4::box::Mdia()});
+    new shiguredo::mp4::BoxInfo(
+        {.parent = mdia,
+         .box = new shiguredo::mp4::box::Mdhd(
+             {.creation_time = 0, .modification_time = 0, .timescale = 48000, .duration = 144000})});
+    auto minf = new shiguredo::mp4::BoxInfo({.parent = mdia, .box = new shiguredo::mp4::box::Minf()});
+    auto stbl = new shiguredo::mp4::BoxInfo({.parent = minf, .box = new shiguredo::mp4::box::Stbl()});
+    new shiguredo::mp4::BoxInfo(
+        {.parent = stbl,
+         .box = new shiguredo::mp4::box::Stsz(
+             {.entry_sizes = std::vector<std::uint32_t>(100, static_cast<std::uint32_t>(10 + i))})});
+  }
+  offset += moov.adjustOffsetAndSize(offset);
+  moov.write(os);
+
+  shiguredo::mp4::BoxInfo mdat({.box = new shiguredo::mp4::box::Mdat({.data = std::vector<std::uint8_t>(1000, 0)})});
+  mdat.adjustOffsetAndSize(offset);
+  mdat.write(os);
+}
+
+std::vector<std::string> collect_paths(const std::vector<shiguredo::mp4::BoxInfo*>& infos) {
+  std::vector<std::string> paths;
+  std::function<void(const shiguredo::mp4::BoxInfo*)> collect = [&](const shiguredo::mp4::BoxInfo* info) {
+    std::string path;
+    for (const auto& type : info->getPath()) {
+      path += (std::empty(path) ? "" : "/") + type.toString();
+    }
+    paths.push_back(path);
+    for (const auto leaf : info->getLeafs()) {
+      collect(leaf);
+    }
+  };
+  for (const auto info : infos) {
+    collect(info);
+  }
+  return paths;
+}
+
+}  // namespace
+
+struct BoxFilterTestCase {
+  const std::string name;
+  const shiguredo::mp4::reader::BoxFilterParameters params;
+  const std::vector<std::string> expected;
+};
+
+BoxFilterTestCase box_filter_test_cases[] = {
+    {
+        "no filter",
+        {},
+        {"free", "moov", "moov/mvhd", "moov/trak", "moov/trak/mdia", "moov/trak/mdia/mdhd", "moov/trak/mdia/minf",
+         "moov/trak/mdia/minf/stbl", "moov/trak/mdia/minf/stbl/stsz", "mdat"},
+    },
+    {
+        "allow paths",
+        {.allow_paths = {shiguredo::mp4::reader::parse_box_path("moov/mvhd"),
+                         shiguredo::mp4::reader::parse_box_path("moov/*/mdia/mdhd")}},
+        {"moov", "moov/mvhd", "moov/trak", "moov/trak/mdia", "moov/trak/mdia/mdhd"},
+    },
+    {
+        "allow subtree",
+        {.allow_paths = {shiguredo::mp4::reader::parse_box_path("moov/trak/mdia")}},
+        {"moov", "moov/trak", "moov/trak/mdia", "moov/trak/mdia/mdhd", "moov/trak/mdia/minf",
+         "moov/trak/mdia/minf/stbl", "moov/trak/mdia/minf/stbl/stsz"},
+    },
+    {
+        "deny types",
+        {.deny_types = {shiguredo::mp4::BoxType("mdat"), shiguredo::mp4::BoxType("stbl")}},
+        {"free", "moov", "moov/mvhd", "moov/trak", "moov/trak/mdia", "moov/trak/mdia/mdhd", "moov/trak/mdia/minf"},
+    },
+    {
+        "max depth",
+        {.max_depth = 2},
+        {"free", "moov", "moov/mvhd", "moov/trak", "mdat"},
+    },
+};
+
+BOOST_AUTO_TEST_CASE(box_filter) {
+  for (const auto& tc : box_filter_test_cases) {
+    BOOST_TEST_MESSAGE(tc.name);
+    std::stringstream ss;
+    write_test_mp4(ss);
+    shiguredo::mp4::reader::SimpleReader reader(ss, {.filter = shiguredo::mp4::reader::BoxFilter(tc.params)});
+    reader.parse();
+    const auto actual = collect_paths(reader.getBoxInfos());
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(tc.expected), std::end(tc.expected), std::begin(actual),
+                                    std::end(actual));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parse_box_path) {
+  const shiguredo::mp4::BoxPath expected = {shiguredo::mp4::BoxType("moov"), shiguredo::mp4::box_type_any(),
+                                            shiguredo::mp4::BoxType("mdhd")};
+  BOOST_REQUIRE(expected == shiguredo::mp4::reader::parse_box_path("moov/*/mdhd"));
+  BOOST_REQUIRE(expected == shiguredo::mp4::reader::parse_box_path("/moov/*/mdhd/"));
+  BOOST_REQUIRE_THROW(shiguredo::mp4::reader::parse_box_path("moov/trak1"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_trak) {
+  std::stringstream ss;
+  write_test_mp4(ss, 8);
+  const auto data = ss.str();
+  std::stringstream sequential_ss(data);
+  shiguredo::mp4::reader::SimpleReader sequential_reader(sequential_ss);
+  sequential_reader.parse();
+  std::vector<std::string> expected;
+  for (const auto info : sequential_reader.getBoxInfos()) {
+    expected.push_back(info->toString());
+  }
+  BOOST_REQUIRE_EQUAL(3, std::size(expected));
+
+  const std::vector<std::size_t> thread_counts = {2, 4, 16};
+  for (const auto thread_count : thread_counts) {
+    BOOST_TEST_MESSAGE(thread_count);
+    std::stringstream parallel_ss(data);
+    shiguredo::mp4::reader::SimpleReader reader(parallel_ss, {.thread_count = thread_count});
+    reader.parse();
+    std::vector<std::string> actual;
+    for (const auto info : reader.getBoxInfos()) {
+      actual.push_back(info->toString());
+    }
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected), std::end(expected), std::begin(actual), std::end(actual));
+    const auto paths = collect_paths(reader.getBoxInfos());
+    BOOST_REQUIRE_EQUAL(3 + 8 * 6 + 1, std::size(paths));
+    BOOST_REQUIRE_EQUAL("moov/trak/mdia/minf/stbl/stsz", paths[std::size(paths) - 2]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parallel_corrupt_moov) {
+  // largesize が 0 の子と, moov の末尾を越える子
+  const std::vector<std::vector<std::uint8_t>> children = {
+      {0x00, 0x00, 0x00, 0x01, 'f', 'r', 'e', 'e', 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x00, 0x00, 0x00, 0x20, 'f', 'r', 'e', 'e', 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  };
+  for (const auto& child : children) {
+    std::vector<std::uint8_t> bin = {0x00, 0x00, 0x00, 0x18, 'm', 'o', 'o', 'v'};
+    bin.insert(std::end(bin), std::begin(child), std::end(child));
+    std::stringstream ss;
+    ss.write(reinterpret_cast<const char*>(bin.data()), static_cast<std::streamsize>(std::size(bin)));
+    shiguredo::mp4::reader::SimpleReader reader(ss, {.thread_count = 2});
+    BOOST_REQUIRE_THROW(reader.parse(), std::runtime_error);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bounded_stream_buf) {
+  std::string data(10000, '\0');
+  for (std::size_t i = 0; i < std::size(data); ++i) {
+    data[i] = static_cast<char>(i % 251);
+  }
+  std::stringstream source(data);
+  // 内部のバッファーより大きい範囲を読む
+  shiguredo::mp4::stream::BoundedStreamBuf buf(source.rdbuf(), 100, 5000);
+  std::istream is(&buf);
+  is.seekg(10, std::ios_base::beg);
+  BOOST_REQUIRE_EQUAL(4990, shiguredo::mp4::stream::get_istream_offset_to_end(is));
+  BOOST_REQUIRE_EQUAL(10, is.tellg());
+  std::string actual(4990, '\0');
+  is.read(actual.data(), static_cast<std::streamsize>(std::size(actual)));
+  BOOST_REQUIRE(is.good());
+  BOOST_REQUIRE(data.substr(110, 4990) == actual);
+  // 範囲の末尾で EOF になる
+  BOOST_REQUIRE_EQUAL(std::char_traits<char>::eof(), is.get());
+
+  is.clear();
+  is.seekg(4095, std::ios_base::beg);
+  BOOST_REQUIRE_EQUAL(data[100 + 4095], static_cast<char>(is.get()));
+  BOOST_REQUIRE_EQUAL(data[100 + 4096], static_cast<char>(is.get()));
+  BOOST_REQUIRE_EQUAL(4097, is.tellg());
+}
+
+BOOST_AUTO_TEST_CASE(box_iterator) {
+  std::stringstream ss;
+  write_test_mp4(ss);
+  shiguredo::mp4::reader::BoxIterator iterator(ss);
+  shiguredo::mp4::reader::BoxEvent event;
+  std::vector<std::string> events;
+  while (iterator.next(&event)) {
+    const auto sign = event.type == shiguredo::mp4::reader::BoxEventType::Enter ? "+" : "-";
+    events.push_back(fmt::format("{}{}{}", sign, event.depth, event.header->getType().toString()));
+    if (event.type == shiguredo::mp4::reader::BoxEventType::Enter &&
+        event.header->getType() == shiguredo::mp4::BoxType("minf")) {
+      iterator.skip();
+    }
+  }
+  const std::vector<std::string> expected = {"+1free", "-1free", "+1moov", "+2mvhd", "-2mvhd", "+2trak",
+                                             "+3mdia", "+4mdhd", "-4mdhd", "+4minf", "-4minf", "-3mdia",
+                                             "-2trak", "-1moov", "+1mdat", "-1mdat"};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected), std::end(expected), std::begin(events), std::end(events));
+  BOOST_REQUIRE(!iterator.next(&event));
+}
+
+namespace {
+
+class MdhdVisitor : public shiguredo::mp4::reader::BoxVisitor {
+ public:
+  shiguredo::mp4::reader::VisitResult onEnter(shiguredo::mp4::reader::BoxIterator* iterator,
+                                              const shiguredo::mp4::reader::BoxEvent& event) override {
+    ++entered;
+    if (event.header->getType() == shiguredo::mp4::BoxType("mdat")) {
+      return shiguredo::mp4::reader::VisitResult::Skip;
+    }
+    if (event.header->getType() == shiguredo::mp4::BoxType("mdhd")) {
+      path = iterator->getPath();
+      mdhd.reset(iterator->parse());
+      return shiguredo::mp4::reader::VisitResult::Stop;
+    }
+    return shiguredo::mp4::reader::VisitResult::Continue;
+  }
+
+  int entered = 0;
+  shiguredo::mp4::BoxPath path;
+  std::unique_ptr<shiguredo::mp4::Box> mdhd;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(visit_boxes) {
+  std::stringstream ss;
+  write_test_mp4(ss);
+  MdhdVisitor visitor;
+  BOOST_REQUIRE(!shiguredo::mp4::reader::visit_boxes(ss, &visitor));
+  BOOST_REQUIRE_EQUAL(6, visitor.entered);
+  BOOST_REQUIRE(shiguredo::mp4::reader::parse_box_path("moov/trak/mdia/mdhd") == visitor.path);
+  BOOST_REQUIRE(visitor.mdhd);
+  BOOST_REQUIRE(visitor.mdhd->getType() == shiguredo::mp4::BoxType("mdhd"));
+  BOOST_REQUIRE_NE(std::string::npos, visitor.mdhd->toStringOnlyData().find("Timescale=48000"));
+}
+
+BOOST_AUTO_TEST_CASE(box_iterator_corrupt) {
+  std::stringstream ss;
+  write_test_mp4(ss);
+  auto data = ss.str();
+  // moov の size を壊す
+  data[10] = static_cast<char>(0x7f);
+  std::stringstream corrupt(data);
+  shiguredo::mp4::reader::BoxIterator iterator(corrupt);
+  shiguredo::mp4::reader::BoxEvent event;
+  BOOST_REQUIRE(iterator.next(&event));
+  BOOST_REQUIRE(iterator.next(&event));
+  BOOST_REQUIRE_THROW(iterator.next(&event), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(box_iterator_wave) {
+  const auto append_header = [](std::string* data, const std::uint32_t size, const std::string& type) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      data->push_back(static_cast<char>((size >> shift) & 0xff));
+    }
+    data->append(type);
+  };
+  // wave の中の mp4a は QuickTime のデータのみを持ち, 子の Box を持たない
+  // mp4a のフィールドとして読むと 28 byte の後ろに junk という子の Box があるように見える
+  std::string data;
+  append_header(&data, 8 + 28 + 8 + 8 + 36, "mp4a");
+  data.append(28, '\0');
+  append_header(&data, 8 + 8 + 36, "wave");
+  append_header(&data, 8 + 36, "mp4a");
+  data.append(28, '\0');
+  append_header(&data, 8, "junk");
+
+  std::stringstream ss(data);
+  shiguredo::mp4::reader::BoxIterator iterator(ss);
+  shiguredo::mp4::reader::BoxEvent event;
+  std::vector<std::string> events;
+  while (iterator.next(&event)) {
+    const auto sign = event.type == shiguredo::mp4::reader::BoxEventType::Enter ? "+" : "-";
+    events.push_back(fmt::format("{}{}{}", sign, event.depth, event.header->getType().toString()));
+  }
+  const std::vector<std::string> expected = {"+1mp4a", "+2wave", "+3mp4a", "-3mp4a", "-2wave", "-1mp4a"};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected), std::end(expected), std::begin(events), std::end(events));
+
+  // SimpleReader と同じ位置に子の Box を見つける
+  std::stringstream is(data);
+  shiguredo::mp4::reader::SimpleReader reader(is);
+  reader.parse();
+  const auto paths = collect_paths(reader.getBoxInfos());
+  const std::vector<std::string> expected_paths = {"mp4a", "mp4a/wave", "mp4a/wave/mp4a"};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected_paths), std::end(expected_paths), std::begin(paths),
+                                  std::end(paths));
+}
+
+BOOST_AUTO_TEST_CASE(probe) {
+  std::stringstream ss;
+  write_test_mp4(ss, 2);
+  const auto result = shiguredo::mp4::reader::probe(ss);
+  BOOST_REQUIRE(std::empty(result.error));
+  BOOST_REQUIRE_EQUAL(ss.str().size(), result.file_size);
+  BOOST_REQUIRE_EQUAL(1000, result.timescale);
+  BOOST_REQUIRE_EQUAL(3000, result.duration);
+  BOOST_REQUIRE_EQUAL(result.file_size * 8 / 3, result.getBitrate());
+  BOOST_REQUIRE(!result.is_fragmented);
+  BOOST_REQUIRE_EQUAL(2, std::size(result.tracks));
+  for (const auto& track : result.tracks) {
+    BOOST_REQUIRE_EQUAL(48000, track.timescale);
+    BOOST_REQUIRE_EQUAL(144000, track.duration);
+    BOOST_REQUIRE_EQUAL(100, track.sample_count);
+  }
+
+  // moov の size を壊しても, 例外は送出せずにエラーを返す
+  auto data = ss.str();
+  data[10] = static_cast<char>(0x7f);
+  std::stringstream corrupt(data);
+  const auto corrupt_result = shiguredo::mp4::reader::probe(corrupt);
+  BOOST_REQUIRE(!std::empty(corrupt_result.error));
+  BOOST_REQUIRE_EQUAL(0, std::size(corrupt_result.tracks));
+}
+
+BOOST_AUTO_TEST_CASE(dump_text) {
+  std::stringstream ss;
+  write_test_mp4(ss);
+  const auto data = ss.str();
+
+  std::stringstream tree_ss(data);
+  shiguredo::mp4::reader::SimpleReader reader(tree_ss);
+  reader.parse();
+  const auto moov = reader.getBoxInfos()[1]->toString();
+
+  std::stringstream is(data);
+  std::stringstream os;
+  shiguredo::mp4::reader::dump(is, os);
+  const auto text = os.str();
+  BOOST_REQUIRE_NE(std::string::npos, text.find(moov + "\n"));
+  const auto mdat = "[mdat] Offset=" + std::to_string(data.size() - 1008) + " Size=1008\n";
+  BOOST_REQUIRE_NE(std::string::npos, text.find(mdat));
+
+  std::stringstream truncated_is(data);
+  std::stringstream truncated_os;
+  shiguredo::mp4::reader::dump(truncated_is, truncated_os, {.max_entries = 3});
+  BOOST_REQUIRE_NE(std::string::npos,
+                   truncated_os.str().find("SampleCount=100 EntrySizes=[10, 10, 10, ... 97 more]\n"));
+
+  // 要素の多い Box は文字列を作る時点で省略する
+  const shiguredo::mp4::box::Stsz stsz({.entry_sizes = std::vector<std::uint32_t>(100, 10)});
+  BOOST_REQUIRE_EQUAL("Version=0 Flags=0x000000 SampleSize=0 SampleCount=100 EntrySizes=[10, 10, ... 98 more]",
+                      stsz.toStringOnlyDataWithMaxEntries(2));
+  BOOST_REQUIRE_EQUAL(stsz.toStringOnlyData(), stsz.toStringOnlyDataWithMaxEntries(100));
+  BOOST_REQUIRE_EQUAL(stsz.toStringOnlyData(), stsz.toStringOnlyDataWithMaxEntries(0));
+}
+
+BOOST_AUTO_TEST_CASE(escape_json) {
+  BOOST_REQUIRE_EQUAL(R"(a\"b\\c\n\r\t\u0001)", shiguredo::mp4::reader::escape_json("a\"b\\c\n\r\t\x01"));
+  // UTF-8 の文字はそのまま書き出す
+  const std::string utf8 = "\xe3\x81\x82/\xf0\x9f\x8e\xa5";
+  BOOST_REQUIRE_EQUAL(utf8, shiguredo::mp4::reader::escape_json(utf8));
+  // UTF-8 として不正なバイトはバイト毎に \u00XX にする
+  BOOST_REQUIRE_EQUAL(R"(\u00ff\u00e3\u0081a\u00c0\u00af\u00ed\u00a0\u0080)",
+                      shiguredo::mp4::reader::escape_json("\xff\xe3\x81" "a\xc0\xaf\xed\xa0\x80"));
+}
+
+BOOST_AUTO_TEST_CASE(dump_json) {
+  std::stringstream ss;
+  write_test_mp4(ss);
+  std::stringstream os;
+  shiguredo::mp4::reader::dump(ss, os, {.format = shiguredo::mp4::reader::DumpFormat::JSON, .max_entries = 2});
+  const auto json = os.str();
+  BOOST_TEST_MESSAGE(json);
+  BOOST_REQUIRE_EQUAL('[', json.front());
+  BOOST_REQUIRE_NE(std::string::npos, json.find(R"({"type":"moov","offset":10,)"));
+  BOOST_REQUIRE_NE(std::string::npos, json.find(R"("Timescale":48000,"Duration":144000,)"));
+  BOOST_REQUIRE_NE(std::string::npos,
+                   json.find(R"("SampleCount":100,"EntrySizes":[10,10,"... 98 more"]},"children":[]})"));
+  BOOST_REQUIRE_NE(std::string::npos, json.find(R"({"type":"mdat","offset":)"));
+  BOOST_REQUIRE_EQUAL("]\n", json.substr(json.size() - 2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
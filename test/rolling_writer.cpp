@@ -0,0 +1,249 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/reader/sample_index.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/rolling_writer.hpp"
+#include "test_track.hpp"
+
+BOOST_AUTO_TEST_SUITE(rolling_writer)
+
+using test_track::find_leaf;
+using test_track::find_moov;
+using test_track::TestTrack;
+using test_track::write_samples;
+
+BOOST_AUTO_TEST_CASE(rolling_writer_segments) {
+  // stringstream は末尾より後ろに seekp() できないため, 十分な大きさの領域を上書きする
+  std::array<std::stringstream, 2> streams = {std::stringstream(std::string(4096, '\0')),
+                                              std::stringstream(std::string(4096, '\0'))};
+  std::array<std::size_t, 2> sizes = {0, 0};
+  shiguredo::mp4::writer::RollingWriter writer(
+      {.segment_duration_ms = 1000,
+       .open_segment = [&streams](const std::uint64_t index) -> std::ostream* {
+         return index < std::size(streams) ? &streams[index] : nullptr;
+       },
+       .on_segment_finished =
+           [&streams, &sizes](const std::uint64_t index) {
+             sizes[index] = static_cast<std::size_t>(streams[index].tellp());
+           }});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer);
+  std::vector<shiguredo::mp4::track::Track*> tracks = {&audio, &video};
+  writer.setTracks(tracks);
+  writer.writeFtypBox();
+  write_samples(&video, &audio);
+  // 1000ms を超えた後の最初のキーフレームの 1200ms で切り替わる
+  BOOST_REQUIRE_EQUAL(1, writer.getSegmentIndex());
+  writer.appendTrakAndUdtaBoxInfo(tracks);
+  writer.writeMoovBox();
+
+  // 1 つ目のセグメントは映像 30 サンプル, 音声 60 サンプル. 2 つ目は残り
+  const std::array<std::size_t, 2> video_counts = {30, 20};
+  const std::array<std::size_t, 2> audio_counts = {60, 40};
+  const std::array<std::uint64_t, 2> durations = {1200, 800};
+  for (std::size_t s = 0; s < 2; ++s) {
+    BOOST_REQUIRE(sizes[s] > 0);
+    const auto output = streams[s].str().substr(0, sizes[s]);
+    std::stringstream is(output);
+    shiguredo::mp4::reader::SimpleReader reader(is);
+    reader.parse();
+    BOOST_REQUIRE_EQUAL("ftyp", reader.getBoxInfos().front()->getType().toString());
+    BOOST_REQUIRE_EQUAL("moov", reader.getBoxInfos().back()->getType().toString());
+    auto moov = find_moov(&reader);
+    auto mvhd = dynamic_cast<shiguredo::mp4::box::Mvhd*>(moov->getLeafs()[0]->getBox());
+    BOOST_REQUIRE_EQUAL(durations[s], mvhd->getDuration());
+
+    const auto indexes = shiguredo::mp4::reader::build_sample_indexes(moov);
+    BOOST_REQUIRE_EQUAL(2, std::size(indexes));
+    const auto& audio_index = indexes[0];
+    const auto& video_index = indexes[1];
+    BOOST_REQUIRE_EQUAL(audio_counts[s], std::size(audio_index.samples));
+    BOOST_REQUIRE_EQUAL(video_counts[s], std::size(video_index.samples));
+    // サンプルの時刻はセグメントの先頭を 0 とする
+    const std::size_t video_first = s == 0 ? 0 : video_counts[0];
+    for (std::size_t i = 0; i < std::size(video_index.samples); ++i) {
+      const auto& sample = video_index.samples[i];
+      const auto n = video_first + i;
+      BOOST_REQUIRE_EQUAL(i * 40, sample.decode_time);
+      BOOST_REQUIRE_EQUAL(40, sample.duration);
+      BOOST_REQUIRE_EQUAL(n % 10 == 0, sample.is_key);
+      BOOST_REQUIRE_EQUAL(10 + n, sample.size);
+      BOOST_REQUIRE_EQUAL(static_cast<char>(n), output[sample.offset]);
+      BOOST_REQUIRE_EQUAL(static_cast<char>(n), output[sample.offset + sample.size - 1]);
+    }
+    const std::size_t audio_first = s == 0 ? 0 : audio_counts[0];
+    for (std::size_t i = 0; i < std::size(audio_index.samples); ++i) {
+      const auto& sample = audio_index.samples[i];
+      BOOST_REQUIRE_EQUAL(i * 960, sample.decode_time);
+      BOOST_REQUIRE_EQUAL(960, sample.duration);
+      BOOST_REQUIRE_EQUAL(static_cast<char>(0x80 | (audio_first + i)), output[sample.offset]);
+    }
+  }
+}
+
+namespace {
+
+struct ElstTestCase {
+  const std::string name;
+  const std::uint64_t video_offset_ms;
+  const std::uint64_t audio_offset_ms;
+  const std::uint64_t duration;
+  // 2 つ目のセグメントの音声の elst の {track_duration, media_time}
+  const std::vector<std::pair<std::uint64_t, std::int64_t>> audio_edits;
+};
+
+ElstTestCase elst_test_cases[] = {
+    {"audio starts after the cut", 0, 10, 810, {{10, -1}, {800, 0}}},
+    {"audio starts before the cut", 10, 0, 800, {{790, 480}}},
+};
+
+std::vector<std::pair<std::uint64_t, std::int64_t>> get_edits(shiguredo::mp4::BoxInfo* trak) {
+  auto edts = find_leaf(trak, "edts");
+  BOOST_REQUIRE(edts != nullptr);
+  auto elst = dynamic_cast<shiguredo::mp4::box::Elst*>(find_leaf(edts, "elst")->getBox());
+  std::vector<std::pair<std::uint64_t, std::int64_t>> edits;
+  for (const auto& entry : elst->getEntries()) {
+    edits.emplace_back(entry.m_track_duration, entry.m_media_time);
+  }
+  return edits;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(rolling_writer_unaligned_audio) {
+  for (const auto& tc : elst_test_cases) {
+    BOOST_TEST_MESSAGE(tc.name);
+    std::array<std::stringstream, 2> streams = {std::stringstream(std::string(4096, '\0')),
+                                                std::stringstream(std::string(4096, '\0'))};
+    std::array<std::size_t, 2> sizes = {0, 0};
+    shiguredo::mp4::writer::RollingWriter writer(
+        {.segment_duration_ms = 1000,
+         .open_segment = [&streams](const std::uint64_t index) -> std::ostream* {
+           return index < std::size(streams) ? &streams[index] : nullptr;
+         },
+         .on_segment_finished =
+             [&streams, &sizes](const std::uint64_t index) {
+               sizes[index] = static_cast<std::size_t>(streams[index].tellp());
+             }});
+    TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer, {.with_edts = true});
+    TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer, {.with_edts = true});
+    std::vector<shiguredo::mp4::track::Track*> tracks = {&audio, &video};
+    writer.setTracks(tracks);
+    writer.writeFtypBox();
+    // write_samples() と同じ順で, 映像と音声の時刻をずらして書き込む
+    for (std::uint64_t c = 0; c < 10; ++c) {
+      for (std::uint64_t i = c * 5; i < c * 5 + 5; ++i) {
+        video.addData(i * 40 + tc.video_offset_ms, std::vector<std::uint8_t>(10, 0), i % 10 == 0);
+      }
+      video.terminateCurrentChunk();
+      for (std::uint64_t i = c * 10; i < c * 10 + 10; ++i) {
+        audio.addData((i * 20 + tc.audio_offset_ms) * 48, std::vector<std::uint8_t>(5, 0), true);
+      }
+      audio.terminateCurrentChunk();
+    }
+    BOOST_REQUIRE_EQUAL(1, writer.getSegmentIndex());
+    writer.appendTrakAndUdtaBoxInfo(tracks);
+    writer.writeMoovBox();
+
+    // 2 つ目のセグメントは映像の 30 番目のサンプルの時刻を先頭とし, 音声の先頭とのずれを elst で表す
+    BOOST_REQUIRE(sizes[1] > 0);
+    std::stringstream is(streams[1].str().substr(0, sizes[1]));
+    shiguredo::mp4::reader::SimpleReader reader(is);
+    reader.parse();
+    auto moov = find_moov(&reader);
+    BOOST_REQUIRE_EQUAL(tc.duration,
+                        dynamic_cast<shiguredo::mp4::box::Mvhd*>(moov->getLeafs()[0]->getBox())->getDuration());
+    const auto audio_edits = get_edits(moov->getLeafs()[1]);
+    BOOST_REQUIRE_EQUAL(std::size(tc.audio_edits), std::size(audio_edits));
+    for (std::size_t i = 0; i < std::size(audio_edits); ++i) {
+      BOOST_REQUIRE_EQUAL(tc.audio_edits[i].first, audio_edits[i].first);
+      BOOST_REQUIRE_EQUAL(tc.audio_edits[i].second, audio_edits[i].second);
+    }
+    const auto video_edits = get_edits(moov->getLeafs()[2]);
+    BOOST_REQUIRE_EQUAL(1, std::size(video_edits));
+    BOOST_REQUIRE_EQUAL(800, video_edits[0].first);
+    BOOST_REQUIRE_EQUAL(0, video_edits[0].second);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rolling_writer_batched_samples) {
+  std::array<std::stringstream, 5> streams;
+  std::array<std::size_t, 5> sizes = {};
+  for (auto& s : streams) {
+    s.str(std::string(4096, '\0'));
+  }
+  shiguredo::mp4::writer::RollingWriter writer(
+      {.segment_duration_ms = 400,
+       .open_segment = [&streams](const std::uint64_t index) -> std::ostream* {
+         return index < std::size(streams) ? &streams[index] : nullptr;
+       },
+       .on_segment_finished =
+           [&streams, &sizes](const std::uint64_t index) {
+             sizes[index] = static_cast<std::size_t>(streams[index].tellp());
+           }});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  std::vector<shiguredo::mp4::track::Track*> tracks = {&video};
+  writer.setTracks(tracks);
+  writer.writeFtypBox();
+  // 5 つの GOP を 1 回の addSamples() で追加する
+  std::vector<std::vector<std::uint8_t>> data;
+  std::vector<shiguredo::mp4::track::Sample> samples;
+  for (std::uint64_t i = 0; i < 50; ++i) {
+    data.emplace_back(10 + i, static_cast<std::uint8_t>(i));
+  }
+  for (std::uint64_t i = 0; i < 50; ++i) {
+    samples.push_back({.timestamp = i * 40, .data = data[i].data(), .size = std::size(data[i]), .is_key = i % 10 == 0});
+  }
+  video.addSamples(samples);
+  // 400ms 毎のキーフレームで切り替わる
+  BOOST_REQUIRE_EQUAL(4, writer.getSegmentIndex());
+  writer.appendTrakAndUdtaBoxInfo(tracks);
+  writer.writeMoovBox();
+
+  for (std::size_t s = 0; s < std::size(streams); ++s) {
+    BOOST_REQUIRE(sizes[s] > 0);
+    const auto output = streams[s].str().substr(0, sizes[s]);
+    std::stringstream is(output);
+    shiguredo::mp4::reader::SimpleReader reader(is);
+    reader.parse();
+    const auto indexes = shiguredo::mp4::reader::build_sample_indexes(find_moov(&reader));
+    BOOST_REQUIRE_EQUAL(1, std::size(indexes));
+    BOOST_REQUIRE_EQUAL(10, std::size(indexes[0].samples));
+    for (std::size_t i = 0; i < 10; ++i) {
+      const auto& sample = indexes[0].samples[i];
+      const auto n = s * 10 + i;
+      BOOST_REQUIRE_EQUAL(i * 40, sample.decode_time);
+      BOOST_REQUIRE_EQUAL(i == 0, sample.is_key);
+      BOOST_REQUIRE_EQUAL(10 + n, sample.size);
+      BOOST_REQUIRE_EQUAL(static_cast<char>(n), output[sample.offset]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rolling_writer_clone_not_supported) {
+  std::stringstream ss(std::string(4096, '\0'));
+  shiguredo::mp4::writer::RollingWriter writer(
+      {.segment_duration_ms = 100, .open_segment = [&ss](const std::uint64_t) { return &ss; }});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer, {.cloneable = false});
+  writer.setTracks({&video});
+  writer.writeFtypBox();
+  std::vector<std::uint8_t> data(10, 0);
+  video.addData(0, data, true);
+  BOOST_REQUIRE_THROW(video.addData(200, data, true), std::logic_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,322 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/reader/sample_index.hpp"
+#include "shiguredo/mp4/track/h264.hpp"
+#include "shiguredo/mp4/track/opus.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/track/vpx.hpp"
+#include "shiguredo/mp4/writer/sample_journal.hpp"
+#include "shiguredo/mp4/writer/simple_writer.hpp"
+#include "test_track.hpp"
+
+BOOST_AUTO_TEST_SUITE(sample_journal)
+
+using test_track::find_leaf;
+using test_track::TestTrack;
+using test_track::write_samples;
+
+namespace {
+
+std::filesystem::path make_temp_path(const std::string& name) {
+  return std::filesystem::temp_directory_path() / ("shiguredo_mp4_test_sample_journal_" + name);
+}
+
+// 映像: timescale 1000 で 40ms 毎のサンプル 50 個. 10 サンプル毎にキーフレーム
+// 音声: timescale 48000 で 20ms 毎のサンプル 100 個
+// moov を書き込まずに終了する
+void write_interrupted_mp4(const std::filesystem::path& path, const std::filesystem::path& journal_path) {
+  std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  shiguredo::mp4::writer::SampleJournal journal(journal_path, {.sync_interval = 16});
+  shiguredo::mp4::writer::SimpleWriter writer(fs, {.duration = 0, .journal = &journal});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer);
+  writer.writeFtypBox();
+  write_samples(&video, &audio);
+  fs.flush();
+}
+
+std::string read_file(const std::filesystem::path& path) {
+  std::ifstream ifs(path, std::ios_base::binary);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(journal_recovery) {
+  const auto path = make_temp_path("recovery.mp4");
+  const auto journal_path = make_temp_path("recovery.journal");
+  write_interrupted_mp4(path, journal_path);
+  // 最後の音声のサンプルの書き込み中に中断したとする
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+  {
+    std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    shiguredo::mp4::writer::JournalRecoveryWriter writer(fs, {});
+    TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+    TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer);
+    std::vector<shiguredo::mp4::track::Track*> tracks = {&video, &audio};
+    BOOST_REQUIRE_EQUAL(149, writer.readJournal(journal_path, tracks));
+    writer.appendTrakAndUdtaBoxInfo(tracks);
+    writer.writeMoovBox();
+  }
+
+  const auto output = read_file(path);
+  std::stringstream ss(output);
+  shiguredo::mp4::reader::SimpleReader reader(ss);
+  reader.parse();
+  std::vector<std::string> types;
+  for (const auto info : reader.getBoxInfos()) {
+    types.push_back(info->getType().toString());
+  }
+  const std::vector<std::string> expected = {"ftyp", "free", "mdat", "moov"};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(types), std::end(types), std::begin(expected), std::end(expected));
+
+  auto moov = reader.getBoxInfos()[3];
+  BOOST_REQUIRE_EQUAL(2000, dynamic_cast<shiguredo::mp4::box::Mvhd*>(find_leaf(moov, "mvhd")->getBox())->getDuration());
+
+  const auto tracks = shiguredo::mp4::reader::build_sample_indexes(moov);
+  BOOST_REQUIRE_EQUAL(2, std::size(tracks));
+  const auto& video = tracks[0];
+  BOOST_REQUIRE_EQUAL(50, std::size(video.samples));
+  for (std::size_t i = 0; i < std::size(video.samples); ++i) {
+    const auto& sample = video.samples[i];
+    BOOST_REQUIRE_EQUAL(i * 40, sample.decode_time);
+    BOOST_REQUIRE_EQUAL(40, sample.duration);
+    BOOST_REQUIRE_EQUAL(i % 10 == 0, sample.is_key);
+    BOOST_REQUIRE_EQUAL(10 + i, sample.size);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(i), output[sample.offset]);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(i), output[sample.offset + sample.size - 1]);
+  }
+  const auto& audio = tracks[1];
+  BOOST_REQUIRE_EQUAL(99, std::size(audio.samples));
+  for (std::size_t i = 0; i < std::size(audio.samples); ++i) {
+    const auto& sample = audio.samples[i];
+    BOOST_REQUIRE_EQUAL(i * 960, sample.decode_time);
+    BOOST_REQUIRE_EQUAL(960, sample.duration);
+    BOOST_REQUIRE_EQUAL(5, sample.size);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(0x80 | i), output[sample.offset]);
+  }
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(journal_path);
+}
+
+BOOST_AUTO_TEST_CASE(journal_recovery_with_lost_records) {
+  const auto path = make_temp_path("lost.mp4");
+  const auto journal_path = make_temp_path("lost.journal");
+  write_interrupted_mp4(path, journal_path);
+  // 最後の 11 サンプル分の記録がディスクに書き込まれず, 途中までの記録が残ったとする
+  std::filesystem::resize_file(journal_path, std::filesystem::file_size(journal_path) - 17 * 10 - 5);
+  const auto file_size = std::filesystem::file_size(path);
+
+  {
+    std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    shiguredo::mp4::writer::JournalRecoveryWriter writer(fs, {});
+    TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+    TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer);
+    std::vector<shiguredo::mp4::track::Track*> tracks = {&video, &audio};
+    BOOST_REQUIRE_EQUAL(139, writer.readJournal(journal_path, tracks));
+    writer.appendTrakAndUdtaBoxInfo(tracks);
+    writer.writeMoovBox();
+  }
+
+  BOOST_REQUIRE(std::filesystem::file_size(path) >= file_size);
+  std::ifstream ifs(path, std::ios_base::binary);
+  shiguredo::mp4::reader::SimpleReader reader(ifs);
+  reader.parse();
+  const auto& infos = reader.getBoxInfos();
+  BOOST_REQUIRE(std::size(infos) >= 4);
+  BOOST_REQUIRE_EQUAL("moov", infos[3]->getType().toString());
+  const auto tracks = shiguredo::mp4::reader::build_sample_indexes(infos[3]);
+  BOOST_REQUIRE_EQUAL(49, std::size(tracks[0].samples));
+  BOOST_REQUIRE_EQUAL(90, std::size(tracks[1].samples));
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(journal_path);
+}
+
+BOOST_AUTO_TEST_CASE(journal_recovery_h264) {
+  const auto path = make_temp_path("h264.mp4");
+  const auto journal_path = make_temp_path("h264.journal");
+  const std::vector<std::uint8_t> sps = {0x67, 0x42, 0xc0, 0x1f, 0xaa, 0xbb};
+  const std::vector<std::uint8_t> pps = {0x68, 0xce, 0x3c, 0x80};
+  {
+    std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    shiguredo::mp4::writer::SampleJournal journal(journal_path, {.sync_interval = 1});
+    shiguredo::mp4::writer::SimpleWriter writer(fs, {.duration = 0, .journal = &journal});
+    shiguredo::mp4::track::H264Track video(
+        {.timescale = 1000, .duration = 0, .track_id = 1, .width = 320, .height = 240, .writer = &writer});
+    writer.writeFtypBox();
+    // キーフレームは毎回 SPS と PPS を先頭に置く
+    for (std::uint64_t i = 0; i < 20; ++i) {
+      std::vector<std::uint8_t> data;
+      if (i % 10 == 0) {
+        for (const auto& nal_unit : {sps, pps}) {
+          data.insert(std::end(data), {0x00, 0x00, 0x00, 0x01});
+          data.insert(std::end(data), std::begin(nal_unit), std::end(nal_unit));
+        }
+      }
+      data.insert(std::end(data), {0x00, 0x00, 0x00, 0x01, static_cast<std::uint8_t>(i % 10 == 0 ? 0x65 : 0x41)});
+      data.insert(std::end(data), 8, 0x11);
+      video.addData(i * 40, data, i % 10 == 0);
+    }
+    fs.flush();
+  }
+
+  {
+    std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    shiguredo::mp4::writer::JournalRecoveryWriter writer(fs, {});
+    shiguredo::mp4::track::H264Track video(
+        {.timescale = 1000, .duration = 0, .track_id = 1, .width = 320, .height = 240, .writer = &writer});
+    std::vector<shiguredo::mp4::track::Track*> tracks = {&video};
+    BOOST_REQUIRE_EQUAL(20, writer.readJournal(journal_path, tracks));
+    writer.appendTrakAndUdtaBoxInfo(tracks);
+    writer.writeMoovBox();
+  }
+
+  std::ifstream ifs(path, std::ios_base::binary);
+  shiguredo::mp4::reader::SimpleReader reader(ifs);
+  reader.parse();
+  auto info = reader.getBoxInfos()[3];
+  for (const auto type : {"trak", "mdia", "minf", "stbl", "stsd", "avc1", "avcC"}) {
+    info = find_leaf(info, type);
+    BOOST_REQUIRE(info != nullptr);
+  }
+  // 復旧した avcC は記録時と同じ SPS と PPS を 1 つずつ持つ
+  const auto avcc = info->getBox()->toStringOnlyData();
+  BOOST_REQUIRE(avcc.find("Profile=0x42") != std::string::npos);
+  BOOST_REQUIRE(avcc.find("NumOfSequenceParameterSets=0x1 SequenceParameterSets=[{Length=6 NALUnit=[0x67, 0x42, "
+                          "0xc0, 0x1f, 0xaa, 0xbb]}]") != std::string::npos);
+  BOOST_REQUIRE(avcc.find("NumOfPictureParameterSets=0x1 PictureParameterSets=[{Length=4 NALUnit=[0x68, 0xce, 0x3c, "
+                          "0x80]}]") != std::string::npos);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(journal_path);
+}
+
+BOOST_AUTO_TEST_CASE(journal_recovery_vp9) {
+  const auto path = make_temp_path("vp9.mp4");
+  const auto journal_path = make_temp_path("vp9.journal");
+  // profile 2, 10bit, BT.709, full range, 1280x720 のキーフレーム
+  const std::vector<std::uint8_t> key_frame = {0x92, 0x49, 0x83, 0x42, 0x28, 0x27, 0xf8, 0x16, 0x78};
+  const std::vector<std::uint8_t> inter_frame = {0x96, 0x00, 0x40, 0x92};
+  {
+    std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    shiguredo::mp4::writer::SampleJournal journal(journal_path, {.sync_interval = 1});
+    shiguredo::mp4::writer::SimpleWriter writer(fs, {.duration = 0, .journal = &journal});
+    shiguredo::mp4::track::VPXTrack video(
+        {.timescale = 1000, .duration = 0, .track_id = 1, .width = 320, .height = 240, .writer = &writer});
+    writer.writeFtypBox();
+    for (std::uint64_t i = 0; i < 20; ++i) {
+      video.addData(i * 40, i % 10 == 0 ? key_frame : inter_frame, i % 10 == 0);
+    }
+    fs.flush();
+  }
+
+  {
+    std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    shiguredo::mp4::writer::JournalRecoveryWriter writer(fs, {});
+    shiguredo::mp4::track::VPXTrack video(
+        {.timescale = 1000, .duration = 0, .track_id = 1, .width = 320, .height = 240, .writer = &writer});
+    std::vector<shiguredo::mp4::track::Track*> tracks = {&video};
+    BOOST_REQUIRE_EQUAL(20, writer.readJournal(journal_path, tracks));
+    writer.appendTrakAndUdtaBoxInfo(tracks);
+    writer.writeMoovBox();
+  }
+
+  std::ifstream ifs(path, std::ios_base::binary);
+  shiguredo::mp4::reader::SimpleReader reader(ifs);
+  reader.parse();
+  auto info = reader.getBoxInfos()[3];
+  for (const auto type : {"trak", "mdia", "minf", "stbl", "stsd", "vp09"}) {
+    info = find_leaf(info, type);
+    BOOST_REQUIRE(info != nullptr);
+  }
+  // 復旧したサンプルエントリーはフレームヘッダーから得た解像度と vpcC の設定を持つ
+  BOOST_REQUIRE(info->getBox()->toStringOnlyData().find("Width=1280 Height=720") != std::string::npos);
+  const auto vpcc = find_leaf(info, "vpcC")->getBox()->toStringOnlyData();
+  BOOST_REQUIRE(vpcc.find("Profile=2 Level=21 BitDepth=10 ChromaSubSampling=1 VideoFullRangeFlag=1 ColourPrimaries=2 "
+                          "TransferCharacteristics=2 MatrixCoefficients=1") != std::string::npos);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(journal_path);
+}
+
+BOOST_AUTO_TEST_CASE(journal_recovery_opus) {
+  const auto path = make_temp_path("opus.mp4");
+  const auto journal_path = make_temp_path("opus.journal");
+  // SILK 60ms のパケット
+  const std::vector<std::uint8_t> packet = {0x18, 0x11, 0x22};
+  {
+    std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    shiguredo::mp4::writer::SampleJournal journal(journal_path, {.sync_interval = 1});
+    shiguredo::mp4::writer::SimpleWriter writer(fs, {.duration = 0, .journal = &journal});
+    shiguredo::mp4::track::OpusTrack audio({.duration = 0, .track_id = 1, .writer = &writer});
+    writer.writeFtypBox();
+    for (std::uint64_t i = 0; i < 10; ++i) {
+      audio.addData(i * 2880, packet, true);
+    }
+    fs.flush();
+  }
+
+  {
+    std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    shiguredo::mp4::writer::JournalRecoveryWriter writer(fs, {});
+    shiguredo::mp4::track::OpusTrack audio({.duration = 0, .track_id = 1, .writer = &writer});
+    std::vector<shiguredo::mp4::track::Track*> tracks = {&audio};
+    BOOST_REQUIRE_EQUAL(10, writer.readJournal(journal_path, tracks));
+    writer.appendTrakAndUdtaBoxInfo(tracks);
+    writer.writeMoovBox();
+  }
+
+  std::ifstream ifs(path, std::ios_base::binary);
+  shiguredo::mp4::reader::SimpleReader reader(ifs);
+  reader.parse();
+  auto info = reader.getBoxInfos()[3];
+  for (const auto type : {"trak", "mdia", "minf", "stbl", "sgpd"}) {
+    info = find_leaf(info, type);
+    BOOST_REQUIRE(info != nullptr);
+  }
+  // 80ms の pre-roll は 60ms のパケット 2 つ分になる. 最初のパケットの長さが戻らなければ既定の -4 になる
+  BOOST_REQUIRE(info->getBox()->toStringOnlyData().find("RollDistances=[-2]") != std::string::npos);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(journal_path);
+}
+
+BOOST_AUTO_TEST_CASE(journal_recovery_invalid_journal) {
+  const auto path = make_temp_path("invalid.mp4");
+  const auto journal_path = make_temp_path("invalid.journal");
+  write_interrupted_mp4(path, journal_path);
+  {
+    std::ofstream ofs(journal_path, std::ios_base::trunc | std::ios_base::binary);
+    ofs << "invalid";
+  }
+
+  std::fstream fs(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+  shiguredo::mp4::writer::JournalRecoveryWriter writer(fs, {});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  std::vector<shiguredo::mp4::track::Track*> tracks = {&video};
+  BOOST_REQUIRE_THROW(writer.readJournal(journal_path, tracks), std::runtime_error);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(journal_path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/boxes.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/reader/sample_index.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/sample_journal.hpp"
+#include "shiguredo/mp4/writer/simple_writer.hpp"
+#include "test_track.hpp"
+
+BOOST_AUTO_TEST_SUITE(simple_writer)
+
+using test_track::find_moov;
+using test_track::TestTrack;
+using test_track::TestTrackOptions;
+using test_track::write_samples;
+
+namespace {
+
+// duration を固定し, edts を書き込む
+const TestTrackOptions track_options = {.duration = 2.0f, .with_edts = true};
+
+std::vector<std::string> get_box_types(shiguredo::mp4::reader::SimpleReader* reader) {
+  std::vector<std::string> types;
+  for (const auto info : reader->getBoxInfos()) {
+    types.push_back(info->getType().toString());
+  }
+  return types;
+}
+
+// サンプルのテーブルが書き込んだサンプルの先頭から一致することを確認する
+void check_samples(const std::string& output,
+                   const shiguredo::mp4::reader::IndexedTrack& video,
+                   const shiguredo::mp4::reader::IndexedTrack& audio) {
+  for (std::size_t i = 0; i < std::size(video.samples); ++i) {
+    const auto& sample = video.samples[i];
+    BOOST_REQUIRE_EQUAL(i * 40, sample.decode_time);
+    BOOST_REQUIRE_EQUAL(40, sample.duration);
+    BOOST_REQUIRE_EQUAL(i % 10 == 0, sample.is_key);
+    BOOST_REQUIRE_EQUAL(10 + i, sample.size);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(i), output[sample.offset]);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(i), output[sample.offset + sample.size - 1]);
+  }
+  for (std::size_t i = 0; i < std::size(audio.samples); ++i) {
+    const auto& sample = audio.samples[i];
+    BOOST_REQUIRE_EQUAL(i * 960, sample.decode_time);
+    BOOST_REQUIRE_EQUAL(960, sample.duration);
+    BOOST_REQUIRE_EQUAL(5, sample.size);
+    BOOST_REQUIRE_EQUAL(static_cast<char>(0x80 | i), output[sample.offset]);
+  }
+}
+
+// xsputn() の呼び出し回数を数え, failed が true の場合は書き込みに失敗する
+// stringbuf は末尾より後ろに seekp() できないため, 十分な大きさの領域を上書きする
+class CountingStreamBuf : public std::stringbuf {
+ public:
+  CountingStreamBuf() : std::stringbuf(std::string(1024, '\0')) {}
+
+  std::size_t write_count = 0;
+  bool failed = false;
+
+ protected:
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    ++write_count;
+    return failed ? 0 : std::stringbuf::xsputn(s, n);
+  }
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(simple_writer_batched_samples) {
+  CountingStreamBuf buf;
+  std::iostream os(&buf);
+  shiguredo::mp4::writer::SimpleWriter writer(os, {.duration = 0});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer);
+  writer.writeFtypBox();
+
+  std::vector<std::vector<std::uint8_t>> data;
+  std::vector<shiguredo::mp4::track::Sample> samples;
+  for (std::uint64_t i = 0; i < 10; ++i) {
+    data.emplace_back(10 + i, static_cast<std::uint8_t>(i));
+  }
+  for (std::uint64_t i = 0; i < 10; ++i) {
+    samples.push_back({.timestamp = i * 40, .data = data[i].data(), .size = std::size(data[i]), .is_key = i == 0});
+  }
+  // まとめて渡したサンプルは 1 度の書き込みで mdat に追加する
+  buf.write_count = 0;
+  video.addSamples(samples);
+  BOOST_REQUIRE_EQUAL(1, buf.write_count);
+  BOOST_REQUIRE_EQUAL(10, video.getSampleCount());
+
+  // 書き込みに失敗したサンプルはテーブルに追加しない
+  buf.failed = true;
+  BOOST_REQUIRE_THROW(video.addSamples(samples), std::runtime_error);
+  BOOST_REQUIRE_EQUAL(10, video.getSampleCount());
+}
+
+BOOST_AUTO_TEST_CASE(simple_writer_checkpoint_truncated) {
+  // stringstream は末尾より後ろに seekp() できないため, 十分な大きさの領域を上書きする
+  std::stringstream ss(std::string(8192, '\0'));
+  shiguredo::mp4::writer::SimpleWriter writer(ss, {.duration = 2.0f, .checkpoint_interval_ms = 500});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer, track_options);
+  TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer, track_options);
+  writer.setCheckpointTracks({&video, &audio});
+  writer.writeFtypBox();
+  write_samples(&video, &audio);
+
+  // writeMoovBox() の前に中断し, 最後の mdat の途中までが書き込まれたとする
+  const auto output = ss.str().substr(0, static_cast<std::size_t>(ss.tellp()) - 3);
+  std::stringstream is(output);
+  shiguredo::mp4::reader::SimpleReader reader(is);
+  reader.parse();
+  const auto types = get_box_types(&reader);
+  BOOST_REQUIRE_EQUAL("ftyp", types.front());
+  BOOST_REQUIRE_EQUAL("mdat", types.back());
+
+  auto moov = find_moov(&reader);
+  const auto tracks = shiguredo::mp4::reader::build_sample_indexes(moov);
+  BOOST_REQUIRE_EQUAL(2, std::size(tracks));
+  // 映像の 520ms, 1040ms, 1560ms のサンプルの書き込み時にスナップショットを書き込む
+  BOOST_REQUIRE_EQUAL(40, std::size(tracks[0].samples));
+  BOOST_REQUIRE_EQUAL(70, std::size(tracks[1].samples));
+  check_samples(output, tracks[0], tracks[1]);
+  BOOST_REQUIRE_EQUAL(1600, dynamic_cast<shiguredo::mp4::box::Mvhd*>(moov->getLeafs()[0]->getBox())->getDuration());
+}
+
+BOOST_AUTO_TEST_CASE(simple_writer_checkpoint_finalized) {
+  std::stringstream ss(std::string(8192, '\0'));
+  shiguredo::mp4::writer::SimpleWriter writer(ss, {.duration = 2.0f, .checkpoint_interval_ms = 500});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer, track_options);
+  TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer, track_options);
+  std::vector<shiguredo::mp4::track::Track*> tracks = {&video, &audio};
+  writer.setCheckpointTracks(tracks);
+  writer.writeFtypBox();
+  write_samples(&video, &audio);
+  writer.appendTrakAndUdtaBoxInfo(tracks);
+  writer.writeMoovBox();
+  const auto size = static_cast<std::size_t>(ss.tellp());
+  writer.writeFreeBoxAndMdatHeader();
+  const auto output = ss.str().substr(0, size);
+
+  std::stringstream is(output);
+  shiguredo::mp4::reader::SimpleReader reader(is);
+  reader.parse();
+  const auto types = get_box_types(&reader);
+  BOOST_REQUIRE_EQUAL("moov", types.back());
+  // 2 回目以降のスナップショットは最初のスナップショットの領域に上書きされるので, mdat は分かれない
+  BOOST_REQUIRE_EQUAL(2, std::count(std::begin(types), std::end(types), "mdat"));
+
+  const auto indexes = shiguredo::mp4::reader::build_sample_indexes(find_moov(&reader));
+  BOOST_REQUIRE_EQUAL(2, std::size(indexes));
+  BOOST_REQUIRE_EQUAL(50, std::size(indexes[0].samples));
+  BOOST_REQUIRE_EQUAL(100, std::size(indexes[1].samples));
+  check_samples(output, indexes[0], indexes[1]);
+}
+
+BOOST_AUTO_TEST_CASE(simple_writer_checkpoint_reuses_region) {
+  std::stringstream ss(std::string(65536, '\0'));
+  shiguredo::mp4::writer::SimpleWriter writer(ss, {.duration = 2.0f, .checkpoint_interval_ms = 1});
+  TestTrack video(1, 1000, shiguredo::mp4::track::HandlerType::vide, &writer, track_options);
+  TestTrack audio(2, 48000, shiguredo::mp4::track::HandlerType::soun, &writer, track_options);
+  writer.setCheckpointTracks({&video, &audio});
+  writer.writeFtypBox();
+  write_samples(&video, &audio);
+
+  const auto output = ss.str().substr(0, static_cast<std::size_t>(ss.tellp()));
+  std::stringstream is(output);
+  shiguredo::mp4::reader::SimpleReader reader(is);
+  reader.parse();
+  // サンプル毎にスナップショットを書き込んでも, 領域を移すのはスナップショットが倍の大きさを超える場合のみ
+  std::uint64_t free_size = 0;
+  std::uint64_t mdat_count = 0;
+  for (const auto info : reader.getBoxInfos()) {
+    if (info->getType().toString() == "free") {
+      free_size += info->getSize();
+    } else if (info->getType().toString() == "mdat") {
+      ++mdat_count;
+    }
+  }
+  auto moov = find_moov(&reader);
+  BOOST_REQUIRE_LE(mdat_count, 8);
+  BOOST_REQUIRE_LT(free_size, moov->getSize() + 8 * mdat_count);
+
+  const auto tracks = shiguredo::mp4::reader::build_sample_indexes(moov);
+  BOOST_REQUIRE_EQUAL(2, std::size(tracks));
+  BOOST_REQUIRE_EQUAL(50, std::size(tracks[0].samples));
+  BOOST_REQUIRE_EQUAL(100, std::size(tracks[1].samples));
+  check_samples(output, tracks[0], tracks[1]);
+}
+
+BOOST_AUTO_TEST_CASE(simple_writer_checkpoint_with_journal) {
+  const auto journal_path = std::filesystem::temp_directory_path() / "shiguredo_mp4_test_simple_writer.journal";
+  {
+    std::stringstream ss;
+    shiguredo::mp4::writer::SampleJournal journal(journal_path);
+    BOOST_REQUIRE_THROW(
+        shiguredo::mp4::writer::SimpleWriter(ss, {.duration = 0, .journal = &journal, .checkpoint_interval_ms = 500}),
+        std::invalid_argument);
+  }
+  std::filesystem::remove(journal_path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/tkhd.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/reader/reader.hpp"
+#include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/writer.hpp"
+
+// Writer のテストで共有するトラックと Box の木を辿る関数
+namespace test_track {
+
+struct TestTrackOptions {
+  const float duration = 0;
+  // trak に edts と elst を含める
+  const bool with_edts = false;
+  // false の場合は clone() で Track::clone() と同じく std::logic_error を送出する
+  const bool cloneable = true;
+};
+
+// 映像の場合のみ stss を書き込み, stsd は書き込まない
+class TestTrack : public shiguredo::mp4::track::Track {
+ public:
+  TestTrack(const std::uint32_t track_id,
+            const std::uint32_t timescale,
+            const shiguredo::mp4::track::HandlerType handler_type,
+            shiguredo::mp4::writer::Writer* writer,
+            const TestTrackOptions& options = {})
+      : m_with_edts(options.with_edts), m_cloneable(options.cloneable) {
+    m_timescale = timescale;
+    m_duration = options.duration;
+    m_mvhd_timescale = 1000;
+    m_time_from_epoch = 0;
+    m_media_time = 0;
+    m_track_id = track_id;
+    m_handler_type = handler_type;
+    m_writer = writer;
+  }
+  std::unique_ptr<shiguredo::mp4::track::Track> clone() const override {
+    if (!m_cloneable) {
+      return Track::clone();
+    }
+    return std::make_unique<TestTrack>(*this);
+  }
+  void appendTrakBoxInfo(shiguredo::mp4::BoxInfo* moov) override {
+    finalize();
+    auto trak = makeTrakBoxInfo(moov);
+    makeTkhdBoxInfo(trak);
+    if (m_with_edts) {
+      auto edts = makeEdtsBoxInfo(trak);
+      makeElstBoxInfo(edts);
+    }
+    auto mdia = makeMdiaBoxInfo(trak);
+    makeMdhdBoxInfo(mdia);
+    makeHdlrBoxInfo(mdia);
+    auto minf = makeMinfBoxInfo(mdia);
+    makeDinfBoxInfo(minf);
+    auto stbl = makeStblBoxInfo(minf);
+    makeSttsBoxInfo(stbl);
+    makeStscBoxInfo(stbl);
+    if (m_handler_type == shiguredo::mp4::track::HandlerType::vide) {
+      makeStssBoxInfo(stbl);
+    }
+    makeStszBoxInfo(stbl);
+    makeOffsetBoxInfo(stbl);
+  }
+  void addSamples(const std::span<const shiguredo::mp4::track::Sample> samples) override { addMdatSamples(samples); }
+  void addData(const std::uint64_t timestamp, const std::vector<std::uint8_t>& data, bool is_key) override {
+    addMdatData(timestamp, data, is_key);
+  }
+  void addData(const std::uint64_t timestamp,
+               const std::uint8_t* data,
+               const std::size_t data_size,
+               bool is_key) override {
+    addMdatData(timestamp, data, data_size, is_key);
+  }
+
+ private:
+  bool m_with_edts;
+  bool m_cloneable;
+  void makeTkhdBoxInfo(shiguredo::mp4::BoxInfo* trak) override {
+    new shiguredo::mp4::BoxInfo({.parent = trak,
+                                 .box = new shiguredo::mp4::box::Tkhd({.creation_time = 0,
+                                                                       .modification_time = 0,
+                                                                       .track_id = m_track_id,
+                                                                       .duration = getDurationInMvhdTimescale()})});
+  }
+};
+
+// 映像: timescale 1000 で 40ms 毎のサンプル 50 個. 10 サンプル毎にキーフレーム. i 番目のサンプルは 10 + i bytes の i
+// 音声: timescale 48000 で 20ms 毎のサンプル 100 個. i 番目のサンプルは 5 bytes の 0x80 | i
+// 200ms 毎に映像 5 サンプル, 音声 10 サンプルの chunk を交互に書き込む
+inline void write_samples(shiguredo::mp4::track::Track* video, shiguredo::mp4::track::Track* audio) {
+  for (std::uint64_t c = 0; c < 10; ++c) {
+    for (std::uint64_t i = c * 5; i < c * 5 + 5; ++i) {
+      std::vector<std::uint8_t> data(10 + i, static_cast<std::uint8_t>(i));
+      video->addData(i * 40, data, i % 10 == 0);
+    }
+    video->terminateCurrentChunk();
+    for (std::uint64_t i = c * 10; i < c * 10 + 10; ++i) {
+      std::vector<std::uint8_t> data(5, static_cast<std::uint8_t>(0x80 | i));
+      audio->addData(i * 960, data, true);
+    }
+    audio->terminateCurrentChunk();
+  }
+}
+
+// 直下の子から type の Box を探す
+inline shiguredo::mp4::BoxInfo* find_leaf(shiguredo::mp4::BoxInfo* info, const std::string& type) {
+  for (const auto leaf : info->getLeafs()) {
+    if (leaf->getType().toString() == type) {
+      return leaf;
+    }
+  }
+  return nullptr;
+}
+
+// トップレベルにただ 1 つある moov を返す
+inline shiguredo::mp4::BoxInfo* find_moov(shiguredo::mp4::reader::SimpleReader* reader) {
+  shiguredo::mp4::BoxInfo* moov = nullptr;
+  for (const auto info : reader->getBoxInfos()) {
+    if (info->getType().toString() == "moov") {
+      BOOST_REQUIRE(moov == nullptr);
+      moov = info;
+    }
+  }
+  BOOST_REQUIRE(moov != nullptr);
+  return moov;
+}
+
+}  // namespace test_track
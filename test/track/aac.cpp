@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/box/moov.hpp"
+#include "shiguredo/mp4/box/stts.hpp"
+#include "shiguredo/mp4/box_info.hpp"
+#include "shiguredo/mp4/box_type.hpp"
+#include "shiguredo/mp4/track/aac.hpp"
+#include "shiguredo/mp4/writer/writer.hpp"
+
+BOOST_AUTO_TEST_SUITE(aac)
+
+struct ParseADTSHeaderTestCase {
+  const std::string name;
+  const std::vector<std::uint8_t> header;
+  const std::size_t data_size;
+  const shiguredo::mp4::track::ADTSHeader expected;
+};
+
+ParseADTSHeaderTestCase parse_adts_header_test_cases[] = {
+    {
+        "AAC-LC 44.1kHz stereo",
+        {0xff, 0xf1, 0x50, 0x80, 0x20, 0x1f, 0xfc},
+        256,
+        {.audio_object_type = 2,
+         .sampling_frequency_index = 4,
+         .channel_configuration = 2,
+         .header_size = 7,
+         .frame_length = 256,
+         .number_of_raw_data_blocks_in_frame = 0},
+    },
+    {
+        "AAC-LC 48kHz mono with CRC",
+        {0xff, 0xf0, 0x4c, 0x40, 0x10, 0x1f, 0xfc, 0x12, 0x34},
+        128,
+        {.audio_object_type = 2,
+         .sampling_frequency_index = 3,
+         .channel_configuration = 1,
+         .header_size = 9,
+         .frame_length = 128,
+         .number_of_raw_data_blocks_in_frame = 0},
+    },
+};
+
+BOOST_AUTO_TEST_CASE(parse_adts_header) {
+  BOOST_TEST_MESSAGE("parse_adts_header");
+  for (const auto& tc : parse_adts_header_test_cases) {
+    BOOST_TEST_MESSAGE(tc.name);
+    std::vector<std::uint8_t> data(tc.data_size, 0);
+    std::copy(std::begin(tc.header), std::end(tc.header), std::begin(data));
+    shiguredo::mp4::track::ADTSHeader header;
+    BOOST_REQUIRE(shiguredo::mp4::track::parse_adts_header(&header, data.data(), data.size()));
+    BOOST_REQUIRE_EQUAL(tc.expected, header);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parse_adts_header_error) {
+  BOOST_TEST_MESSAGE("parse_adts_header_error");
+  shiguredo::mp4::track::ADTSHeader header;
+  // raw AAC
+  const std::vector<std::uint8_t> raw = {0x21, 0x19, 0x94, 0xa5, 0x40, 0x00, 0x00, 0x00};
+  BOOST_REQUIRE(!shiguredo::mp4::track::parse_adts_header(&header, raw.data(), raw.size()));
+  // frame_length がデータサイズを越える
+  const std::vector<std::uint8_t> truncated = {0xff, 0xf1, 0x50, 0x80, 0x20, 0x1f, 0xfc, 0x00};
+  BOOST_REQUIRE(!shiguredo::mp4::track::parse_adts_header(&header, truncated.data(), truncated.size()));
+}
+
+struct ParseAudioSpecificConfigTestCase {
+  const std::vector<std::uint8_t> data;
+  const shiguredo::mp4::track::AudioSpecificConfig expected;
+};
+
+ParseAudioSpecificConfigTestCase parse_audio_specific_config_test_cases[] = {
+    {{0x11, 0x90}, {.audio_object_type = 2, .sampling_frequency = 48000, .channel_configuration = 2}},
+    {{0x12, 0x10}, {.audio_object_type = 2, .sampling_frequency = 44100, .channel_configuration = 2}},
+    {{0x2b, 0x92, 0x08, 0x00}, {.audio_object_type = 5, .sampling_frequency = 22050, .channel_configuration = 2}},
+    {{0x17, 0x80, 0x5d, 0xc0, 0x08}, {.audio_object_type = 2, .sampling_frequency = 48000, .channel_configuration = 1}},
+    {{0xf8, 0x26, 0xc0}, {.audio_object_type = 33, .sampling_frequency = 48000, .channel_configuration = 6}},
+};
+
+BOOST_AUTO_TEST_CASE(parse_audio_specific_config) {
+  BOOST_TEST_MESSAGE("parse_audio_specific_config");
+  for (const auto& tc : parse_audio_specific_config_test_cases) {
+    shiguredo::mp4::track::AudioSpecificConfig asc;
+    BOOST_REQUIRE(shiguredo::mp4::track::parse_audio_specific_config(&asc, tc.data));
+    BOOST_REQUIRE_EQUAL(tc.expected, asc);
+  }
+  shiguredo::mp4::track::AudioSpecificConfig asc;
+  BOOST_REQUIRE(!shiguredo::mp4::track::parse_audio_specific_config(&asc, {0x11}));
+}
+
+BOOST_AUTO_TEST_CASE(make_audio_specific_config) {
+  BOOST_TEST_MESSAGE("make_audio_specific_config");
+  std::vector<std::uint8_t> data;
+  shiguredo::mp4::track::make_audio_specific_config(
+      &data, {.audio_object_type = 2, .sampling_frequency_index = 4, .channel_configuration = 2});
+  const std::vector<std::uint8_t> expected = {0x12, 0x10};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected), std::end(expected), std::begin(data), std::end(data));
+}
+
+namespace {
+
+class MemoryWriter : public shiguredo::mp4::writer::Writer {
+ public:
+  MemoryWriter() {
+    m_mvhd_timescale = 1000;
+    m_duration = 0;
+    m_time_from_epoch = 0;
+    m_ftyp_size = 0;
+  }
+  void writeFtypBox() override {}
+  void writeMoovBox() override {}
+  void addMdatData(const std::uint8_t* data, const std::size_t data_size) override {
+    m_data.insert(std::end(m_data), data, data + data_size);
+  }
+  std::uint64_t tellCurrentMdatOffset() override { return std::size(m_data); }
+  void appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>&) override {}
+  const std::vector<std::uint8_t>& getData() const { return m_data; }
+
+ private:
+  std::vector<std::uint8_t> m_data;
+
+  void setOffsetAndSize() override {}
+};
+
+// AAC-LC stereo で protection_absent の ADTS フレームを data の末尾に追加する
+void append_adts_frame(std::vector<std::uint8_t>* data,
+                       const std::uint8_t sampling_frequency_index,
+                       const std::size_t payload_size,
+                       const std::uint8_t value) {
+  const auto frame_length = 7 + payload_size;
+  const std::vector<std::uint8_t> header = {
+      0xff,
+      0xf1,
+      static_cast<std::uint8_t>(0x40 | (sampling_frequency_index << 2)),
+      static_cast<std::uint8_t>(0x80 | ((frame_length >> 11) & 0x03)),
+      static_cast<std::uint8_t>((frame_length >> 3) & 0xff),
+      static_cast<std::uint8_t>(((frame_length & 0x07) << 5) | 0x1f),
+      0xfc};
+  data->insert(std::end(*data), std::begin(header), std::end(header));
+  data->insert(std::end(*data), payload_size, value);
+}
+
+shiguredo::mp4::BoxInfo* find_box(shiguredo::mp4::BoxInfo* info, const std::string& type) {
+  if (info->getType().toString() == type) {
+    return info;
+  }
+  for (const auto leaf : info->getLeafs()) {
+    if (auto found = find_box(leaf, type)) {
+      return found;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(add_multiple_adts_frames) {
+  BOOST_TEST_MESSAGE("add_multiple_adts_frames");
+  MemoryWriter writer;
+  shiguredo::mp4::track::AACTrack track({.timescale = 48000, .duration = 0.1f, .track_id = 1, .writer = &writer});
+  // 1 回の addData() に 3 つのフレーム, 次に 1 つのフレーム
+  std::vector<std::uint8_t> frames;
+  append_adts_frame(&frames, 3, 4, 1);
+  append_adts_frame(&frames, 3, 5, 2);
+  append_adts_frame(&frames, 3, 6, 3);
+  track.addData(0, frames, true);
+  std::vector<std::uint8_t> frame;
+  append_adts_frame(&frame, 3, 7, 4);
+  track.addData(3072, frame, true);
+
+  BOOST_REQUIRE_EQUAL(4, track.getSampleCount());
+  std::vector<std::uint8_t> expected_data;
+  for (std::uint8_t i = 1; i <= 4; ++i) {
+    expected_data.insert(std::end(expected_data), 3 + i, i);
+  }
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(std::begin(expected_data), std::end(expected_data), std::begin(writer.getData()),
+                                  std::end(writer.getData()));
+
+  shiguredo::mp4::BoxInfo moov({.box = new shiguredo::mp4::box::Moov()});
+  track.appendTrakBoxInfo(&moov);
+  const auto stts = dynamic_cast<shiguredo::mp4::box::Stts*>(find_box(&moov, "stts")->getBox());
+  BOOST_REQUIRE_EQUAL(1024, stts->getEntries().front().getSampleDuration());
+  BOOST_REQUIRE_EQUAL(3, stts->getEntries().front().getSampleCount());
+  BOOST_REQUIRE(find_box(&moov, "mp4a")->getBox()->toStringOnlyData().find("SampleRate=3145728000") !=
+                std::string::npos);
+
+  // フレームの後ろに ADTS フレームでないデータが続く場合は捨てずにエラーにする
+  frame.push_back(0);
+  BOOST_REQUIRE_THROW(track.addData(4096, frame, true), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(sample_rate_out_of_range) {
+  BOOST_TEST_MESSAGE("sample_rate_out_of_range");
+  MemoryWriter writer;
+  shiguredo::mp4::track::AACTrack track({.timescale = 96000, .duration = 0.1f, .track_id = 1, .writer = &writer});
+  std::vector<std::uint8_t> frame;
+  append_adts_frame(&frame, 0, 4, 1);
+  track.addData(0, frame, true);
+  shiguredo::mp4::BoxInfo moov({.box = new shiguredo::mp4::box::Moov()});
+  track.appendTrakBoxInfo(&moov);
+  // 96kHz は 16.16 の固定小数点で表せないので 0 になる
+  BOOST_REQUIRE(find_box(&moov, "mp4a")->getBox()->toStringOnlyData().find("SampleRate=0") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/track/opus.hpp"
+
+BOOST_AUTO_TEST_SUITE(opus)
+
+struct ParseOpusHeadTestCase {
+  const std::string name;
+  const std::vector<std::uint8_t> data;
+  const shiguredo::mp4::track::OpusHead expected;
+};
+
+ParseOpusHeadTestCase parse_opus_head_test_cases[] = {
+    {
+        "stereo",
+        {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x02, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00},
+        {.pre_skip = 312},
+    },
+    {
+        "mono 16kHz",
+        {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x01, 0x38, 0x01, 0x80, 0x3e, 0x00, 0x00, 0x00, 0x01, 0x00},
+        {.channel_count = 1, .pre_skip = 312, .input_sample_rate = 16000, .output_gain = 256, .coupled_count = 0},
+    },
+    {
+        "5.1",
+        {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x06, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00,
+         0x00, 0x01, 0x04, 0x02, 0x00, 0x04, 0x01, 0x02, 0x03, 0x05},
+        {.channel_count = 6,
+         .pre_skip = 312,
+         .channel_mapping_family = 1,
+         .stream_count = 4,
+         .coupled_count = 2,
+         .channel_mapping = {0, 4, 1, 2, 3, 5}},
+    },
+    {
+        "first order ambisonics",
+        {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x04, 0x38, 0x01, 0x80, 0xbb, 0x00,
+         0x00, 0x00, 0x00, 0x02, 0x04, 0x00, 0x00, 0x01, 0x02, 0x03},
+        {.channel_count = 4,
+         .pre_skip = 312,
+         .channel_mapping_family = 2,
+         .stream_count = 4,
+         .coupled_count = 0,
+         .channel_mapping = {0, 1, 2, 3}},
+    },
+};
+
+BOOST_AUTO_TEST_CASE(parse_opus_head) {
+  BOOST_TEST_MESSAGE("parse_opus_head");
+  for (const auto& tc : parse_opus_head_test_cases) {
+    BOOST_TEST_MESSAGE(tc.name);
+    shiguredo::mp4::track::OpusHead head;
+    BOOST_REQUIRE(shiguredo::mp4::track::parse_opus_head(&head, tc.data.data(), tc.data.size()));
+    BOOST_REQUIRE_EQUAL(tc.expected, head);
+  }
+}
+
+struct ParseOpusHeadErrorTestCase {
+  const std::string name;
+  const std::vector<std::uint8_t> data;
+};
+
+ParseOpusHeadErrorTestCase parse_opus_head_error_test_cases[] = {
+    {"invalid magic",
+     {'O', 'p', 'u', 's', 'T', 'a', 'g', 's', 0x01, 0x02, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"incompatible version",
+     {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x10, 0x02, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"family 0 with 6 channels",
+     {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x06, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"truncated channel mapping table",
+     {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x06, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04,
+      0x02, 0x00, 0x04}},
+    {"channel mapping out of range",
+     {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x02, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01,
+      0x00, 0x00, 0x01}},
+};
+
+BOOST_AUTO_TEST_CASE(parse_opus_head_error) {
+  BOOST_TEST_MESSAGE("parse_opus_head_error");
+  for (const auto& tc : parse_opus_head_error_test_cases) {
+    BOOST_TEST_MESSAGE(tc.name);
+    shiguredo::mp4::track::OpusHead head;
+    BOOST_REQUIRE(!shiguredo::mp4::track::parse_opus_head(&head, tc.data.data(), tc.data.size()));
+  }
+}
+
+struct GetOpusPacketDurationTestCase {
+  const std::vector<std::uint8_t> data;
+  const std::uint32_t expected;
+};
+
+GetOpusPacketDurationTestCase get_opus_packet_duration_test_cases[] = {
+    {{0xfc}, 960},         // CELT 20ms, 1 frame
+    {{0xe8}, 240},         // CELT 5ms, 1 frame
+    {{0xf9}, 1920},        // CELT 20ms, 2 frames
+    {{0x78}, 960},         // Hybrid 20ms, 1 frame
+    {{0x18}, 2880},        // SILK 60ms, 1 frame
+    {{0x4b, 0x03}, 2880},  // SILK 20ms, 3 frames
+    {{0x1b, 0x03}, 0},     // SILK 60ms, 3 frames (120ms を越える)
+    {{0x4b}, 0},           // frame count が無い
+    {{}, 0},
+};
+
+BOOST_AUTO_TEST_CASE(get_opus_packet_duration) {
+  BOOST_TEST_MESSAGE("get_opus_packet_duration");
+  for (const auto& tc : get_opus_packet_duration_test_cases) {
+    BOOST_REQUIRE_EQUAL(tc.expected, shiguredo::mp4::track::get_opus_packet_duration(tc.data.data(), tc.data.size()));
+  }
+}
+
+namespace {
+
+void write_ogg_page(std::ostream& os,
+                    const std::uint8_t header_type,
+                    const std::uint32_t serial_number,
+                    const std::vector<std::uint8_t>& lacing_values,
+                    const std::vector<std::uint8_t>& body) {
+  std::vector<std::uint8_t> header = {'O', 'g', 'g', 'S', 0x00, header_type, 0, 0, 0, 0, 0, 0, 0, 0};
+  for (std::size_t i = 0; i < 4; ++i) {
+    header.push_back(static_cast<std::uint8_t>(serial_number >> (8 * i)));
+  }
+  header.insert(std::end(header), 8, 0);  // sequence number, CRC
+  header.push_back(static_cast<std::uint8_t>(lacing_values.size()));
+  header.insert(std::end(header), std::begin(lacing_values), std::end(lacing_values));
+  os.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+  os.write(reinterpret_cast<const char*>(body.data()), static_cast<std::streamsize>(body.size()));
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(ogg_opus_reader) {
+  BOOST_TEST_MESSAGE("ogg_opus_reader");
+  std::stringstream ss;
+  const std::vector<std::uint8_t> opus_head = {'O',  'p',  'u',  's',  'H',  'e',  'a',  'd',  0x01, 0x02,
+                                               0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00};
+  write_ogg_page(ss, 0x02, 1, {19}, opus_head);
+  write_ogg_page(ss, 0x00, 1, {8}, {'O', 'p', 'u', 's', 'T', 'a', 'g', 's'});
+  write_ogg_page(ss, 0x00, 1, {3, 3}, {0xfc, 0x01, 0x02, 0xf9, 0x03, 0x04});
+  // 別の論理ストリームは読み飛ばす
+  write_ogg_page(ss, 0x02, 2, {2}, {0xff, 0xff});
+  // ページをまたぐパケット
+  std::vector<std::uint8_t> large(300, 0xaa);
+  large[0] = 0xfc;
+  write_ogg_page(ss, 0x00, 1, {255}, std::vector<std::uint8_t>(std::begin(large), std::begin(large) + 255));
+  write_ogg_page(ss, 0x01, 1, {45, 1}, [&large]() {
+    std::vector<std::uint8_t> body(std::begin(large) + 255, std::end(large));
+    body.push_back(0xe4);
+    return body;
+  }());
+
+  shiguredo::mp4::track::OggOpusReader reader(ss);
+  BOOST_REQUIRE_EQUAL(shiguredo::mp4::track::OpusHead({.pre_skip = 312}), reader.getOpusHead());
+
+  const std::vector<std::uint64_t> expected_timestamps = {0, 960, 2880, 3840};
+  const std::vector<std::size_t> expected_sizes = {3, 3, 300, 1};
+  shiguredo::mp4::track::OpusPacket packet;
+  for (std::size_t i = 0; i < expected_timestamps.size(); ++i) {
+    BOOST_REQUIRE(reader.readPacket(&packet));
+    BOOST_REQUIRE_EQUAL(expected_timestamps[i], packet.timestamp);
+    BOOST_REQUIRE_EQUAL(expected_sizes[i], packet.size);
+    if (i == 2) {
+      BOOST_REQUIRE(std::equal(std::begin(large), std::end(large), packet.data));
+    }
+  }
+  BOOST_REQUIRE(!reader.readPacket(&packet));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,4 +1,5 @@
 #include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -9,6 +10,7 @@
 #include "shiguredo/mp4/box/stsc.hpp"
 #include "shiguredo/mp4/box/stts.hpp"
 #include "shiguredo/mp4/track/track.hpp"
+#include "shiguredo/mp4/writer/writer.hpp"
 
 BOOST_AUTO_TEST_SUITE(track)
 
@@ -162,4 +164,166 @@ BOOST_AUTO_TEST_CASE(make_offset_box) {
   }
 }
 
+namespace {
+
+class NullWriter : public shiguredo::mp4::writer::Writer {
+ public:
+  NullWriter() {
+    m_mvhd_timescale = 1000;
+    m_duration = 0;
+    m_time_from_epoch = 0;
+    m_ftyp_size = 0;
+  }
+  void writeFtypBox() override {}
+  void writeMoovBox() override {}
+  void addMdatData(const std::uint8_t* data, const std::size_t data_size) override {
+    m_data.insert(std::end(m_data), data, data + data_size);
+    m_mdat_data_size += data_size;
+  }
+  std::uint64_t tellCurrentMdatOffset() override { return m_mdat_data_size; }
+  void appendTrakAndUdtaBoxInfo(const std::vector<shiguredo::mp4::track::Track*>&) override {}
+  const std::vector<std::uint8_t>& getData() const { return m_data; }
+
+ private:
+  std::vector<std::uint8_t> m_data;
+
+  void setOffsetAndSize() override {}
+};
+
+class TestTrack : public shiguredo::mp4::track::Track {
+ public:
+  TestTrack(const std::uint32_t timescale,
+            const float duration,
+            shiguredo::mp4::writer::Writer* writer,
+            const shiguredo::mp4::track::HandlerType handler_type = shiguredo::mp4::track::HandlerType::soun) {
+    m_timescale = timescale;
+    m_duration = duration;
+    m_handler_type = handler_type;
+    m_writer = writer;
+  }
+  void appendTrakBoxInfo(shiguredo::mp4::BoxInfo*) override { finalize(); }
+  void addData(const std::uint64_t timestamp, const std::vector<std::uint8_t>& data, bool is_key) override {
+    addMdatData(timestamp, data, is_key);
+  }
+  void addData(const std::uint64_t timestamp,
+               const std::uint8_t* data,
+               const std::size_t data_size,
+               bool is_key) override {
+    addMdatData(timestamp, data, data_size, is_key);
+  }
+  void addSamples(const std::span<const shiguredo::mp4::track::Sample> samples) override { addMdatSamples(samples); }
+  void terminateChunk() { terminateCurrentChunk(); }
+  const std::vector<std::uint32_t>& getSampleSizes() const { return m_mdat_sample_sizes; }
+  const std::vector<std::uint32_t>& getSampleDurations() const { return m_sample_durations; }
+  const std::vector<std::uint32_t>& getKeySampleNumbers() const { return m_key_sample_numbers; }
+  const std::vector<shiguredo::mp4::track::ChunkInfo>& getChunkInfos() const { return m_chunk_infos; }
+
+ private:
+  void makeTkhdBoxInfo(shiguredo::mp4::BoxInfo*) override {}
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(bitrate_statistics) {
+  BOOST_TEST_MESSAGE("bitrate_statistics");
+  NullWriter writer;
+  TestTrack track(1000, 3.0f, &writer);
+  BOOST_REQUIRE_EQUAL(0, track.getBitrateStatistics().max_bitrate);
+
+  // 最初の 1 秒は 20ms 毎に 100 bytes, 次の 1 秒は 20ms 毎に 300 bytes, 最後の 1 秒は 20ms 毎に 200 bytes
+  std::vector<std::uint8_t> data(300);
+  for (std::uint64_t t = 0; t < 3000; t += 20) {
+    const std::size_t size = t < 1000 ? 100 : (t < 2000 ? 300 : 200);
+    track.addData(t, data.data(), size, true);
+  }
+  track.appendTrakBoxInfo(nullptr);
+
+  const auto statistics = track.getBitrateStatistics();
+  BOOST_REQUIRE_EQUAL(300 * 8 * 50, statistics.max_bitrate);
+  BOOST_REQUIRE_EQUAL(200 * 8 * 50, statistics.avg_bitrate);
+  BOOST_REQUIRE_EQUAL(300, statistics.buffer_size);
+}
+
+BOOST_AUTO_TEST_CASE(bitrate_statistics_short_track) {
+  BOOST_TEST_MESSAGE("bitrate_statistics_short_track");
+  NullWriter writer;
+  TestTrack track(1000, 0.5f, &writer);
+  std::vector<std::uint8_t> data(100);
+  for (std::uint64_t t = 0; t < 500; t += 100) {
+    track.addData(t, data, true);
+  }
+  track.appendTrakBoxInfo(nullptr);
+
+  // 1 秒に満たないトラックでは最大ビットレートは平均ビットレートになる
+  const auto statistics = track.getBitrateStatistics();
+  BOOST_REQUIRE_EQUAL(100 * 8 * 10, statistics.avg_bitrate);
+  BOOST_REQUIRE_EQUAL(statistics.avg_bitrate, statistics.max_bitrate);
+  BOOST_REQUIRE_EQUAL(100, statistics.buffer_size);
+}
+
+BOOST_AUTO_TEST_CASE(bitrate_statistics_burst) {
+  BOOST_TEST_MESSAGE("bitrate_statistics_burst");
+  NullWriter writer;
+  TestTrack track(1000, 3.0f, &writer);
+  // 100ms 毎のサンプルで, 1 秒毎に 1000 bytes のサンプルが 2 つ続き, 残りは 100 bytes
+  std::vector<std::uint8_t> data(1000);
+  for (std::uint64_t t = 0; t < 3000; t += 100) {
+    const std::size_t size = t % 1000 < 200 ? 1000 : 100;
+    track.addData(t, data.data(), size, true);
+  }
+  track.appendTrakBoxInfo(nullptr);
+
+  // 100ms 毎に 2800 * 8 bps で 280 bytes 減るので, 2 つ目の 1000 bytes のサンプルで 1000 - 280 + 1000 bytes になる
+  const auto statistics = track.getBitrateStatistics();
+  BOOST_REQUIRE_EQUAL(2800 * 8, statistics.max_bitrate);
+  BOOST_REQUIRE_EQUAL(1720, statistics.buffer_size);
+}
+
+BOOST_AUTO_TEST_CASE(add_samples) {
+  BOOST_TEST_MESSAGE("add_samples");
+  std::vector<std::uint8_t> data(256);
+  for (std::size_t i = 0; i < std::size(data); ++i) {
+    data[i] = static_cast<std::uint8_t>(i);
+  }
+  std::vector<shiguredo::mp4::track::Sample> samples;
+  for (std::uint64_t i = 0; i < 20; ++i) {
+    samples.push_back(
+        {.timestamp = i * 33, .data = data.data() + i, .size = static_cast<std::size_t>(10 + i), .is_key = i % 10 == 0});
+  }
+
+  NullWriter expected_writer;
+  TestTrack expected(1000, 1.0f, &expected_writer, shiguredo::mp4::track::HandlerType::vide);
+  for (std::size_t i = 0; i < std::size(samples); ++i) {
+    if (i == 12) {
+      expected.terminateChunk();
+    }
+    expected.addData(samples[i].timestamp, samples[i].data, samples[i].size, samples[i].is_key);
+  }
+  expected.appendTrakBoxInfo(nullptr);
+
+  NullWriter actual_writer;
+  TestTrack actual(1000, 1.0f, &actual_writer, shiguredo::mp4::track::HandlerType::vide);
+  const std::span<const shiguredo::mp4::track::Sample> all(samples);
+  actual.addSamples(all.first(5));
+  actual.addSamples(all.subspan(5, 7));
+  actual.terminateChunk();
+  actual.addSamples(all.subspan(12));
+  actual.addSamples({});
+  actual.appendTrakBoxInfo(nullptr);
+
+  BOOST_REQUIRE(expected_writer.getData() == actual_writer.getData());
+  BOOST_REQUIRE(expected.getSampleSizes() == actual.getSampleSizes());
+  BOOST_REQUIRE(expected.getSampleDurations() == actual.getSampleDurations());
+  BOOST_REQUIRE(expected.getKeySampleNumbers() == actual.getKeySampleNumbers());
+  const std::vector<std::uint32_t> expected_key_sample_numbers = {1, 11};
+  BOOST_REQUIRE(expected_key_sample_numbers == actual.getKeySampleNumbers());
+  BOOST_REQUIRE_EQUAL(2, std::size(actual.getChunkInfos()));
+  for (std::size_t i = 0; i < 2; ++i) {
+    BOOST_REQUIRE_EQUAL(expected.getChunkInfos()[i].offset, actual.getChunkInfos()[i].offset);
+    BOOST_REQUIRE_EQUAL(expected.getChunkInfos()[i].number_of_samples, actual.getChunkInfos()[i].number_of_samples);
+  }
+  BOOST_REQUIRE_EQUAL(expected.getBitrateStatistics().max_bitrate, actual.getBitrateStatistics().max_bitrate);
+  BOOST_REQUIRE_EQUAL(expected.getBitrateStatistics().avg_bitrate, actual.getBitrateStatistics().avg_bitrate);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "shiguredo/mp4/track/vpx.hpp"
+
+BOOST_AUTO_TEST_SUITE(vpx)
+
+struct ParseFrameHeaderTestCase {
+  const std::string name;
+  const std::vector<std::uint8_t> data;
+  const shiguredo::mp4::track::VPXFrameHeader header;
+};
+
+ParseFrameHeaderTestCase parse_vp8_frame_header_test_cases[] = {
+    {
+        "key frame",
+        {0xb0, 0x53, 0x00, 0x9d, 0x01, 0x2a, 0x80, 0x02, 0xf0, 0x00},
+        {.is_key = true, .width = 640, .height = 240},
+    },
+    {
+        "key frame: scaled",
+        {0x50, 0x42, 0x00, 0x9d, 0x01, 0x2a, 0x80, 0x42, 0xe0, 0x81},
+        {.is_key = true, .width = 640, .height = 480},
+    },
+    {
+        "inter frame",
+        {0xb1, 0x39, 0x00},
+        {.is_key = false},
+    },
+    {
+        "inter frame: version 1",
+        {0x33, 0x39, 0x00},
+        {.is_key = false, .profile = 1},
+    },
+};
+
+BOOST_AUTO_TEST_CASE(parse_vp8_frame_header) {
+  BOOST_TEST_MESSAGE("parse_vp8_frame_header");
+  for (const auto& tc : parse_vp8_frame_header_test_cases) {
+    BOOST_TEST_MESSAGE(tc.name);
+    shiguredo::mp4::track::VPXFrameHeader header;
+    BOOST_REQUIRE(shiguredo::mp4::track::parse_vp8_frame_header(&header, tc.data.data(), tc.data.size()));
+    BOOST_REQUIRE_EQUAL(tc.header, header);
+  }
+}
+
+ParseFrameHeaderTestCase parse_vp9_frame_header_test_cases[] = {
+    {
+        "profile 0 key frame",
+        {0x82, 0x49, 0x83, 0x42, 0x00, 0x27, 0xf0, 0x0e, 0xf6},
+        {.is_key = true, .width = 640, .height = 240},
+    },
+    {
+        "profile 0 inter frame",
+        {0x86, 0x00, 0x40, 0x92},
+        {.is_key = false},
+    },
+    {
+        "profile 2 key frame: 10bit BT.709 full range",
+        {0x92, 0x49, 0x83, 0x42, 0x28, 0x27, 0xf8, 0x16, 0x78},
+        {.is_key = true,
+         .profile = 2,
+         .bit_depth = 10,
+         .video_full_range_flag = 1,
+         .matrix_coefficients = 1,
+         .width = 1280,
+         .height = 720},
+    },
+    {
+        "profile 1 key frame: RGB",
+        {0xa2, 0x49, 0x83, 0x42, 0xe0, 0x13, 0xf0, 0x0b, 0x30},
+        {.is_key = true,
+         .profile = 1,
+         .chroma_sub_sampling = 3,
+         .video_full_range_flag = 1,
+         .colour_primaries = 1,
+         .transfer_characteristics = 13,
+         .matrix_coefficients = 0,
+         .width = 320,
+         .height = 180},
+    },
+    {
+        "profile 1 key frame: 4:2:2 BT.601",
+        {0xa2, 0x49, 0x83, 0x42, 0x28, 0x02, 0x7e, 0x01, 0x66},
+        {.is_key = true,
+         .profile = 1,
+         .chroma_sub_sampling = 2,
+         .matrix_coefficients = 5,
+         .width = 320,
+         .height = 180},
+    },
+    {
+        "profile 3 key frame: 12bit 4:4:4 SMPTE 170",
+        {0xb1, 0x24, 0xc1, 0xa1, 0x58, 0x01, 0x3f, 0x80, 0xef, 0x80},
+        {.is_key = true,
+         .profile = 3,
+         .bit_depth = 12,
+         .chroma_sub_sampling = 3,
+         .matrix_coefficients = 6,
+         .width = 640,
+         .height = 480},
+    },
+    {
+        "show existing frame",
+        {0x88},
+        {.is_key = false},
+    },
+};
+
+BOOST_AUTO_TEST_CASE(parse_vp9_frame_header) {
+  BOOST_TEST_MESSAGE("parse_vp9_frame_header");
+  for (const auto& tc : parse_vp9_frame_header_test_cases) {
+    BOOST_TEST_MESSAGE(tc.name);
+    shiguredo::mp4::track::VPXFrameHeader header;
+    BOOST_REQUIRE(shiguredo::mp4::track::parse_vp9_frame_header(&header, tc.data.data(), tc.data.size()));
+    BOOST_REQUIRE_EQUAL(tc.header, header);
+  }
+}
+
+struct ParseFrameHeaderErrorTestCase {
+  const std::string name;
+  const std::vector<std::uint8_t> data;
+};
+
+ParseFrameHeaderErrorTestCase parse_vp9_frame_header_error_test_cases[] = {
+    {"empty", {}},
+    {"invalid frame marker", {0x02, 0x49, 0x83, 0x42, 0x00, 0x27, 0xf0, 0x0e, 0xf6}},
+    {"invalid sync code", {0x82, 0x49, 0x83, 0x43, 0x00, 0x27, 0xf0, 0x0e, 0xf6}},
+    {"truncated", {0x82, 0x49, 0x83, 0x42, 0x00, 0x27}},
+};
+
+BOOST_AUTO_TEST_CASE(parse_vp9_frame_header_error) {
+  BOOST_TEST_MESSAGE("parse_vp9_frame_header_error");
+  for (const auto& tc : parse_vp9_frame_header_error_test_cases) {
+    BOOST_TEST_MESSAGE(tc.name);
+    shiguredo::mp4::track::VPXFrameHeader header;
+    BOOST_REQUIRE(!shiguredo::mp4::track::parse_vp9_frame_header(&header, tc.data.data(), tc.data.size()));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()